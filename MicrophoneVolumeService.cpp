@@ -1,8 +1,5 @@
 #include <windows.h>
 #include <winsvc.h>
-#include <mmdeviceapi.h>
-#include <endpointvolume.h>
-#include <functiondiscoverykeys_devpkey.h>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -10,11 +7,36 @@
 #include <chrono>
 #include <comdef.h>
 #include <map>
+#include <memory>
+#include <vector>
 #include "version.h"
+#include "core/AsyncLogger.h"
+#include "core/BinaryEventLog.h"
+#include "core/Clock.h"
+#include "core/EventLoop.h"
+#include "core/FileLogSink.h"
+#include "core/LogRateLimiter.h"
+#include "core/Metrics.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/ProcessActivation.h"
+#include "core/ServiceConfig.h"
+#include "core/ServiceOptions.h"
+#include "core/SessionEnforcer.h"
+#include "core/StatusBlock.h"
+#include "core/Suspension.h"
+#include "core/WorkerPool.h"
+#include "win/ConfigWatcher.h"
+#include "win/EventLogSink.h"
+#include "win/MetricsPipe.h"
+#include "win/StatusMemory.h"
+#include "win/WasapiBackend.h"
+#include "win/WasapiSessions.h"
+#include "win/WmiProcessSource.h"
 
 #pragma comment(lib, "ole32.lib")
 #pragma comment(lib, "user32.lib")
 #pragma comment(lib, "advapi32.lib")
+#pragma comment(lib, "oleaut32.lib")
 
 // Constants
 #define SERVICE_NAME L"MicrophoneVolumeService"
@@ -24,249 +46,1118 @@
 // Global variables
 SERVICE_STATUS g_ServiceStatus = {0};
 SERVICE_STATUS_HANDLE g_StatusHandle = NULL;
-HANDLE g_ServiceStopEvent = INVALID_HANDLE_VALUE;
-DWORD g_IntervalSeconds = 2;           // Default interval
-std::wstring g_MicrophoneFilter = L""; // Microphone filter
-std::wstring g_LogFile = L"C:\\Windows\\Temp\\MicrophoneVolumeService.log";
+MicVol::ServiceOptions g_CommandLine; // Parsed from the command line, never changed afterwards
+MicVol::ServiceOptions g_Options;     // In effect: g_CommandLine overlaid with -config; worker thread once running
+std::unique_ptr<const MicVol::ServiceConfig> g_Config;      // In effect; worker thread once running
+MicVol::SnapshotSwap<MicVol::ServiceConfig> g_ConfigSwap;  // Reloaded configuration on its way to the worker
+ConfigWatcher g_ConfigWatcher;                              // Used with -config
 HANDLE g_EventLogHandle = NULL;
-std::map<std::wstring, float> g_LastVolumeState;  // Track last volume for each device
-bool g_UseEventLog = false;  // Option to use Windows Event Log instead of file
+MicVol::AsyncLogger g_Logger;  // Messages from every thread, written by a background thread
+MicVol::BinaryLogWriter g_BinaryLog; // Owned by the worker thread
+MicVol::SteadyClock g_Clock;
+
+// What the worker thread's event loop waits for
+enum LoopSource : uint32_t
+{
+    SourceNotification, // Volume, device and session notifications
+    SourceActivation,   // A -whenrunning process started or exited
+    SourceConfig,       // g_ConfigSwap holds a reloaded configuration
+    SourceControl       // A pause, power or session control arrived
+};
+
+enum LoopTimer : uint32_t
+{
+    TimerSweep,     // The -t sweep, when not adaptive
+    TimerCheck,     // The next device check the enforcer has scheduled
+    TimerSessions,  // The -t session endpoint refresh in adaptive mode
+    TimerLogSummary // The next summary of suppressed log lines
+};
+
+MicVol::EventLoop g_Loop(g_Clock); // Stopped by the control handler, run by the worker thread
+bool g_Enforcing = false;          // Worker thread
+WasapiBackend g_AudioBackend;
+
+// Turns what the enforcer does into log messages and binary log events
+class ServiceObserver : public MicVol::EnforcementObserver
+{
+public:
+    void OnSessionError(HRESULT hr) override;
+    void OnEnumerationError(HRESULT hr) override;
+    void OnDeviceNotificationsUnavailable() override;
+    void OnActiveDevicesChanged(size_t count) override;
+    void OnDeviceAdded(MicVol::DeviceHandle device, float volume) override;
+    void OnDeviceRemoved(MicVol::DeviceHandle device) override;
+    void OnDeviceRenamed(MicVol::DeviceHandle device) override;
+    void OnPolicyResolved(MicVol::DeviceHandle device) override;
+    void OnVolumeChanged(MicVol::DeviceHandle device, float oldVolume, float newVolume) override;
+    void OnVolumeAtTarget(MicVol::DeviceHandle device) override;
+    void OnVolumeCorrected(MicVol::DeviceHandle device, float oldVolume, float newVolume,
+                           MicVol::CorrectionSource source) override;
+    void OnCorrectionFailed(MicVol::DeviceHandle device, float oldVolume, float targetVolume, HRESULT hr,
+                            MicVol::CorrectionSource source) override;
+    void OnReadFailed(MicVol::DeviceHandle device, HRESULT hr, MicVol::CorrectionSource source) override;
+    void OnMuteCorrected(MicVol::DeviceHandle device, bool muted, HRESULT hr, MicVol::CorrectionSource source) override;
+    void OnWatchAttached(MicVol::DeviceHandle device) override;
+    void OnWatchFailed(MicVol::DeviceHandle device, HRESULT hr) override;
+    void OnTamperWarStarted(MicVol::DeviceHandle device) override;
+    void OnTamperWarEnded(MicVol::DeviceHandle device, uint32_t cycles, uint64_t durationMs) override;
+    void OnBreakerOpened(MicVol::DeviceHandle device, HRESULT hr, uint64_t retryInMs) override;
+    void OnBreakerClosed(MicVol::DeviceHandle device, uint64_t openForMs) override;
+    void OnCheckDropped(MicVol::DeviceHandle device) override;
+};
+
+ServiceObserver g_Observer;
+
+// Makes the device calls of sweeps and checks in parallel (-workers); its threads join the COM MTA
+MicVol::WorkerPool g_DevicePool([]() { CoInitializeEx(NULL, COINIT_MULTITHREADED); }, []() { CoUninitialize(); });
+
+MicVol::MicrophoneEnforcer g_Enforcer(g_AudioBackend, g_Clock, g_Observer, []() { g_Loop.Signal(SourceNotification); });  // Owned by the worker thread
+MicVol::LogRateLimiter g_LogLimiter;  // Limits the lines g_Observer writes per device, used on the worker thread
+
+// Logs what the -sessions enforcer does
+class SessionLogObserver : public MicVol::SessionObserver
+{
+public:
+    void OnEndpointWatchFailed(const std::wstring &endpointId, HRESULT hr) override;
+    void OnSessionTracked(MicVol::SessionHandle session) override;
+    void OnSessionEnded(MicVol::SessionHandle session) override;
+    void OnSessionCorrected(MicVol::SessionHandle session, float oldVolume, float newVolume) override;
+    void OnSessionMuteCorrected(MicVol::SessionHandle session, bool muted) override;
+    void OnSessionError(MicVol::SessionHandle session, HRESULT hr) override;
+};
+
+SessionLogObserver g_SessionObserver;
+WasapiSessionManager g_SessionManager;
+MicVol::SessionEnforcer g_SessionEnforcer(g_SessionManager, g_SessionObserver, []() { g_Loop.Signal(SourceNotification); });  // Owned by the worker thread, used with -sessions
+
+MicVol::MetricsRegistry g_Metrics; // Names the counters and histograms of g_Enforcer
+MicVol::MetricsFileExporter g_MetricsFile(g_Metrics); // Used with -metrics
+MetricsPipe g_MetricsPipe(g_Metrics);                  // Used with -metricspipe
+StatusMemory g_StatusMemory;       // Read by -status
+MicVol::StatusSnapshot g_Status;   // Reused by PublishStatus() on the worker thread
+
+WmiProcessSource g_ProcessSource;
+MicVol::ProcessActivation g_Activation(g_ProcessSource, []() { g_Loop.Signal(SourceActivation); });  // Owned by the worker thread, used with -whenrunning
+
+MicVol::SuspendController g_Suspend([]() { g_Loop.Signal(SourceControl); });  // Posted to by the control handler, updated by the worker thread
 
 // Functions for log management
-void WriteLog(const std::wstring &message, WORD eventType = EVENTLOG_INFORMATION_TYPE)
+void WriteLog(const std::wstring &message, MicVol::LogLevel level = MicVol::LogLevel::Information)
+{
+    // Queued for the background writer; never blocks on the file or the Event Log
+    g_Logger.Log(level, message);
+}
+
+void WriteErrorLog(const std::wstring &message)
+{
+    WriteLog(L"ERROR: " + message, MicVol::LogLevel::Error);
+}
+
+void WriteWarningLog(const std::wstring &message)
 {
-    if (g_UseEventLog && g_EventLogHandle)
+    WriteLog(L"WARNING: " + message, MicVol::LogLevel::Warning);
+}
+
+// Selects the log sink and starts the background writer
+void StartLogging()
+{
+    g_Logger.SetMinLevel(g_Options.logLevel);
+
+    bool eventLogFailed = false;
+    if (g_Options.useEventLog && g_EventLogHandle == NULL)
     {
-        // Write to Windows Event Log
-        LPCWSTR strings[] = { message.c_str() };
-        ReportEventW(g_EventLogHandle, eventType, 0, 0, NULL, 1, 0, strings, NULL);
+        g_EventLogHandle = RegisterEventSourceW(NULL, SERVICE_NAME);
+        if (g_EventLogHandle == NULL)
+        {
+            // Fall back to file logging if Event Log registration fails
+            g_Options.useEventLog = false;
+            eventLogFailed = true;
+        }
     }
+
+    if (g_Options.useEventLog)
+        g_Logger.SetSink(std::make_shared<EventLogSink>(g_EventLogHandle));
     else
     {
-        // Write to file
-        std::wofstream logFile(g_LogFile, std::ios::app);
-        if (logFile.is_open())
-        {
-            SYSTEMTIME st;
-            GetLocalTime(&st);
-            logFile << L"[" << st.wYear << L"-" 
-                    << (st.wMonth < 10 ? L"0" : L"") << st.wMonth << L"-"
-                    << (st.wDay < 10 ? L"0" : L"") << st.wDay << L" "
-                    << (st.wHour < 10 ? L"0" : L"") << st.wHour << L":"
-                    << (st.wMinute < 10 ? L"0" : L"") << st.wMinute << L":"
-                    << (st.wSecond < 10 ? L"0" : L"") << st.wSecond
-                    << L"] " << message << std::endl;
-            logFile.close();
-        }
+        MicVol::FileLogRotation rotation;
+        rotation.segmentBytes = (uint64_t)g_Options.logSegmentMb * 1024 * 1024;
+        rotation.segmentCount = g_Options.logSegmentCount;
+        g_Logger.SetSink(std::make_shared<MicVol::FileLogSink>(g_Options.logFile, rotation));
+    }
+
+    if (FAILED(g_Logger.Start()))
+    {
+        WriteWarningLog(L"Could not start the log writer thread, logging synchronously");
+    }
+
+    if (eventLogFailed)
+    {
+        WriteLog(L"Warning: Could not register Event Log source, falling back to file logging");
     }
 }
 
-void WriteErrorLog(const std::wstring &message)
+// Drains queued messages to the sink. Later messages are written synchronously.
+void StopLogging()
 {
-    WriteLog(L"ERROR: " + message, EVENTLOG_ERROR_TYPE);
+    g_Logger.Stop();
 }
 
-void WriteWarningLog(const std::wstring &message)
+// Ctrl+C in test mode: get queued messages to disk before the process is terminated
+BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlType)
 {
-    WriteLog(L"WARNING: " + message, EVENTLOG_WARNING_TYPE);
+    StopLogging();
+    return FALSE;
 }
 
-// Function to get current volume
-float GetCurrentVolume(IMMDevice *pDevice)
+// Opens the binary event log if one is configured
+void StartBinaryLog()
 {
-    IAudioEndpointVolume *pEndpointVolume = NULL;
-    float currentVolume = 0.0f;
-    
-    HRESULT hr = pDevice->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_ALL, NULL, (void **)&pEndpointVolume);
-    if (SUCCEEDED(hr))
+    if (g_Options.binaryLogFile.empty() || g_BinaryLog.IsOpen())
+        return;
+
+    HRESULT hr = g_BinaryLog.Open(g_Options.binaryLogFile, MicVol::WallClockMs());
+    if (hr == E_INVALIDARG)
     {
-        hr = pEndpointVolume->GetMasterVolumeLevelScalar(&currentVolume);
-        pEndpointVolume->Release();
+        WriteWarningLog(L"Binary log disabled, not a binary event log: " + g_Options.binaryLogFile);
     }
-    
-    return SUCCEEDED(hr) ? currentVolume : -1.0f;
+    else if (FAILED(hr))
+    {
+        WriteWarningLog(L"Binary log disabled, could not open: " + g_Options.binaryLogFile);
+    }
+}
+
+void StopBinaryLog()
+{
+    g_BinaryLog.Close();
 }
 
-// Function to set microphone volume
-HRESULT SetMicrophoneVolume(IMMDevice *pDevice, float volume)
+// Starts exporting metrics if -metrics or -metricspipe is set; both run on their own threads
+void StartMetrics()
 {
-    IAudioEndpointVolume *pEndpointVolume = NULL;
-    HRESULT hr = pDevice->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_ALL, NULL, (void **)&pEndpointVolume);
+    if (g_Options.metricsFile.empty() && !g_Options.metricsPipe)
+        return;
 
-    if (SUCCEEDED(hr))
+    static bool registered = false;
+    if (!registered)
     {
-        hr = pEndpointVolume->SetMasterVolumeLevelScalar(volume, NULL);
-        pEndpointVolume->Release();
+        MicVol::RegisterEnforcementMetrics(g_Metrics, g_Enforcer.Metrics());
+        g_Metrics.AddCounter("mvs_wakeups_total", "Times the worker thread woke to handle events or timers.",
+                             g_Loop.Wakeups());
+        g_Metrics.AddCounter("mvs_pool_steals_total", "Device checks taken over by an idle worker pool thread.",
+                             g_DevicePool.Steals());
+        g_Metrics.AddCounter("mvs_log_suppressed_total", "Repeated log lines of a device left out and summarized instead.",
+                             g_LogLimiter.Suppressed());
+        g_Metrics.AddCounter("mvs_pool_abandoned_total", "Device checks the worker stopped waiting for at the deadline.",
+                             g_DevicePool.Abandoned());
+        g_Metrics.AddCounter("mvs_pool_replaced_total", "Worker pool threads started in place of one stuck in a device call.",
+                             g_DevicePool.Replaced());
+        registered = true;
     }
 
-    return hr;
+    if (!g_Options.metricsFile.empty() && FAILED(g_MetricsFile.Start(g_Options.metricsFile, MetricsFileIntervalMs)))
+        WriteWarningLog(L"Metrics file disabled, could not start the exporter");
+    if (g_Options.metricsPipe && FAILED(g_MetricsPipe.Start()))
+        WriteWarningLog(L"Metrics pipe disabled, could not start the server");
 }
 
-// Function to get device name
-std::wstring GetDeviceName(IMMDevice *pDevice)
+void StopMetrics()
 {
-    IPropertyStore *pProps = NULL;
-    PROPVARIANT varName;
-    PropVariantInit(&varName);
-    std::wstring deviceName = L"Unknown";
+    g_MetricsPipe.Stop();
+    g_MetricsFile.Stop();
+    if (!g_Options.metricsFile.empty() && FAILED(g_MetricsFile.LastResult()))
+        WriteWarningLog(L"Could not write the metrics file: " + g_Options.metricsFile);
+}
 
-    HRESULT hr = pDevice->OpenPropertyStore(STGM_READ, &pProps);
-    if (SUCCEEDED(hr))
+// Creates the shared status block read by -status
+void StartStatus()
+{
+    HRESULT hr = g_StatusMemory.Create();
+    if (FAILED(hr))
     {
-        hr = pProps->GetValue(PKEY_Device_FriendlyName, &varName);
-        if (SUCCEEDED(hr))
-        {
-            deviceName = varName.pwszVal;
-        }
-        PropVariantClear(&varName);
-        pProps->Release();
+        WriteWarningLog(L"Status for -status unavailable, shared memory error: " + std::to_wstring(hr));
+        return;
     }
 
-    return deviceName;
+    g_Status = MicVol::StatusSnapshot();
+    g_Status.processId = GetCurrentProcessId();
+    g_Status.startedWallMs = MicVol::WallClockMs();
+    g_Status.mode = (g_Options.useEvents ? MicVol::StatusModeEvents : 0) |
+                    (g_Options.adaptive ? MicVol::StatusModeAdaptive : 0) |
+                    (g_Options.enforceSessions ? MicVol::StatusModeSessions : 0) |
+                    (g_Options.activationProcesses.empty() ? 0 : MicVol::StatusModeWhenRunning);
 }
 
-// Main function for working with microphones
-void ProcessMicrophones()
+// Publishes a snapshot before the worker waits; nextMs is when it wakes up on its own
+void PublishStatus(MicVol::ServiceState state, uint64_t nextMs)
 {
-    HRESULT hr = CoInitialize(NULL);
-    if (FAILED(hr))
+    MicVol::SeqLockedStatus *shared = g_StatusMemory.Status();
+    if (!shared)
+        return;
+
+    uint64_t now = g_Clock.NowMs();
+    MicVol::CaptureStatus(g_Enforcer, now, MicVol::WallClockMs(), g_Status);
+    g_Status.state = (uint8_t)state;
+    g_Status.nextWakeInMs = nextMs == MicVol::TimerWheel::Never ? -1 : nextMs > now ? (int64_t)(nextMs - now) : 0;
+    shared->Write(g_Status);
+}
+
+void StopStatus()
+{
+    PublishStatus(MicVol::ServiceState::Stopped, MicVol::TimerWheel::Never);
+    g_StatusMemory.Close();
+}
+
+// -status: prints the snapshot the running service published
+int PrintStatus()
+{
+    StatusMemory memory;
+    if (FAILED(memory.OpenForReading()))
+    {
+        std::wcout << L"Service is not running (no status published)" << std::endl;
+        return 1;
+    }
+
+    MicVol::StatusSnapshot status;
+    if (!memory.Status()->Read(status))
+    {
+        std::wcout << L"Status is being updated continuously, try again" << std::endl;
+        return 1;
+    }
+    if (status.magic != MicVol::StatusMagic || status.version != MicVol::StatusVersion)
+    {
+        std::wcout << L"Service has not published a status yet, or is another version" << std::endl;
+        return 1;
+    }
+
+    std::wcout << MicVol::FormatStatus(status, MicVol::WallClockMs());
+    return status.state == (uint8_t)MicVol::ServiceState::Stopped ? 1 : 0;
+}
+
+static void LogRulesError(const MicVol::ServiceConfig &config)
+{
+    const std::wstring &path = config.options.rulesFile;
+    WriteErrorLog(config.rulesErrorLine > 0 ? L"Invalid rule in " + path + L" line " + std::to_wstring(config.rulesErrorLine)
+                                            : L"Cannot read rules file: " + path);
+}
+
+// Watcher thread: builds the changed configuration and hands it to the worker
+void ReloadConfig()
+{
+    std::unique_ptr<MicVol::ServiceConfig> config = MicVol::BuildServiceConfig(g_CommandLine);
+    if (FAILED(config->configResult))
     {
-        WriteErrorLog(L"COM initialization error: " + std::to_wstring(hr));
+        WriteWarningLog(L"Cannot read configuration file " + g_CommandLine.configFile + L", keeping the current settings");
         return;
     }
+    g_ConfigSwap.Publish(std::move(config));
+    g_Loop.Signal(SourceConfig);
+}
 
-    IMMDeviceEnumerator *pEnumerator = NULL;
-    hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL,
-                          __uuidof(IMMDeviceEnumerator), (void **)&pEnumerator);
+// Watches the -config file and the rules file in effect; SERVICE_CONTROL_PARAMCHANGE
+// reloads them on request
+void StartConfigWatch()
+{
+    if (g_CommandLine.configFile.empty())
+        return;
 
+    HRESULT hr = g_ConfigWatcher.Start(g_Config->options, ReloadConfig);
     if (FAILED(hr))
+        WriteWarningLog(L"Configuration changes are not detected, directory watch error: " + std::to_wstring(hr));
+}
+
+void StopConfigWatch()
+{
+    g_ConfigWatcher.Stop();
+}
+
+// Worker thread: swaps in a configuration published by ReloadConfig(). Device state and
+// cached endpoints are kept; only the policy is resolved again. Returns true when the
+// loops have to react (the interval, filter, rules or schedule changed).
+bool ApplyPendingConfig()
+{
+    std::unique_ptr<const MicVol::ServiceConfig> next = g_ConfigSwap.Take();
+    if (!next)
+        return false;
+
+    // A rules file that fails to load (e.g. half saved) keeps the rules in effect
+    if (FAILED(next->rulesResult))
+    {
+        LogRulesError(*next);
+        std::unique_ptr<MicVol::ServiceConfig> kept(new MicVol::ServiceConfig(*next));
+        kept->rules = g_Config->rules;
+        kept->options.rulesFile = g_Config->options.rulesFile;
+        next = std::move(kept);
+    }
+
+    std::wstring restartOptions;
+    uint32_t changes = MicVol::CompareConfigs(*g_Config, *next, restartOptions);
+    const MicVol::ServiceOptions &options = next->options;
+    std::wstring summary;
+
+    if (changes & MicVol::ConfigChangeInterval)
+    {
+        g_Options.intervalSeconds = options.intervalSeconds;
+        summary += L" interval " + std::to_wstring(options.intervalSeconds) + L" sec.";
+    }
+    if (changes & MicVol::ConfigChangeFilter)
+    {
+        g_Options.microphoneFilter = options.microphoneFilter;
+        g_Enforcer.SetFilter(options.microphoneFilter);
+        summary += L" filter " + (options.microphoneFilter.empty() ? L"(all microphones)" : options.microphoneFilter) + L".";
+    }
+    bool rulesFileChanged = false;
+    if (changes & MicVol::ConfigChangeRules)
+    {
+        rulesFileChanged = g_Options.rulesFile != options.rulesFile;
+        g_Options.rulesFile = options.rulesFile;
+        g_Enforcer.SetRules(next->rules);
+        g_SessionEnforcer.SetRules(next->rules);
+        summary += L" " + std::to_wstring(next->rules.size()) + L" policy rules.";
+    }
+    if (changes & MicVol::ConfigChangeFightStrategy)
+    {
+        g_Options.fightStrategy = options.fightStrategy;
+        MicVol::TamperWarOptions fight;
+        fight.strategy = options.fightStrategy;
+        g_Enforcer.SetTamperWarOptions(fight);
+        summary += L" fight strategy changed.";
+    }
+    if (changes & MicVol::ConfigChangeSchedule)
+    {
+        g_Options.minIntervalMs = options.minIntervalMs;
+        g_Options.maxIntervalMs = options.maxIntervalMs;
+        if (g_Options.adaptive)
+        {
+            MicVol::CheckSchedule schedule;
+            schedule.minIntervalMs = options.minIntervalMs;
+            schedule.maxIntervalMs = options.maxIntervalMs;
+            g_Enforcer.EnableAdaptiveSchedule(schedule);
+        }
+        summary += L" adaptive intervals " + std::to_wstring(options.minIntervalMs) + L"-" +
+                   std::to_wstring(options.maxIntervalMs) + L" ms.";
+    }
+    if (changes & MicVol::ConfigChangeDeadline)
+    {
+        g_Options.callDeadlineMs = options.callDeadlineMs;
+        g_Enforcer.SetCallDeadline(options.callDeadlineMs);
+        summary += L" device call deadline " + std::to_wstring(options.callDeadlineMs) + L" ms.";
+    }
+    if (changes & MicVol::ConfigChangeLogLevel)
+    {
+        static const wchar_t *const levels[] = {L"info", L"warning", L"error"};
+        summary += std::wstring(L" log level ") + levels[(int)options.logLevel] + L".";
+    }
+    if (!summary.empty())
+        WriteLog(L"Configuration reloaded:" + summary);
+    if (changes & MicVol::ConfigChangeRestart)
+        WriteWarningLog(L"Configuration changes to " + restartOptions + L" take effect when the service restarts");
+
+    // After the summary, so raising the level does not hide it
+    if (changes & MicVol::ConfigChangeLogLevel)
+    {
+        g_Options.logLevel = options.logLevel;
+        g_Logger.SetMinLevel(options.logLevel);
+    }
+
+    // Restart-only options stay as the run started with them
+    g_Config = std::move(next);
+
+    // The watch follows the rules file to its directory
+    if (rulesFileChanged)
     {
-        WriteErrorLog(L"Device Enumerator creation error: " + std::to_wstring(hr));
-        CoUninitialize();
+        StopConfigWatch();
+        StartConfigWatch();
+    }
+    return (changes & ~MicVol::ConfigChangeRestart) != 0;
+}
+
+// Appends one record to the binary event log; no-op unless -binlog is set
+void RecordEvent(MicVol::EventType type, MicVol::DeviceHandle device, float oldVolume = 0.0f, float newVolume = 0.0f,
+                 HRESULT hr = S_OK, MicVol::WriterKind writer = MicVol::WriterKind::Unknown, uint32_t count = 0)
+{
+    if (!g_BinaryLog.IsOpen())
         return;
+
+    if (device != MicVol::InvalidDeviceHandle && !g_BinaryLog.IsDescribed(device))
+    {
+        g_BinaryLog.Describe(device, g_Enforcer.Devices().EndpointId(device), g_Enforcer.Session().GetName(device));
+    }
+
+    MicVol::EventRecord record = {};
+    record.timestampMs = MicVol::WallClockMs();
+    record.device = device;
+    record.type = (uint16_t)type;
+    record.writer = (uint16_t)writer;
+    record.oldVolume = oldVolume;
+    record.newVolume = newVolume;
+    record.hr = hr;
+    record.count = count;
+    g_BinaryLog.Append(record);
+}
+
+// " (changed by application)" for a correction of a foreign change, empty when the writer is not known
+// A literal, so deferred log messages can carry it
+static const wchar_t *ChangedBy(MicVol::WriterKind writer)
+{
+    switch (writer)
+    {
+    case MicVol::WriterKind::Service:
+        return L" (changed by service)";
+    case MicVol::WriterKind::Unidentified:
+        return L" (changed by unidentified writer)";
+    case MicVol::WriterKind::Application:
+        return L" (changed by application)";
+    default:
+        return L"";
     }
+}
+
+static const std::wstring &DeviceName(MicVol::DeviceHandle device)
+{
+    return g_Enforcer.Session().GetName(device);
+}
+
+static std::wstring Percent(float level)
+{
+    return std::to_wstring((int)(level * 100 + 0.5f)) + L"%";
+}
+
+// Checked before a line that can repeat every check is queued. A suppressed line arms
+// the summary timer, so the summary is logged on time even if nothing else happens.
+static bool LogAllowed(MicVol::DeviceHandle device, MicVol::LogKind kind,
+                       MicVol::LogLevel level = MicVol::LogLevel::Information)
+{
+    if (!g_Logger.Enabled(level))
+        return false;
+    if (g_LogLimiter.Allow(device, kind, g_Clock.NowMs()))
+        return true;
+
+    uint64_t summaryMs = g_LogLimiter.NextSummaryMs();
+    if (g_Loop.DueMs(TimerLogSummary) != summaryMs)
+        g_Loop.Schedule(TimerLogSummary, summaryMs);
+    return false;
+}
+
+// 1243567 -> "1,243,567"
+static std::wstring GroupDigits(uint64_t value)
+{
+    std::wstring digits = std::to_wstring(value);
+    for (size_t i = digits.size(); i > 3; i -= 3)
+        digits.insert(i - 3, L",");
+    return digits;
+}
 
-    IMMDeviceCollection *pCollection = NULL;
-    hr = pEnumerator->EnumAudioEndpoints(eCapture, DEVICE_STATE_ACTIVE, &pCollection);
+// Logs the summaries of suppressed lines that are due, or with all every pending one
+static void LogSuppressedSummary(const MicVol::LogSummary &summary)
+{
+    uint64_t minutes = (summary.periodMs + 30000) / 60000;
+    std::wstring period = minutes > 0 ? std::to_wstring(minutes) + L" min" : std::to_wstring(summary.periodMs / 1000) + L" s";
+    WriteLog(std::wstring(MicVol::LogKindName(summary.kind)) + L" for " + DeviceName(summary.device) + L": suppressed " +
+             GroupDigits(summary.suppressed) + L" identical events in the last " + period);
+}
+
+static void LogSuppressedSummaries(bool all)
+{
+    MicVol::LogSummary summary;
+    while (g_LogLimiter.NextSummary(g_Clock.NowMs(), summary, all))
+        LogSuppressedSummary(summary);
+}
+
+void ServiceObserver::OnSessionError(HRESULT hr)
+{
+    WriteErrorLog(L"Audio session initialization error: " + std::to_wstring(hr));
+}
+
+void ServiceObserver::OnEnumerationError(HRESULT hr)
+{
+    WriteErrorLog(L"Audio devices enumeration error: " + std::to_wstring(hr));
+}
+
+void ServiceObserver::OnDeviceNotificationsUnavailable()
+{
+    WriteWarningLog(L"Device change notifications unavailable, devices are re-enumerated every check");
+}
+
+void ServiceObserver::OnActiveDevicesChanged(size_t count)
+{
+    WriteLog(L"Active microphones found: " + std::to_wstring(count));
+}
+
+void ServiceObserver::OnDeviceAdded(MicVol::DeviceHandle device, float volume)
+{
+    g_Logger.Names().Set(device, DeviceName(device));
+    WriteLog(L"New microphone detected: " + DeviceName(device) +
+             L" (current volume: " + std::to_wstring((int)(volume * 100)) + L"%)");
+    RecordEvent(MicVol::EventType::DeviceAdded, device, -1.0f, volume);
+}
+
+void ServiceObserver::OnDeviceRemoved(MicVol::DeviceHandle device)
+{
+    // Its suppressed lines are reported now; if it comes back, under the same handle,
+    // its lines start with a full burst
+    MicVol::LogSummary summary;
+    while (g_LogLimiter.TakeSummary(device, g_Clock.NowMs(), summary))
+        LogSuppressedSummary(summary);
+    g_LogLimiter.Forget(device);
+    WriteLog(L"Microphone removed: " + DeviceName(device));
+    RecordEvent(MicVol::EventType::DeviceRemoved, device);
+}
+
+void ServiceObserver::OnDeviceRenamed(MicVol::DeviceHandle device)
+{
+    g_Logger.Names().Set(device, DeviceName(device));
+    if (g_BinaryLog.IsOpen())
+    {
+        g_BinaryLog.Describe(device, g_Enforcer.Devices().EndpointId(device), DeviceName(device));
+    }
+}
 
+void ServiceObserver::OnPolicyResolved(MicVol::DeviceHandle device)
+{
+    const MicVol::DeviceSlot &slot = g_Enforcer.Devices().Slot(device);
+    std::wstring rule = slot.policyRule < 0 ? L"default" : L"rule " + std::to_wstring(slot.policyRule + 1);
+    if (!slot.enforced)
+    {
+        WriteLog(L"Policy for " + DeviceName(device) + L": not enforced (" + rule + L")");
+        return;
+    }
+
+    const wchar_t *mute = slot.mute == MicVol::MutePolicy::Mute     ? L", keep muted"
+                          : slot.mute == MicVol::MutePolicy::Unmute ? L", keep unmuted"
+                                                                    : L"";
+    WriteLog(L"Policy for " + DeviceName(device) + L": volume " + Percent(slot.targetVolume) + L" +/- " +
+             Percent(slot.tolerance) + mute + L" (" + rule + L")");
+}
+
+void ServiceObserver::OnVolumeChanged(MicVol::DeviceHandle device, float oldVolume, float newVolume)
+{
+    // The rounds of a tamper war are summarized when it ends
+    if (g_Enforcer.InTamperWar(device))
+        return;
+    if (LogAllowed(device, MicVol::LogKind::VolumeChanged))
+        MVS_LOG_INFO(g_Logger, L"Volume changed for {}: {} -> {}", MicVol::LogArg::Device(device),
+                     MicVol::LogArg::Percent(oldVolume), MicVol::LogArg::Percent(newVolume));
+    RecordEvent(MicVol::EventType::VolumeChanged, device, oldVolume, newVolume);
+}
+
+void ServiceObserver::OnVolumeAtTarget(MicVol::DeviceHandle device)
+{
+    MVS_LOG_INFO(g_Logger, L"Volume already at {} for: {}",
+                 MicVol::LogArg::Percent(g_Enforcer.Devices().Slot(device).targetVolume), MicVol::LogArg::Device(device));
+}
+
+void ServiceObserver::OnVolumeCorrected(MicVol::DeviceHandle device, float oldVolume, float newVolume,
+                                        MicVol::CorrectionSource source)
+{
+    if (g_Enforcer.InTamperWar(device))
+        return;
+
+    MicVol::WriterKind writer = MicVol::WriterKind::Unknown;
+    if (source == MicVol::CorrectionSource::Notification)
+        writer = g_Enforcer.Devices().Slot(device).lastWriter;
+
+    if (LogAllowed(device, MicVol::LogKind::VolumeCorrected))
+    {
+        if (source == MicVol::CorrectionSource::Notification)
+            MVS_LOG_INFO(g_Logger, L"Volume changed for {}: {}, corrected to {}{}", MicVol::LogArg::Device(device),
+                         MicVol::LogArg::Percent(oldVolume), MicVol::LogArg::Percent(newVolume), ChangedBy(writer));
+        else
+            MVS_LOG_INFO(g_Logger, L"Volume corrected to {} for: {}", MicVol::LogArg::Percent(newVolume),
+                         MicVol::LogArg::Device(device));
+    }
+    RecordEvent(MicVol::EventType::VolumeCorrected, device, oldVolume, newVolume, S_OK, writer);
+}
+
+void ServiceObserver::OnCorrectionFailed(MicVol::DeviceHandle device, float oldVolume, float targetVolume, HRESULT hr,
+                                         MicVol::CorrectionSource source)
+{
+    // A failed probe of a device with an open breaker was already reported when it opened
+    if (!g_Enforcer.Breakers().IsOpen(device) &&
+        LogAllowed(device, MicVol::LogKind::CorrectionFailed, MicVol::LogLevel::Error))
+        MVS_LOG_ERROR(g_Logger, L"ERROR: Volume setting error for {}: {}", MicVol::LogArg::Device(device), hr);
+    RecordEvent(MicVol::EventType::CorrectionFailed, device, oldVolume, targetVolume, hr);
+}
+
+void ServiceObserver::OnReadFailed(MicVol::DeviceHandle device, HRESULT hr, MicVol::CorrectionSource source)
+{
+    // A failed read in a sweep is followed by a correction attempt, which logs if it fails too;
+    // a timed out check is not
+    if (source == MicVol::CorrectionSource::Notification)
+    {
+        if (LogAllowed(device, MicVol::LogKind::CorrectionFailed, MicVol::LogLevel::Error))
+            MVS_LOG_ERROR(g_Logger, L"ERROR: Volume setting error for {}: {}", MicVol::LogArg::Device(device), hr);
+    }
+    else if (hr == MicVol::MVS_E_CALL_TIMEOUT && !g_Enforcer.Breakers().IsOpen(device) &&
+             LogAllowed(device, MicVol::LogKind::CallTimeout, MicVol::LogLevel::Error))
+    {
+        MVS_LOG_ERROR(g_Logger, L"ERROR: Device calls timed out after {} ms for {}", g_Enforcer.CallDeadline(),
+                      MicVol::LogArg::Device(device));
+    }
+    RecordEvent(MicVol::EventType::ReadFailed, device, g_Enforcer.Devices().Slot(device).lastVolume, -1.0f, hr);
+}
+
+void ServiceObserver::OnMuteCorrected(MicVol::DeviceHandle device, bool muted, HRESULT hr,
+                                      MicVol::CorrectionSource source)
+{
+    if (SUCCEEDED(hr) && g_Enforcer.InTamperWar(device))
+        return;
+
+    MicVol::WriterKind writer = source == MicVol::CorrectionSource::Notification
+                                    ? g_Enforcer.Devices().Slot(device).lastWriter
+                                    : MicVol::WriterKind::Unknown;
     if (SUCCEEDED(hr))
     {
-        UINT count;
-        hr = pCollection->GetCount(&count);
+        if (LogAllowed(device, MicVol::LogKind::MuteCorrected))
+            MVS_LOG_INFO(g_Logger, L"Microphone {}: {}{}", muted ? L"muted" : L"unmuted", MicVol::LogArg::Device(device),
+                         ChangedBy(writer));
+    }
+    else if (LogAllowed(device, MicVol::LogKind::MuteFailed, MicVol::LogLevel::Error))
+    {
+        MVS_LOG_ERROR(g_Logger, L"ERROR: Mute setting error for {}: {}", MicVol::LogArg::Device(device), hr);
+    }
+}
 
-        if (SUCCEEDED(hr))
-        {
-            // Only log device count on first run or when count changes
-            static UINT lastDeviceCount = 0;
-            static bool firstRun = true;
-            
-            if (firstRun || count != lastDeviceCount)
-            {
-                WriteLog(L"Active microphones found: " + std::to_wstring(count));
-                lastDeviceCount = count;
-                firstRun = false;
-            }
+void ServiceObserver::OnTamperWarStarted(MicVol::DeviceHandle device)
+{
+    const wchar_t *strategy = g_Options.fightStrategy == MicVol::FightStrategy::Backoff
+                                  ? L"backing off between corrections"
+                                  : L"verifying closely after each correction";
+    WriteLog(L"Another application keeps changing the volume of " + DeviceName(device) + L"; " + strategy +
+             L" and logging a summary when it stops");
+    RecordEvent(MicVol::EventType::TamperWarStarted, device);
+}
 
-            for (UINT i = 0; i < count; i++)
-            {
-                IMMDevice *pDevice = NULL;
-                hr = pCollection->Item(i, &pDevice);
-
-                if (SUCCEEDED(hr))
-                {
-                    std::wstring deviceName = GetDeviceName(pDevice);
-
-                    // Check microphone filter
-                    bool shouldProcess = g_MicrophoneFilter.empty() ||
-                                         deviceName.find(g_MicrophoneFilter) != std::wstring::npos;
-
-                    if (shouldProcess)
-                    {
-                        // Get current volume before setting
-                        float currentVolume = GetCurrentVolume(pDevice);
-                        const float targetVolume = 1.0f; // 100%
-                        const float tolerance = 0.01f;   // 1% tolerance to avoid floating point issues
-                        
-                        // Check if volume has changed significantly
-                        bool volumeChanged = false;
-                        auto it = g_LastVolumeState.find(deviceName);
-                        
-                        if (it == g_LastVolumeState.end())
-                        {
-                            // First time seeing this device
-                            g_LastVolumeState[deviceName] = currentVolume;
-                            volumeChanged = true;
-                            WriteLog(L"New microphone detected: " + deviceName + 
-                                    L" (current volume: " + std::to_wstring((int)(currentVolume * 100)) + L"%)");
-                        }
-                        else if (std::abs(currentVolume - it->second) > tolerance)
-                        {
-                            // Volume has changed since last check
-                            volumeChanged = true;
-                            WriteLog(L"Volume changed for " + deviceName + 
-                                    L": " + std::to_wstring((int)(it->second * 100)) + L"% -> " + 
-                                    std::to_wstring((int)(currentVolume * 100)) + L"%");
-                            g_LastVolumeState[deviceName] = currentVolume;
-                        }
-
-                        // Set volume to 100% if it's not already there
-                        if (std::abs(currentVolume - targetVolume) > tolerance)
-                        {
-                            hr = SetMicrophoneVolume(pDevice, targetVolume);
-
-                            if (SUCCEEDED(hr))
-                            {
-                                WriteLog(L"Volume corrected to 100% for: " + deviceName);
-                                g_LastVolumeState[deviceName] = targetVolume;
-                            }
-                            else
-                            {
-                                WriteErrorLog(L"Volume setting error for " + deviceName +
-                                             L": " + std::to_wstring(hr));
-                            }
-                        }
-                        else if (volumeChanged)
-                        {
-                            // Volume was already at 100%, but we detected a device or want to log the state
-                            WriteLog(L"Volume already at 100% for: " + deviceName);
-                        }
-                    }
-
-                    pDevice->Release();
-                }
-            }
-        }
-        pCollection->Release();
+void ServiceObserver::OnTamperWarEnded(MicVol::DeviceHandle device, uint32_t cycles, uint64_t durationMs)
+{
+    WriteLog(L"Volume fight over for " + DeviceName(device) + L": " + std::to_wstring(cycles) + L" corrections in " +
+             std::to_wstring(durationMs / 1000) + L" s");
+    RecordEvent(MicVol::EventType::TamperWarEnded, device, 0.0f, 0.0f, S_OK, MicVol::WriterKind::Unknown, cycles);
+}
+
+void ServiceObserver::OnBreakerOpened(MicVol::DeviceHandle device, HRESULT hr, uint64_t retryInMs)
+{
+    WriteErrorLog(DeviceName(device) + L" keeps failing (" + std::to_wstring(hr) + L"); skipping it and retrying in " +
+                  std::to_wstring(retryInMs / 1000) + L" s, then less and less often");
+}
+
+void ServiceObserver::OnBreakerClosed(MicVol::DeviceHandle device, uint64_t openForMs)
+{
+    WriteLog(DeviceName(device) + L" works again after failing for " + std::to_wstring(openForMs / 1000) + L" s");
+}
+
+void ServiceObserver::OnCheckDropped(MicVol::DeviceHandle device)
+{
+    if (LogAllowed(device, MicVol::LogKind::CheckDropped, MicVol::LogLevel::Error))
+        MVS_LOG_ERROR(g_Logger, L"ERROR: Every worker thread is stuck in a device call, {} was not checked",
+                      MicVol::LogArg::Device(device));
+}
+
+void ServiceObserver::OnWatchAttached(MicVol::DeviceHandle device)
+{
+    WriteLog(L"Watching volume changes for: " + DeviceName(device));
+}
+
+void ServiceObserver::OnWatchFailed(MicVol::DeviceHandle device, HRESULT hr)
+{
+    WriteErrorLog(L"Volume change registration error for " + DeviceName(device) + L": " + std::to_wstring(hr));
+}
+
+static std::wstring SessionName(MicVol::SessionHandle session)
+{
+    const MicVol::TrackedSession &info = g_SessionEnforcer.Session(session);
+    return info.processName + (info.flow == MicVol::DataFlow::Capture ? L" (capture)" : L" (render)");
+}
+
+void SessionLogObserver::OnEndpointWatchFailed(const std::wstring &endpointId, HRESULT hr)
+{
+    WriteErrorLog(L"Session notification registration error for " + endpointId + L": " + std::to_wstring(hr));
+}
+
+void SessionLogObserver::OnSessionTracked(MicVol::SessionHandle session)
+{
+    const MicVol::TrackedSession &info = g_SessionEnforcer.Session(session);
+    std::wstring mute = info.policy.mute == MicVol::MutePolicy::Mute     ? L", keep muted"
+                        : info.policy.mute == MicVol::MutePolicy::Unmute ? L", keep unmuted"
+                                                                         : L"";
+    WriteLog(L"Enforcing session of " + SessionName(session) + L": volume " + Percent(info.policy.targetVolume) +
+             L" +/- " + Percent(info.policy.tolerance) + mute + L" (rule " + std::to_wstring(info.policyRule + 1) + L")");
+}
+
+void SessionLogObserver::OnSessionEnded(MicVol::SessionHandle session)
+{
+    WriteLog(L"Session ended: " + SessionName(session));
+}
+
+void SessionLogObserver::OnSessionCorrected(MicVol::SessionHandle session, float oldVolume, float newVolume)
+{
+    WriteLog(L"Session volume corrected: " + SessionName(session) + L" " + Percent(oldVolume) + L" -> " +
+             Percent(newVolume) + ChangedBy(g_SessionEnforcer.Session(session).lastWriter));
+}
+
+void SessionLogObserver::OnSessionMuteCorrected(MicVol::SessionHandle session, bool muted)
+{
+    WriteLog((muted ? L"Session muted: " : L"Session unmuted: ") + SessionName(session) +
+             ChangedBy(g_SessionEnforcer.Session(session).lastWriter));
+}
+
+void SessionLogObserver::OnSessionError(MicVol::SessionHandle session, HRESULT hr)
+{
+    WriteErrorLog(L"Session volume error for " + SessionName(session) + L": " + std::to_wstring(hr));
+}
+
+// Watches endpoints that appeared since the last sweep; sessions themselves arrive by notification
+void RefreshSessionEndpoints()
+{
+    if (!g_Options.enforceSessions)
+        return;
+
+    HRESULT hr = g_SessionEnforcer.RefreshEndpoints();
+    if (FAILED(hr))
+        WriteErrorLog(L"Audio session enumeration error: " + std::to_wstring(hr));
+}
+
+// Logs and records a change reported by g_Suspend.Update()
+static void LogSuspendChange(MicVol::SuspendChange change)
+{
+    if (change == MicVol::SuspendChange::Suspended)
+    {
+        WriteLog(std::wstring(L"Enforcement suspended: ") + MicVol::SuspendReasonsName(g_Suspend.Reasons()));
+        RecordEvent(MicVol::EventType::Suspended, MicVol::InvalidDeviceHandle, 0.0f, 0.0f, S_OK,
+                    MicVol::WriterKind::Unknown, g_Suspend.Reasons());
+    }
+    else if (change == MicVol::SuspendChange::Resumed)
+    {
+        uint32_t seconds = (uint32_t)(g_Suspend.LastSuspendedMs() / 1000);
+        WriteLog(L"Enforcement resumed after " + std::to_wstring(seconds) + L" sec.");
+        RecordEvent(MicVol::EventType::Resumed, MicVol::InvalidDeviceHandle, 0.0f, 0.0f, S_OK,
+                    MicVol::WriterKind::Unknown, seconds);
     }
+}
+
+// Main function for working with microphones
+void ProcessMicrophones()
+{
+    g_Enforcer.Sweep();
+    RefreshSessionEndpoints();
+    g_BinaryLog.FlushIfDue(MicVol::WallClockMs());
+}
+
+// Corrects every device flagged by a volume change notification
+void ProcessVolumeChanges()
+{
+    g_Enforcer.ProcessNotifications();
+    if (g_Options.enforceSessions)
+        g_SessionEnforcer.ProcessPending();
+    g_BinaryLog.FlushIfDue(MicVol::WallClockMs());
+}
+
+// One pass over every selected device: levels are often off after a resume from sleep
+static void ResyncDevices()
+{
+    g_Enforcer.Resync();
+    RefreshSessionEndpoints();
+    g_BinaryLog.FlushIfDue(MicVol::WallClockMs());
+}
+
+// Arms the sweep, or in adaptive mode the session refresh, -t seconds from now
+static void RestartIntervalTimer()
+{
+    LoopTimer timer = g_Options.adaptive ? TimerSessions : TimerSweep;
+    uint64_t intervalMs = g_Options.intervalSeconds * 1000ull;
+    if (intervalMs == 0 || (g_Options.adaptive && !g_Options.enforceSessions))
+        g_Loop.Cancel(timer);
     else
+        g_Loop.Schedule(timer, g_Clock.NowMs() + intervalMs);
+}
+
+// First pass when enforcement starts: a re-sync after a suspension, otherwise a sweep
+// that registers every matching device (adaptive mode: the devices that are due,
+// which at first are all of them)
+static void StartEnforcing(bool resumed)
+{
+    if (g_Options.useEvents)
+        g_Enforcer.EnableNotifications();
+
+    g_Enforcing = true;
+    if (resumed)
+    {
+        ResyncDevices();
+    }
+    else if (g_Options.adaptive)
+    {
+        g_Enforcer.CheckDue();
+        RefreshSessionEndpoints();
+        g_BinaryLog.FlushIfDue(MicVol::WallClockMs());
+    }
+    else
+    {
+        ProcessMicrophones();
+    }
+    RestartIntervalTimer();
+}
+
+// Starts or stops enforcing after a -whenrunning target, pause, sleep or lock change.
+// A suspension keeps the cached endpoints, and notifications only queue up for the
+// re-sync; while no target process runs, interfaces, notifications and COM are released.
+static void UpdateEnforcement(bool resumed)
+{
+    bool armed = g_Options.activationProcesses.empty() || g_Activation.Armed();
+    bool wanted = armed && !g_Suspend.IsSuspended();
+    if (wanted && !g_Enforcing)
+    {
+        StartEnforcing(resumed);
+    }
+    else if (wanted && resumed)
     {
-        WriteErrorLog(L"Audio devices enumeration error: " + std::to_wstring(hr));
+        // Asleep and awake again between two wakeups of the loop
+        ResyncDevices();
+        RestartIntervalTimer();
+    }
+    else if (!wanted && g_Enforcing)
+    {
+        g_Enforcing = false;
+        g_Loop.Cancel(TimerSweep);
+        g_Loop.Cancel(TimerCheck);
+        g_Loop.Cancel(TimerSessions);
     }
 
-    pEnumerator->Release();
-    CoUninitialize();
+    if (!armed)
+    {
+        g_Enforcer.Shutdown();
+        g_SessionEnforcer.Shutdown();
+    }
 }
 
-// Main service worker function
-DWORD WINAPI ServiceWorkerThread(LPVOID lpParam)
+static void OnNotification()
 {
-    WriteLog(L"Service started. Interval: " + std::to_wstring(g_IntervalSeconds) +
-             L" sec. Filter: " + (g_MicrophoneFilter.empty() ? L"(all microphones)" : g_MicrophoneFilter));
+    if (!g_Enforcing)
+        return;
 
-    while (WaitForSingleObject(g_ServiceStopEvent, g_IntervalSeconds * 1000) == WAIT_TIMEOUT)
+    if (g_Options.adaptive)
     {
+        // Applies queued hotplug changes and checks the devices that are due
+        g_Enforcer.CheckDue();
+        ProcessVolumeChanges();
+    }
+    else if (g_Options.useEvents || g_Options.enforceSessions)
+    {
+        // Hotplug: attach new devices before handling volume changes
+        if (g_Enforcer.HasPendingDeviceChanges())
+            ProcessMicrophones();
+        ProcessVolumeChanges();
+    }
+    // Polling: the next sweep applies device changes
+}
+
+static void OnActivation()
+{
+    // Another instance started or one of several exited: nothing changes
+    if (!g_Activation.ProcessPending())
+        return;
+
+    if (g_Activation.Armed())
+        WriteLog(L"Target process running: " + g_Activation.RunningTarget() + L". Enforcement active");
+    else
+        WriteLog(L"Target processes exited. Enforcement paused");
+    UpdateEnforcement(false);
+}
+
+static void OnConfig()
+{
+    if (!ApplyPendingConfig() || !g_Enforcing)
+        return;
+
+    // Apply the new filter, rules or schedule right away and restart the interval
+    if (g_Options.adaptive)
+        g_Enforcer.CheckDue();
+    else
         ProcessMicrophones();
+    RestartIntervalTimer();
+}
+
+static void OnControl()
+{
+    MicVol::SuspendChange change = g_Suspend.Update(g_Clock.NowMs());
+    LogSuspendChange(change);
+    UpdateEnforcement(change == MicVol::SuspendChange::Resumed);
+}
+
+static void OnSweep()
+{
+    ProcessMicrophones();
+    RestartIntervalTimer();
+}
+
+static void OnCheck()
+{
+    g_Enforcer.CheckDue();
+    g_BinaryLog.FlushIfDue(MicVol::WallClockMs());
+}
+
+static void OnSessionRefresh()
+{
+    RefreshSessionEndpoints();
+    RestartIntervalTimer();
+}
+
+static void OnLogSummary()
+{
+    LogSuppressedSummaries(false);
+    uint64_t next = g_LogLimiter.NextSummaryMs();
+    if (next != UINT64_MAX)
+        g_Loop.Schedule(TimerLogSummary, next);
+}
+
+// Re-arms the check timer from the enforcer's schedule and publishes the status
+static void BeforeWait()
+{
+    uint64_t next = g_Enforcing ? g_Enforcer.NextCheckMs() : MicVol::TimerWheel::Never;
+    if (next == MicVol::TimerWheel::Never)
+        g_Loop.Cancel(TimerCheck);
+    else
+        g_Loop.Schedule(TimerCheck, next);
+
+    MicVol::ServiceState state = g_Enforcing                ? MicVol::ServiceState::Enforcing
+                                 : g_Suspend.IsSuspended() ? MicVol::ServiceState::Suspended
+                                                           : MicVol::ServiceState::Idle;
+    PublishStatus(state, g_Loop.NextDueMs());
+}
+
+// Runs the selected mode on g_Loop until the service stops. Every mode is a set of
+// handlers on the same sources and timers: polling arms the sweep timer, -events adds
+// notifications, -adaptive replaces the sweep with the per-device check timer, and
+// -whenrunning and suspensions start and stop enforcing. With nothing due the worker
+// sleeps without a timeout.
+void RunEventLoop()
+{
+    g_Loop.SetSource(SourceNotification, OnNotification);
+    g_Loop.SetSource(SourceActivation, OnActivation);
+    g_Loop.SetSource(SourceConfig, OnConfig);
+    g_Loop.SetSource(SourceControl, OnControl);
+    g_Loop.SetTimer(TimerSweep, OnSweep);
+    g_Loop.SetTimer(TimerCheck, OnCheck);
+    g_Loop.SetTimer(TimerSessions, OnSessionRefresh);
+    g_Loop.SetTimer(TimerLogSummary, OnLogSummary);
+    g_Loop.SetBeforeWait(BeforeWait);
+
+    if (g_Options.adaptive)
+    {
+        MicVol::CheckSchedule schedule;
+        schedule.minIntervalMs = g_Options.minIntervalMs;
+        schedule.maxIntervalMs = g_Options.maxIntervalMs;
+        g_Enforcer.EnableAdaptiveSchedule(schedule);
+    }
+
+    if (!g_Options.activationProcesses.empty())
+    {
+        std::vector<std::wstring> targets;
+        MicVol::ProcessActivation::ParseTargets(g_Options.activationProcesses, targets);
+        g_Activation.SetTargets(targets);
+        HRESULT hr = g_Activation.Start();
+        if (FAILED(hr))
+        {
+            WriteErrorLog(L"Process watch error: " + std::to_wstring(hr) + L". Enforcing continuously");
+            g_Options.activationProcesses.clear();
+        }
+        else if (g_Activation.Armed())
+        {
+            WriteLog(L"Target process running: " + g_Activation.RunningTarget() + L". Enforcement active");
+        }
+    }
+
+    UpdateEnforcement(false);
+    g_Loop.Run();
+
+    g_Activation.Stop();
+    g_Enforcing = false;
+}
+
+// Main service worker function
+DWORD WINAPI ServiceWorkerThread(LPVOID lpParam)
+{
+    WriteLog(L"Service started. Interval: " + std::to_wstring(g_Options.intervalSeconds) +
+             L" sec. Filter: " + (g_Options.microphoneFilter.empty() ? L"(all microphones)" : g_Options.microphoneFilter) +
+             (g_Options.adaptive ? L". Mode: adaptive" : g_Options.useEvents ? L". Mode: event-driven" : L". Mode: polling") +
+             (g_Options.enforceSessions ? L", application sessions" : L"") +
+             (g_Options.activationProcesses.empty() ? L"" : L". Active while running: " + g_Options.activationProcesses));
+
+    StartBinaryLog();
+    RecordEvent(MicVol::EventType::ServiceStarted, MicVol::InvalidDeviceHandle);
+    StartMetrics();
+    StartStatus();
+    StartConfigWatch();
+    if (g_Options.workerThreads > 0)
+    {
+        // As many spares again, to replace threads stuck in calls past the deadline
+        if (SUCCEEDED(g_DevicePool.Start(g_Options.workerThreads, g_Options.workerThreads)))
+            g_Enforcer.SetWorkerPool(&g_DevicePool);
+        else
+            WriteWarningLog(L"Could not start the worker pool, checking devices on one thread");
     }
 
+    RunEventLoop();
+    LogSuppressedSummaries(true);
+
+    // Release cached interfaces, notifications and COM on the thread that created them
+    g_Enforcer.Shutdown();
+    g_SessionEnforcer.Shutdown();
+    g_Enforcer.SetWorkerPool(nullptr);
+    g_DevicePool.Stop();
+    StopConfigWatch();
+    StopStatus();
+    StopMetrics();
+
+    RecordEvent(MicVol::EventType::ServiceStopped, MicVol::InvalidDeviceHandle);
+    StopBinaryLog();
+
     WriteLog(L"Service stopped");
     return ERROR_SUCCESS;
 }
 
-// Service control function
-VOID WINAPI ServiceCtrlHandler(DWORD CtrlCode)
+// Reports a new state to SCM from the control handler
+static void ReportServiceState(DWORD state)
+{
+    g_ServiceStatus.dwCurrentState = state;
+    if (SetServiceStatus(g_StatusHandle, &g_ServiceStatus) == FALSE)
+    {
+        WriteLog(L"SetServiceStatus error");
+    }
+}
+
+// Service control function. Pause, power and session controls only post to g_Suspend;
+// the worker suspends and resumes at its next wake.
+DWORD WINAPI ServiceCtrlHandler(DWORD CtrlCode, DWORD eventType, LPVOID eventData, LPVOID context)
 {
     switch (CtrlCode)
     {
+    case SERVICE_CONTROL_PAUSE:
+        g_Suspend.Post(MicVol::ControlEvent::Pause);
+        ReportServiceState(SERVICE_PAUSED);
+        break;
+    case SERVICE_CONTROL_CONTINUE:
+        g_Suspend.Post(MicVol::ControlEvent::Continue);
+        ReportServiceState(SERVICE_RUNNING);
+        break;
+    case SERVICE_CONTROL_POWEREVENT:
+        if (eventType == PBT_APMSUSPEND)
+            g_Suspend.Post(MicVol::ControlEvent::PowerSuspend);
+        else if (eventType == PBT_APMRESUMEAUTOMATIC || eventType == PBT_APMRESUMESUSPEND)
+            g_Suspend.Post(MicVol::ControlEvent::PowerResume);
+        break;
+    case SERVICE_CONTROL_SESSIONCHANGE:
+        // Only the console session: another user's remote session does not stop the local microphones
+        if (eventData && ((WTSSESSION_NOTIFICATION *)eventData)->dwSessionId == WTSGetActiveConsoleSessionId())
+        {
+            if (eventType == WTS_SESSION_LOCK)
+                g_Suspend.Post(MicVol::ControlEvent::SessionLock);
+            else if (eventType == WTS_SESSION_UNLOCK)
+                g_Suspend.Post(MicVol::ControlEvent::SessionUnlock);
+        }
+        break;
+    case SERVICE_CONTROL_PARAMCHANGE:
+        // sc control MicrophoneVolumeService paramchange
+        g_ConfigWatcher.RequestReload();
+        break;
     case SERVICE_CONTROL_STOP:
         WriteLog(L"Service stop signal received");
         if (g_ServiceStatus.dwCurrentState != SERVICE_STOP_PENDING)
@@ -281,12 +1172,15 @@ VOID WINAPI ServiceCtrlHandler(DWORD CtrlCode)
                 WriteLog(L"SetServiceStatus error");
             }
 
-            SetEvent(g_ServiceStopEvent);
+            g_Loop.Stop();
         }
         break;
-    default:
+    case SERVICE_CONTROL_INTERROGATE:
         break;
+    default:
+        return ERROR_CALL_NOT_IMPLEMENTED;
     }
+    return NO_ERROR;
 }
 
 // Main service function
@@ -294,21 +1188,10 @@ VOID WINAPI ServiceMain(DWORD argc, LPTSTR *argv)
 {
     DWORD Status = E_FAIL;
 
-    // Initialize Event Log handle if using Event Log
-    if (g_UseEventLog)
-    {
-        g_EventLogHandle = RegisterEventSourceW(NULL, SERVICE_NAME);
-        if (g_EventLogHandle == NULL)
-        {
-            // Fall back to file logging if Event Log registration fails
-            g_UseEventLog = false;
-            WriteLog(L"Warning: Could not register Event Log source, falling back to file logging");
-        }
-    }
-
-    g_StatusHandle = RegisterServiceCtrlHandler(SERVICE_NAME, ServiceCtrlHandler);
+    g_StatusHandle = RegisterServiceCtrlHandlerEx(SERVICE_NAME, ServiceCtrlHandler, NULL);
     if (g_StatusHandle == NULL)
     {
+        StopLogging();
         return;
     }
 
@@ -325,22 +1208,8 @@ VOID WINAPI ServiceMain(DWORD argc, LPTSTR *argv)
         WriteErrorLog(L"SetServiceStatus error");
     }
 
-    g_ServiceStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    if (g_ServiceStopEvent == NULL)
-    {
-        g_ServiceStatus.dwControlsAccepted = 0;
-        g_ServiceStatus.dwCurrentState = SERVICE_STOPPED;
-        g_ServiceStatus.dwWin32ExitCode = GetLastError();
-        g_ServiceStatus.dwCheckPoint = 1;
-
-        if (SetServiceStatus(g_StatusHandle, &g_ServiceStatus) == FALSE)
-        {
-            WriteErrorLog(L"SetServiceStatus error");
-        }
-        return;
-    }
-
-    g_ServiceStatus.dwControlsAccepted = SERVICE_ACCEPT_STOP;
+    g_ServiceStatus.dwControlsAccepted = SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_PARAMCHANGE | SERVICE_ACCEPT_PAUSE_CONTINUE |
+                                         SERVICE_ACCEPT_POWEREVENT | SERVICE_ACCEPT_SESSIONCHANGE;
     g_ServiceStatus.dwCurrentState = SERVICE_RUNNING;
     g_ServiceStatus.dwWin32ExitCode = 0;
     g_ServiceStatus.dwCheckPoint = 0;
@@ -359,17 +1228,11 @@ VOID WINAPI ServiceMain(DWORD argc, LPTSTR *argv)
         CloseHandle(hThread);
     }
 
-    CloseHandle(g_ServiceStopEvent);
-
-    // Clean up Event Log handle
-    if (g_EventLogHandle)
-    {
-        DeregisterEventSource(g_EventLogHandle);
-        g_EventLogHandle = NULL;
-    }
-
     WriteLog(L"Microphone Volume Service stopped");
 
+    // Everything queued must be on disk before SCM is told we stopped and may end the process
+    StopLogging();
+
     g_ServiceStatus.dwControlsAccepted = 0;
     g_ServiceStatus.dwCurrentState = SERVICE_STOPPED;
     g_ServiceStatus.dwWin32ExitCode = 0;
@@ -382,7 +1245,7 @@ VOID WINAPI ServiceMain(DWORD argc, LPTSTR *argv)
 }
 
 // Service installation function
-BOOL InstallService(DWORD intervalSeconds, const std::wstring &microphoneFilter, const std::wstring &logFile, bool useEventLog)
+BOOL InstallService(const MicVol::ServiceOptions &options)
 {
     SC_HANDLE schSCManager = OpenSCManager(NULL, NULL, SC_MANAGER_ALL_ACCESS);
     if (schSCManager == NULL)
@@ -401,23 +1264,7 @@ BOOL InstallService(DWORD intervalSeconds, const std::wstring &microphoneFilter,
 
     // Build parameter string
     std::wstring servicePath = szPath;
-    servicePath += L" -service";
-    if (intervalSeconds != 2)
-    {
-        servicePath += L" -t " + std::to_wstring(intervalSeconds);
-    }
-    if (!microphoneFilter.empty())
-    {
-        servicePath += L" -m \"" + microphoneFilter + L"\"";
-    }
-    if (useEventLog)
-    {
-        servicePath += L" -eventlog";
-    }
-    else if (!logFile.empty() && logFile != L"C:\\Windows\\Temp\\MicrophoneVolumeService.log")
-    {
-        servicePath += L" -logfile \"" + logFile + L"\"";
-    }
+    servicePath += L" -service" + MicVol::FormatServiceArguments(options);
 
     SC_HANDLE schService = CreateService(
         schSCManager,
@@ -452,7 +1299,7 @@ BOOL InstallService(DWORD intervalSeconds, const std::wstring &microphoneFilter,
 
     // Start the service immediately after installation
     std::wcout << L"Service successfully installed" << std::endl;
-    std::wcout << L"Logging: " << (useEventLog ? L"Windows Event Log" : (L"File: " + logFile)) << std::endl;
+    std::wcout << L"Logging: " << (options.useEventLog ? L"Windows Event Log" : (L"File: " + options.logFile)) << std::endl;
     
     if (StartService(schService, 0, NULL))
     {
@@ -510,30 +1357,86 @@ BOOL UninstallService()
 }
 
 // Function to parse command line arguments
+// Reads the command line and the -config file it names
 void ParseCommandLine(int argc, wchar_t *argv[])
 {
-    for (int i = 1; i < argc; i++)
+    MicVol::ParseServiceOptions(argc, argv, 1, g_CommandLine);
+    g_Config = MicVol::BuildServiceConfig(g_CommandLine);
+    g_Options = g_Config->options;
+    g_Enforcer.SetFilter(g_Options.microphoneFilter);
+
+    MicVol::TamperWarOptions fight;
+    fight.strategy = g_Options.fightStrategy;
+    g_Enforcer.SetTamperWarOptions(fight);
+    g_Enforcer.SetCallDeadline(g_Options.callDeadlineMs);
+}
+
+// Installs the -rules file read with the configuration; on an error the service runs with the -m filter alone
+void LoadRules()
+{
+    if (FAILED(g_Config->configResult))
+        WriteErrorLog(L"Cannot read configuration file " + g_CommandLine.configFile + L", using the command line alone");
+
+    if (g_Config->rulesResult == S_FALSE)
+        return;
+    if (FAILED(g_Config->rulesResult))
     {
-        if (wcscmp(argv[i], L"-t") == 0 && i + 1 < argc)
-        {
-            g_IntervalSeconds = _wtoi(argv[++i]);
-            if (g_IntervalSeconds < 1)
-                g_IntervalSeconds = 2;
-        }
-        else if (wcscmp(argv[i], L"-m") == 0 && i + 1 < argc)
-        {
-            g_MicrophoneFilter = argv[++i];
-        }
-        else if (wcscmp(argv[i], L"-logfile") == 0 && i + 1 < argc)
+        LogRulesError(*g_Config);
+        return;
+    }
+
+    g_Enforcer.SetRules(g_Config->rules);
+    g_SessionEnforcer.SetRules(g_Config->rules);
+    WriteLog(L"Loaded " + std::to_wstring(g_Config->rules.size()) + L" policy rules from " + g_Options.rulesFile);
+}
+
+// -log-query: prints the events of a binary log that match a time range and device
+int QueryBinaryLog(int argc, wchar_t *argv[])
+{
+    std::wstring path = argv[2];
+    MicVol::BinaryLogQuery query;
+
+    for (int i = 3; i < argc; i++)
+    {
+        if ((wcscmp(argv[i], L"-from") == 0 || wcscmp(argv[i], L"-to") == 0) && i + 1 < argc)
         {
-            g_LogFile = argv[++i];
-            g_UseEventLog = false;
+            bool from = wcscmp(argv[i], L"-from") == 0;
+            uint64_t ms = 0;
+            if (!MicVol::ParseLocalTime(argv[++i], ms))
+            {
+                std::wcout << L"Invalid time: " << argv[i] << L" (expected YYYY-MM-DD[ HH:MM[:SS]])" << std::endl;
+                return 1;
+            }
+            if (from)
+                query.fromMs = ms;
+            else
+                query.toMs = ms;
         }
-        else if (wcscmp(argv[i], L"-eventlog") == 0)
+        else if (wcscmp(argv[i], L"-device") == 0 && i + 1 < argc)
         {
-            g_UseEventLog = true;
+            query.device = argv[++i];
         }
     }
+
+    MicVol::BinaryLogReader reader;
+    HRESULT hr = reader.Open(path);
+    if (FAILED(hr))
+    {
+        std::wcout << (hr == E_INVALIDARG ? L"Not a binary event log: " : L"Cannot open: ") << path << std::endl;
+        return 1;
+    }
+
+    std::vector<MicVol::DecodedEvent> events;
+    MicVol::BinaryLogQueryStats stats;
+    reader.Query(query, events, &stats);
+
+    for (const MicVol::DecodedEvent &event : events)
+    {
+        std::wcout << MicVol::FormatEvent(event) << std::endl;
+    }
+    std::wcout << events.size() << L" events (" << stats.blocksRead << L" blocks read, " << stats.blocksSkipped
+               << L" skipped)" << std::endl;
+    return 0;
 }
 
 // Main function
@@ -543,45 +1446,28 @@ int wmain(int argc, wchar_t *argv[])
     {
         if (wcscmp(argv[1], L"-install") == 0)
         {
-            DWORD interval = 2;
-            std::wstring filter = L"";
-            std::wstring logFile = L"C:\\Windows\\Temp\\MicrophoneVolumeService.log";
-            bool useEventLog = false;
-
-            // Parse parameters for installation
-            for (int i = 2; i < argc; i++)
-            {
-                if (wcscmp(argv[i], L"-t") == 0 && i + 1 < argc)
-                {
-                    interval = _wtoi(argv[++i]);
-                    if (interval < 1)
-                        interval = 2;
-                }
-                else if (wcscmp(argv[i], L"-m") == 0 && i + 1 < argc)
-                {
-                    filter = argv[++i];
-                }
-                else if (wcscmp(argv[i], L"-logfile") == 0 && i + 1 < argc)
-                {
-                    logFile = argv[++i];
-                    useEventLog = false;
-                }
-                else if (wcscmp(argv[i], L"-eventlog") == 0)
-                {
-                    useEventLog = true;
-                }
-            }
-
-            return InstallService(interval, filter, logFile, useEventLog) ? 0 : 1;
+            MicVol::ServiceOptions options;
+            MicVol::ParseServiceOptions(argc, argv, 2, options);
+            return InstallService(options) ? 0 : 1;
         }
         else if (wcscmp(argv[1], L"-uninstall") == 0)
         {
             return UninstallService() ? 0 : 1;
         }
+        else if (wcscmp(argv[1], L"-status") == 0)
+        {
+            return PrintStatus();
+        }
+        else if (wcscmp(argv[1], L"-log-query") == 0 && argc > 2)
+        {
+            return QueryBinaryLog(argc, argv);
+        }
         else if (wcscmp(argv[1], L"-service") == 0)
         {
             // Run as service
             ParseCommandLine(argc, argv);
+            StartLogging();
+            LoadRules();
 
             SERVICE_TABLE_ENTRY ServiceTable[] = {
                 {const_cast<LPWSTR>(SERVICE_NAME), (LPSERVICE_MAIN_FUNCTION)ServiceMain},
@@ -589,8 +1475,10 @@ int wmain(int argc, wchar_t *argv[])
 
             if (StartServiceCtrlDispatcher(ServiceTable) == FALSE)
             {
-                WriteLog(L"StartServiceCtrlDispatcher error: " + std::to_wstring(GetLastError()));
-                return GetLastError();
+                DWORD error = GetLastError();
+                WriteLog(L"StartServiceCtrlDispatcher error: " + std::to_wstring(error));
+                StopLogging();
+                return error;
             }
             return 0;
         }
@@ -598,17 +1486,23 @@ int wmain(int argc, wchar_t *argv[])
         {
             // Test mode
             ParseCommandLine(argc, argv);
-            std::wcout << L"Test mode. Interval: " << g_IntervalSeconds << L" sec." << std::endl;
-            std::wcout << L"Microphone filter: " << (g_MicrophoneFilter.empty() ? L"(all)" : g_MicrophoneFilter) << std::endl;
-            std::wcout << L"Logging: " << (g_UseEventLog ? L"Windows Event Log" : (L"File: " + g_LogFile)) << std::endl;
+            StartLogging();
+            LoadRules();
+            SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE);
+            std::wcout << L"Test mode. Interval: " << g_Options.intervalSeconds << L" sec." << std::endl;
+            std::wcout << L"Microphone filter: " << (g_Options.microphoneFilter.empty() ? L"(all)" : g_Options.microphoneFilter) << std::endl;
+            if (!g_Options.rulesFile.empty())
+                std::wcout << L"Policy rules: " << g_Options.rulesFile << L" (" << g_Enforcer.Rules().size() << L" loaded)" << std::endl;
+            std::wcout << L"Logging: " << (g_Options.useEventLog ? L"Windows Event Log" : (L"File: " + g_Options.logFile)) << std::endl;
+            std::wcout << L"Mode: " << (g_Options.adaptive ? L"adaptive" : g_Options.useEvents ? L"event-driven" : L"polling") << std::endl;
+            if (!g_Options.activationProcesses.empty())
+                std::wcout << L"Active while running: " << g_Options.activationProcesses << std::endl;
+            if (g_Options.enforceSessions)
+                std::wcout << L"Application sessions: " << g_SessionEnforcer.RuleCount() << L" process rules" << std::endl;
             std::wcout << L"Note: Only logs when volume actually changes" << std::endl;
             std::wcout << L"Press Ctrl+C to stop..." << std::endl;
 
-            while (true)
-            {
-                ProcessMicrophones();
-                std::this_thread::sleep_for(std::chrono::seconds(g_IntervalSeconds));
-            }
+            ServiceWorkerThread(NULL);
             return 0;
         }
         else if (wcscmp(argv[1], L"-version") == 0 || wcscmp(argv[1], L"--version") == 0)
@@ -627,25 +1521,51 @@ int wmain(int argc, wchar_t *argv[])
     std::wcout << L"Created to fix Helldivers 2 microphone volume bug" << std::endl;
     std::wcout << L"" << std::endl;
     std::wcout << L"Usage:" << std::endl;
-    std::wcout << L"  " << argv[0] << L" -install [-t seconds] [-m \"microphone_name\"] [-logfile path | -eventlog]" << std::endl;
+    std::wcout << L"  " << argv[0] << L" -install [-t seconds] [-m \"microphone_name\"] [-rules path] [-config path] [-sessions] [-whenrunning processes] [-events] [-adaptive [-tmin ms] [-tmax ms]] [-fight verify|backoff|off] [-workers n] [-deadline ms] [-metrics path] [-metricspipe] [-logfile path [-logsize MB] [-logcount n] | -eventlog] [-loglevel info|warning|error] [-binlog path]" << std::endl;
     std::wcout << L"  " << argv[0] << L" -uninstall" << std::endl;
-    std::wcout << L"  " << argv[0] << L" -test [-t seconds] [-m \"microphone_name\"] [-logfile path | -eventlog]" << std::endl;
+    std::wcout << L"  " << argv[0] << L" -test [-t seconds] [-m \"microphone_name\"] [-rules path] [-config path] [-sessions] [-whenrunning processes] [-events] [-adaptive [-tmin ms] [-tmax ms]] [-fight verify|backoff|off] [-workers n] [-deadline ms] [-metrics path] [-metricspipe] [-logfile path [-logsize MB] [-logcount n] | -eventlog] [-loglevel info|warning|error] [-binlog path]" << std::endl;
+    std::wcout << L"  " << argv[0] << L" -status" << std::endl;
+    std::wcout << L"  " << argv[0] << L" -log-query path [-from time] [-to time] [-device name]" << std::endl;
     std::wcout << L"  " << argv[0] << L" -version" << std::endl;
     std::wcout << L"" << std::endl;
     std::wcout << L"Parameters:" << std::endl;
     std::wcout << L"  -t seconds     Check interval (default 2)" << std::endl;
-    std::wcout << L"  -m name        Microphone name filter (default all)" << std::endl;
+    std::wcout << L"  -m name        Microphone name filter, case-insensitive (default all)" << std::endl;
+    std::wcout << L"  -rules path    Per-device policy rules, one per line:" << std::endl;
+    std::wcout << L"                 include|exclude name|id|formfactor|process:<glob> [volume=%] [tolerance=%] [mute=leave|unmute|mute]" << std::endl;
+    std::wcout << L"  -config path   More of these parameters, one or more per line; changes to -t, -m, -rules," << std::endl;
+    std::wcout << L"                 -fight, -tmin, -tmax, -deadline and -loglevel apply without a restart (also on sc control ... paramchange)" << std::endl;
+    std::wcout << L"  -sessions      Also enforce per-application session volumes selected by process rules" << std::endl;
+    std::wcout << L"  -whenrunning p Enforce only while one of the processes runs, e.g. \"helldivers2.exe\" (comma separated, globs)" << std::endl;
+    std::wcout << L"  -events        Correct volume on change notifications; -t becomes a safety-net sweep (0 = off)" << std::endl;
+    std::wcout << L"  -adaptive      Check each device on its own schedule instead of sweeping every -t seconds" << std::endl;
+    std::wcout << L"  -tmin ms       Adaptive: interval right after a correction (default 250)" << std::endl;
+    std::wcout << L"  -tmax ms       Adaptive: interval a stable device backs off to (default 30000)" << std::endl;
+    std::wcout << L"  -fight s       When an application keeps re-applying its level: verify (default) re-checks closely" << std::endl;
+    std::wcout << L"                 after each correction, backoff pauses corrections, off treats every round alike" << std::endl;
+    std::wcout << L"  -workers n     Threads that check devices in parallel, so a slow one holds up only itself (default 2)" << std::endl;
+    std::wcout << L"  -deadline ms   Longest the calls of one device check may take before it counts as failed; only -workers stops waiting for it, 0 = no limit (default 5000)" << std::endl;
+    std::wcout << L"  -metrics path  Write counters and latency histograms in Prometheus text format to path every 5 sec" << std::endl;
+    std::wcout << L"  -metricspipe   Serve the same metrics on \\\\.\\pipe\\MicrophoneVolumeService.metrics" << std::endl;
     std::wcout << L"  -logfile path  Log to custom file (default C:\\Windows\\Temp\\MicrophoneVolumeService.log)" << std::endl;
+    std::wcout << L"  -logsize MB    Rotate the log file every MB megabytes (default 10, 0 = never)" << std::endl;
+    std::wcout << L"  -logcount n    Log files kept when rotating, including the current one (default 5)" << std::endl;
+    std::wcout << L"  -loglevel l    Leave out messages below info, warning or error (default info)" << std::endl;
     std::wcout << L"  -eventlog      Use Windows Event Log instead of file" << std::endl;
+    std::wcout << L"  -binlog path   Also record events to a compact binary log (read with -log-query)" << std::endl;
+    std::wcout << L"  -status        Show what the running service is doing: devices, corrections, errors, schedule" << std::endl;
+    std::wcout << L"  -from, -to     Query time range, local time \"YYYY-MM-DD[ HH:MM[:SS]]\"" << std::endl;
+    std::wcout << L"  -device name   Query only devices whose name or endpoint ID contains name" << std::endl;
     std::wcout << L"" << std::endl;
     std::wcout << L"Logging behavior:" << std::endl;
     std::wcout << L"  - Only logs when microphone volume actually changes" << std::endl;
     std::wcout << L"  - Reduces log file size and noise" << std::endl;
-    std::wcout << L"  - Use Event Log for automatic log rotation" << std::endl;
+    std::wcout << L"  - Log file is rotated at -logsize, keeping -logcount files" << std::endl;
     std::wcout << L"  -version       Show version information" << std::endl;
     std::wcout << L"" << std::endl;
     std::wcout << L"Examples:" << std::endl;
     std::wcout << L"  " << argv[0] << L" -install -t 5 -m \"USB Microphone\"" << std::endl;
+    std::wcout << L"  " << argv[0] << L" -install -events -whenrunning helldivers2.exe" << std::endl;
     std::wcout << L"  " << argv[0] << L" -test -t 1" << std::endl;
 
     return 0;
@@ -0,0 +1,136 @@
+// Cost of a log call on the enforcement thread: the old WriteLog (open, append,
+// close a std::wofstream per message) versus AsyncLogger into a temp-file sink.
+//
+// Usage: AsyncLoggerBench [messages]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "core/AsyncLogger.h"
+#include "core/FileLogSink.h"
+
+using namespace MicVol;
+
+static const wchar_t Message[] = L"Volume changed for Microphone (USB Audio Device): 37% -> 100%";
+
+struct Result
+{
+    double meanNs;
+    double p99Ns;
+    double totalMs; // Until every message is on disk
+};
+
+static Result Summarize(std::vector<double> &samples, std::chrono::steady_clock::duration total)
+{
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples)
+    {
+        sum += sample;
+    }
+    Result result;
+    result.meanNs = sum / samples.size();
+    result.p99Ns = samples[samples.size() * 99 / 100];
+    result.totalMs = std::chrono::duration<double, std::milli>(total).count();
+    return result;
+}
+
+// The pre-AsyncLogger WriteLog body, with the Win32 time call replaced by localtime
+static void OpenAppendClose(const std::filesystem::path &path, const std::wstring &message)
+{
+    std::wofstream logFile(path, std::ios::app);
+    if (logFile.is_open())
+    {
+        time_t now = time(nullptr);
+        struct tm local = *localtime(&now);
+        logFile << L"[" << local.tm_year + 1900 << L"-"
+                << (local.tm_mon + 1 < 10 ? L"0" : L"") << local.tm_mon + 1 << L"-"
+                << (local.tm_mday < 10 ? L"0" : L"") << local.tm_mday << L" "
+                << (local.tm_hour < 10 ? L"0" : L"") << local.tm_hour << L":"
+                << (local.tm_min < 10 ? L"0" : L"") << local.tm_min << L":"
+                << (local.tm_sec < 10 ? L"0" : L"") << local.tm_sec
+                << L"] " << message << std::endl;
+        logFile.close();
+    }
+}
+
+static Result RunOpenAppendClose(const std::filesystem::path &path, int messages)
+{
+    std::wstring message = Message;
+    std::vector<double> samples;
+    samples.reserve(messages);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < messages; i++)
+    {
+        auto before = std::chrono::steady_clock::now();
+        OpenAppendClose(path, message);
+        samples.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - before)
+                              .count());
+    }
+    return Summarize(samples, std::chrono::steady_clock::now() - start);
+}
+
+static Result RunAsync(const std::filesystem::path &path, int messages, LogOverflowPolicy overflow, uint64_t *dropped)
+{
+    std::wstring message = Message;
+    std::vector<double> samples;
+    samples.reserve(messages);
+
+    AsyncLoggerOptions options;
+    options.overflow = overflow;
+    AsyncLogger logger(options);
+    logger.SetSink(std::make_shared<FileLogSink>(path.wstring()));
+    logger.Start();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < messages; i++)
+    {
+        auto before = std::chrono::steady_clock::now();
+        logger.Log(LogLevel::Information, message);
+        samples.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - before)
+                              .count());
+    }
+    logger.Stop();
+    *dropped = logger.Dropped();
+    return Summarize(samples, std::chrono::steady_clock::now() - start);
+}
+
+int main(int argc, char *argv[])
+{
+    int messages = argc > 1 ? std::atoi(argv[1]) : 100000;
+    if (messages < 1)
+        messages = 100000;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::filesystem::path oldPath = directory / "mvs_bench_open_append_close.log";
+    std::filesystem::path dropPath = directory / "mvs_bench_async_drop.log";
+    std::filesystem::path blockPath = directory / "mvs_bench_async_block.log";
+
+    uint64_t droppedDrop = 0;
+    uint64_t droppedBlock = 0;
+    Result old = RunOpenAppendClose(oldPath, messages);
+    Result drop = RunAsync(dropPath, messages, LogOverflowPolicy::Drop, &droppedDrop);
+    Result block = RunAsync(blockPath, messages, LogOverflowPolicy::Block, &droppedBlock);
+
+    std::printf("%d messages\n", messages);
+    std::printf("%-22s %14s %14s %14s %10s\n", "logger", "mean ns/call", "p99 ns/call", "total ms", "dropped");
+    std::printf("%-22s %14.0f %14.0f %14.1f %10d\n", "open/append/close", old.meanNs, old.p99Ns, old.totalMs, 0);
+    std::printf("%-22s %14.0f %14.0f %14.1f %10llu\n", "async (drop)", drop.meanNs, drop.p99Ns, drop.totalMs,
+                (unsigned long long)droppedDrop);
+    std::printf("%-22s %14.0f %14.0f %14.1f %10llu\n", "async (block)", block.meanNs, block.p99Ns, block.totalMs,
+                (unsigned long long)droppedBlock);
+
+    std::filesystem::remove(oldPath);
+    std::filesystem::remove(dropPath);
+    std::filesystem::remove(blockPath);
+    return 0;
+}
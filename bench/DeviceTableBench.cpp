@@ -0,0 +1,104 @@
+// Per-tick device state lookup: the old std::map<std::wstring, float> keyed by
+// friendly name versus DeviceTable slots indexed by handle.
+//
+// Usage: DeviceTableBench [ticks]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include "core/DeviceTable.h"
+
+using namespace MicVol;
+
+// Keeps the optimizer from dropping the measured loops
+static volatile float g_Sink;
+
+static std::wstring FriendlyName(int i)
+{
+    return L"Microphone (USB Audio Device #" + std::to_wstring(i) + L")";
+}
+
+static std::wstring EndpointId(int i)
+{
+    wchar_t buffer[64];
+    swprintf(buffer, 64, L"{0.0.1.00000000}.{%08x-1f2e-4d3c-8b7a-%012x}", i * 2654435761u, i);
+    return buffer;
+}
+
+// One tick as ProcessMicrophones() did it: name lookup, tolerance check, store
+static double MapNsPerLookup(int deviceCount, int ticks)
+{
+    std::map<std::wstring, float> lastVolumeState;
+    std::vector<std::wstring> names;
+    for (int i = 0; i < deviceCount; i++)
+    {
+        names.push_back(FriendlyName(i));
+        lastVolumeState[names.back()] = 1.0f;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    float total = 0.0f;
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        for (const std::wstring &name : names)
+        {
+            auto it = lastVolumeState.find(name);
+            if (std::fabs(it->second - 1.0f) > 0.01f)
+                it->second = 1.0f;
+            total += it->second;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    g_Sink = total;
+
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / ((double)ticks * deviceCount);
+}
+
+static double TableNsPerLookup(int deviceCount, int ticks)
+{
+    DeviceTable table;
+    std::vector<DeviceHandle> devices;
+    for (int i = 0; i < deviceCount; i++)
+    {
+        devices.push_back(table.Intern(EndpointId(i)));
+        table.Slot(devices.back()).lastVolume = 1.0f;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    float total = 0.0f;
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        for (DeviceHandle device : devices)
+        {
+            DeviceSlot &slot = table.Slot(device);
+            if (std::fabs(slot.lastVolume - slot.targetVolume) > slot.tolerance)
+                slot.lastVolume = slot.targetVolume;
+            total += slot.lastVolume;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    g_Sink = total;
+
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / ((double)ticks * deviceCount);
+}
+
+int main(int argc, char *argv[])
+{
+    int lookups = argc > 1 ? std::atoi(argv[1]) : 2000000;
+    if (lookups < 1)
+        lookups = 2000000;
+
+    std::printf("%8s %18s %18s %8s\n", "devices", "map ns/lookup", "table ns/lookup", "speedup");
+    for (int deviceCount : {10, 100, 1000})
+    {
+        int ticks = lookups / deviceCount;
+        double mapNs = MapNsPerLookup(deviceCount, ticks);
+        double tableNs = TableNsPerLookup(deviceCount, ticks);
+        std::printf("%8d %18.2f %18.2f %7.1fx\n", deviceCount, mapNs, tableNs, tableNs > 0 ? mapNs / tableNs : 0.0);
+    }
+    return 0;
+}
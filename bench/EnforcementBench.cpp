@@ -0,0 +1,353 @@
+// Simulated workload for the enforcement loop: MicrophoneEnforcer against a
+// SimulatedAudioBackend under a virtual clock, so hours of operation run in
+// seconds. Other applications tamper with random devices as a Poisson process;
+// every endpoint call costs a configurable virtual latency.
+//
+// Reports per device count: CPU time per sweep, corrections per second and
+// time-to-correct after a tamper, as JSON.
+//
+// Usage: EnforcementBench [-devices 1,10,100,1000,4000] [-hours 1] [-interval 2]
+//                         [-tamper-rate 6] [-latency-us 50] [-events] [-adaptive [-tmin 250] [-tmax 30000]]
+//                         [-seed 1] [-json path]
+//
+//   -tamper-rate  tampers per device per hour
+//   -latency-us   virtual time each endpoint volume call takes
+//   -events       correct from change notifications; -interval is the safety-net sweep
+//   -adaptive     per-device schedule between -tmin and -tmax ms; "sweeps" counts CheckDue() passes
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace MicVol;
+
+struct BenchConfig
+{
+    std::vector<int> deviceCounts = {1, 10, 100, 1000, 4000};
+    double hours = 1.0;
+    uint64_t intervalMs = 2000;
+    double tampersPerDeviceHour = 6.0;
+    uint64_t latencyUs = 50;
+    bool events = false;
+    bool adaptive = false;
+    CheckSchedule schedule;
+    uint64_t seed = 1;
+    std::string jsonPath; // Empty writes to stdout
+};
+
+struct Percentiles
+{
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+    double mean = 0;
+};
+
+struct BenchResult
+{
+    int devices = 0;
+    uint64_t sweeps = 0;
+    uint64_t notificationPasses = 0;
+    uint64_t tampers = 0;
+    uint64_t corrections = 0;
+    uint64_t deviceChecks = 0;
+    double simulatedSeconds = 0;
+    double wallSeconds = 0;
+    Percentiles sweepCpuUs;
+    Percentiles notificationCpuUs;
+    Percentiles timeToCorrectMs;
+};
+
+// Virtual time with microsecond resolution; the enforcer sees milliseconds
+class SimulationClock : public Clock
+{
+public:
+    uint64_t NowMs() override { return m_nowUs / 1000; }
+    uint64_t NowUs() const { return m_nowUs; }
+    void AdvanceUs(uint64_t us) { m_nowUs += us; }
+    void SetUs(uint64_t us) { m_nowUs = std::max(m_nowUs, us); }
+
+private:
+    uint64_t m_nowUs = 0;
+};
+
+const uint64_t NotTampered = UINT64_MAX;
+
+// Measures time from a device's first unanswered tamper to its correction
+class TimeToCorrectObserver : public EnforcementObserver
+{
+public:
+    TimeToCorrectObserver(SimulationClock &clock, std::vector<uint64_t> &tamperedAtUs)
+        : m_clock(clock), m_tamperedAtUs(tamperedAtUs)
+    {
+    }
+
+    void OnVolumeCorrected(DeviceHandle device, float, float, CorrectionSource) override
+    {
+        corrections++;
+        if (device < m_tamperedAtUs.size() && m_tamperedAtUs[device] != NotTampered)
+        {
+            samplesMs.push_back((double)(m_clock.NowUs() - m_tamperedAtUs[device]) / 1000.0);
+            m_tamperedAtUs[device] = NotTampered;
+        }
+    }
+
+    uint64_t corrections = 0;
+    std::vector<double> samplesMs;
+
+private:
+    SimulationClock &m_clock;
+    std::vector<uint64_t> &m_tamperedAtUs;
+};
+
+static Percentiles Summarize(std::vector<double> &samples)
+{
+    Percentiles result;
+    if (samples.empty())
+        return result;
+
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double sample : samples)
+        total += sample;
+
+    result.p50 = samples[(samples.size() - 1) / 2];
+    result.p99 = samples[(size_t)((samples.size() - 1) * 0.99)];
+    result.max = samples.back();
+    result.mean = total / samples.size();
+    return result;
+}
+
+static double ElapsedUs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static BenchResult Run(const BenchConfig &config, int deviceCount)
+{
+    SimulationClock clock;
+    SimulatedAudioBackend backend;
+    std::vector<std::shared_ptr<SimulatedEndpoint>> endpoints;
+    for (int i = 0; i < deviceCount; i++)
+    {
+        auto endpoint = backend.AddDevice(L"{0.0.1.00000000}.{sim-" + std::to_wstring(i) + L"}",
+                                          L"Microphone (Simulated #" + std::to_wstring(i) + L")", 1.0f);
+        uint64_t latencyUs = config.latencyUs;
+        endpoint->SetCallHook([&clock, latencyUs]() { clock.AdvanceUs(latencyUs); });
+        endpoints.push_back(endpoint);
+    }
+
+    std::vector<uint64_t> tamperedAtUs;
+    TimeToCorrectObserver observer(clock, tamperedAtUs);
+    bool woken = false;
+    MicrophoneEnforcer enforcer(backend, clock, observer, [&woken]() { woken = true; });
+    if (config.events)
+        enforcer.EnableNotifications();
+    if (config.adaptive)
+        enforcer.EnableAdaptiveSchedule(config.schedule);
+
+    // First pass interns every device; handles follow the inventory order, not the index
+    if (config.adaptive)
+        enforcer.CheckDue();
+    else
+        enforcer.Sweep();
+    std::vector<DeviceHandle> handles;
+    for (int i = 0; i < deviceCount; i++)
+        handles.push_back(enforcer.Devices().Find(L"{0.0.1.00000000}.{sim-" + std::to_wstring(i) + L"}"));
+    tamperedAtUs.assign(enforcer.Devices().Size(), NotTampered);
+    enforcer.ProcessNotifications();
+    woken = false;
+
+    std::mt19937_64 random(config.seed);
+    double tampersPerUs = config.tampersPerDeviceHour * deviceCount / 3600e6;
+    std::exponential_distribution<double> tamperGap(tampersPerUs > 0 ? tampersPerUs : 1.0);
+    std::uniform_int_distribution<int> pickDevice(0, deviceCount - 1);
+    std::uniform_real_distribution<double> pickLevel(0.0, 0.9);
+
+    const uint64_t startUs = clock.NowUs();
+    const uint64_t endUs = startUs + (uint64_t)(config.hours * 3600e6);
+    const uint64_t intervalUs = config.intervalMs * 1000;
+    uint64_t nextSweepUs = startUs + intervalUs;
+    uint64_t nextTamperUs = tampersPerUs > 0 ? startUs + (uint64_t)tamperGap(random) : UINT64_MAX;
+
+    BenchResult result;
+    result.devices = deviceCount;
+    std::vector<double> sweepCpuUs;
+    std::vector<double> notificationCpuUs;
+    auto wallStart = std::chrono::steady_clock::now();
+
+    for (;;)
+    {
+        if (config.adaptive)
+        {
+            uint64_t nextCheckMs = enforcer.NextCheckMs();
+            nextSweepUs = nextCheckMs == TimerWheel::Never ? UINT64_MAX : std::max(nextCheckMs * 1000, clock.NowUs());
+        }
+        uint64_t nextUs = std::min(nextTamperUs, intervalUs > 0 || config.adaptive ? nextSweepUs : UINT64_MAX);
+        if (nextUs >= endUs)
+            break;
+        clock.SetUs(nextUs);
+
+        if (nextUs == nextTamperUs)
+        {
+            int index = pickDevice(random);
+            DeviceHandle device = handles[index];
+            if (tamperedAtUs[device] == NotTampered)
+                tamperedAtUs[device] = clock.NowUs();
+            endpoints[index]->Tamper((float)pickLevel(random));
+            result.tampers++;
+            nextTamperUs = nextUs + 1 + (uint64_t)tamperGap(random);
+
+            if (woken)
+            {
+                woken = false;
+                auto start = std::chrono::steady_clock::now();
+                enforcer.ProcessNotifications();
+                notificationCpuUs.push_back(ElapsedUs(start));
+            }
+        }
+        else
+        {
+            auto start = std::chrono::steady_clock::now();
+            if (config.adaptive)
+                enforcer.CheckDue();
+            else
+                enforcer.Sweep();
+            sweepCpuUs.push_back(ElapsedUs(start));
+            woken = false;
+
+            // A sweep slower than the interval delays the next one, like the service loop
+            nextSweepUs = std::max(nextSweepUs + intervalUs, clock.NowUs());
+        }
+    }
+
+    result.wallSeconds = ElapsedUs(wallStart) / 1e6;
+    result.simulatedSeconds = (double)(endUs - startUs) / 1e6;
+    result.sweeps = sweepCpuUs.size();
+    result.notificationPasses = notificationCpuUs.size();
+    result.corrections = observer.corrections;
+    result.deviceChecks = enforcer.Checks();
+    result.sweepCpuUs = Summarize(sweepCpuUs);
+    result.notificationCpuUs = Summarize(notificationCpuUs);
+    result.timeToCorrectMs = Summarize(observer.samplesMs);
+    return result;
+}
+
+static void WritePercentiles(FILE *out, const char *name, const Percentiles &value)
+{
+    std::fprintf(out, "\"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}", name, value.mean,
+                 value.p50, value.p99, value.max);
+}
+
+static void WriteJson(FILE *out, const BenchConfig &config, const std::vector<BenchResult> &results)
+{
+    std::fprintf(out, "{\n  \"benchmark\": \"enforcement\",\n");
+    std::fprintf(out, "  \"config\": {\"hours\": %.3f, \"interval_ms\": %llu, \"tampers_per_device_hour\": %.3f, "
+                      "\"latency_us\": %llu, \"mode\": \"%s\", \"adaptive\": %s, \"seed\": %llu},\n",
+                 config.hours, (unsigned long long)config.intervalMs, config.tampersPerDeviceHour,
+                 (unsigned long long)config.latencyUs, config.events ? "events" : "polling",
+                 config.adaptive ? "true" : "false", (unsigned long long)config.seed);
+    std::fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &r = results[i];
+        std::fprintf(out, "    {\"devices\": %d, \"sweeps\": %llu, \"notification_passes\": %llu, \"tampers\": %llu, "
+                          "\"corrections\": %llu, \"device_checks\": %llu, \"corrections_per_sec\": %.3f, \"simulated_seconds\": %.1f, "
+                          "\"wall_seconds\": %.3f,\n     ",
+                     r.devices, (unsigned long long)r.sweeps, (unsigned long long)r.notificationPasses,
+                     (unsigned long long)r.tampers, (unsigned long long)r.corrections, (unsigned long long)r.deviceChecks,
+                     r.simulatedSeconds > 0 ? r.corrections / r.simulatedSeconds : 0.0, r.simulatedSeconds,
+                     r.wallSeconds);
+        WritePercentiles(out, "sweep_cpu_us", r.sweepCpuUs);
+        std::fprintf(out, ",\n     ");
+        WritePercentiles(out, "notification_cpu_us", r.notificationCpuUs);
+        std::fprintf(out, ",\n     ");
+        WritePercentiles(out, "time_to_correct_ms", r.timeToCorrectMs);
+        std::fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+static std::vector<int> ParseList(const char *text)
+{
+    std::vector<int> values;
+    std::string list = text;
+    size_t start = 0;
+    while (start < list.size())
+    {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        int value = std::atoi(list.substr(start, end - start).c_str());
+        if (value > 0)
+            values.push_back(value);
+        start = end + 1;
+    }
+    return values;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchConfig config;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "-devices") == 0 && hasValue)
+            config.deviceCounts = ParseList(argv[++i]);
+        else if (std::strcmp(argv[i], "-hours") == 0 && hasValue)
+            config.hours = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "-interval") == 0 && hasValue)
+            config.intervalMs = (uint64_t)(std::atof(argv[++i]) * 1000);
+        else if (std::strcmp(argv[i], "-tamper-rate") == 0 && hasValue)
+            config.tampersPerDeviceHour = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "-latency-us") == 0 && hasValue)
+            config.latencyUs = (uint64_t)std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "-seed") == 0 && hasValue)
+            config.seed = (uint64_t)std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "-json") == 0 && hasValue)
+            config.jsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "-tmin") == 0 && hasValue)
+            config.schedule.minIntervalMs = (uint32_t)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-tmax") == 0 && hasValue)
+            config.schedule.maxIntervalMs = (uint32_t)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "-events") == 0)
+            config.events = true;
+        else if (std::strcmp(argv[i], "-adaptive") == 0)
+            config.adaptive = true;
+    }
+
+    // Without notifications the sweep is the only way anything gets corrected
+    if (config.intervalMs == 0 && !config.events)
+        config.intervalMs = 2000;
+
+    std::vector<BenchResult> results;
+    for (int deviceCount : config.deviceCounts)
+    {
+        results.push_back(Run(config, deviceCount));
+        const BenchResult &r = results.back();
+        std::fprintf(stderr, "%6d devices: %8.1f us/sweep p50, %8.1f ms time-to-correct p99, %.2f s wall\n",
+                     r.devices, r.sweepCpuUs.p50, r.timeToCorrectMs.p99, r.wallSeconds);
+    }
+
+    FILE *out = stdout;
+    if (!config.jsonPath.empty())
+    {
+        out = std::fopen(config.jsonPath.c_str(), "w");
+        if (!out)
+        {
+            std::fprintf(stderr, "Cannot write %s\n", config.jsonPath.c_str());
+            return 1;
+        }
+    }
+    WriteJson(out, config, results);
+    if (out != stdout)
+        std::fclose(out);
+    return 0;
+}
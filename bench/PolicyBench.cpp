@@ -0,0 +1,189 @@
+// Cost of the per-device policy rules: compiling the rule set, resolving a device
+// with the compiled matcher versus trying every glob in order, and a full sweep,
+// which must not depend on the number of rules.
+//
+// Usage: PolicyBench [sweeps]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cwctype>
+#include <string>
+#include <vector>
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace MicVol;
+
+typedef std::chrono::steady_clock BenchClock;
+
+// Keeps the optimizer from dropping the measured loops
+static volatile int g_Sink;
+
+static std::wstring FriendlyName(int i)
+{
+    return L"Microphone (USB Audio Device #" + std::to_wstring(i) + L")";
+}
+
+static std::wstring EndpointId(int i)
+{
+    wchar_t buffer[64];
+    swprintf(buffer, 64, L"{0.0.1.00000000}.{%08x-1f2e-4d3c-8b7a-%012x}", i * 2654435761u, i);
+    return buffer;
+}
+
+// A realistic mix: mostly name rules, some endpoint ID and form factor rules, a few
+// excludes for devices that are not there. A final catch-all keeps every device
+// enforced, so sweeps over different rule counts do the same work.
+static std::vector<PolicyRule> MakeRules(int ruleCount)
+{
+    std::vector<PolicyRule> rules;
+    for (int i = 0; i < ruleCount; i++)
+    {
+        PolicyRule rule;
+        if (i % 7 == 3)
+        {
+            rule.pattern = L"*virtual cable " + std::to_wstring(i) + L"*";
+            rule.policy.enforce = false;
+        }
+        else if (i % 10 == 9)
+        {
+            rule.field = RuleField::EndpointId;
+            rule.pattern = L"*" + EndpointId(i).substr(18, 8) + L"*";
+        }
+        else if (i % 50 == 25)
+        {
+            rule.field = RuleField::FormFactor;
+            rule.pattern = i % 100 == 25 ? L"headset" : L"head*";
+        }
+        else
+        {
+            rule.pattern = L"*device #" + std::to_wstring(i) + L")";
+        }
+        rule.policy.targetVolume = 0.5f + (float)(i % 50) / 100.0f;
+        rules.push_back(rule);
+    }
+    if (ruleCount > 0)
+    {
+        PolicyRule catchAll;
+        catchAll.pattern = L"*";
+        rules.push_back(catchAll);
+    }
+    return rules;
+}
+
+static double Microseconds(BenchClock::duration elapsed)
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1000.0;
+}
+
+// The naive alternative: every rule's glob in order against the lowercased attribute
+static int LinearResolve(const std::vector<PolicyRule> &rules, const std::vector<std::wstring> &patterns,
+                         const std::wstring &name, const std::wstring &id, const std::wstring &formFactor)
+{
+    for (size_t i = 0; i < rules.size(); i++)
+    {
+        const std::wstring &value = rules[i].field == RuleField::Name ? name
+                                    : rules[i].field == RuleField::EndpointId ? id
+                                                                              : formFactor;
+        if (GlobMatch(patterns[i], value))
+            return (int)i;
+    }
+    return -1;
+}
+
+static std::wstring Lower(const std::wstring &text)
+{
+    std::wstring lower = text;
+    for (wchar_t &c : lower)
+    {
+        c = (wchar_t)towlower(c);
+    }
+    return lower;
+}
+
+static void Run(int ruleCount, int deviceCount, int sweeps)
+{
+    std::vector<PolicyRule> rules = MakeRules(ruleCount);
+
+    auto start = BenchClock::now();
+    PolicyEngine engine;
+    engine.Compile(rules);
+    double compileUs = Microseconds(BenchClock::now() - start);
+
+    std::vector<std::wstring> names, ids;
+    for (int i = 0; i < deviceCount; i++)
+    {
+        names.push_back(FriendlyName(i));
+        ids.push_back(EndpointId(i));
+    }
+
+    int matched = 0;
+    size_t candidates = 0;
+    start = BenchClock::now();
+    for (int i = 0; i < deviceCount; i++)
+    {
+        PolicySubject subject;
+        subject.name = names[i];
+        subject.endpointId = ids[i];
+        subject.formFactor = FormFactor::Microphone;
+        DevicePolicy policy;
+        matched += engine.Resolve(subject, policy) >= 0;
+        candidates += engine.LastCandidateCount();
+    }
+    double compiledNs = Microseconds(BenchClock::now() - start) * 1000.0 / deviceCount;
+
+    std::vector<std::wstring> patterns;
+    for (const PolicyRule &rule : rules)
+    {
+        patterns.push_back(Lower(rule.pattern));
+    }
+    int linearMatched = 0;
+    start = BenchClock::now();
+    for (int i = 0; i < deviceCount; i++)
+    {
+        linearMatched += LinearResolve(rules, patterns, Lower(names[i]), Lower(ids[i]), L"microphone") >= 0;
+    }
+    double linearNs = Microseconds(BenchClock::now() - start) * 1000.0 / deviceCount;
+    g_Sink = matched + linearMatched;
+
+    // Full sweeps through the enforcer with the rule set installed
+    SimulatedAudioBackend backend;
+    for (int i = 0; i < deviceCount; i++)
+    {
+        backend.AddDevice(ids[i], names[i], 1.0f);
+    }
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.SetRules(rules);
+    enforcer.Sweep();
+
+    start = BenchClock::now();
+    for (int i = 0; i < sweeps; i++)
+    {
+        enforcer.Sweep();
+    }
+    double sweepUs = Microseconds(BenchClock::now() - start) / sweeps;
+
+    std::printf("%6d %8d %11.1f %10.2f %13.0f %11.0f %9.1f\n", ruleCount, deviceCount, compileUs,
+                (double)candidates / deviceCount, compiledNs, linearNs, sweepUs);
+}
+
+int main(int argc, char *argv[])
+{
+    int sweeps = argc > 1 ? std::atoi(argv[1]) : 2000;
+    if (sweeps < 1)
+        sweeps = 2000;
+
+    std::printf("%6s %8s %11s %10s %13s %11s %9s\n", "rules", "devices", "compile us", "candidates",
+                "compiled ns", "linear ns", "sweep us");
+    for (int deviceCount : {100, 500})
+    {
+        for (int ruleCount : {0, 10, 100, 500})
+        {
+            Run(ruleCount, deviceCount, sweeps);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+// Sweep latency with slow endpoints: MicrophoneEnforcer::Sweep() over simulated
+// devices whose volume calls sleep for real, checked on the worker thread alone
+// versus spread over a WorkerPool. One device is much slower than the rest, like a
+// sleepy Bluetooth headset; every device is tampered with before each sweep, so
+// each check is a read and a write. The worker thread only waits on the pool, so
+// one pool thread runs the checks no faster than the worker thread alone.
+//
+// Usage: WorkerPoolBench [-devices 16] [-latency-ms 10] [-slow-ms 100] [-sweeps 10] [-threads 0,1,3,7]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace MicVol;
+
+struct BenchConfig
+{
+    int devices = 16;
+    int latencyMs = 10;
+    int slowMs = 100;
+    int sweeps = 10;
+    std::vector<int> threadCounts = {0, 1, 3, 7};
+};
+
+struct SweepTimes
+{
+    double meanMs = 0;
+    double maxMs = 0;
+    uint64_t steals = 0;
+};
+
+static SweepTimes Measure(const BenchConfig &config, int threads)
+{
+    SimulatedAudioBackend backend;
+    std::vector<std::shared_ptr<SimulatedEndpoint>> endpoints;
+    for (int i = 0; i < config.devices; i++)
+    {
+        auto endpoint = backend.AddDevice(L"{dev-" + std::to_wstring(i) + L"}", L"Microphone " + std::to_wstring(i), 1.0f);
+        int latencyMs = i == 0 ? config.slowMs : config.latencyMs;
+        endpoint->SetCallHook([latencyMs]() { std::this_thread::sleep_for(std::chrono::milliseconds(latencyMs)); });
+        endpoints.push_back(endpoint);
+    }
+
+    SteadyClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    WorkerPool pool;
+    pool.Start((unsigned)threads);
+    enforcer.SetWorkerPool(&pool);
+    enforcer.Sweep(); // Activates and caches every endpoint
+
+    SweepTimes times;
+    for (int sweep = 0; sweep < config.sweeps; sweep++)
+    {
+        for (auto &endpoint : endpoints)
+            endpoint->Tamper(0.5f);
+
+        auto start = std::chrono::steady_clock::now();
+        enforcer.Sweep();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        times.meanMs += ms / config.sweeps;
+        times.maxMs = std::max(times.maxMs, ms);
+    }
+    times.steals = pool.Steals().Value();
+
+    enforcer.SetWorkerPool(nullptr);
+    pool.Stop();
+    return times;
+}
+
+static std::vector<int> ParseList(const char *text)
+{
+    std::vector<int> values;
+    while (*text)
+    {
+        values.push_back(std::atoi(text));
+        const char *comma = std::strchr(text, ',');
+        if (!comma)
+            break;
+        text = comma + 1;
+    }
+    return values;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchConfig config;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "-devices") == 0)
+            config.devices = std::max(1, std::atoi(argv[i + 1]));
+        else if (std::strcmp(argv[i], "-latency-ms") == 0)
+            config.latencyMs = std::max(0, std::atoi(argv[i + 1]));
+        else if (std::strcmp(argv[i], "-slow-ms") == 0)
+            config.slowMs = std::max(0, std::atoi(argv[i + 1]));
+        else if (std::strcmp(argv[i], "-sweeps") == 0)
+            config.sweeps = std::max(1, std::atoi(argv[i + 1]));
+        else if (std::strcmp(argv[i], "-threads") == 0)
+            config.threadCounts = ParseList(argv[i + 1]);
+    }
+
+    std::printf("%d devices, %d ms per call, one device %d ms per call\n", config.devices, config.latencyMs,
+                config.slowMs);
+    std::printf("%8s %14s %14s %8s %8s\n", "threads", "mean sweep ms", "max sweep ms", "steals", "speedup");
+    double serialMs = 0;
+    for (int threads : config.threadCounts)
+    {
+        SweepTimes times = Measure(config, threads);
+        if (serialMs == 0)
+            serialMs = times.meanMs;
+        std::printf("%8d %14.1f %14.1f %8llu %7.1fx\n", threads, times.meanMs, times.maxMs,
+                    (unsigned long long)times.steals, times.meanMs > 0 ? serialMs / times.meanMs : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,310 @@
+#include "AsyncLogger.h"
+#include "Clock.h"
+#include <algorithm>
+#include <chrono>
+#include <cwchar>
+#include <system_error>
+
+namespace MicVol
+{
+
+static size_t RoundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 2;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+AsyncLogger::AsyncLogger(const AsyncLoggerOptions &options)
+    : m_options(options)
+{
+    size_t capacity = RoundUpToPowerOfTwo(options.capacity);
+    m_cells.reset(new Cell[capacity]);
+    m_mask = capacity - 1;
+    for (size_t i = 0; i < capacity; i++)
+    {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    if (m_options.flushRecords == 0)
+    {
+        m_options.flushRecords = 1;
+    }
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    Stop();
+}
+
+void AsyncLogger::SetSink(std::shared_ptr<LogSink> sink)
+{
+    if (m_running.load())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+    m_sink = std::move(sink);
+}
+
+HRESULT AsyncLogger::Start()
+{
+    if (m_running.load())
+        return S_FALSE;
+
+    if (m_writer.joinable())
+    {
+        m_writer.join();
+    }
+
+    m_stopRequested.store(false);
+    m_running.store(true);
+    try
+    {
+        m_writer = std::thread(&AsyncLogger::WriterLoop, this);
+    }
+    catch (const std::system_error &)
+    {
+        m_running.store(false);
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+void AsyncLogger::Stop()
+{
+    if (!m_running.exchange(false))
+        return;
+
+    // Producers that saw m_running set are still pushing; let them finish so the
+    // final drain sees every message
+    while (m_producers.load() != 0)
+    {
+        std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopRequested.store(true);
+        m_wake.notify_one();
+    }
+    m_writer.join();
+}
+
+void AsyncLogger::Log(LogLevel level, const wchar_t *text, size_t length)
+{
+    if (!Enabled(level))
+        return;
+
+    Message message = {level, text, length, nullptr};
+    Enqueue(message);
+}
+
+void AsyncLogger::LogDeferred(LogLevel level, const wchar_t *format, const LogArg *args, size_t count)
+{
+    if (!Enabled(level))
+        return;
+
+    DeferredLogRecord deferred;
+    deferred.timestampMs = WallClockMs();
+    deferred.level = level;
+    deferred.argCount = (uint8_t)std::min(count, DeferredLogMaxArgs);
+    deferred.format = format;
+    std::copy(args, args + deferred.argCount, deferred.args);
+
+    Message message = {level, nullptr, 0, &deferred};
+    Enqueue(message);
+}
+
+void AsyncLogger::Enqueue(const Message &message)
+{
+    m_producers.fetch_add(1);
+    if (!m_running.load())
+    {
+        m_producers.fetch_sub(1);
+        WriteSynchronous(message);
+        return;
+    }
+
+    bool pushed = TryPush(message);
+    if (!pushed && m_options.overflow == LogOverflowPolicy::Block)
+    {
+        while (!(pushed = TryPush(message)))
+        {
+            std::this_thread::yield();
+        }
+    }
+    m_producers.fetch_sub(1);
+
+    if (!pushed)
+    {
+        m_dropped.fetch_add(1);
+        return;
+    }
+
+    // Pairs with the fence in WriterLoop: either the writer sees the record or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_writerWaiting.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wake.notify_one();
+    }
+}
+
+void AsyncLogger::Fill(LogRecord &record, LogLevel level, const wchar_t *text, size_t length)
+{
+    record.timestampMs = WallClockMs();
+    record.level = level;
+    record.truncated = length > LogRecordMaxChars - 1;
+    record.length = (uint16_t)std::min(length, LogRecordMaxChars - 1);
+    std::wmemcpy(record.text, text, record.length);
+    record.text[record.length] = L'\0';
+}
+
+// Bounded MPMC ring (Vyukov): each cell's sequence says whether it is free for
+// position pos (== pos) or holds the record written at pos (== pos + 1)
+bool AsyncLogger::TryPush(const Message &message)
+{
+    size_t pos = m_tail.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;)
+    {
+        cell = &m_cells[pos & m_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; // Full
+        }
+        else
+        {
+            pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->deferred = message.deferred != nullptr;
+    if (cell->deferred)
+        cell->deferredRecord = *message.deferred;
+    else
+        Fill(cell->record, message.level, message.text, message.length);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogger::QueueEmpty() const
+{
+    return m_cells[m_head & m_mask].sequence.load(std::memory_order_acquire) != m_head + 1;
+}
+
+size_t AsyncLogger::Drain()
+{
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+
+    size_t count = 0;
+    for (;;)
+    {
+        Cell &cell = m_cells[m_head & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != m_head + 1)
+            break;
+
+        if (m_sink && cell.deferred)
+        {
+            FormatDeferred(cell.deferredRecord, m_names, m_formatted);
+            m_sink->Write(m_formatted);
+        }
+        else if (m_sink)
+        {
+            m_sink->Write(cell.record);
+        }
+        cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+        m_head++;
+        count++;
+    }
+
+    uint64_t dropped = m_dropped.load();
+    if (dropped != m_droppedReported && m_sink)
+    {
+        std::wstring message = L"WARNING: " + std::to_wstring(dropped - m_droppedReported) +
+                               L" log messages dropped, queue full";
+        LogRecord record;
+        Fill(record, LogLevel::Warning, message.c_str(), message.size());
+        m_sink->Write(record);
+        m_droppedReported = dropped;
+        count++;
+    }
+
+    m_written.fetch_add(count);
+    return count;
+}
+
+void AsyncLogger::WriteSynchronous(const Message &message)
+{
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+    if (!m_sink)
+        return;
+
+    if (message.deferred)
+        FormatDeferred(*message.deferred, m_names, m_formatted);
+    else
+        Fill(m_formatted, message.level, message.text, message.length);
+    m_sink->Write(m_formatted);
+    m_sink->Flush();
+    m_written.fetch_add(1);
+}
+
+void AsyncLogger::WriterLoop()
+{
+    const std::chrono::milliseconds flushInterval(m_options.flushIntervalMs);
+    auto lastFlush = std::chrono::steady_clock::now();
+    size_t unflushed = 0;
+
+    for (;;)
+    {
+        // Read before draining: once set, no producer can still be pushing
+        bool stopping = m_stopRequested.load();
+
+        size_t drained = Drain();
+        unflushed += drained;
+
+        auto now = std::chrono::steady_clock::now();
+        if (unflushed > 0 && (stopping || unflushed >= m_options.flushRecords || now - lastFlush >= flushInterval))
+        {
+            std::lock_guard<std::mutex> lock(m_sinkMutex);
+            if (m_sink)
+            {
+                m_sink->Flush();
+            }
+            unflushed = 0;
+            lastFlush = now;
+        }
+
+        if (stopping)
+            break;
+        if (drained > 0)
+            continue;
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_writerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (QueueEmpty() && !m_stopRequested.load())
+        {
+            if (unflushed > 0)
+            {
+                m_wake.wait_for(lock, flushInterval - (now - lastFlush));
+            }
+            else
+            {
+                m_wake.wait(lock);
+            }
+        }
+        m_writerWaiting.store(false, std::memory_order_relaxed);
+    }
+}
+
+} // namespace MicVol
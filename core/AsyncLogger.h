@@ -0,0 +1,164 @@
+#pragma once
+#include "DeferredLog.h"
+#include "LogSink.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace MicVol
+{
+
+// What Log() does when the queue is full
+enum class LogOverflowPolicy
+{
+    Drop,  // Discard the message and count it; the caller never waits on disk
+    Block  // Wait for the writer to make room
+};
+
+struct AsyncLoggerOptions
+{
+    size_t capacity = 1024; // Records; rounded up to a power of two
+    LogOverflowPolicy overflow = LogOverflowPolicy::Drop;
+    uint32_t flushIntervalMs = 1000; // Flush at least this often while messages are pending
+    size_t flushRecords = 256;       // ... or as soon as this many are unflushed
+};
+
+// Moves log I/O off the calling thread.
+//
+// Log() copies the message into a bounded lock-free queue and returns; a single
+// background writer drains the queue into the sink, batching writes and flushing
+// on the time or size threshold. Stop() drains whatever is queued before returning.
+// While the writer is not running, Log() writes synchronously, so messages from
+// before Start() or after Stop() are not lost.
+//
+// LogDeferred(), normally reached through the MVS_LOG_* macros below, queues a
+// DeferredLogRecord instead of text: the caller copies a few typed fields and the
+// writer formats them. Messages below the level set with SetMinLevel() are dropped
+// before anything is copied.
+class AsyncLogger
+{
+public:
+    explicit AsyncLogger(const AsyncLoggerOptions &options = AsyncLoggerOptions());
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger &) = delete;
+    AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+    // Replaces the sink; only allowed while the writer is stopped
+    void SetSink(std::shared_ptr<LogSink> sink);
+
+    HRESULT Start();
+    void Stop();
+    bool IsRunning() const { return m_running.load(); }
+
+    void Log(LogLevel level, const std::wstring &message) { Log(level, message.c_str(), message.size()); }
+    void Log(LogLevel level, const wchar_t *text, size_t length);
+
+    // format and text arguments must outlive the queue; see DeferredLogRecord
+    template <typename... Args>
+    void LogDeferred(LogLevel level, const wchar_t *format, const Args &...args)
+    {
+        static_assert(sizeof...(Args) <= DeferredLogMaxArgs, "too many log arguments");
+        const LogArg list[sizeof...(Args) + 1] = {LogArg(args)...};
+        LogDeferred(level, format, list, sizeof...(Args));
+    }
+    void LogDeferred(LogLevel level, const wchar_t *format, const LogArg *args, size_t count);
+
+    // Messages below level are discarded; Information (everything) by default
+    void SetMinLevel(LogLevel level) { m_minLevel.store((uint8_t)level, std::memory_order_relaxed); }
+    bool Enabled(LogLevel level) const { return (uint8_t)level >= m_minLevel.load(std::memory_order_relaxed); }
+
+    // Names the writer gives the devices of deferred messages
+    LogNames &Names() { return m_names; }
+
+    uint64_t Dropped() const { return m_dropped.load(); }
+    uint64_t Written() const { return m_written.load(); }
+    size_t Capacity() const { return m_mask + 1; }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        bool deferred;
+        LogRecord record;
+        DeferredLogRecord deferredRecord;
+    };
+
+    // A message on its way into the queue: text, or a deferred record
+    struct Message
+    {
+        LogLevel level;
+        const wchar_t *text;
+        size_t length;
+        const DeferredLogRecord *deferred;
+    };
+
+    static void Fill(LogRecord &record, LogLevel level, const wchar_t *text, size_t length);
+
+    void Enqueue(const Message &message);
+    bool TryPush(const Message &message);
+    bool QueueEmpty() const;
+    size_t Drain();
+    void ReportDropped();
+    void WriteSynchronous(const Message &message);
+    void WriterLoop();
+
+    AsyncLoggerOptions m_options;
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+
+    alignas(64) std::atomic<size_t> m_tail{0}; // Next position producers claim
+    alignas(64) size_t m_head = 0;             // Next position the writer reads
+
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_stopRequested{false};
+    std::atomic<int> m_producers{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_written{0};
+    uint64_t m_droppedReported = 0;
+    std::atomic<uint8_t> m_minLevel{(uint8_t)LogLevel::Information};
+    LogNames m_names;
+
+    std::atomic<bool> m_writerWaiting{false};
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+
+    std::mutex m_sinkMutex; // Serializes the writer thread and synchronous writes
+    std::shared_ptr<LogSink> m_sink;
+    LogRecord m_formatted; // A deferred record turned into text, under m_sinkMutex
+    std::thread m_writer;
+};
+
+} // namespace MicVol
+
+// Lowest level the MVS_LOG_* macros compile in: 0 keeps every message, 1 leaves out
+// Information and 2 also Warning. A left-out call compiles to nothing, arguments included.
+#ifndef MVS_LOG_MIN_LEVEL
+#define MVS_LOG_MIN_LEVEL 0
+#endif
+
+// Deferred logging: the arguments are evaluated only if the logger's run-time level
+// lets the message through, and then only copied into the queue
+#define MVS_LOG_AT(logger, level, ...)                                                                                \
+    do                                                                                                                \
+    {                                                                                                                 \
+        if ((logger).Enabled(level))                                                                                  \
+            (logger).LogDeferred(level, __VA_ARGS__);                                                                 \
+    } while (0)
+
+#if MVS_LOG_MIN_LEVEL <= 0
+#define MVS_LOG_INFO(logger, ...) MVS_LOG_AT(logger, MicVol::LogLevel::Information, __VA_ARGS__)
+#else
+#define MVS_LOG_INFO(logger, ...) ((void)0)
+#endif
+
+#if MVS_LOG_MIN_LEVEL <= 1
+#define MVS_LOG_WARNING(logger, ...) MVS_LOG_AT(logger, MicVol::LogLevel::Warning, __VA_ARGS__)
+#else
+#define MVS_LOG_WARNING(logger, ...) ((void)0)
+#endif
+
+#define MVS_LOG_ERROR(logger, ...) MVS_LOG_AT(logger, MicVol::LogLevel::Error, __VA_ARGS__)
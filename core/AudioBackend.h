@@ -0,0 +1,63 @@
+#pragma once
+#include "DeviceNotifications.h"
+#include "VolumeEndpoint.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MicVol
+{
+
+// Physical kind of an endpoint (mirrors EndpointFormFactor)
+enum class FormFactor
+{
+    RemoteNetworkDevice = 0,
+    Speakers,
+    LineLevel,
+    Headphones,
+    Microphone,
+    Headset,
+    Handset,
+    UnknownDigitalPassthrough,
+    SPDIF,
+    DigitalAudioDisplayDevice,
+    UnknownFormFactor
+};
+
+// Access to the system audio stack (WASAPI/MMDevice on Windows, in-memory in tests).
+// Methods are called from the worker thread that called Initialize(), except
+// ActivateVolume(): with a worker pool it runs on the pool threads, several at once,
+// and a call stuck past its deadline may return after Uninitialize() or a new
+// Initialize(). It must then fail or use the current state, never what was released.
+class AudioBackend
+{
+public:
+    virtual ~AudioBackend() = default;
+
+    // COM initialization and device enumerator creation
+    virtual HRESULT Initialize() = 0;
+    virtual void Uninitialize() = 0;
+
+    // IDs of all active capture endpoints
+    virtual HRESULT EnumerateCaptureEndpoints(std::vector<std::wstring> &deviceIds) = 0;
+
+    virtual HRESULT GetEndpointName(const std::wstring &deviceId, std::wstring &name) = 0;
+
+    // PKEY_AudioEndpoint_FormFactor of an endpoint
+    virtual HRESULT GetEndpointFormFactor(const std::wstring &deviceId, FormFactor &formFactor) = 0;
+
+    // Data flow and DEVICE_STATE_XXX of an endpoint (used when a notification names a new device)
+    virtual HRESULT GetEndpointState(const std::wstring &deviceId, DataFlow &flow, unsigned &state) = 0;
+
+    // S_FALSE with an empty ID when there is no default capture device
+    virtual HRESULT GetDefaultCaptureEndpoint(std::wstring &deviceId) = 0;
+
+    // The sink must stay alive until UnregisterDeviceNotifications returns
+    virtual HRESULT RegisterDeviceNotifications(DeviceNotificationSink *sink) = 0;
+    virtual HRESULT UnregisterDeviceNotifications(DeviceNotificationSink *sink) = 0;
+
+    // Activates the volume control of an endpoint; from any thread, see above
+    virtual HRESULT ActivateVolume(const std::wstring &deviceId, std::shared_ptr<VolumeEndpoint> &endpoint) = 0;
+};
+
+} // namespace MicVol
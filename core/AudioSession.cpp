@@ -0,0 +1,215 @@
+#include "AudioSession.h"
+#include <algorithm>
+
+namespace MicVol
+{
+
+HRESULT AudioSession::Open()
+{
+    if (m_open)
+        return S_FALSE;
+
+    Count(&SessionCallCounters::initializations);
+    HRESULT hr = m_backend.Initialize();
+    if (SUCCEEDED(hr))
+        m_open = true;
+    return hr;
+}
+
+void AudioSession::Close()
+{
+    if (!m_open)
+        return;
+
+    // Interfaces must be released before the backend uninitializes COM
+    m_endpoints.clear();
+    m_backend.Uninitialize();
+    m_open = false;
+}
+
+HRESULT AudioSession::EnumerateCaptureEndpoints(std::vector<DeviceHandle> &devices)
+{
+    devices.clear();
+
+    std::vector<std::wstring> deviceIds;
+    Count(&SessionCallCounters::enumerations);
+    HRESULT hr = m_backend.EnumerateCaptureEndpoints(deviceIds);
+    if (FAILED(hr))
+        return hr;
+
+    for (const std::wstring &deviceId : deviceIds)
+    {
+        devices.push_back(m_devices.Intern(deviceId));
+    }
+
+    for (DeviceHandle device = 0; device < (DeviceHandle)m_endpoints.size(); device++)
+    {
+        if (std::find(devices.begin(), devices.end(), device) == devices.end())
+            Forget(device);
+    }
+    return hr;
+}
+
+const std::wstring &AudioSession::GetName(DeviceHandle device)
+{
+    CachedEndpoint &entry = Entry(device);
+    if (!entry.hasName)
+    {
+        Count(&SessionCallCounters::nameReads);
+        if (FAILED(m_backend.GetEndpointName(m_devices.EndpointId(device), entry.name)))
+        {
+            // Not cached, so a transient failure is retried next time
+            entry.name = L"Unknown";
+            return entry.name;
+        }
+        entry.hasName = true;
+    }
+    return entry.name;
+}
+
+HRESULT AudioSession::GetEndpoint(DeviceHandle device, std::shared_ptr<VolumeEndpoint> &endpoint)
+{
+    CachedEndpoint &entry = Entry(device);
+    if (!entry.volume)
+    {
+        Count(&SessionCallCounters::activations);
+        HRESULT hr = m_backend.ActivateVolume(m_devices.EndpointId(device), entry.volume);
+        if (FAILED(hr))
+        {
+            entry.volume.reset();
+            return hr;
+        }
+    }
+
+    endpoint = entry.volume;
+    return S_OK;
+}
+
+bool AudioSession::FindEndpoint(DeviceHandle device, std::shared_ptr<VolumeEndpoint> &endpoint)
+{
+    if (device >= m_endpoints.size() || !m_endpoints[device].volume)
+        return false;
+    endpoint = m_endpoints[device].volume;
+    return true;
+}
+
+void AudioSession::CacheEndpoint(DeviceHandle device, std::shared_ptr<VolumeEndpoint> endpoint)
+{
+    Entry(device).volume = std::move(endpoint);
+}
+
+HRESULT AudioSession::GetVolume(DeviceHandle device, float *level)
+{
+    CachedEndpoint &entry = Entry(device);
+    if (!entry.volume)
+    {
+        std::shared_ptr<VolumeEndpoint> endpoint;
+        HRESULT hr = GetEndpoint(device, endpoint);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    Count(&SessionCallCounters::volumeReads);
+    HRESULT hr = entry.volume->GetMasterVolume(level);
+    if (FAILED(hr))
+        Invalidate(device);
+    return hr;
+}
+
+HRESULT AudioSession::SetVolume(DeviceHandle device, float level)
+{
+    CachedEndpoint &entry = Entry(device);
+    if (!entry.volume)
+    {
+        std::shared_ptr<VolumeEndpoint> endpoint;
+        HRESULT hr = GetEndpoint(device, endpoint);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    Count(&SessionCallCounters::volumeWrites);
+    HRESULT hr = entry.volume->SetMasterVolume(level);
+    if (FAILED(hr))
+        Invalidate(device);
+    return hr;
+}
+
+HRESULT AudioSession::GetMute(DeviceHandle device, bool *muted)
+{
+    CachedEndpoint &entry = Entry(device);
+    if (!entry.volume)
+    {
+        std::shared_ptr<VolumeEndpoint> endpoint;
+        HRESULT hr = GetEndpoint(device, endpoint);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    Count(&SessionCallCounters::muteReads);
+    HRESULT hr = entry.volume->GetMute(muted);
+    if (FAILED(hr))
+        Invalidate(device);
+    return hr;
+}
+
+HRESULT AudioSession::SetMute(DeviceHandle device, bool muted)
+{
+    CachedEndpoint &entry = Entry(device);
+    if (!entry.volume)
+    {
+        std::shared_ptr<VolumeEndpoint> endpoint;
+        HRESULT hr = GetEndpoint(device, endpoint);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    Count(&SessionCallCounters::muteWrites);
+    HRESULT hr = entry.volume->SetMute(muted);
+    if (FAILED(hr))
+        Invalidate(device);
+    return hr;
+}
+
+void AudioSession::Invalidate(DeviceHandle device)
+{
+    if (device < m_endpoints.size())
+        m_endpoints[device].volume.reset();
+}
+
+void AudioSession::Forget(DeviceHandle device)
+{
+    if (device < m_endpoints.size())
+        m_endpoints[device] = CachedEndpoint();
+}
+
+void AudioSession::ForgetName(DeviceHandle device)
+{
+    if (device < m_endpoints.size())
+        m_endpoints[device].hasName = false;
+}
+
+size_t AudioSession::CachedEndpointCount() const
+{
+    size_t count = 0;
+    for (const CachedEndpoint &entry : m_endpoints)
+    {
+        if (entry.volume || entry.hasName)
+            count++;
+    }
+    return count;
+}
+
+AudioSession::CachedEndpoint &AudioSession::Entry(DeviceHandle device)
+{
+    if (device >= m_endpoints.size())
+        m_endpoints.resize(m_devices.Size());
+    return m_endpoints[device];
+}
+
+void AudioSession::Count(unsigned long long SessionCallCounters::*counter)
+{
+    m_tickCalls.*counter += 1;
+    m_totalCalls.*counter += 1;
+}
+
+} // namespace MicVol
@@ -0,0 +1,119 @@
+#pragma once
+#include "AudioBackend.h"
+#include "DeviceTable.h"
+
+namespace MicVol
+{
+
+// Backend calls made through an AudioSession
+struct SessionCallCounters
+{
+    unsigned long long initializations = 0;
+    unsigned long long enumerations = 0;
+    unsigned long long nameReads = 0;
+    unsigned long long activations = 0;
+    unsigned long long volumeReads = 0;
+    unsigned long long volumeWrites = 0;
+    unsigned long long muteReads = 0;
+    unsigned long long muteWrites = 0;
+
+    unsigned long long Total() const
+    {
+        return initializations + enumerations + nameReads + activations + volumeReads + volumeWrites +
+               muteReads + muteWrites;
+    }
+
+    void Add(const SessionCallCounters &calls)
+    {
+        initializations += calls.initializations;
+        enumerations += calls.enumerations;
+        nameReads += calls.nameReads;
+        activations += calls.activations;
+        volumeReads += calls.volumeReads;
+        volumeWrites += calls.volumeWrites;
+        muteReads += calls.muteReads;
+        muteWrites += calls.muteWrites;
+    }
+};
+
+// Long-lived connection to the audio stack.
+//
+// Owns backend initialization (COM + enumerator) and caches the activated volume
+// interface and friendly name of every endpoint, so a steady-state tick only
+// reads/writes volumes. A cache entry is dropped when its device disappears from
+// an enumeration or when a call through it fails; the next use re-activates it.
+// Devices are addressed by their DeviceTable handle.
+class AudioSession
+{
+public:
+    AudioSession(AudioBackend &backend, DeviceTable &devices) : m_backend(backend), m_devices(devices) {}
+    ~AudioSession() { Close(); }
+
+    AudioSession(const AudioSession &) = delete;
+    AudioSession &operator=(const AudioSession &) = delete;
+
+    // Idempotent; only the first successful call touches the backend
+    HRESULT Open();
+    void Close();
+    bool IsOpen() const { return m_open; }
+
+    // Starts a new per-tick call window
+    void BeginTick() { m_tickCalls = SessionCallCounters(); }
+    const SessionCallCounters &TickCalls() const { return m_tickCalls; }
+    const SessionCallCounters &TotalCalls() const { return m_totalCalls; }
+
+    // Interns every reported device and forgets cached endpoints that are no longer reported
+    HRESULT EnumerateCaptureEndpoints(std::vector<DeviceHandle> &devices);
+
+    const std::wstring &GetName(DeviceHandle device);
+    HRESULT GetEndpoint(DeviceHandle device, std::shared_ptr<VolumeEndpoint> &endpoint);
+
+    // The cached endpoint, without activating one; false when none is cached
+    bool FindEndpoint(DeviceHandle device, std::shared_ptr<VolumeEndpoint> &endpoint);
+
+    // Caches an endpoint activated by the caller, e.g. on another thread; count the
+    // activation with CountCalls()
+    void CacheEndpoint(DeviceHandle device, std::shared_ptr<VolumeEndpoint> endpoint);
+    HRESULT GetVolume(DeviceHandle device, float *level);
+    HRESULT SetVolume(DeviceHandle device, float level);
+    HRESULT GetMute(DeviceHandle device, bool *muted);
+    HRESULT SetMute(DeviceHandle device, bool muted);
+
+    // Counts calls made directly on an endpoint from GetEndpoint(), e.g. on another thread
+    void CountCalls(const SessionCallCounters &calls)
+    {
+        m_tickCalls.Add(calls);
+        m_totalCalls.Add(calls);
+    }
+
+    // Drops the activated interface after a failed call; the name stays cached
+    void Invalidate(DeviceHandle device);
+
+    // Drops everything cached for a device that went away
+    void Forget(DeviceHandle device);
+
+    // The friendly name is re-read on next use (device renamed)
+    void ForgetName(DeviceHandle device);
+
+    size_t CachedEndpointCount() const;
+
+private:
+    struct CachedEndpoint
+    {
+        std::wstring name;
+        bool hasName = false;
+        std::shared_ptr<VolumeEndpoint> volume;
+    };
+
+    CachedEndpoint &Entry(DeviceHandle device);
+    void Count(unsigned long long SessionCallCounters::*counter);
+
+    AudioBackend &m_backend;
+    DeviceTable &m_devices;
+    bool m_open = false;
+    std::vector<CachedEndpoint> m_endpoints; // Indexed by DeviceHandle
+    SessionCallCounters m_tickCalls;
+    SessionCallCounters m_totalCalls;
+};
+
+} // namespace MicVol
@@ -0,0 +1,593 @@
+#include "BinaryEventLog.h"
+#include "FileIo.h"
+#include "Suspension.h"
+#include <cstring>
+#include <ctime>
+#include <cwchar>
+#include <cwctype>
+#include <filesystem>
+
+namespace MicVol
+{
+
+static const char FileMagic[8] = {'M', 'V', 'S', 'E', 'V', 'L', 'O', 'G'};
+
+// Names are stored as UTF-16 regardless of the platform's wchar_t
+static void AppendUtf16(std::vector<uint8_t> &out, const std::wstring &text)
+{
+    auto put = [&out](uint16_t unit) {
+        out.push_back((uint8_t)(unit & 0xFF));
+        out.push_back((uint8_t)(unit >> 8));
+    };
+    for (wchar_t ch : text)
+    {
+        uint32_t c = (uint32_t)ch;
+        if (c >= 0x10000 && c <= 0x10FFFF)
+        {
+            c -= 0x10000;
+            put((uint16_t)(0xD800 + (c >> 10)));
+            put((uint16_t)(0xDC00 + (c & 0x3FF)));
+        }
+        else
+        {
+            put((uint16_t)c);
+        }
+    }
+}
+
+static size_t Utf16Length(const std::wstring &text)
+{
+    size_t units = 0;
+    for (wchar_t ch : text)
+    {
+        units += ((uint32_t)ch >= 0x10000 && (uint32_t)ch <= 0x10FFFF) ? 2 : 1;
+    }
+    return units;
+}
+
+static std::wstring DecodeUtf16(const uint8_t *data, size_t units)
+{
+    std::wstring text;
+    text.reserve(units);
+    for (size_t i = 0; i < units; i++)
+    {
+        uint32_t c = data[i * 2] | (data[i * 2 + 1] << 8);
+        if (sizeof(wchar_t) == 4 && c >= 0xD800 && c <= 0xDBFF && i + 1 < units)
+        {
+            uint32_t low = data[(i + 1) * 2] | (data[(i + 1) * 2 + 1] << 8);
+            if (low >= 0xDC00 && low <= 0xDFFF)
+            {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+            }
+        }
+        text += (wchar_t)c;
+    }
+    return text;
+}
+
+static bool ReadFileHeader(FILE *file)
+{
+    BinaryLogFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1)
+        return false;
+    return memcmp(header.magic, FileMagic, sizeof(FileMagic)) == 0 && header.version == BinaryLogVersion &&
+           header.recordSize == sizeof(EventRecord);
+}
+
+// Offset just past the last complete block; a crash can leave a partial one behind
+static long FindValidEnd(FILE *file)
+{
+    long end = (long)sizeof(BinaryLogFileHeader);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, end, SEEK_SET);
+
+    BinaryLogBlockHeader header;
+    while (fread(&header, sizeof(header), 1, file) == 1)
+    {
+        if (header.magic != BinaryLogBlockMagic)
+            break;
+        long next = end + (long)sizeof(header) + (long)header.payloadBytes;
+        if (next > size)
+            break;
+        end = next;
+        fseek(file, end, SEEK_SET);
+    }
+    return end;
+}
+
+// BinaryLogWriter
+
+BinaryLogWriter::BinaryLogWriter(uint16_t blockRecords, uint64_t flushIntervalMs)
+    : m_blockRecords(blockRecords ? blockRecords : 1), m_flushIntervalMs(flushIntervalMs)
+{
+    m_pending.reserve(m_blockRecords);
+}
+
+BinaryLogWriter::~BinaryLogWriter()
+{
+    Close();
+}
+
+HRESULT BinaryLogWriter::Open(const std::wstring &path, uint64_t nowMs)
+{
+    Close();
+
+    // An existing log must be ours; cut off a partial block left by a crash
+    bool exists = false;
+    FILE *existing = OpenSharedFile(path, "rb");
+    if (existing)
+    {
+        fseek(existing, 0, SEEK_END);
+        exists = ftell(existing) > 0;
+        if (exists)
+        {
+            fseek(existing, 0, SEEK_SET);
+            if (!ReadFileHeader(existing))
+            {
+                fclose(existing);
+                return E_INVALIDARG;
+            }
+            long validEnd = FindValidEnd(existing);
+            fseek(existing, 0, SEEK_END);
+            long size = ftell(existing);
+            fclose(existing);
+            if (validEnd != size)
+            {
+                std::error_code error;
+                std::filesystem::resize_file(std::filesystem::path(path), (uintmax_t)validEnd, error);
+                if (error)
+                    return E_FAIL;
+            }
+        }
+        else
+        {
+            fclose(existing);
+        }
+    }
+
+    m_file = OpenSharedFile(path, "ab");
+    if (!m_file)
+        return E_FAIL;
+
+    if (!exists)
+    {
+        BinaryLogFileHeader header = {};
+        memcpy(header.magic, FileMagic, sizeof(FileMagic));
+        header.version = BinaryLogVersion;
+        header.recordSize = sizeof(EventRecord);
+        header.createdMs = nowMs;
+        if (fwrite(&header, sizeof(header), 1, m_file) != 1)
+        {
+            Close();
+            return E_FAIL;
+        }
+    }
+
+    m_pending.clear();
+    m_described.clear();
+    m_namesPayload.clear();
+    m_namesCount = 0;
+
+    HRESULT hr = WriteBlock(BinaryLogBlockKind::Session, 0, nowMs, nowMs, 0, nullptr, 0);
+    if (SUCCEEDED(hr) && fflush(m_file) != 0)
+        hr = E_FAIL;
+    if (FAILED(hr))
+    {
+        Close();
+    }
+    return hr;
+}
+
+void BinaryLogWriter::Close()
+{
+    if (!m_file)
+        return;
+
+    Flush();
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+void BinaryLogWriter::Describe(DeviceHandle device, const std::wstring &endpointId, const std::wstring &name)
+{
+    if (device == InvalidDeviceHandle)
+        return;
+
+    if (device >= m_described.size())
+    {
+        m_described.resize(device + 1, false);
+    }
+    m_described[device] = true;
+
+    uint32_t handle = device;
+    uint16_t idLength = (uint16_t)Utf16Length(endpointId);
+    uint16_t nameLength = (uint16_t)Utf16Length(name);
+    const uint8_t *fields[] = {(const uint8_t *)&handle, (const uint8_t *)&idLength, (const uint8_t *)&nameLength};
+    const size_t sizes[] = {sizeof(handle), sizeof(idLength), sizeof(nameLength)};
+    for (size_t i = 0; i < 3; i++)
+    {
+        m_namesPayload.insert(m_namesPayload.end(), fields[i], fields[i] + sizes[i]);
+    }
+    AppendUtf16(m_namesPayload, endpointId);
+    AppendUtf16(m_namesPayload, name);
+    m_namesCount++;
+}
+
+bool BinaryLogWriter::IsDescribed(DeviceHandle device) const
+{
+    return device < m_described.size() && m_described[device];
+}
+
+void BinaryLogWriter::Append(const EventRecord &record)
+{
+    if (!m_file)
+        return;
+
+    m_pending.push_back(record);
+    if (m_pending.size() >= m_blockRecords)
+    {
+        Flush();
+    }
+}
+
+HRESULT BinaryLogWriter::Flush()
+{
+    if (!m_file)
+        return S_FALSE;
+
+    HRESULT hr = WriteNames();
+    if (SUCCEEDED(hr) && !m_pending.empty())
+    {
+        uint64_t firstMs = m_pending.front().timestampMs;
+        uint64_t lastMs = firstMs;
+        uint64_t mask = 0;
+        for (const EventRecord &record : m_pending)
+        {
+            if (record.timestampMs < firstMs)
+                firstMs = record.timestampMs;
+            if (record.timestampMs > lastMs)
+                lastMs = record.timestampMs;
+            mask |= DeviceMaskBit(record.device);
+        }
+        hr = WriteBlock(BinaryLogBlockKind::Events, (uint16_t)m_pending.size(), firstMs, lastMs, mask, m_pending.data(),
+                        m_pending.size() * sizeof(EventRecord));
+        m_pending.clear();
+    }
+
+    if (fflush(m_file) != 0)
+        hr = E_FAIL;
+    return hr;
+}
+
+HRESULT BinaryLogWriter::FlushIfDue(uint64_t nowMs)
+{
+    if (m_pending.empty() || nowMs < m_pending.front().timestampMs + m_flushIntervalMs)
+        return S_FALSE;
+    return Flush();
+}
+
+HRESULT BinaryLogWriter::WriteNames()
+{
+    if (m_namesCount == 0)
+        return S_OK;
+
+    HRESULT hr = WriteBlock(BinaryLogBlockKind::Names, m_namesCount, 0, 0, 0, m_namesPayload.data(), m_namesPayload.size());
+    m_namesPayload.clear();
+    m_namesCount = 0;
+    return hr;
+}
+
+HRESULT BinaryLogWriter::WriteBlock(BinaryLogBlockKind kind, uint16_t count, uint64_t firstMs, uint64_t lastMs,
+                                    uint64_t deviceMask, const void *payload, size_t payloadBytes)
+{
+    BinaryLogBlockHeader header = {};
+    header.magic = BinaryLogBlockMagic;
+    header.kind = (uint16_t)kind;
+    header.count = count;
+    header.firstMs = firstMs;
+    header.lastMs = lastMs;
+    header.deviceMask = deviceMask;
+    header.payloadBytes = (uint32_t)payloadBytes;
+
+    if (fwrite(&header, sizeof(header), 1, m_file) != 1)
+        return E_FAIL;
+    if (payloadBytes > 0 && fwrite(payload, payloadBytes, 1, m_file) != 1)
+        return E_FAIL;
+
+    m_blocksWritten++;
+    return S_OK;
+}
+
+// BinaryLogReader
+
+BinaryLogReader::~BinaryLogReader()
+{
+    Close();
+}
+
+HRESULT BinaryLogReader::Open(const std::wstring &path)
+{
+    Close();
+
+    m_file = OpenSharedFile(path, "rb");
+    if (!m_file)
+        return E_FAIL;
+
+    if (!ReadFileHeader(m_file))
+    {
+        Close();
+        return E_INVALIDARG;
+    }
+    return S_OK;
+}
+
+void BinaryLogReader::Close()
+{
+    if (m_file)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+static bool ContainsNoCase(const std::wstring &text, const std::wstring &part)
+{
+    if (part.size() > text.size())
+        return false;
+
+    for (size_t start = 0; start + part.size() <= text.size(); start++)
+    {
+        size_t i = 0;
+        while (i < part.size() && std::towlower(text[start + i]) == std::towlower(part[i]))
+        {
+            i++;
+        }
+        if (i == part.size())
+            return true;
+    }
+    return false;
+}
+
+HRESULT BinaryLogReader::Query(const BinaryLogQuery &query, std::vector<DecodedEvent> &events, BinaryLogQueryStats *stats)
+{
+    if (!m_file)
+        return E_FAIL;
+
+    BinaryLogQueryStats localStats;
+    if (!stats)
+        stats = &localStats;
+
+    struct DeviceName
+    {
+        std::wstring endpointId;
+        std::wstring name;
+        bool matches = false;
+    };
+    std::vector<DeviceName> devices; // Indexed by handle, reset with every session
+    uint64_t matchMask = 0;
+    std::vector<uint8_t> payload;
+
+    fseek(m_file, (long)sizeof(BinaryLogFileHeader), SEEK_SET);
+
+    BinaryLogBlockHeader header;
+    while (fread(&header, sizeof(header), 1, m_file) == 1 && header.magic == BinaryLogBlockMagic)
+    {
+        BinaryLogBlockKind kind = (BinaryLogBlockKind)header.kind;
+
+        if (kind == BinaryLogBlockKind::Events)
+        {
+            bool timeMatches = header.lastMs >= query.fromMs && header.firstMs <= query.toMs;
+            bool deviceMatches = query.device.empty() || (header.deviceMask & matchMask) != 0;
+            if (!timeMatches || !deviceMatches)
+            {
+                fseek(m_file, (long)header.payloadBytes, SEEK_CUR);
+                stats->blocksSkipped++;
+                continue;
+            }
+        }
+        else if (kind != BinaryLogBlockKind::Names)
+        {
+            if (kind == BinaryLogBlockKind::Session)
+            {
+                devices.clear();
+                matchMask = 0;
+            }
+            fseek(m_file, (long)header.payloadBytes, SEEK_CUR);
+            continue;
+        }
+
+        payload.resize(header.payloadBytes);
+        if (header.payloadBytes > 0 && fread(payload.data(), header.payloadBytes, 1, m_file) != 1)
+            break; // Truncated tail
+        stats->blocksRead++;
+
+        if (kind == BinaryLogBlockKind::Names)
+        {
+            size_t offset = 0;
+            for (uint16_t i = 0; i < header.count && offset + 8 <= payload.size(); i++)
+            {
+                uint32_t handle;
+                uint16_t idLength;
+                uint16_t nameLength;
+                memcpy(&handle, &payload[offset], 4);
+                memcpy(&idLength, &payload[offset + 4], 2);
+                memcpy(&nameLength, &payload[offset + 6], 2);
+                offset += 8;
+                if (offset + (idLength + nameLength) * 2u > payload.size() || handle == InvalidDeviceHandle)
+                    break;
+
+                if (handle >= devices.size())
+                {
+                    devices.resize(handle + 1);
+                }
+                DeviceName &device = devices[handle];
+                device.endpointId = DecodeUtf16(&payload[offset], idLength);
+                device.name = DecodeUtf16(&payload[offset + idLength * 2], nameLength);
+                device.matches = query.device.empty() || ContainsNoCase(device.name, query.device) ||
+                                 ContainsNoCase(device.endpointId, query.device);
+                if (device.matches)
+                {
+                    matchMask |= DeviceMaskBit(handle);
+                }
+                offset += (idLength + nameLength) * 2u;
+            }
+            continue;
+        }
+
+        size_t count = payload.size() / sizeof(EventRecord);
+        for (size_t i = 0; i < count; i++)
+        {
+            DecodedEvent event;
+            memcpy(&event.record, &payload[i * sizeof(EventRecord)], sizeof(EventRecord));
+            if (event.record.timestampMs < query.fromMs || event.record.timestampMs > query.toMs)
+                continue;
+
+            const DeviceName *device = event.record.device < devices.size() ? &devices[event.record.device] : nullptr;
+            if (!query.device.empty() && !(device && device->matches))
+                continue;
+
+            if (device)
+            {
+                event.deviceName = device->name;
+                event.endpointId = device->endpointId;
+            }
+            events.push_back(event);
+        }
+    }
+    return S_OK;
+}
+
+const wchar_t *EventTypeName(EventType type)
+{
+    switch (type)
+    {
+    case EventType::ServiceStarted:
+        return L"ServiceStarted";
+    case EventType::ServiceStopped:
+        return L"ServiceStopped";
+    case EventType::DeviceAdded:
+        return L"DeviceAdded";
+    case EventType::DeviceRemoved:
+        return L"DeviceRemoved";
+    case EventType::VolumeChanged:
+        return L"VolumeChanged";
+    case EventType::VolumeCorrected:
+        return L"VolumeCorrected";
+    case EventType::CorrectionFailed:
+        return L"CorrectionFailed";
+    case EventType::ReadFailed:
+        return L"ReadFailed";
+    case EventType::TamperWarStarted:
+        return L"TamperWarStarted";
+    case EventType::TamperWarEnded:
+        return L"TamperWarEnded";
+    case EventType::Suspended:
+        return L"Suspended";
+    case EventType::Resumed:
+        return L"Resumed";
+    }
+    return L"Unknown";
+}
+
+std::wstring FormatEvent(const DecodedEvent &event)
+{
+    const EventRecord &record = event.record;
+    struct tm local;
+    ToLocalTime((int64_t)(record.timestampMs / 1000), local);
+
+    wchar_t buffer[128];
+    swprintf(buffer, 128, L"[%04d-%02d-%02d %02d:%02d:%02d.%03d] %ls", local.tm_year + 1900, local.tm_mon + 1,
+             local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec, (int)(record.timestampMs % 1000),
+             EventTypeName((EventType)record.type));
+    std::wstring line = buffer;
+
+    if (record.device != InvalidDeviceHandle)
+    {
+        line += L" ";
+        line += event.deviceName.empty() ? L"device #" + std::to_wstring(record.device) : event.deviceName;
+    }
+
+    switch ((EventType)record.type)
+    {
+    case EventType::DeviceAdded:
+        swprintf(buffer, 128, L" volume %d%%", (int)(record.newVolume * 100 + 0.5f));
+        line += buffer;
+        break;
+    case EventType::VolumeChanged:
+    case EventType::VolumeCorrected:
+        swprintf(buffer, 128, L" %d%% -> %d%%", (int)(record.oldVolume * 100 + 0.5f), (int)(record.newVolume * 100 + 0.5f));
+        line += buffer;
+        if (record.writer != (uint16_t)WriterKind::Unknown)
+        {
+            line += L" (by ";
+            line += WriterKindName((WriterKind)record.writer);
+            line += L")";
+        }
+        break;
+    case EventType::CorrectionFailed:
+    case EventType::ReadFailed:
+        swprintf(buffer, 128, L" hr 0x%08X", (unsigned)record.hr);
+        line += buffer;
+        break;
+    case EventType::TamperWarEnded:
+        swprintf(buffer, 128, L" after %u rounds", record.count);
+        line += buffer;
+        break;
+    case EventType::Suspended:
+        line += L" (";
+        line += SuspendReasonsName(record.count);
+        line += L")";
+        break;
+    case EventType::Resumed:
+        swprintf(buffer, 128, L" after %u s", record.count);
+        line += buffer;
+        break;
+    default:
+        break;
+    }
+    return line;
+}
+
+bool ParseLocalTime(const std::wstring &text, uint64_t &ms)
+{
+    // Numbers separated by exactly these characters: YYYY-MM-DD HH:MM:SS
+    static const wchar_t Separators[] = L"-- ::";
+    int values[6] = {};
+    int fields = 0;
+    const wchar_t *p = text.c_str();
+    while (fields < 6)
+    {
+        if (*p < L'0' || *p > L'9')
+            return false;
+        while (*p >= L'0' && *p <= L'9')
+        {
+            values[fields] = values[fields] * 10 + (*p - L'0');
+            p++;
+        }
+        fields++;
+        if (*p == L'\0' || fields == 6 || *p != Separators[fields - 1])
+            break;
+        p++;
+    }
+    if (*p != L'\0' || (fields != 3 && fields != 5 && fields != 6))
+        return false;
+
+    struct tm local = {};
+    local.tm_year = values[0] - 1900;
+    local.tm_mon = values[1] - 1;
+    local.tm_mday = values[2];
+    local.tm_hour = values[3];
+    local.tm_min = values[4];
+    local.tm_sec = values[5];
+    local.tm_isdst = -1;
+    time_t seconds = mktime(&local);
+    if (seconds == (time_t)-1)
+        return false;
+
+    ms = (uint64_t)seconds * 1000;
+    return true;
+}
+
+} // namespace MicVol
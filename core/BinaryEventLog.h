@@ -0,0 +1,176 @@
+#pragma once
+#include "DeviceTable.h"
+#include "Platform.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace MicVol
+{
+
+// Binary event log layout (little-endian):
+//
+//   BinaryLogFileHeader
+//   block*  each block = BinaryLogBlockHeader + payloadBytes of payload
+//
+// A Session block starts every run of the writer: device handles are only
+// meaningful within one session. Names blocks map handles to endpoint ID and
+// friendly name. Events blocks hold fixed-size EventRecords; their headers carry
+// the time range and a device bit mask so queries can seek past whole blocks.
+
+enum class EventType : uint16_t
+{
+    ServiceStarted = 1,
+    ServiceStopped = 2,
+    DeviceAdded = 3,
+    DeviceRemoved = 4,
+    VolumeChanged = 5,    // Observed a level different from the last one
+    VolumeCorrected = 6,  // Wrote the target level
+    CorrectionFailed = 7, // Write failed, hr says why
+    ReadFailed = 8,       // Reading the level failed, hr says why
+    TamperWarStarted = 9, // Another application keeps re-applying its level; its rounds are not recorded
+    TamperWarEnded = 10,  // count has the rounds
+    Suspended = 11,       // count has the Suspend* reason bits
+    Resumed = 12          // count has the seconds enforcement was suspended
+};
+
+enum class BinaryLogBlockKind : uint16_t
+{
+    Session = 1,
+    Names = 2,
+    Events = 3
+};
+
+struct BinaryLogFileHeader
+{
+    char magic[8]; // "MVSEVLOG"
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t reserved;
+    uint64_t createdMs;
+};
+
+struct BinaryLogBlockHeader
+{
+    uint32_t magic; // BinaryLogBlockMagic
+    uint16_t kind;
+    uint16_t count; // Records or name entries
+    uint64_t firstMs;
+    uint64_t lastMs;
+    uint64_t deviceMask; // Bit (handle % 64) set for every device in the block
+    uint32_t payloadBytes;
+    uint32_t reserved;
+};
+
+struct EventRecord
+{
+    uint64_t timestampMs; // Wall clock, milliseconds since the Unix epoch
+    uint32_t device;      // DeviceHandle within the session, InvalidDeviceHandle for service events
+    uint16_t type;        // EventType
+    uint16_t writer;      // WriterKind of a corrected change, 0 (unknown) in logs of older versions
+    float oldVolume;
+    float newVolume;
+    int32_t hr;
+    uint32_t count; // Rounds of a TamperWarEnded event, reasons or seconds of Suspended and Resumed, 0 otherwise
+};
+
+static_assert(sizeof(BinaryLogFileHeader) == 24, "file header layout is part of the format");
+static_assert(sizeof(BinaryLogBlockHeader) == 40, "block header layout is part of the format");
+static_assert(sizeof(EventRecord) == 32, "record layout is part of the format");
+
+const uint16_t BinaryLogVersion = 1;
+const uint32_t BinaryLogBlockMagic = 0x4B4C4256; // "VBLK"
+
+inline uint64_t DeviceMaskBit(uint32_t device)
+{
+    return device == InvalidDeviceHandle ? 0 : (uint64_t)1 << (device % 64);
+}
+
+// Appends events to a binary log. Records are buffered and written one block at
+// a time, when the block is full, when FlushIfDue() finds the oldest buffered
+// record older than the flush interval, and on Close(). Single-threaded.
+class BinaryLogWriter
+{
+public:
+    explicit BinaryLogWriter(uint16_t blockRecords = 256, uint64_t flushIntervalMs = 1000);
+    ~BinaryLogWriter();
+
+    BinaryLogWriter(const BinaryLogWriter &) = delete;
+    BinaryLogWriter &operator=(const BinaryLogWriter &) = delete;
+
+    // Creates the file or appends to an existing log; starts a new session
+    HRESULT Open(const std::wstring &path, uint64_t nowMs);
+    void Close();
+    bool IsOpen() const { return m_file != nullptr; }
+
+    // Records the endpoint ID and name a handle stands for; written before the next events
+    void Describe(DeviceHandle device, const std::wstring &endpointId, const std::wstring &name);
+    bool IsDescribed(DeviceHandle device) const;
+
+    void Append(const EventRecord &record);
+    HRESULT Flush();
+    HRESULT FlushIfDue(uint64_t nowMs);
+
+    uint64_t BlocksWritten() const { return m_blocksWritten; }
+
+private:
+    HRESULT WriteBlock(BinaryLogBlockKind kind, uint16_t count, uint64_t firstMs, uint64_t lastMs,
+                       uint64_t deviceMask, const void *payload, size_t payloadBytes);
+    HRESULT WriteNames();
+
+    FILE *m_file = nullptr;
+    uint16_t m_blockRecords;
+    uint64_t m_flushIntervalMs;
+    std::vector<EventRecord> m_pending;
+    std::vector<bool> m_described;
+    std::vector<uint8_t> m_namesPayload; // Name entries not yet written
+    uint16_t m_namesCount = 0;
+    uint64_t m_blocksWritten = 0;
+};
+
+struct BinaryLogQuery
+{
+    uint64_t fromMs = 0;
+    uint64_t toMs = UINT64_MAX;
+    std::wstring device; // Case-insensitive substring of the name or endpoint ID; empty matches all
+};
+
+struct DecodedEvent
+{
+    EventRecord record;
+    std::wstring deviceName; // Empty for service events
+    std::wstring endpointId;
+};
+
+struct BinaryLogQueryStats
+{
+    uint32_t blocksRead = 0;
+    uint32_t blocksSkipped = 0; // Seeked past using the header's time range and device mask
+};
+
+// Reads a binary log. Query() walks the block headers and only reads event
+// payloads whose time range and device mask can match.
+class BinaryLogReader
+{
+public:
+    ~BinaryLogReader();
+
+    HRESULT Open(const std::wstring &path);
+    void Close();
+
+    HRESULT Query(const BinaryLogQuery &query, std::vector<DecodedEvent> &events, BinaryLogQueryStats *stats = nullptr);
+
+private:
+    FILE *m_file = nullptr;
+};
+
+const wchar_t *EventTypeName(EventType type);
+
+// "[2025-01-31 18:04:05.123] VolumeCorrected Headset Microphone 37% -> 100%"
+std::wstring FormatEvent(const DecodedEvent &event);
+
+// Parses local time "YYYY-MM-DD", "YYYY-MM-DD HH:MM" or "YYYY-MM-DD HH:MM:SS"
+bool ParseLocalTime(const std::wstring &text, uint64_t &ms);
+
+} // namespace MicVol
@@ -0,0 +1,91 @@
+#include "CircuitBreaker.h"
+
+namespace MicVol
+{
+
+void CircuitBreaker::SetOptions(const BreakerOptions &options)
+{
+    m_options = options;
+    if (m_options.failures < 1)
+        m_options.failures = 1;
+    if (m_options.openMs < 1)
+        m_options.openMs = 1;
+    if (m_options.maxOpenMs < m_options.openMs)
+        m_options.maxOpenMs = m_options.openMs;
+    m_states.clear();
+}
+
+CircuitBreakerState &CircuitBreaker::Get(DeviceHandle device)
+{
+    if (device >= m_states.size())
+        m_states.resize(device + 1);
+    return m_states[device];
+}
+
+bool CircuitBreaker::Allow(DeviceHandle device, uint64_t nowMs)
+{
+    if (device >= m_states.size())
+        return true;
+
+    CircuitBreakerState &state = m_states[device];
+    if (state.state == BreakerState::Open && nowMs >= state.retryAtMs)
+        state.state = BreakerState::HalfOpen;
+    return state.state != BreakerState::Open;
+}
+
+BreakerChange CircuitBreaker::OnSuccess(DeviceHandle device)
+{
+    if (device >= m_states.size())
+        return BreakerChange::None;
+
+    CircuitBreakerState &state = m_states[device];
+    bool wasOpen = state.state != BreakerState::Closed;
+    state.state = BreakerState::Closed;
+    state.failures = 0;
+    state.probes = 0;
+    return wasOpen ? BreakerChange::Closed : BreakerChange::None;
+}
+
+BreakerChange CircuitBreaker::OnFailure(DeviceHandle device, HRESULT hr, uint64_t nowMs)
+{
+    CircuitBreakerState &state = Get(device);
+    state.failures++;
+    state.lastError = hr;
+
+    if (state.state == BreakerState::Closed)
+    {
+        if (state.failures < m_options.failures)
+            return BreakerChange::None;
+        state.state = BreakerState::Open;
+        state.openMs = m_options.openMs;
+        state.openedMs = nowMs;
+        state.retryAtMs = nowMs + state.openMs;
+        return BreakerChange::Opened;
+    }
+
+    // A failed probe, or a failure reported late for a device already open
+    if (state.state == BreakerState::HalfOpen)
+    {
+        state.probes++;
+        uint64_t doubled = (uint64_t)state.openMs * 2;
+        state.openMs = (uint32_t)(doubled < m_options.maxOpenMs ? doubled : m_options.maxOpenMs);
+    }
+    state.state = BreakerState::Open;
+    state.retryAtMs = nowMs + state.openMs;
+    return BreakerChange::Reopened;
+}
+
+uint64_t CircuitBreaker::RetryAtMs(DeviceHandle device) const
+{
+    if (!IsOpen(device))
+        return UINT64_MAX;
+    return m_states[device].retryAtMs;
+}
+
+void CircuitBreaker::Forget(DeviceHandle device)
+{
+    if (device < m_states.size())
+        m_states[device] = CircuitBreakerState();
+}
+
+} // namespace MicVol
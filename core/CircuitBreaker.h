@@ -0,0 +1,84 @@
+#pragma once
+#include "DeviceTable.h"
+#include "Platform.h"
+#include <cstdint>
+#include <vector>
+
+namespace MicVol
+{
+
+struct BreakerOptions
+{
+    uint32_t failures = 3;        // Failed or timed out checks in a row that open the breaker
+    uint32_t openMs = 5000;       // First wait before a probe, doubled after every failed probe
+    uint32_t maxOpenMs = 300000;
+};
+
+enum class BreakerState : uint8_t
+{
+    Closed,  // Checked as usual
+    Open,    // Skipped until retryAtMs
+    HalfOpen // The wait is over; the next check is the probe
+};
+
+// Circuit breaker state of one device
+struct CircuitBreakerState
+{
+    BreakerState state = BreakerState::Closed;
+    uint32_t failures = 0;      // In a row
+    uint32_t openMs = 0;        // Current wait
+    uint64_t openedMs = 0;      // When it opened after the last success
+    uint64_t retryAtMs = 0;     // Open: no check before this
+    uint32_t probes = 0;        // Failed probes since it opened
+    HRESULT lastError = S_OK;
+};
+
+enum class BreakerChange
+{
+    None,
+    Opened,   // Too many failures in a row
+    Reopened, // The probe failed; the wait doubled
+    Closed    // A check succeeded after the breaker opened
+};
+
+// Stops checking a device that keeps failing or timing out: after
+// BreakerOptions::failures failed checks in a row its breaker opens and the device
+// is skipped; once the wait is over one check probes it, which closes the breaker
+// on success and doubles the wait on failure. Pure bookkeeping like
+// TamperWarDetector: the clock is passed in and all calls come from the worker thread.
+class CircuitBreaker
+{
+public:
+    void SetOptions(const BreakerOptions &options);
+    const BreakerOptions &Options() const { return m_options; }
+
+    // False while open; an open breaker whose wait is over turns half-open and lets the
+    // device be checked. Asking again before the outcome is reported gives the same answer.
+    bool Allow(DeviceHandle device, uint64_t nowMs);
+
+    // Open or half-open: the device failed recently and has not recovered yet
+    bool IsOpen(DeviceHandle device) const
+    {
+        return device < m_states.size() && m_states[device].state != BreakerState::Closed;
+    }
+
+    BreakerChange OnSuccess(DeviceHandle device);
+    BreakerChange OnFailure(DeviceHandle device, HRESULT hr, uint64_t nowMs);
+
+    // Clock time of the next probe, Never (UINT64_MAX) while closed
+    uint64_t RetryAtMs(DeviceHandle device) const;
+
+    const CircuitBreakerState &State(DeviceHandle device) { return Get(device); }
+
+    // The device went away or was resynced; its breaker closes without a report
+    void Forget(DeviceHandle device);
+    void Reset() { m_states.clear(); }
+
+private:
+    CircuitBreakerState &Get(DeviceHandle device);
+
+    BreakerOptions m_options;
+    std::vector<CircuitBreakerState> m_states; // Indexed by DeviceHandle
+};
+
+} // namespace MicVol
@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace MicVol
+{
+
+// Millisecond time source, so scheduling and timestamps can run on a virtual clock in tests
+class Clock
+{
+public:
+    virtual ~Clock() = default;
+    virtual uint64_t NowMs() = 0;
+};
+
+class SteadyClock : public Clock
+{
+public:
+    uint64_t NowMs() override
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+};
+
+// Wall clock time for timestamps that are shown to people, milliseconds since the Unix epoch
+inline uint64_t WallClockMs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Steady clock in microseconds, for measuring durations; not affected by a virtual Clock
+inline uint64_t MonotonicUs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Only moves when told to
+class VirtualClock : public Clock
+{
+public:
+    explicit VirtualClock(uint64_t startMs = 0) : m_nowMs(startMs) {}
+
+    uint64_t NowMs() override { return m_nowMs.load(); }
+    void Advance(uint64_t ms) { m_nowMs += ms; }
+    void Set(uint64_t ms) { m_nowMs = ms; }
+
+private:
+    std::atomic<uint64_t> m_nowMs;
+};
+
+} // namespace MicVol
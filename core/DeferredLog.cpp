@@ -0,0 +1,122 @@
+#include "DeferredLog.h"
+#include <charconv>
+#include <cwchar>
+
+namespace MicVol
+{
+
+void LogNames::Set(DeviceHandle device, const std::wstring &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (device >= m_names.size())
+        m_names.resize(device + 1);
+    m_names[device] = name;
+}
+
+void LogNames::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_names.clear();
+}
+
+// Appends text[0..length) to the record, truncating at its capacity
+static void Append(LogRecord &record, const wchar_t *text, size_t length)
+{
+    size_t room = LogRecordMaxChars - 1 - record.length;
+    if (length > room)
+    {
+        length = room;
+        record.truncated = true;
+    }
+    std::wmemcpy(record.text + record.length, text, length);
+    record.length = (uint16_t)(record.length + length);
+}
+
+template <typename T>
+static void AppendNumber(LogRecord &record, T value)
+{
+    char digits[24];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    wchar_t wide[24];
+    size_t length = (size_t)(result.ptr - digits);
+    for (size_t i = 0; i < length; i++)
+        wide[i] = (wchar_t)digits[i];
+    Append(record, wide, length);
+}
+
+size_t LogNames::Copy(DeviceHandle device, wchar_t *text, size_t capacity) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (device < m_names.size() && !m_names[device].empty())
+        {
+            const std::wstring &name = m_names[device];
+            size_t length = name.size() < capacity ? name.size() : capacity;
+            std::wmemcpy(text, name.data(), length);
+            return length;
+        }
+    }
+
+    LogRecord fallback;
+    fallback.length = 0;
+    fallback.truncated = false;
+    Append(fallback, L"device ", 7);
+    AppendNumber(fallback, device);
+    size_t length = fallback.length < capacity ? fallback.length : capacity;
+    std::wmemcpy(text, fallback.text, length);
+    return length;
+}
+
+static void AppendArg(LogRecord &record, const LogArg &arg, const LogNames &names)
+{
+    switch (arg.type)
+    {
+    case LogArgType::Int:
+        AppendNumber(record, arg.i);
+        break;
+    case LogArgType::UInt:
+        AppendNumber(record, arg.u);
+        break;
+    case LogArgType::Percent:
+        AppendNumber(record, (int)(arg.f * 100 + 0.5f));
+        Append(record, L"%", 1);
+        break;
+    case LogArgType::Device:
+    {
+        size_t room = LogRecordMaxChars - 1 - record.length;
+        size_t length = names.Copy((DeviceHandle)arg.u, record.text + record.length, room);
+        record.length = (uint16_t)(record.length + length);
+        break;
+    }
+    case LogArgType::Text:
+        if (arg.text)
+            Append(record, arg.text, std::wcslen(arg.text));
+        break;
+    }
+}
+
+void FormatDeferred(const DeferredLogRecord &deferred, const LogNames &names, LogRecord &record)
+{
+    record.timestampMs = deferred.timestampMs;
+    record.level = deferred.level;
+    record.truncated = false;
+    record.length = 0;
+
+    const wchar_t *literal = deferred.format ? deferred.format : L"";
+    size_t next = 0;
+    for (;;)
+    {
+        const wchar_t *placeholder = std::wcsstr(literal, L"{}");
+        if (!placeholder || next >= deferred.argCount)
+        {
+            Append(record, literal, std::wcslen(literal));
+            break;
+        }
+        Append(record, literal, (size_t)(placeholder - literal));
+        AppendArg(record, deferred.args[next++], names);
+        literal = placeholder + 2;
+    }
+    record.text[record.length] = L'\0';
+}
+
+} // namespace MicVol
@@ -0,0 +1,109 @@
+#pragma once
+#include "DeviceTable.h"
+#include "LogSink.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace MicVol
+{
+
+enum class LogArgType : uint8_t
+{
+    Int,
+    UInt,
+    Percent, // A level, 0.37f -> "37%"
+    Device,  // A DeviceHandle, shown by name
+    Text     // A string that outlives the queue, normally a literal
+};
+
+// One typed field of a deferred message; copied into the queue as is and only
+// turned into text on the writer thread
+struct LogArg
+{
+    LogArgType type;
+    union
+    {
+        int64_t i;
+        uint64_t u;
+        float f;
+        const wchar_t *text;
+    };
+
+    LogArg() : type(LogArgType::UInt), u(0) {}
+
+    // Integers, HRESULTs and counts
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    LogArg(T value)
+    {
+        if (std::is_signed<T>::value)
+        {
+            type = LogArgType::Int;
+            i = (int64_t)value;
+        }
+        else
+        {
+            type = LogArgType::UInt;
+            u = (uint64_t)value;
+        }
+    }
+
+    LogArg(const wchar_t *value) : type(LogArgType::Text), text(value) {}
+
+    static LogArg Percent(float level)
+    {
+        LogArg arg;
+        arg.type = LogArgType::Percent;
+        arg.f = level;
+        return arg;
+    }
+
+    static LogArg Device(DeviceHandle device)
+    {
+        LogArg arg;
+        arg.type = LogArgType::Device;
+        arg.u = device;
+        return arg;
+    }
+};
+
+const size_t DeferredLogMaxArgs = 6;
+
+// A message whose formatting is left to the writer thread: a format with one "{}"
+// per argument, which like text arguments must outlive the queue (a literal), and
+// the arguments themselves. Fixed size like LogRecord, at a fraction of its size.
+struct DeferredLogRecord
+{
+    uint64_t timestampMs; // Wall clock, milliseconds since the Unix epoch
+    LogLevel level;
+    uint8_t argCount;
+    const wchar_t *format;
+    LogArg args[DeferredLogMaxArgs];
+};
+
+// Device names for the writer thread, which cannot ask the enforcer. Set when a
+// device appears or is renamed; a record still queued when that happens shows the
+// new name.
+class LogNames
+{
+public:
+    void Set(DeviceHandle device, const std::wstring &name);
+    void Clear();
+
+    // Copies the name, or "device N" for a handle without one, into text[0..capacity);
+    // returns the characters written
+    size_t Copy(DeviceHandle device, wchar_t *text, size_t capacity) const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<std::wstring> m_names; // Indexed by DeviceHandle
+};
+
+// Replaces each "{}" in the format with the next argument; placeholders without an
+// argument stay as they are. Numbers go through std::to_chars, so this neither
+// allocates nor depends on the locale.
+void FormatDeferred(const DeferredLogRecord &deferred, const LogNames &names, LogRecord &record);
+
+} // namespace MicVol
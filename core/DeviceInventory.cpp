@@ -0,0 +1,193 @@
+#include "DeviceInventory.h"
+#include <algorithm>
+
+namespace MicVol
+{
+
+HRESULT DeviceInventory::Build(AudioBackend &backend)
+{
+    // Register first so nothing that happens during the enumeration is lost;
+    // replaying those events afterwards is harmless
+    if (!m_registered)
+    {
+        m_registered = SUCCEEDED(backend.RegisterDeviceNotifications(this));
+    }
+
+    std::vector<std::wstring> devices;
+    HRESULT hr = backend.EnumerateCaptureEndpoints(devices);
+    if (FAILED(hr))
+        return hr;
+
+    std::wstring defaultDevice;
+    if (FAILED(backend.GetDefaultCaptureEndpoint(defaultDevice)))
+    {
+        defaultDevice.clear();
+    }
+
+    m_devices.swap(devices);
+    m_defaultDevice.swap(defaultDevice);
+    m_generation++;
+    m_built = true;
+    return hr;
+}
+
+void DeviceInventory::Reset(AudioBackend &backend)
+{
+    if (m_registered)
+    {
+        backend.UnregisterDeviceNotifications(this);
+        m_registered = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.clear();
+    }
+
+    m_devices.clear();
+    m_defaultDevice.clear();
+    m_built = false;
+    m_generation++;
+}
+
+bool DeviceInventory::HasPending()
+{
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    return !m_queue.empty();
+}
+
+InventoryChanges DeviceInventory::ApplyPending(AudioBackend &backend)
+{
+    InventoryChanges changes;
+
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        events.swap(m_queue);
+    }
+
+    bool changed = false;
+    for (const Event &event : events)
+    {
+        switch (event.type)
+        {
+        case EventType::Added:
+        case EventType::StateChanged:
+        {
+            if (event.type == EventType::StateChanged && event.state != EndpointStateActive)
+            {
+                changed |= Remove(event.deviceId, changes);
+                break;
+            }
+
+            DataFlow flow = DataFlow::Render;
+            unsigned state = 0;
+            if (SUCCEEDED(backend.GetEndpointState(event.deviceId, flow, state)) &&
+                flow == DataFlow::Capture && state == EndpointStateActive)
+            {
+                changed |= Add(event.deviceId, changes);
+            }
+            break;
+        }
+        case EventType::Removed:
+            changed |= Remove(event.deviceId, changes);
+            break;
+        case EventType::DefaultChanged:
+            if (m_defaultDevice != event.deviceId)
+            {
+                m_defaultDevice = event.deviceId;
+                changes.defaultChanged = true;
+                changed = true;
+            }
+            break;
+        case EventType::PropertyChanged:
+            if (Contains(event.deviceId) &&
+                std::find(changes.renamed.begin(), changes.renamed.end(), event.deviceId) == changes.renamed.end())
+            {
+                changes.renamed.push_back(event.deviceId);
+            }
+            break;
+        }
+    }
+
+    if (changed)
+        m_generation++;
+    return changes;
+}
+
+bool DeviceInventory::Contains(const std::wstring &deviceId) const
+{
+    return std::find(m_devices.begin(), m_devices.end(), deviceId) != m_devices.end();
+}
+
+bool DeviceInventory::Add(const std::wstring &deviceId, InventoryChanges &changes)
+{
+    if (Contains(deviceId))
+        return false;
+
+    m_devices.push_back(deviceId);
+
+    // A device that left and came back within one batch is reported as added only
+    auto removed = std::find(changes.removed.begin(), changes.removed.end(), deviceId);
+    if (removed != changes.removed.end())
+        changes.removed.erase(removed);
+    changes.added.push_back(deviceId);
+    return true;
+}
+
+bool DeviceInventory::Remove(const std::wstring &deviceId, InventoryChanges &changes)
+{
+    auto it = std::find(m_devices.begin(), m_devices.end(), deviceId);
+    if (it == m_devices.end())
+        return false;
+
+    m_devices.erase(it);
+
+    auto added = std::find(changes.added.begin(), changes.added.end(), deviceId);
+    if (added != changes.added.end())
+        changes.added.erase(added);
+    else
+        changes.removed.push_back(deviceId);
+    return true;
+}
+
+void DeviceInventory::OnDeviceAdded(const std::wstring &deviceId)
+{
+    Queue(EventType::Added, deviceId);
+}
+
+void DeviceInventory::OnDeviceRemoved(const std::wstring &deviceId)
+{
+    Queue(EventType::Removed, deviceId);
+}
+
+void DeviceInventory::OnDeviceStateChanged(const std::wstring &deviceId, unsigned newState)
+{
+    Queue(EventType::StateChanged, deviceId, newState);
+}
+
+void DeviceInventory::OnDefaultDeviceChanged(DataFlow flow, DeviceRole role, const std::wstring &deviceId)
+{
+    if (flow == DataFlow::Capture && role == DeviceRole::Console)
+    {
+        Queue(EventType::DefaultChanged, deviceId);
+    }
+}
+
+void DeviceInventory::OnDevicePropertyChanged(const std::wstring &deviceId)
+{
+    Queue(EventType::PropertyChanged, deviceId);
+}
+
+void DeviceInventory::Queue(EventType type, const std::wstring &deviceId, unsigned state)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.push_back({type, deviceId, state});
+    }
+
+    if (m_wake)
+        m_wake();
+}
+
+} // namespace MicVol
@@ -0,0 +1,88 @@
+#pragma once
+#include "AudioBackend.h"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace MicVol
+{
+
+// What ApplyPending() changed
+struct InventoryChanges
+{
+    std::vector<std::wstring> added;
+    std::vector<std::wstring> removed;
+    std::vector<std::wstring> renamed;
+    bool defaultChanged = false;
+
+    bool Empty() const { return added.empty() && removed.empty() && renamed.empty() && !defaultChanged; }
+};
+
+// In-memory list of active capture endpoints.
+//
+// Built once with a full enumeration, then kept current from device notifications,
+// so enforcement never has to call EnumAudioEndpoints on a tick. Notifications are
+// queued on the callback thread and applied by the worker in ApplyPending().
+// Generation() increases every time the device set or the default device changes.
+class DeviceInventory : public DeviceNotificationSink
+{
+public:
+    // wake is called on the notification thread after an event was queued
+    explicit DeviceInventory(std::function<void()> wake = nullptr) : m_wake(std::move(wake)) {}
+
+    // Registers for notifications (if not yet registered) and enumerates all devices
+    HRESULT Build(AudioBackend &backend);
+    void Reset(AudioBackend &backend);
+
+    bool IsBuilt() const { return m_built; }
+    bool IsNotifying() const { return m_registered; }
+    bool HasPending();
+
+    // Applies queued notifications; queries the backend only for devices named in them
+    InventoryChanges ApplyPending(AudioBackend &backend);
+
+    const std::vector<std::wstring> &CaptureDevices() const { return m_devices; }
+    const std::wstring &DefaultCaptureDevice() const { return m_defaultDevice; }
+    bool Contains(const std::wstring &deviceId) const;
+    uint64_t Generation() const { return m_generation; }
+
+    // DeviceNotificationSink
+    void OnDeviceAdded(const std::wstring &deviceId) override;
+    void OnDeviceRemoved(const std::wstring &deviceId) override;
+    void OnDeviceStateChanged(const std::wstring &deviceId, unsigned newState) override;
+    void OnDefaultDeviceChanged(DataFlow flow, DeviceRole role, const std::wstring &deviceId) override;
+    void OnDevicePropertyChanged(const std::wstring &deviceId) override;
+
+private:
+    enum class EventType
+    {
+        Added,
+        Removed,
+        StateChanged,
+        DefaultChanged,
+        PropertyChanged
+    };
+
+    struct Event
+    {
+        EventType type;
+        std::wstring deviceId;
+        unsigned state;
+    };
+
+    void Queue(EventType type, const std::wstring &deviceId, unsigned state = 0);
+    bool Add(const std::wstring &deviceId, InventoryChanges &changes);
+    bool Remove(const std::wstring &deviceId, InventoryChanges &changes);
+
+    std::function<void()> m_wake;
+    std::mutex m_queueMutex;
+    std::vector<Event> m_queue;
+
+    bool m_built = false;
+    bool m_registered = false;
+    std::vector<std::wstring> m_devices;
+    std::wstring m_defaultDevice;
+    uint64_t m_generation = 0;
+};
+
+} // namespace MicVol
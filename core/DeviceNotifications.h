@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+
+namespace MicVol
+{
+
+// Mirrors EDataFlow / ERole / DEVICE_STATE_XXX from mmdeviceapi.h
+enum class DataFlow
+{
+    Render,
+    Capture
+};
+
+enum class DeviceRole
+{
+    Console,
+    Multimedia,
+    Communications
+};
+
+const unsigned EndpointStateActive = 0x00000001;
+
+// Device topology notifications (the IMMNotificationClient model).
+// Called on an audio service thread: implementations must only record the event
+// and return; querying the device from inside the callback can deadlock.
+class DeviceNotificationSink
+{
+public:
+    virtual ~DeviceNotificationSink() = default;
+
+    virtual void OnDeviceAdded(const std::wstring &deviceId) = 0;
+    virtual void OnDeviceRemoved(const std::wstring &deviceId) = 0;
+    virtual void OnDeviceStateChanged(const std::wstring &deviceId, unsigned newState) = 0;
+    virtual void OnDefaultDeviceChanged(DataFlow flow, DeviceRole role, const std::wstring &deviceId) = 0;
+
+    // Any endpoint property changed; the friendly name is the one we care about
+    virtual void OnDevicePropertyChanged(const std::wstring &deviceId) = 0;
+};
+
+} // namespace MicVol
@@ -0,0 +1,25 @@
+#include "DeviceTable.h"
+
+namespace MicVol
+{
+
+DeviceHandle DeviceTable::Intern(const std::wstring &endpointId)
+{
+    auto it = m_handles.find(endpointId);
+    if (it != m_handles.end())
+        return it->second;
+
+    DeviceHandle handle = (DeviceHandle)m_slots.size();
+    m_handles.emplace(endpointId, handle);
+    m_ids.push_back(endpointId);
+    m_slots.emplace_back();
+    return handle;
+}
+
+DeviceHandle DeviceTable::Find(const std::wstring &endpointId) const
+{
+    auto it = m_handles.find(endpointId);
+    return it == m_handles.end() ? InvalidDeviceHandle : it->second;
+}
+
+} // namespace MicVol
@@ -0,0 +1,69 @@
+#pragma once
+#include "VolumeEndpoint.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace MicVol
+{
+
+// Dense index of an interned endpoint ID. Stable for the lifetime of the table,
+// so a device that is unplugged and plugged back in gets its old slot again.
+typedef uint32_t DeviceHandle;
+const DeviceHandle InvalidDeviceHandle = 0xFFFFFFFFu;
+
+// What enforcement does with the mute state of a device
+enum class MutePolicy : uint8_t
+{
+    Leave,  // Not enforced
+    Unmute, // Keep unmuted
+    Mute    // Keep muted
+};
+
+// Per-device enforcement state. Kept small and free of strings so a tick walks
+// contiguous memory; names and IDs live in separate tables.
+struct DeviceSlot
+{
+    float lastVolume = -1.0f; // Last observed level, -1 before the first successful read
+    float targetVolume = 1.0f;
+    float tolerance = 0.01f;
+    uint32_t corrections = 0;
+    uint64_t lastCorrectionMs = 0;
+    uint32_t errorCount = 0;
+    uint32_t consecutiveErrors = 0;
+    uint32_t checkIntervalMs = 0; // Adaptive schedule: current check interval, 0 before the first check
+    uint32_t tamperCycles = 0;    // Corrections that followed the previous one within the tamper war window
+    uint32_t tamperWars = 0;
+    int32_t policyRule = -1;       // Index of the rule that decided the policy, -1 for the default
+    MutePolicy mute = MutePolicy::Leave;
+    WriterKind lastWriter = WriterKind::Unknown; // Of the latest change corrected through a notification
+    bool enforced = true;          // Selected by the policy rules
+    bool policyResolved = false;   // Rules were evaluated since the device appeared or was renamed
+    bool present = false;
+    bool seen = false; // Volume was read at least once since the device appeared
+};
+
+// Interns endpoint IDs (IMMDevice::GetId, stable across renames and reboots) into
+// DeviceHandles and owns one DeviceSlot per handle. Interning hashes the ID and is
+// meant for the rare paths (device appeared); every per-tick access is Slot(handle).
+class DeviceTable
+{
+public:
+    DeviceHandle Intern(const std::wstring &endpointId);
+    DeviceHandle Find(const std::wstring &endpointId) const;
+
+    DeviceSlot &Slot(DeviceHandle handle) { return m_slots[handle]; }
+    const DeviceSlot &Slot(DeviceHandle handle) const { return m_slots[handle]; }
+    const std::wstring &EndpointId(DeviceHandle handle) const { return m_ids[handle]; }
+
+    size_t Size() const { return m_slots.size(); }
+    bool IsValid(DeviceHandle handle) const { return handle < m_slots.size(); }
+
+private:
+    std::unordered_map<std::wstring, DeviceHandle> m_handles;
+    std::vector<std::wstring> m_ids;
+    std::vector<DeviceSlot> m_slots;
+};
+
+} // namespace MicVol
@@ -0,0 +1,112 @@
+#include "EventLoop.h"
+#include <algorithm>
+#include <chrono>
+
+namespace MicVol
+{
+
+void EventLoop::SetSource(uint32_t source, std::function<void()> handler)
+{
+    if (source >= MaxSources)
+        return;
+    if (source >= m_sources.size())
+        m_sources.resize(source + 1);
+    m_sources[source] = std::move(handler);
+}
+
+void EventLoop::SetTimer(uint32_t timer, std::function<void()> handler)
+{
+    if (timer >= m_timerHandlers.size())
+        m_timerHandlers.resize(timer + 1);
+    m_timerHandlers[timer] = std::move(handler);
+}
+
+void EventLoop::Signal(uint32_t source)
+{
+    if (source >= MaxSources)
+        return;
+
+    // Only the first signal since the last dispatch has to wake the loop
+    if (m_pending.fetch_or(1u << source) != 0)
+        return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wake.notify_one();
+}
+
+void EventLoop::Stop()
+{
+    m_stopRequested = true;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wake.notify_one();
+}
+
+bool EventLoop::Ready(uint64_t nowMs) const
+{
+    return m_pending.load() != 0 || m_timers.NextDueMs() <= nowMs;
+}
+
+void EventLoop::Run()
+{
+    for (;;)
+    {
+        if (m_beforeWait)
+            m_beforeWait();
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (;;)
+            {
+                if (m_stopRequested)
+                    return;
+                uint64_t now = m_clock.NowMs();
+                if (Ready(now))
+                    break;
+
+                uint64_t due = m_timers.NextDueMs();
+                if (due == TimerWheel::Never)
+                    m_wake.wait(lock);
+                else
+                    m_wake.wait_for(lock, std::chrono::milliseconds(due - now));
+            }
+        }
+        Dispatch();
+    }
+}
+
+bool EventLoop::Poll()
+{
+    if (m_beforeWait)
+        m_beforeWait();
+    if (m_stopRequested || !Ready(m_clock.NowMs()))
+        return false;
+    Dispatch();
+    return true;
+}
+
+void EventLoop::Dispatch()
+{
+    m_wakeups.Add();
+
+    uint32_t pending = m_pending.exchange(0);
+    for (uint32_t source = 0; pending != 0 && source < m_sources.size(); source++)
+    {
+        uint32_t bit = 1u << source;
+        if ((pending & bit) == 0)
+            continue;
+        pending &= ~bit;
+        if (m_sources[source])
+            m_sources[source]();
+    }
+
+    // Timers due at the same time run in ID order
+    m_dueTimers.clear();
+    m_timers.PopDue(m_clock.NowMs(), m_dueTimers);
+    std::sort(m_dueTimers.begin(), m_dueTimers.end());
+    for (uint32_t timer : m_dueTimers)
+    {
+        if (timer < m_timerHandlers.size() && m_timerHandlers[timer])
+            m_timerHandlers[timer]();
+    }
+}
+
+} // namespace MicVol
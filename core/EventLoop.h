@@ -0,0 +1,78 @@
+#pragma once
+#include "Clock.h"
+#include "Metrics.h"
+#include "TimerWheel.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace MicVol
+{
+
+// The worker thread's only wait: sources signalled from any thread, timers on the loop
+// thread, and a stop request, multiplexed on one condition variable.
+//
+// Signal() sets the source's bit in one atomic word and notifies only when the word
+// was empty, so signals that arrive together or while the handlers run are coalesced
+// into one wakeup. Without a pending signal or a timer the loop waits with no timeout
+// at all; Wakeups() counts the times it woke to dispatch. Handlers run on the loop
+// thread: sources in ID order first, then the due timers.
+class EventLoop
+{
+public:
+    static const uint32_t MaxSources = 32;
+
+    explicit EventLoop(Clock &clock) : m_clock(clock), m_timers(1, 64) {}
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    // Setup, before Run(). IDs are small integers chosen by the caller.
+    void SetSource(uint32_t source, std::function<void()> handler);
+    void SetTimer(uint32_t timer, std::function<void()> handler);
+
+    // Runs before every wait, e.g. to re-arm timers from a schedule or publish status
+    void SetBeforeWait(std::function<void()> handler) { m_beforeWait = std::move(handler); }
+
+    // Any thread. A signal without a handler is dropped when dispatched.
+    void Signal(uint32_t source);
+    void Stop();
+    bool StopRequested() const { return m_stopRequested.load(); }
+
+    // Loop thread
+    void Schedule(uint32_t timer, uint64_t dueMs) { m_timers.Schedule(timer, dueMs); }
+    void Cancel(uint32_t timer) { m_timers.Cancel(timer); }
+    uint64_t DueMs(uint32_t timer) const { return m_timers.DueMs(timer); }
+    uint64_t NextDueMs() const { return m_timers.NextDueMs(); }
+
+    // Until Stop(); a stop requested before Run() returns right away
+    void Run();
+
+    // One turn of Run() without the wait: the before-wait handler, then whatever is
+    // ready. False when nothing was. For tests on a virtual clock.
+    bool Poll();
+
+    const Counter &Wakeups() const { return m_wakeups; }
+
+private:
+    bool Ready(uint64_t nowMs) const;
+    void Dispatch();
+
+    Clock &m_clock;
+    std::vector<std::function<void()>> m_sources;
+    std::vector<std::function<void()>> m_timerHandlers;
+    std::function<void()> m_beforeWait;
+    TimerWheel m_timers;
+    std::vector<uint32_t> m_dueTimers; // Reused by Dispatch()
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<uint32_t> m_pending{0};
+    std::atomic<bool> m_stopRequested{false};
+    Counter m_wakeups;
+};
+
+} // namespace MicVol
@@ -0,0 +1,186 @@
+#include "FileIo.h"
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#include <windows.h>
+#elif defined(__linux__)
+#include <fcntl.h>
+#endif
+
+namespace MicVol
+{
+
+// Encodes the character at text[i] into bytes; advances i past a surrogate pair. Returns the byte count.
+static size_t EncodeUtf8(const wchar_t *text, size_t length, size_t &i, char bytes[4])
+{
+    uint32_t c = (uint32_t)text[i];
+
+    // wchar_t is UTF-16 on Windows: join surrogate pairs
+    if (c >= 0xD800 && c <= 0xDBFF && i + 1 < length)
+    {
+        uint32_t low = (uint32_t)text[i + 1];
+        if (low >= 0xDC00 && low <= 0xDFFF)
+        {
+            c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+            i++;
+        }
+    }
+    if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF)
+    {
+        c = 0xFFFD;
+    }
+
+    if (c < 0x80)
+    {
+        bytes[0] = (char)c;
+        return 1;
+    }
+    if (c < 0x800)
+    {
+        bytes[0] = (char)(0xC0 | (c >> 6));
+        bytes[1] = (char)(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000)
+    {
+        bytes[0] = (char)(0xE0 | (c >> 12));
+        bytes[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+        bytes[2] = (char)(0x80 | (c & 0x3F));
+        return 3;
+    }
+    bytes[0] = (char)(0xF0 | (c >> 18));
+    bytes[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+    bytes[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+    bytes[3] = (char)(0x80 | (c & 0x3F));
+    return 4;
+}
+
+void AppendUtf8(std::string &out, const wchar_t *text, size_t length)
+{
+    char bytes[4];
+    for (size_t i = 0; i < length; i++)
+    {
+        out.append(bytes, EncodeUtf8(text, length, i, bytes));
+    }
+}
+
+size_t CopyUtf8(char *out, size_t capacity, const wchar_t *text, size_t length)
+{
+    if (capacity == 0)
+        return 0;
+
+    size_t written = 0;
+    char bytes[4];
+    for (size_t i = 0; i < length; i++)
+    {
+        size_t count = EncodeUtf8(text, length, i, bytes);
+        if (written + count >= capacity)
+            break;
+        memcpy(out + written, bytes, count);
+        written += count;
+    }
+    out[written] = '\0';
+    return written;
+}
+
+void AppendWide(std::wstring &out, const char *text, size_t length)
+{
+    for (size_t i = 0; i < length;)
+    {
+        uint8_t lead = (uint8_t)text[i];
+        size_t extra = lead < 0x80 ? 0 : (lead & 0xE0) == 0xC0 ? 1 : (lead & 0xF0) == 0xE0 ? 2 : (lead & 0xF8) == 0xF0 ? 3 : 4;
+        uint32_t c = extra == 0 ? lead : extra == 1 ? (lead & 0x1F) : extra == 2 ? (lead & 0x0F) : (lead & 0x07);
+
+        bool valid = extra < 4 && i + extra < length;
+        for (size_t k = 1; valid && k <= extra; k++)
+        {
+            uint8_t next = (uint8_t)text[i + k];
+            valid = (next & 0xC0) == 0x80;
+            c = (c << 6) | (next & 0x3F);
+        }
+        if (!valid || (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF)
+        {
+            out += (wchar_t)0xFFFD;
+            i++;
+            continue;
+        }
+        i += extra + 1;
+
+        if (c >= 0x10000 && sizeof(wchar_t) == 2)
+        {
+            c -= 0x10000;
+            out += (wchar_t)(0xD800 + (c >> 10));
+            out += (wchar_t)(0xDC00 + (c & 0x3FF));
+        }
+        else
+        {
+            out += (wchar_t)c;
+        }
+    }
+}
+
+FILE *OpenSharedFile(const std::wstring &path, const char *mode)
+{
+#ifdef _WIN32
+    std::wstring wideMode(mode, mode + strlen(mode));
+    // Shared so logs can be read while the service runs
+    return _wfsopen(path.c_str(), wideMode.c_str(), _SH_DENYNO);
+#else
+    std::string narrowPath;
+    AppendUtf8(narrowPath, path.c_str(), path.size());
+    return fopen(narrowPath.c_str(), mode);
+#endif
+}
+
+HRESULT ReadTextFile(const std::wstring &path, std::wstring &text)
+{
+    FILE *file = OpenSharedFile(path, "rb");
+    if (!file)
+        return E_FAIL;
+
+    std::string bytes;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        bytes.append(buffer, read);
+    }
+    fclose(file);
+
+    size_t start = bytes.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+    text.clear();
+    AppendWide(text, bytes.data() + start, bytes.size() - start);
+    return S_OK;
+}
+
+bool PreallocateFile(FILE *file, uint64_t bytes)
+{
+    if (fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = (LONGLONG)bytes;
+    return SetFileInformationByHandle(handle, FileAllocationInfo, &info, sizeof(info)) != FALSE;
+#elif defined(__linux__)
+    return fallocate(fileno(file), FALLOC_FL_KEEP_SIZE, 0, (off_t)bytes) == 0;
+#else
+    (void)bytes;
+    return false;
+#endif
+}
+
+void ToLocalTime(int64_t seconds, struct tm &local)
+{
+    time_t time = (time_t)seconds;
+#ifdef _WIN32
+    localtime_s(&local, &time);
+#else
+    localtime_r(&time, &local);
+#endif
+}
+
+} // namespace MicVol
@@ -0,0 +1,34 @@
+#pragma once
+#include "Platform.h"
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+
+namespace MicVol
+{
+
+// Appends the UTF-8 encoding of text to out
+void AppendUtf8(std::string &out, const wchar_t *text, size_t length);
+
+// Writes the UTF-8 encoding of text to out without allocating, stopping at a character
+// that does not fit; out is always null-terminated. Returns the bytes written.
+size_t CopyUtf8(char *out, size_t capacity, const wchar_t *text, size_t length);
+
+// Appends the decoded UTF-8 text to out (UTF-16 on Windows); invalid bytes become U+FFFD
+void AppendWide(std::wstring &out, const char *text, size_t length);
+
+// fopen for a wide path; on Windows the file stays readable and writable by others
+FILE *OpenSharedFile(const std::wstring &path, const char *mode);
+
+// Reads a whole UTF-8 text file, skipping a byte order mark
+HRESULT ReadTextFile(const std::wstring &path, std::wstring &text);
+
+// Reserves disk space for the file up to bytes without changing its size, so later
+// appends up to that size do not allocate. Returns false where unsupported.
+bool PreallocateFile(FILE *file, uint64_t bytes);
+
+// Converts seconds since the Unix epoch to local calendar time
+void ToLocalTime(int64_t seconds, struct tm &local);
+
+} // namespace MicVol
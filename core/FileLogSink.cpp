@@ -0,0 +1,161 @@
+#include "FileLogSink.h"
+#include "FileIo.h"
+#include <filesystem>
+
+namespace MicVol
+{
+
+#ifdef _WIN32
+static const char LineEnd[] = "\r\n";
+#else
+static const char LineEnd[] = "\n";
+#endif
+
+FileLogSink::FileLogSink(const std::wstring &path, const FileLogRotation &rotation)
+    : m_path(path), m_rotation(rotation)
+{
+    if (m_rotation.segmentCount < 2)
+    {
+        m_rotation.segmentCount = 2;
+    }
+    m_line.reserve(1024);
+}
+
+FileLogSink::~FileLogSink()
+{
+    Close();
+}
+
+std::wstring FileLogSink::SegmentPath(uint32_t index) const
+{
+    if (index == 0)
+        return m_path;
+
+    size_t slash = m_path.find_last_of(L"\\/");
+    size_t dot = m_path.find_last_of(L'.');
+    if (dot == std::wstring::npos || (slash != std::wstring::npos && dot < slash))
+        return m_path + L"." + std::to_wstring(index);
+    return m_path.substr(0, dot) + L"." + std::to_wstring(index) + m_path.substr(dot);
+}
+
+HRESULT FileLogSink::Open(bool truncate)
+{
+    m_file = OpenSharedFile(m_path, truncate ? "wb" : "ab");
+    if (!m_file)
+        return E_FAIL;
+
+    setvbuf(m_file, nullptr, _IOFBF, 64 * 1024);
+    fseek(m_file, 0, SEEK_END);
+    long size = ftell(m_file);
+    m_size = size > 0 ? (uint64_t)size : 0;
+
+    m_preallocated = m_rotation.segmentBytes > 0 && PreallocateFile(m_file, m_rotation.segmentBytes);
+    return S_OK;
+}
+
+void FileLogSink::Close()
+{
+    if (m_file)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+HRESULT FileLogSink::Rotate()
+{
+    Close();
+
+    std::error_code error;
+    const uint32_t last = m_rotation.segmentCount - 1;
+    const std::filesystem::path recycled = std::filesystem::path(m_path + L".recycle");
+
+    // Park the oldest segment, shift the others down one name, then bring the
+    // oldest back as the (emptied) current segment
+    bool reuse = std::filesystem::exists(std::filesystem::path(SegmentPath(last)), error);
+    if (reuse)
+    {
+        std::filesystem::rename(std::filesystem::path(SegmentPath(last)), recycled, error);
+        reuse = !error;
+    }
+    for (uint32_t index = last; index >= 1 && !error; index--)
+    {
+        std::filesystem::path from(SegmentPath(index - 1));
+        if (std::filesystem::exists(from, error))
+        {
+            std::filesystem::rename(from, std::filesystem::path(SegmentPath(index)), error);
+        }
+    }
+    if (!error && reuse)
+    {
+        std::filesystem::rename(recycled, std::filesystem::path(m_path), error);
+    }
+
+    if (error)
+    {
+        // Typically another process holds a segment open without delete sharing.
+        // Keep appending to the current file and try again an eighth of a segment later.
+        if (FAILED(Open()))
+            return E_FAIL;
+        m_retryRotationAt = m_size + m_rotation.segmentBytes / 8;
+        return S_FALSE;
+    }
+
+    m_retryRotationAt = 0;
+    m_rotations++;
+    return Open(true);
+}
+
+HRESULT FileLogSink::Write(const LogRecord &record)
+{
+    if (!m_file && FAILED(Open()))
+        return E_FAIL;
+
+    // Consecutive messages usually share a second; format the prefix once per second
+    int64_t second = (int64_t)(record.timestampMs / 1000);
+    if (second != m_prefixSecond)
+    {
+        struct tm local;
+        ToLocalTime(second, local);
+        m_prefixLength = strftime(m_prefix, sizeof(m_prefix), "[%Y-%m-%d %H:%M:%S] ", &local);
+        m_prefixSecond = second;
+    }
+
+    m_line.assign(m_prefix, m_prefixLength);
+    AppendUtf8(m_line, record.text, record.length);
+    if (record.truncated)
+    {
+        m_line += "...";
+    }
+    m_line += LineEnd;
+
+    if (m_rotation.segmentBytes > 0 && m_size > 0 && m_size + m_line.size() > m_rotation.segmentBytes &&
+        m_size >= m_retryRotationAt)
+    {
+        if (FAILED(Rotate()))
+            return E_FAIL;
+    }
+
+    if (fwrite(m_line.data(), 1, m_line.size(), m_file) != m_line.size())
+    {
+        Close();
+        return E_FAIL;
+    }
+    m_size += m_line.size();
+    return S_OK;
+}
+
+HRESULT FileLogSink::Flush()
+{
+    if (!m_file)
+        return S_FALSE;
+
+    if (fflush(m_file) != 0)
+    {
+        Close();
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+} // namespace MicVol
@@ -0,0 +1,57 @@
+#pragma once
+#include "LogSink.h"
+#include <cstdio>
+#include <string>
+
+namespace MicVol
+{
+
+// Size-bounded rotation: path holds the newest segment, path.1 ... path.(count-1)
+// (inserted before the extension) the older ones
+struct FileLogRotation
+{
+    uint64_t segmentBytes = 0; // 0 disables rotation: one file that grows without bound
+    uint32_t segmentCount = 5; // Including the current segment; at least 2
+};
+
+// Appends "[YYYY-MM-DD HH:MM:SS] message" lines in UTF-8 to a file kept open
+// between writes. Opens lazily and retries after a failed open or write.
+//
+// With rotation, each segment's disk space is reserved when it is opened so
+// appends never extend the allocation, and when a line would overflow the
+// segment the files shift down one name and the oldest is reused as the new
+// current segment. Runs on the logger's writer thread, never on the caller's.
+class FileLogSink : public LogSink
+{
+public:
+    explicit FileLogSink(const std::wstring &path, const FileLogRotation &rotation = FileLogRotation());
+    ~FileLogSink() override;
+
+    HRESULT Write(const LogRecord &record) override;
+    HRESULT Flush() override;
+
+    const std::wstring &Path() const { return m_path; }
+    bool IsOpen() const { return m_file != nullptr; }
+    bool IsPreallocated() const { return m_preallocated; }
+    std::wstring SegmentPath(uint32_t index) const;
+    uint64_t Rotations() const { return m_rotations; }
+
+private:
+    HRESULT Open(bool truncate = false);
+    void Close();
+    HRESULT Rotate();
+
+    std::wstring m_path;
+    FileLogRotation m_rotation;
+    FILE *m_file = nullptr;
+    uint64_t m_size = 0;            // Bytes in the current segment
+    uint64_t m_retryRotationAt = 0; // After a failed rotation, keep appending until this size
+    bool m_preallocated = false;
+    uint64_t m_rotations = 0;
+    std::string m_line;           // Reused formatting buffer
+    int64_t m_prefixSecond = -1;  // Second the cached timestamp prefix was formatted for
+    char m_prefix[32] = {};
+    size_t m_prefixLength = 0;
+};
+
+} // namespace MicVol
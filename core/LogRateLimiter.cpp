@@ -0,0 +1,154 @@
+#include "LogRateLimiter.h"
+
+namespace MicVol
+{
+
+const wchar_t *LogKindName(LogKind kind)
+{
+    switch (kind)
+    {
+    case LogKind::VolumeChanged:
+        return L"Volume changed";
+    case LogKind::VolumeCorrected:
+        return L"Volume corrected";
+    case LogKind::CorrectionFailed:
+        return L"Volume setting error";
+    case LogKind::CallTimeout:
+        return L"Device calls timed out";
+    case LogKind::CheckDropped:
+        return L"Check dropped";
+    case LogKind::MuteCorrected:
+        return L"Mute corrected";
+    case LogKind::MuteFailed:
+        return L"Mute setting error";
+    default:
+        return L"Event";
+    }
+}
+
+void LogRateLimiter::SetOptions(const LogLimitOptions &options)
+{
+    m_options = options;
+    if (m_options.burst < 1)
+        m_options.burst = 1;
+    if (m_options.refillMs < 1)
+        m_options.refillMs = 1;
+    if (m_options.summaryMs < 1)
+        m_options.summaryMs = 1;
+    Reset();
+}
+
+bool LogRateLimiter::Allow(DeviceHandle device, LogKind kind, uint64_t nowMs)
+{
+    if (kind >= LogKind::Count)
+        return true;
+
+    size_t index = (size_t)device * KindCount + (size_t)kind;
+    if (index >= m_buckets.size())
+        m_buckets.resize(((size_t)device + 1) * KindCount);
+
+    Bucket &bucket = m_buckets[index];
+    if (!bucket.used)
+    {
+        bucket.used = true;
+        bucket.tokens = m_options.burst;
+        bucket.refilledMs = nowMs;
+    }
+    else if (bucket.tokens < m_options.burst && nowMs >= bucket.refilledMs + m_options.refillMs)
+    {
+        uint64_t refills = (nowMs - bucket.refilledMs) / m_options.refillMs;
+        if (refills >= m_options.burst - bucket.tokens)
+        {
+            bucket.tokens = m_options.burst;
+            bucket.refilledMs = nowMs;
+        }
+        else
+        {
+            bucket.tokens += (uint32_t)refills;
+            bucket.refilledMs += refills * m_options.refillMs;
+        }
+    }
+
+    if (bucket.tokens > 0)
+    {
+        // A full bucket starts refilling from the line that takes the first token
+        if (bucket.tokens == m_options.burst)
+            bucket.refilledMs = nowMs;
+        bucket.tokens--;
+        return true;
+    }
+
+    if (bucket.suppressed++ == 0)
+    {
+        bucket.firstSuppressedMs = nowMs;
+        uint64_t dueMs = nowMs + m_options.summaryMs;
+        if (dueMs < m_nextSummaryMs)
+            m_nextSummaryMs = dueMs;
+    }
+    m_suppressed.Add();
+    return false;
+}
+
+bool LogRateLimiter::NextSummary(uint64_t nowMs, LogSummary &summary, bool all)
+{
+    if (!all && nowMs < m_nextSummaryMs)
+        return false;
+
+    uint64_t nextMs = UINT64_MAX;
+    for (size_t i = 0; i < m_buckets.size(); i++)
+    {
+        Bucket &bucket = m_buckets[i];
+        if (bucket.suppressed == 0)
+            continue;
+
+        uint64_t dueMs = bucket.firstSuppressedMs + m_options.summaryMs;
+        if (all || nowMs >= dueMs)
+        {
+            summary.device = (DeviceHandle)(i / KindCount);
+            summary.kind = (LogKind)(i % KindCount);
+            summary.suppressed = bucket.suppressed;
+            summary.periodMs = nowMs > bucket.firstSuppressedMs ? nowMs - bucket.firstSuppressedMs : 0;
+            bucket.suppressed = 0;
+            return true;
+        }
+        if (dueMs < nextMs)
+            nextMs = dueMs;
+    }
+
+    m_nextSummaryMs = nextMs;
+    return false;
+}
+
+bool LogRateLimiter::TakeSummary(DeviceHandle device, uint64_t nowMs, LogSummary &summary)
+{
+    size_t first = (size_t)device * KindCount;
+    for (size_t i = first; i < first + KindCount && i < m_buckets.size(); i++)
+    {
+        Bucket &bucket = m_buckets[i];
+        if (bucket.suppressed == 0)
+            continue;
+
+        summary.device = device;
+        summary.kind = (LogKind)(i - first);
+        summary.suppressed = bucket.suppressed;
+        summary.periodMs = nowMs > bucket.firstSuppressedMs ? nowMs - bucket.firstSuppressedMs : 0;
+        bucket.suppressed = 0;
+        return true;
+    }
+    return false;
+}
+
+void LogRateLimiter::Forget(DeviceHandle device)
+{
+    size_t first = (size_t)device * KindCount;
+    for (size_t i = first; i < first + KindCount && i < m_buckets.size(); i++)
+        m_buckets[i] = Bucket();
+}
+
+void LogRateLimiter::Reset()
+{
+    m_buckets.clear();
+    m_nextSummaryMs = UINT64_MAX;
+}
+
+} // namespace MicVol
@@ -0,0 +1,93 @@
+#pragma once
+#include "DeviceTable.h"
+#include "Metrics.h"
+#include <cstdint>
+#include <vector>
+
+namespace MicVol
+{
+
+// Log lines of a device that can repeat every check while something is wrong
+enum class LogKind : uint8_t
+{
+    VolumeChanged,
+    VolumeCorrected,
+    CorrectionFailed,
+    CallTimeout,
+    CheckDropped,
+    MuteCorrected,
+    MuteFailed,
+    Count
+};
+
+// What the lines of a kind are about, for the summary of the suppressed ones
+const wchar_t *LogKindName(LogKind kind);
+
+struct LogLimitOptions
+{
+    uint32_t burst = 5;           // Lines of one device and kind logged in a row before limiting starts
+    uint32_t refillMs = 60000;    // Then one more line per refillMs
+    uint32_t summaryMs = 600000;  // Suppressed lines are counted and summarized this long after the first
+};
+
+// Lines of one device and kind left out of the log
+struct LogSummary
+{
+    DeviceHandle device = 0;
+    LogKind kind = LogKind::VolumeChanged;
+    uint64_t suppressed = 0;
+    uint64_t periodMs = 0;  // From the first suppressed line to the summary
+};
+
+// Keeps a device that fails or is re-tampered with on every check from writing a
+// line per check: each (device, kind) has a token bucket that lets a burst of lines
+// through and then one per refillMs. Lines it suppresses are only counted, and
+// NextSummary() hands out one summary per key and summaryMs. Allow() runs before
+// the line is formatted, so a suppressed line costs no formatting or I/O. Pure
+// bookkeeping like TamperWarDetector: the clock is passed in and all calls come from
+// the worker thread.
+class LogRateLimiter
+{
+public:
+    void SetOptions(const LogLimitOptions &options);
+    const LogLimitOptions &Options() const { return m_options; }
+
+    // True when the line is to be logged; otherwise it is counted for the summary
+    bool Allow(DeviceHandle device, LogKind kind, uint64_t nowMs);
+
+    // Takes a summary that is due, or with all any pending one; false when there is none
+    bool NextSummary(uint64_t nowMs, LogSummary &summary, bool all = false);
+
+    // When NextSummary() may have a summary due, e.g. to arm a timer; UINT64_MAX while
+    // nothing is suppressed. Never later than the first summary, at times earlier.
+    uint64_t NextSummaryMs() const { return m_nextSummaryMs; }
+
+    // Takes a pending summary of one device, due or not; false when there is none
+    bool TakeSummary(DeviceHandle device, uint64_t nowMs, LogSummary &summary);
+
+    // Starts the device's buckets over, e.g. when it went away; take its summaries first
+    void Forget(DeviceHandle device);
+    void Reset();
+
+    // Lines suppressed since the start
+    const Counter &Suppressed() const { return m_suppressed; }
+
+private:
+    struct Bucket
+    {
+        uint32_t tokens = 0;
+        uint64_t refilledMs = 0;
+        bool used = false;
+        uint64_t suppressed = 0;     // Since the last summary
+        uint64_t firstSuppressedMs = 0;
+    };
+
+    static const size_t KindCount = (size_t)LogKind::Count;
+
+    LogLimitOptions m_options;
+    std::vector<Bucket> m_buckets; // KindCount per DeviceHandle
+    uint64_t m_nextSummaryMs = UINT64_MAX;
+    Counter m_suppressed;
+};
+
+} // namespace MicVol
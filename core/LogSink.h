@@ -0,0 +1,39 @@
+#pragma once
+#include "Platform.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace MicVol
+{
+
+enum class LogLevel : uint8_t
+{
+    Information,
+    Warning,
+    Error
+};
+
+// Longest message a record holds, including the terminating null; longer text is truncated
+const size_t LogRecordMaxChars = 240;
+
+// One log message. Fixed size so the logger queue never allocates.
+struct LogRecord
+{
+    uint64_t timestampMs; // Wall clock, milliseconds since the Unix epoch
+    LogLevel level;
+    bool truncated;
+    uint16_t length; // Characters in text, excluding the null terminator
+    wchar_t text[LogRecordMaxChars];
+};
+
+// Destination for log records. Only ever called from one thread at a time.
+class LogSink
+{
+public:
+    virtual ~LogSink() = default;
+
+    virtual HRESULT Write(const LogRecord &record) = 0;
+    virtual HRESULT Flush() = 0;
+};
+
+} // namespace MicVol
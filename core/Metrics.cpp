@@ -0,0 +1,176 @@
+#include "Metrics.h"
+#include "FileIo.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+namespace MicVol
+{
+
+// Microseconds as decimal seconds without trailing zeros, e.g. 1500 -> "0.0015"
+static void AppendSeconds(std::string &out, uint64_t micros)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%llu.%06llu", (unsigned long long)(micros / 1000000),
+             (unsigned long long)(micros % 1000000));
+    std::string text = buffer;
+    text.erase(text.find_last_not_of('0') + 1);
+    if (text.back() == '.')
+        text.pop_back();
+    out += text;
+}
+
+static void AppendCount(std::string &out, uint64_t value)
+{
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)value);
+    out += buffer;
+}
+
+void MetricsRegistry::AddCounter(const char *name, const char *help, const Counter &counter)
+{
+    m_entries.push_back({name, help, &counter, nullptr});
+}
+
+void MetricsRegistry::AddHistogram(const char *name, const char *help, const Histogram &histogram)
+{
+    m_entries.push_back({name, help, nullptr, &histogram});
+}
+
+std::string MetricsRegistry::FormatPrometheus() const
+{
+    std::string out;
+    for (const Entry &entry : m_entries)
+    {
+        out += "# HELP " + entry.name + " " + entry.help + "\n";
+        if (entry.counter)
+        {
+            out += "# TYPE " + entry.name + " counter\n" + entry.name + " ";
+            AppendCount(out, entry.counter->Value());
+            out += "\n";
+            continue;
+        }
+
+        // Buckets are cumulative in the exposition format
+        out += "# TYPE " + entry.name + " histogram\n";
+        uint64_t cumulative = 0;
+        for (int i = 0; i < Histogram::BucketCount; i++)
+        {
+            cumulative += entry.histogram->Bucket(i);
+            out += entry.name + "_bucket{le=\"";
+            if (i < Histogram::BucketCount - 1)
+                AppendSeconds(out, (uint64_t)1 << i);
+            else
+                out += "+Inf";
+            out += "\"} ";
+            AppendCount(out, cumulative);
+            out += "\n";
+        }
+        out += entry.name + "_sum ";
+        AppendSeconds(out, entry.histogram->SumMicros());
+        out += "\n" + entry.name + "_count ";
+        AppendCount(out, entry.histogram->Count());
+        out += "\n";
+    }
+    return out;
+}
+
+HRESULT MetricsRegistry::WritePrometheusFile(const std::wstring &path) const
+{
+    std::string text = FormatPrometheus();
+    std::wstring temporary = path + L".tmp";
+
+    FILE *file = OpenSharedFile(temporary, "wb");
+    if (!file)
+        return E_FAIL;
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+    written = fclose(file) == 0 && written;
+    if (!written)
+        return E_FAIL;
+
+    std::error_code error;
+    std::filesystem::rename(std::filesystem::path(temporary), std::filesystem::path(path), error);
+    return error ? E_FAIL : S_OK;
+}
+
+void RegisterEnforcementMetrics(MetricsRegistry &registry, const EnforcementMetrics &metrics)
+{
+    registry.AddCounter("mvs_ticks_total", "Enforcement passes (sweeps, scheduled checks, notification batches).",
+                        metrics.ticks);
+    registry.AddCounter("mvs_corrections_total", "Volume and mute corrections written.", metrics.corrections);
+    registry.AddCounter("mvs_tamper_events_total", "Foreign volume changes reported by notifications.",
+                        metrics.tamperEvents);
+    registry.AddCounter("mvs_backend_errors_total", "Failed endpoint volume reads and writes.", metrics.backendErrors);
+    registry.AddCounter("mvs_call_timeouts_total", "Device checks whose endpoint calls overran their deadline.",
+                        metrics.callTimeouts);
+    registry.AddCounter("mvs_checks_dropped_total", "Device checks not made because every worker pool thread was stuck.",
+                        metrics.checksDropped);
+    registry.AddCounter("mvs_breaker_trips_total", "Circuit breakers opened by devices that kept failing.",
+                        metrics.breakerTrips);
+    registry.AddHistogram("mvs_backend_call_seconds", "Duration of one endpoint volume or mute call.",
+                          metrics.backendCall);
+    registry.AddHistogram("mvs_tick_seconds", "Duration of one enforcement pass.", metrics.tick);
+    registry.AddHistogram("mvs_time_to_correct_seconds",
+                          "Time from a volume change notification to the completed correction.",
+                          metrics.timeToCorrect);
+}
+
+MetricsFileExporter::~MetricsFileExporter()
+{
+    Stop();
+}
+
+HRESULT MetricsFileExporter::Start(const std::wstring &path, uint32_t intervalMs)
+{
+    if (m_thread.joinable())
+        return E_FAIL;
+
+    m_path = path;
+    m_intervalMs = intervalMs > 0 ? intervalMs : 1;
+    m_stopRequested = false;
+    try
+    {
+        m_thread = std::thread(&MetricsFileExporter::Loop, this);
+    }
+    catch (const std::system_error &)
+    {
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+void MetricsFileExporter::Stop()
+{
+    if (!m_thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+        m_wake.notify_one();
+    }
+    m_thread.join();
+}
+
+void MetricsFileExporter::Loop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        lock.unlock();
+        Export();
+        lock.lock();
+        if (m_wake.wait_for(lock, std::chrono::milliseconds(m_intervalMs), [this]() { return m_stopRequested; }))
+            break;
+    }
+    lock.unlock();
+    Export();
+}
+
+void MetricsFileExporter::Export()
+{
+    m_lastResult = m_registry.WritePrometheusFile(m_path);
+    m_writes++;
+}
+
+} // namespace MicVol
@@ -0,0 +1,161 @@
+#pragma once
+#include "Clock.h"
+#include "Platform.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MicVol
+{
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "metrics are recorded with lock-free atomics");
+
+// Monotonically increasing count. Add() is one relaxed atomic add: no lock, no allocation.
+class Counter
+{
+public:
+    void Add(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_value{0};
+};
+
+// Distribution of durations in microseconds over power-of-two buckets: bucket i
+// counts values up to 2^i us, the last one everything above 2^(BucketCount-2) us
+// (about 18 minutes). Record() is three relaxed atomic adds: no lock, no allocation.
+class Histogram
+{
+public:
+    static const int BucketCount = 32;
+
+    void Record(uint64_t micros)
+    {
+        m_buckets[BucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+        m_sumMicros.fetch_add(micros, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static int BucketIndex(uint64_t micros)
+    {
+        int index = 0;
+        for (uint64_t rest = micros > 0 ? micros - 1 : 0; rest != 0; rest >>= 1)
+        {
+            index++;
+        }
+        return index < BucketCount - 1 ? index : BucketCount - 1;
+    }
+
+    uint64_t Bucket(int index) const { return m_buckets[index].load(std::memory_order_relaxed); }
+    uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t SumMicros() const { return m_sumMicros.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_buckets[BucketCount] = {};
+    std::atomic<uint64_t> m_sumMicros{0};
+    std::atomic<uint64_t> m_count{0};
+};
+
+// Records the time from construction to destruction; a null histogram records nothing
+class ScopedLatency
+{
+public:
+    explicit ScopedLatency(Histogram *histogram) : m_histogram(histogram), m_startUs(histogram ? MonotonicUs() : 0) {}
+    ~ScopedLatency()
+    {
+        if (m_histogram)
+            m_histogram->Record(MonotonicUs() - m_startUs);
+    }
+
+    ScopedLatency(const ScopedLatency &) = delete;
+    ScopedLatency &operator=(const ScopedLatency &) = delete;
+
+private:
+    Histogram *m_histogram;
+    uint64_t m_startUs;
+};
+
+// Names the metrics of the service for export. The metrics are owned by the
+// components that record them; registration keeps a reference, allocates and is
+// meant for startup. Formatting only reads the atomics, so any thread may export
+// while the worker records.
+class MetricsRegistry
+{
+public:
+    // name follows Prometheus conventions: counters end in _total, histograms in _seconds
+    void AddCounter(const char *name, const char *help, const Counter &counter);
+    void AddHistogram(const char *name, const char *help, const Histogram &histogram);
+
+    // Prometheus text exposition format, version 0.0.4
+    std::string FormatPrometheus() const;
+
+    // Replaces the file through a temporary one, so readers never see half a snapshot
+    HRESULT WritePrometheusFile(const std::wstring &path) const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        std::string help;
+        const Counter *counter;
+        const Histogram *histogram;
+    };
+
+    std::vector<Entry> m_entries;
+};
+
+// What the enforcement loop records
+struct EnforcementMetrics
+{
+    Counter ticks;             // Sweep(), CheckDue() and ProcessNotifications() passes
+    Counter corrections;       // Volume and mute writes that succeeded
+    Counter tamperEvents;      // Foreign changes reported by volume notifications
+    Counter backendErrors;     // Failed endpoint reads and writes
+    Counter callTimeouts;      // Device checks whose endpoint calls overran their deadline
+    Counter checksDropped;     // Device checks not made since every pool thread was stuck
+    Counter breakerTrips;      // Circuit breakers opened by failing devices
+    Histogram backendCall;     // Each endpoint volume or mute read and write
+    Histogram tick;            // Duration of a pass
+    Histogram timeToCorrect;   // From the change notification to the completed correction
+};
+
+void RegisterEnforcementMetrics(MetricsRegistry &registry, const EnforcementMetrics &metrics);
+
+// Rewrites the Prometheus file every intervalMs on its own thread, so exporting
+// never runs on the worker. Stop() writes a last snapshot.
+class MetricsFileExporter
+{
+public:
+    explicit MetricsFileExporter(const MetricsRegistry &registry) : m_registry(registry) {}
+    ~MetricsFileExporter();
+
+    MetricsFileExporter(const MetricsFileExporter &) = delete;
+    MetricsFileExporter &operator=(const MetricsFileExporter &) = delete;
+
+    HRESULT Start(const std::wstring &path, uint32_t intervalMs);
+    void Stop();
+    bool IsRunning() const { return m_thread.joinable(); }
+
+    uint64_t Writes() const { return m_writes.load(); }
+    HRESULT LastResult() const { return m_lastResult.load(); }
+
+private:
+    void Loop();
+    void Export();
+
+    const MetricsRegistry &m_registry;
+    std::wstring m_path;
+    uint32_t m_intervalMs = 0;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopRequested = false;
+    std::atomic<uint64_t> m_writes{0};
+    std::atomic<HRESULT> m_lastResult{S_OK};
+};
+
+} // namespace MicVol
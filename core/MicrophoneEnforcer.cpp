@@ -0,0 +1,931 @@
+#include "MicrophoneEnforcer.h"
+#include <cmath>
+
+namespace MicVol
+{
+
+MicrophoneEnforcer::MicrophoneEnforcer(AudioBackend &backend, Clock &clock, EnforcementObserver &observer,
+                                       std::function<void()> wake)
+    : m_backend(backend), m_clock(clock), m_observer(observer), m_wake(std::move(wake)),
+      m_session(backend, m_devices), m_inventory(m_wake)
+{
+    // Captures the records and the backend, not the enforcer, which a stuck call may outlive
+    std::shared_ptr<CallRecords> calls = std::make_shared<CallRecords>();
+    m_calls = calls;
+    AudioBackend *audio = &m_backend;
+    m_callTask = std::make_shared<const WorkerPool::Task>([calls, audio](uint32_t device) {
+        std::shared_ptr<CheckRecord> record;
+        {
+            std::lock_guard<std::mutex> lock(calls->mutex);
+            record = calls->records[device];
+        }
+
+        // The worker drops a queued call that no thread got to; whoever claims it first wins
+        uint8_t expected = CallQueued;
+        if (!record->state.compare_exchange_strong(expected, CallRunning, std::memory_order_acquire))
+            return;
+        CallEndpoint(record->check, *audio);
+        record->state.store(CallDone, std::memory_order_release);
+    });
+}
+
+MicrophoneEnforcer::~MicrophoneEnforcer()
+{
+    Shutdown();
+}
+
+void MicrophoneEnforcer::SetRules(const std::vector<PolicyRule> &rules)
+{
+    m_rules = rules;
+    CompilePolicy();
+}
+
+void MicrophoneEnforcer::SetFilter(const std::wstring &filter)
+{
+    m_filter = filter;
+    CompilePolicy();
+}
+
+bool MicrophoneEnforcer::IsSelected(const std::wstring &deviceName)
+{
+    PolicySubject subject;
+    subject.name = deviceName;
+    DevicePolicy policy;
+    m_policy.Resolve(subject, policy);
+    return policy.enforce;
+}
+
+void MicrophoneEnforcer::CompilePolicy()
+{
+    // Process rules are for audio sessions (SessionEnforcer) and skipped by the device scope
+    std::vector<PolicyRule> rules = m_rules;
+    if (!m_filter.empty())
+    {
+        PolicyRule filterRule;
+        filterRule.pattern = L"*" + m_filter + L"*";
+        rules.push_back(filterRule);
+    }
+    m_policy.Compile(rules);
+
+    // Every known device is resolved again on the next pass
+    for (DeviceHandle device = 0; device < (DeviceHandle)m_devices.Size(); device++)
+    {
+        m_devices.Slot(device).policyResolved = false;
+    }
+    m_inventoryGeneration = 0;
+}
+
+// Evaluates the rules for one present device and caches the outcome in its slot
+void MicrophoneEnforcer::ResolvePolicy(DeviceHandle device)
+{
+    DeviceSlot &slot = m_devices.Slot(device);
+
+    PolicySubject subject;
+    subject.name = m_session.GetName(device);
+    subject.endpointId = m_devices.EndpointId(device);
+    if (m_policy.UsesField(RuleField::FormFactor))
+    {
+        if (FAILED(m_backend.GetEndpointFormFactor(subject.endpointId, subject.formFactor)))
+            subject.formFactor = FormFactor::UnknownFormFactor;
+    }
+
+    DevicePolicy policy;
+    slot.policyRule = m_policy.Resolve(subject, policy);
+
+    bool changed = !slot.policyResolved || slot.enforced != policy.enforce ||
+                   slot.targetVolume != policy.targetVolume || slot.tolerance != policy.tolerance ||
+                   slot.mute != policy.mute;
+    slot.enforced = policy.enforce;
+    slot.targetVolume = policy.targetVolume;
+    slot.tolerance = policy.tolerance;
+    slot.mute = policy.mute;
+    slot.policyResolved = true;
+    if (!changed)
+        return;
+
+    m_observer.OnPolicyResolved(device);
+
+    // A watch holds the old targets; the next pass attaches a new one if still enforced
+    if (m_volumeWatch)
+        m_volumeWatch->Detach(device);
+
+    m_wars.Forget(device);
+    if (m_adaptive && slot.enforced)
+    {
+        slot.checkIntervalMs = 0;
+        m_schedule.Schedule(device, m_clock.NowMs());
+    }
+    else
+    {
+        m_schedule.Cancel(device);
+    }
+}
+
+void MicrophoneEnforcer::EnableNotifications()
+{
+    if (!m_volumeWatch)
+    {
+        m_volumeWatch.reset(new VolumeChangeEnforcer(m_wake, &m_metrics));
+    }
+}
+
+void MicrophoneEnforcer::DisableNotifications()
+{
+    if (m_volumeWatch)
+    {
+        m_volumeWatch->DetachAll();
+        m_volumeWatch.reset();
+    }
+}
+
+void MicrophoneEnforcer::Shutdown()
+{
+    DisableNotifications();
+    m_wars.Reset();
+    m_breakers.Reset();
+    if (!m_adaptive)
+        m_schedule.Clear();
+
+    // Endpoints go with the session, except one a stuck call still holds on to
+    for (std::shared_ptr<CheckRecord> &record : m_calls->records)
+    {
+        if (record && record->state.load(std::memory_order_acquire) != CallRunning)
+            record->check.endpoint.reset();
+    }
+
+    // No device notification may call the wake function after this
+    m_inventory.Reset(m_backend);
+    m_session.Close();
+}
+
+// Brings the device inventory up to date: one full enumeration at start,
+// afterwards only the queued device notifications are applied
+HRESULT MicrophoneEnforcer::UpdateInventory()
+{
+    // Without notifications the inventory cannot track hotplug, so fall back to enumerating
+    if (!m_inventory.IsBuilt() || !m_inventory.IsNotifying())
+    {
+        bool firstBuild = !m_inventory.IsBuilt();
+        HRESULT hr = m_inventory.Build(m_backend);
+        if (SUCCEEDED(hr) && firstBuild && !m_inventory.IsNotifying())
+        {
+            m_observer.OnDeviceNotificationsUnavailable();
+        }
+        return hr;
+    }
+
+    InventoryChanges changes = m_inventory.ApplyPending(m_backend);
+
+    for (const std::wstring &deviceId : changes.removed)
+    {
+        DeviceHandle device = m_devices.Find(deviceId);
+        if (device != InvalidDeviceHandle)
+        {
+            m_observer.OnDeviceRemoved(device);
+            m_session.Forget(device);
+            m_devices.Slot(device).policyResolved = false;
+        }
+    }
+    for (const std::wstring &deviceId : changes.renamed)
+    {
+        DeviceHandle device = m_devices.Find(deviceId);
+        if (device != InvalidDeviceHandle)
+        {
+            m_session.ForgetName(device);
+            m_devices.Slot(device).policyResolved = false;
+            if (m_devices.Slot(device).present)
+                ResolvePolicy(device);
+            m_observer.OnDeviceRenamed(device);
+        }
+    }
+
+    return S_OK;
+}
+
+// Re-interns the inventory into handles; only runs when the device set changed
+void MicrophoneEnforcer::RefreshActiveDevices()
+{
+    if (m_inventory.Generation() == m_inventoryGeneration)
+        return;
+    m_inventoryGeneration = m_inventory.Generation();
+
+    for (DeviceHandle device : m_activeDevices)
+    {
+        m_devices.Slot(device).present = false;
+    }
+
+    m_activeDevices.clear();
+    for (const std::wstring &deviceId : m_inventory.CaptureDevices())
+    {
+        DeviceHandle device = m_devices.Intern(deviceId);
+        m_devices.Slot(device).present = true;
+        m_activeDevices.push_back(device);
+    }
+
+    // A device that went away may come back under another name
+    for (DeviceHandle device = 0; device < (DeviceHandle)m_devices.Size(); device++)
+    {
+        DeviceSlot &slot = m_devices.Slot(device);
+        if (!slot.present)
+            slot.policyResolved = false;
+    }
+    for (DeviceHandle device : m_activeDevices)
+    {
+        if (!m_devices.Slot(device).policyResolved)
+            ResolvePolicy(device);
+    }
+
+    // Gone devices leave the schedule, which also holds the follow-up checks of tamper wars
+    for (DeviceHandle device = 0; device < (DeviceHandle)m_devices.Size(); device++)
+    {
+        if (m_devices.Slot(device).present)
+            continue;
+        m_wars.Forget(device);
+        m_breakers.Forget(device);
+        if (m_schedule.IsScheduled(device))
+        {
+            m_schedule.Cancel(device);
+            if (m_volumeWatch)
+                m_volumeWatch->Detach(device);
+        }
+    }
+
+    if (m_adaptive)
+    {
+        // New and returning selected devices are checked right away
+        uint64_t now = m_clock.NowMs();
+        for (DeviceHandle device : m_activeDevices)
+        {
+            if (!m_schedule.IsScheduled(device) && m_devices.Slot(device).enforced)
+            {
+                m_devices.Slot(device).checkIntervalMs = 0;
+                m_schedule.Schedule(device, now);
+            }
+        }
+    }
+
+    m_observer.OnActiveDevicesChanged(m_activeDevices.size());
+}
+
+void MicrophoneEnforcer::EnableAdaptiveSchedule(const CheckSchedule &schedule)
+{
+    m_scheduleOptions = schedule;
+    if (m_scheduleOptions.minIntervalMs < 1)
+        m_scheduleOptions.minIntervalMs = 1;
+    if (m_scheduleOptions.maxIntervalMs < m_scheduleOptions.minIntervalMs)
+        m_scheduleOptions.maxIntervalMs = m_scheduleOptions.minIntervalMs;
+    if (m_scheduleOptions.backoff < 1)
+        m_scheduleOptions.backoff = 1;
+
+    m_adaptive = true;
+
+    // Schedule the devices already known on the next pass
+    m_inventoryGeneration = 0;
+}
+
+// Opens the session and brings the device list up to date; false if there is nothing to check
+bool MicrophoneEnforcer::BeginPass()
+{
+    // The backend connection, the enumerator and activated endpoints persist across passes
+    HRESULT hr = m_session.Open();
+    if (FAILED(hr))
+    {
+        m_observer.OnSessionError(hr);
+        return false;
+    }
+
+    m_session.BeginTick();
+
+    hr = UpdateInventory();
+    if (FAILED(hr))
+    {
+        m_observer.OnEnumerationError(hr);
+        return false;
+    }
+
+    RefreshActiveDevices();
+    return true;
+}
+
+void MicrophoneEnforcer::Sweep()
+{
+    m_metrics.ticks.Add();
+    ScopedLatency tickLatency(&m_metrics.tick);
+    if (!BeginPass())
+        return;
+
+    uint64_t now = m_clock.NowMs();
+    if (m_pool)
+    {
+        m_checkBatch.clear();
+        for (DeviceHandle device : m_activeDevices)
+        {
+            if (m_devices.Slot(device).enforced && ShouldCheck(device, now))
+                m_checkBatch.push_back(device);
+        }
+        CallEndpoints(m_checkBatch);
+    }
+
+    m_watchedDevices.clear();
+    for (DeviceHandle device : m_activeDevices)
+    {
+        if (!m_devices.Slot(device).enforced)
+            continue;
+
+        if (ShouldCheck(device, now))
+        {
+            HRESULT failure;
+            CheckResult result = CheckDevice(device, failure);
+            FinishCheck(device, result, failure);
+        }
+
+        if (m_volumeWatch)
+        {
+            m_watchedDevices.push_back(device);
+            if (!m_volumeWatch->IsAttached(device) && !m_breakers.IsOpen(device))
+            {
+                AttachWatch(device);
+            }
+        }
+    }
+
+    // Drop registrations for devices that went away or no longer match the filter
+    if (m_volumeWatch)
+    {
+        m_volumeWatch->DetachMissing(m_watchedDevices);
+    }
+}
+
+void MicrophoneEnforcer::Resync()
+{
+    for (DeviceHandle device = 0; device < (DeviceHandle)m_devices.Size(); device++)
+    {
+        m_wars.Forget(device);
+        m_breakers.Forget(device);
+        m_devices.Slot(device).checkIntervalMs = 0;
+    }
+    if (!m_adaptive)
+        m_schedule.Clear();
+
+    Sweep();
+}
+
+void MicrophoneEnforcer::SetBreakerOptions(const BreakerOptions &options)
+{
+    m_breakers.SetOptions(options);
+    if (!m_adaptive)
+        m_schedule.Clear();
+}
+
+void MicrophoneEnforcer::SetTamperWarOptions(const TamperWarOptions &options)
+{
+    m_wars.SetOptions(options);
+    if (!m_adaptive)
+        m_schedule.Clear();
+}
+
+void MicrophoneEnforcer::CheckDue()
+{
+    // Without the adaptive schedule only tamper wars put devices on it
+    if (!m_adaptive && m_schedule.Size() == 0)
+        return;
+
+    m_metrics.ticks.Add();
+    ScopedLatency tickLatency(&m_metrics.tick);
+    if (!BeginPass())
+        return;
+
+    uint64_t now = m_clock.NowMs();
+    m_dueDevices.clear();
+    m_schedule.PopDue(now, m_dueDevices);
+
+    // A device scheduled for another reason waits for the probe of its open breaker
+    size_t kept = 0;
+    for (DeviceHandle device : m_dueDevices)
+    {
+        if (m_breakers.Allow(device, now))
+            m_dueDevices[kept++] = device;
+        else
+            m_schedule.Schedule(device, m_breakers.RetryAtMs(device));
+    }
+    m_dueDevices.resize(kept);
+    CallEndpoints(m_dueDevices);
+
+    for (DeviceHandle device : m_dueDevices)
+    {
+        HRESULT failure;
+        CheckResult result = CheckDevice(device, failure);
+        FinishCheck(device, result, failure);
+
+        if (m_volumeWatch && !m_volumeWatch->IsAttached(device) && !m_breakers.IsOpen(device))
+        {
+            AttachWatch(device);
+        }
+    }
+}
+
+// Checks a tampered device again soon; backs off exponentially while it stays at its target
+void MicrophoneEnforcer::Reschedule(DeviceHandle device, bool tampered)
+{
+    DeviceSlot &slot = m_devices.Slot(device);
+    if (tampered || slot.checkIntervalMs == 0)
+    {
+        slot.checkIntervalMs = m_scheduleOptions.minIntervalMs;
+    }
+    else
+    {
+        uint64_t interval = (uint64_t)slot.checkIntervalMs * m_scheduleOptions.backoff;
+        slot.checkIntervalMs = (uint32_t)(interval < m_scheduleOptions.maxIntervalMs ? interval : m_scheduleOptions.maxIntervalMs);
+    }
+    m_schedule.Schedule(device, m_clock.NowMs() + slot.checkIntervalMs);
+}
+
+// Backoff of a tamper war or an open breaker: the device is left alone for now
+bool MicrophoneEnforcer::ShouldCheck(DeviceHandle device, uint64_t nowMs)
+{
+    return !m_wars.IsHeld(device, nowMs) && m_breakers.Allow(device, nowMs);
+}
+
+MicrophoneEnforcer::CheckRecord &MicrophoneEnforcer::Record(DeviceHandle device)
+{
+    // Only the worker changes the table, so it reads it without the lock
+    std::vector<std::shared_ptr<CheckRecord>> &records = m_calls->records;
+    if (device >= records.size() || !records[device])
+    {
+        std::lock_guard<std::mutex> lock(m_calls->mutex);
+        if (device >= records.size())
+            records.resize(device < m_devices.Size() ? m_devices.Size() : device + 1);
+        records[device] = std::make_shared<CheckRecord>();
+    }
+    return *records[device];
+}
+
+// Makes the endpoint calls of the checks of devices on the pool, one task per device
+// sharded by handle; CheckDevice() then only applies what they returned. The worker
+// waits for a check no longer than the call deadline.
+void MicrophoneEnforcer::CallEndpoints(const std::vector<DeviceHandle> &devices)
+{
+    if (!m_pool || m_pool->ThreadCount() == 0 || devices.empty())
+        return;
+
+    m_poolBatch.clear();
+    for (DeviceHandle device : devices)
+    {
+        CheckRecord &record = Record(device);
+        record.pending = true;
+        if (!BeginCheck(device, record, true))
+            continue;
+        record.state.store(CallQueued, std::memory_order_relaxed);
+        m_poolBatch.push_back(device);
+    }
+
+    m_pool->RunBatch(m_poolBatch.data(), m_poolBatch.size(), m_callTask, m_callDeadlineMs);
+
+    for (DeviceHandle device : m_poolBatch)
+    {
+        CheckRecord &record = *m_calls->records[device];
+        uint8_t state = CallQueued;
+        if (record.state.compare_exchange_strong(state, CallIdle, std::memory_order_acquire))
+            record.verdict = CallVerdict::Dropped;
+        else if (state == CallDone)
+            record.state.store(CallIdle, std::memory_order_relaxed);
+        else
+            record.verdict = CallVerdict::TimedOut;
+    }
+}
+
+// Worker thread part of a check before the endpoint calls: takes the endpoint from the
+// session cache, and resumes a held watch since the check covers what it flagged. An
+// endpoint not cached is activated here, or by the calls when they run on the pool.
+// False while a call given up on is still running; the device is not called meanwhile.
+bool MicrophoneEnforcer::BeginCheck(DeviceHandle device, CheckRecord &record, bool onPool)
+{
+    if (record.state.load(std::memory_order_acquire) == CallRunning)
+    {
+        record.verdict = CallVerdict::TimedOut;
+        return false;
+    }
+
+    // A call given up on may have returned since; what it found is stale
+    record.state.store(CallIdle, std::memory_order_relaxed);
+    record.verdict = CallVerdict::Made;
+    EndpointCheck &check = record.check;
+    check = EndpointCheck();
+    const DeviceSlot &slot = m_devices.Slot(device);
+    check.targetVolume = slot.targetVolume;
+    check.tolerance = slot.tolerance;
+    check.mute = slot.mute;
+    check.deadlineUs = (uint64_t)m_callDeadlineMs * 1000;
+    if (m_volumeWatch)
+        m_volumeWatch->Resume(device);
+
+    if (!onPool)
+    {
+        check.activateHr = m_session.GetEndpoint(device, check.endpoint);
+    }
+    else if (!m_session.FindEndpoint(device, check.endpoint))
+    {
+        check.activate = true;
+        check.endpointId = m_devices.EndpointId(device);
+    }
+    return true;
+}
+
+// Reads the level (and the mute state if enforced) and writes what is off target.
+// Uses only the check, never the device table, so it may run on a pool thread while
+// the worker waits or has moved on.
+void MicrophoneEnforcer::CallEndpoint(EndpointCheck &check, AudioBackend &backend)
+{
+    uint64_t startedUs = MonotonicUs();
+
+    if (check.activate)
+    {
+        check.calls.activations++;
+        check.activateHr = backend.ActivateVolume(check.endpointId, check.endpoint);
+        if (FAILED(check.activateHr))
+            check.endpoint.reset();
+    }
+
+    if (check.endpoint)
+    {
+        uint64_t callStartedUs = MonotonicUs();
+        check.calls.volumeReads++;
+        check.readHr = check.endpoint->GetMasterVolume(&check.volume);
+        check.EndCall(callStartedUs);
+    }
+    else
+    {
+        check.readHr = check.activateHr;
+    }
+    if (FAILED(check.readHr))
+        check.volume = -1.0f;
+
+    if (std::abs(check.volume - check.targetVolume) > check.tolerance)
+    {
+        check.volumeWritten = true;
+        if (check.endpoint)
+        {
+            uint64_t callStartedUs = MonotonicUs();
+            check.calls.volumeWrites++;
+            check.writeHr = check.endpoint->SetMasterVolume(check.targetVolume);
+            check.EndCall(callStartedUs);
+        }
+        else
+        {
+            check.writeHr = check.activateHr;
+        }
+    }
+
+    if (check.mute != MutePolicy::Leave && check.volume >= 0.0f)
+    {
+        check.muteRead = true;
+        {
+            uint64_t callStartedUs = MonotonicUs();
+            check.calls.muteReads++;
+            check.muteReadHr = check.endpoint->GetMute(&check.muted);
+            check.EndCall(callStartedUs);
+        }
+        const bool wanted = check.mute == MutePolicy::Mute;
+        if (SUCCEEDED(check.muteReadHr) && check.muted != wanted)
+        {
+            check.muteWritten = true;
+            uint64_t callStartedUs = MonotonicUs();
+            check.calls.muteWrites++;
+            check.muteWriteHr = check.endpoint->SetMute(wanted);
+            check.EndCall(callStartedUs);
+        }
+    }
+
+    check.overran = check.deadlineUs > 0 && MonotonicUs() - startedUs > check.deadlineUs;
+}
+
+// Checks one device: tracks level changes and corrects the level when it is outside the
+// tolerance band. Without a pool the endpoint calls are made here, in between. failure
+// is the first error of the check, for the circuit breaker.
+MicrophoneEnforcer::CheckResult MicrophoneEnforcer::CheckDevice(DeviceHandle device, HRESULT &failure)
+{
+    CheckRecord &record = Record(device);
+    if (!record.pending && BeginCheck(device, record, false))
+        CallEndpoint(record.check, m_backend);
+    record.pending = false;
+    failure = S_OK;
+
+    DeviceSlot &slot = m_devices.Slot(device);
+    if (record.verdict == CallVerdict::Dropped)
+    {
+        m_metrics.checksDropped.Add();
+        m_observer.OnCheckDropped(device);
+        return CheckResult::Skipped;
+    }
+
+    m_checks++;
+    if (record.verdict == CallVerdict::TimedOut)
+    {
+        // The stuck call still owns the record, and the endpoint stays cached for it.
+        // Notifications must not call the device from the worker thread either.
+        if (m_volumeWatch)
+            m_volumeWatch->Hold(device);
+        m_metrics.callTimeouts.Add();
+        CountError(slot);
+        slot.consecutiveErrors++;
+        m_observer.OnReadFailed(device, MVS_E_CALL_TIMEOUT, CorrectionSource::Sweep);
+        failure = MVS_E_CALL_TIMEOUT;
+        return CheckResult::Failed;
+    }
+
+    const EndpointCheck &check = record.check;
+    m_session.CountCalls(check.calls);
+    if (check.activate && check.endpoint)
+        m_session.CacheEndpoint(device, check.endpoint);
+    for (uint8_t call = 0; call < check.callCount; call++)
+        m_metrics.backendCall.Record(check.callUs[call]);
+    if (check.endpoint && (FAILED(check.readHr) || FAILED(check.writeHr) || FAILED(check.muteReadHr) ||
+                           FAILED(check.muteWriteHr)))
+    {
+        m_session.Invalidate(device);
+    }
+
+    float currentVolume = check.volume;
+    if (SUCCEEDED(check.readHr))
+    {
+        slot.consecutiveErrors = 0;
+    }
+    else
+    {
+        CountError(slot);
+        slot.consecutiveErrors++;
+        m_observer.OnReadFailed(device, check.readHr, CorrectionSource::Sweep);
+    }
+    const float targetVolume = check.targetVolume;
+    const float tolerance = check.tolerance;
+
+    bool volumeChanged = false;
+    if (!slot.seen)
+    {
+        slot.lastVolume = currentVolume;
+        slot.seen = true;
+        volumeChanged = true;
+        m_observer.OnDeviceAdded(device, currentVolume);
+    }
+    else if (std::abs(currentVolume - slot.lastVolume) > tolerance)
+    {
+        volumeChanged = true;
+        m_observer.OnVolumeChanged(device, slot.lastVolume, currentVolume);
+        slot.lastVolume = currentVolume;
+    }
+
+    CheckResult result = CheckResult::AtTarget;
+    if (check.volumeWritten)
+    {
+        if (SUCCEEDED(check.writeHr))
+        {
+            slot.lastVolume = targetVolume;
+            CountCorrection(slot);
+            m_observer.OnVolumeCorrected(device, currentVolume, targetVolume, CorrectionSource::Sweep);
+            result = CheckResult::Corrected;
+        }
+        else
+        {
+            CountError(slot);
+            m_observer.OnCorrectionFailed(device, currentVolume, targetVolume, check.writeHr, CorrectionSource::Sweep);
+            result = CheckResult::Failed;
+        }
+    }
+    else if (volumeChanged)
+    {
+        m_observer.OnVolumeAtTarget(device);
+    }
+
+    if (check.muteRead)
+    {
+        CheckResult muteResult = CheckMute(device, check);
+        if (result == CheckResult::AtTarget)
+            result = muteResult;
+    }
+
+    if (FAILED(check.readHr))
+        failure = check.readHr;
+    else if (FAILED(check.writeHr))
+        failure = check.writeHr;
+    else if (FAILED(check.muteReadHr))
+        failure = check.muteReadHr;
+    else if (FAILED(check.muteWriteHr))
+        failure = check.muteWriteHr;
+    if (check.overran)
+    {
+        m_metrics.callTimeouts.Add();
+        if (SUCCEEDED(failure))
+            failure = MVS_E_CALL_TIMEOUT;
+    }
+    return result;
+}
+
+MicrophoneEnforcer::CheckResult MicrophoneEnforcer::CheckMute(DeviceHandle device, const EndpointCheck &check)
+{
+    DeviceSlot &slot = m_devices.Slot(device);
+    if (FAILED(check.muteReadHr))
+    {
+        CountError(slot);
+        m_observer.OnReadFailed(device, check.muteReadHr, CorrectionSource::Sweep);
+        return CheckResult::Failed;
+    }
+    if (!check.muteWritten)
+        return CheckResult::AtTarget;
+
+    m_observer.OnMuteCorrected(device, !check.muted, check.muteWriteHr, CorrectionSource::Sweep);
+    if (FAILED(check.muteWriteHr))
+    {
+        CountError(slot);
+        return CheckResult::Failed;
+    }
+    CountCorrection(slot);
+    return CheckResult::Corrected;
+}
+
+void MicrophoneEnforcer::CountCorrection(DeviceSlot &slot)
+{
+    slot.corrections++;
+    slot.lastCorrectionMs = m_clock.NowMs();
+    m_metrics.corrections.Add();
+}
+
+void MicrophoneEnforcer::CountError(DeviceSlot &slot)
+{
+    slot.errorCount++;
+    m_metrics.backendErrors.Add();
+}
+
+// Follows a check up: its next check on the schedule, tamper war and breaker bookkeeping
+void MicrophoneEnforcer::FinishCheck(DeviceHandle device, CheckResult result, HRESULT failure)
+{
+    if (result == CheckResult::Skipped)
+    {
+        // Nothing was learned; try again soon
+        if (m_adaptive || m_breakers.IsOpen(device))
+            m_schedule.Schedule(device, m_clock.NowMs() + m_scheduleOptions.minIntervalMs);
+        return;
+    }
+
+    if (m_adaptive)
+        Reschedule(device, result == CheckResult::Corrected);
+    TrackFight(device, result);
+    TrackBreaker(device, failure);
+}
+
+// Feeds the outcome of a check or correction to the tamper war detector and applies the
+// strategy: the follow-up check goes on the schedule, a backing-off watch is held
+void MicrophoneEnforcer::TrackFight(DeviceHandle device, CheckResult result)
+{
+    if (!m_wars.Enabled() || result == CheckResult::Failed)
+        return;
+
+    DeviceSlot &slot = m_devices.Slot(device);
+    uint64_t now = m_clock.NowMs();
+    FightChange change;
+    if (result == CheckResult::Corrected)
+    {
+        change = m_wars.OnCorrected(device, now);
+        if (m_wars.State(device).streak > 1)
+            slot.tamperCycles++;
+    }
+    else
+    {
+        change = m_wars.OnAtTarget(device, now);
+    }
+
+    if (change == FightChange::Ended)
+    {
+        const TamperWarState &state = m_wars.State(device);
+        m_observer.OnTamperWarEnded(device, state.cycles, now - state.startedMs);
+        // The adaptive schedule already has the regular next check
+        if (!m_adaptive)
+            m_schedule.Cancel(device);
+        return;
+    }
+    if (change == FightChange::Started)
+    {
+        slot.tamperWars++;
+        m_observer.OnTamperWarStarted(device);
+    }
+    if (!m_wars.IsFighting(device))
+        return;
+
+    m_schedule.Schedule(device, m_wars.NextCheckMs(device));
+    if (m_volumeWatch && m_wars.IsHeld(device, now))
+        m_volumeWatch->Hold(device);
+}
+
+// Feeds the outcome of a check or correction to the circuit breaker. An open breaker
+// puts its probe on the schedule and holds the watch, so that notifications make no
+// calls to the device meanwhile.
+void MicrophoneEnforcer::TrackBreaker(DeviceHandle device, HRESULT failure)
+{
+    uint64_t now = m_clock.NowMs();
+    if (SUCCEEDED(failure))
+    {
+        if (m_breakers.OnSuccess(device) != BreakerChange::Closed)
+            return;
+        m_observer.OnBreakerClosed(device, now - m_breakers.State(device).openedMs);
+        // The adaptive schedule and a tamper war already have the next check
+        if (!m_adaptive && !m_wars.IsFighting(device))
+            m_schedule.Cancel(device);
+        return;
+    }
+
+    BreakerChange change = m_breakers.OnFailure(device, failure, now);
+    if (change == BreakerChange::None)
+        return;
+
+    uint64_t retryAt = m_breakers.RetryAtMs(device);
+    if (change == BreakerChange::Opened)
+    {
+        m_metrics.breakerTrips.Add();
+        m_observer.OnBreakerOpened(device, failure, retryAt - now);
+    }
+    m_schedule.Schedule(device, retryAt);
+    if (m_volumeWatch)
+        m_volumeWatch->Hold(device);
+}
+
+void MicrophoneEnforcer::AttachWatch(DeviceHandle device)
+{
+    const DeviceSlot &slot = m_devices.Slot(device);
+
+    // With a pool only the checks activate endpoints; the next one retries
+    std::shared_ptr<VolumeEndpoint> endpoint;
+    HRESULT hr;
+    if (m_pool && m_pool->ThreadCount() > 0)
+    {
+        if (!m_session.FindEndpoint(device, endpoint))
+            return;
+        hr = S_OK;
+    }
+    else
+    {
+        hr = m_session.GetEndpoint(device, endpoint);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = m_volumeWatch->Attach(device, endpoint, slot.targetVolume, slot.tolerance, slot.mute);
+    }
+
+    if (SUCCEEDED(hr))
+        m_observer.OnWatchAttached(device);
+    else
+        m_observer.OnWatchFailed(device, hr);
+}
+
+void MicrophoneEnforcer::ProcessNotifications()
+{
+    if (!m_volumeWatch)
+        return;
+
+    m_metrics.ticks.Add();
+    ScopedLatency tickLatency(&m_metrics.tick);
+    m_corrections.clear();
+    m_volumeWatch->ProcessPending(m_corrections);
+
+    DeviceHandle lastFought = InvalidDeviceHandle;
+    for (const VolumeCorrection &correction : m_corrections)
+    {
+        DeviceSlot &slot = m_devices.Slot(correction.device);
+        slot.lastWriter = correction.writer;
+        if (SUCCEEDED(correction.hr))
+        {
+            if (!correction.mute)
+                slot.lastVolume = correction.targetVolume;
+            CountCorrection(slot);
+            if (correction.flaggedUs != 0)
+                m_metrics.timeToCorrect.Record(MonotonicUs() - correction.flaggedUs);
+            if (correction.mute)
+                m_observer.OnMuteCorrected(correction.device, correction.targetVolume > 0.5f, correction.hr,
+                                           CorrectionSource::Notification);
+            else
+                m_observer.OnVolumeCorrected(correction.device, correction.observedVolume, correction.targetVolume,
+                                             CorrectionSource::Notification);
+            if (m_adaptive && m_schedule.IsScheduled(correction.device))
+                Reschedule(correction.device, true);
+            // A volume and a mute correction of one change are one round
+            if (correction.device != lastFought)
+                TrackFight(correction.device, CheckResult::Corrected);
+            lastFought = correction.device;
+            TrackBreaker(correction.device, S_OK);
+        }
+        else
+        {
+            CountError(slot);
+            if (correction.observedVolume < 0.0f)
+                m_observer.OnReadFailed(correction.device, correction.hr, CorrectionSource::Notification);
+            else if (correction.mute)
+                m_observer.OnMuteCorrected(correction.device, correction.targetVolume > 0.5f, correction.hr,
+                                           CorrectionSource::Notification);
+            else
+                m_observer.OnCorrectionFailed(correction.device, correction.observedVolume, correction.targetVolume,
+                                              correction.hr, CorrectionSource::Notification);
+            m_session.Invalidate(correction.device);
+            TrackBreaker(correction.device, correction.hr);
+        }
+    }
+}
+
+} // namespace MicVol
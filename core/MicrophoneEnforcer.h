@@ -0,0 +1,327 @@
+#pragma once
+#include "AudioSession.h"
+#include "CircuitBreaker.h"
+#include "Clock.h"
+#include "DeviceInventory.h"
+#include "Metrics.h"
+#include "PolicyRules.h"
+#include "TamperWar.h"
+#include "TimerWheel.h"
+#include "VolumeChangeEnforcer.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace MicVol
+{
+
+// Reported for a device check whose endpoint calls overran their deadline
+// (same value as HRESULT_FROM_WIN32(ERROR_TIMEOUT))
+const HRESULT MVS_E_CALL_TIMEOUT = (HRESULT)0x800705B4L;
+
+enum class CorrectionSource
+{
+    Sweep,       // Sweep of every device or scheduled check of one
+    Notification // Volume change notification in event-driven mode
+};
+
+// Bounds of the adaptive per-device check interval. A device whose level had to
+// be corrected is checked again after minIntervalMs; every check that finds it
+// at its target multiplies the interval by backoff, up to maxIntervalMs.
+struct CheckSchedule
+{
+    uint32_t minIntervalMs = 250;
+    uint32_t maxIntervalMs = 30000;
+    uint32_t backoff = 2;
+};
+
+// What the enforcer did, for logging. Every method has an empty default.
+// Names are available through MicrophoneEnforcer::Session().GetName(device).
+class EnforcementObserver
+{
+public:
+    virtual ~EnforcementObserver() = default;
+
+    virtual void OnSessionError(HRESULT) {}
+    virtual void OnEnumerationError(HRESULT) {}
+    virtual void OnDeviceNotificationsUnavailable() {}
+    virtual void OnActiveDevicesChanged(size_t) {}
+
+    virtual void OnDeviceAdded(DeviceHandle, float /*volume*/) {}
+    virtual void OnDeviceRemoved(DeviceHandle) {}
+    virtual void OnDeviceRenamed(DeviceHandle) {}
+
+    // The policy in the DeviceSlot was set or changed (device appeared or was renamed, rules changed)
+    virtual void OnPolicyResolved(DeviceHandle) {}
+
+    virtual void OnVolumeChanged(DeviceHandle, float /*oldVolume*/, float /*newVolume*/) {}
+    virtual void OnVolumeAtTarget(DeviceHandle) {}
+    virtual void OnVolumeCorrected(DeviceHandle, float /*oldVolume*/, float /*newVolume*/, CorrectionSource) {}
+    virtual void OnCorrectionFailed(DeviceHandle, float /*oldVolume*/, float /*targetVolume*/, HRESULT, CorrectionSource) {}
+    virtual void OnReadFailed(DeviceHandle, HRESULT, CorrectionSource) {}
+    virtual void OnMuteCorrected(DeviceHandle, bool /*muted*/, HRESULT, CorrectionSource) {}
+
+    virtual void OnWatchAttached(DeviceHandle) {}
+    virtual void OnWatchFailed(DeviceHandle, HRESULT) {}
+
+    // Another application keeps re-applying its level; corrections made while the
+    // war lasts are reported as usual, InTamperWar() tells them apart
+    virtual void OnTamperWarStarted(DeviceHandle) {}
+    virtual void OnTamperWarEnded(DeviceHandle, uint32_t /*cycles*/, uint64_t /*durationMs*/) {}
+
+    // The device kept failing and is skipped until a probe after retryInMs succeeds;
+    // failed probes are not reported again
+    virtual void OnBreakerOpened(DeviceHandle, HRESULT, uint64_t /*retryInMs*/) {}
+    virtual void OnBreakerClosed(DeviceHandle, uint64_t /*openForMs*/) {}
+
+    // Every pool thread was stuck in a call past its deadline, so the device was not
+    // checked; the next pass tries again
+    virtual void OnCheckDropped(DeviceHandle) {}
+};
+
+// The enforcement logic of the service, independent of Windows: keeps the device
+// inventory current, selects devices and their targets by policy rules, tracks
+// per-device state and decides and applies corrections through the AudioBackend.
+//
+// The rules are evaluated only when a device appears or is renamed; the outcome is
+// cached in its DeviceSlot, so the cost of a pass does not depend on the rule count.
+//
+// Sweep() checks every selected device. With the adaptive schedule enabled,
+// CheckDue() checks only the devices whose own interval has elapsed, and
+// NextCheckMs() tells the worker when to call it next. With notifications enabled, selected
+// devices are also watched and ProcessNotifications() corrects the ones that
+// reported a change. The wake function is called from notification threads when
+// there is work for ProcessNotifications() or Sweep(). Everything else must be
+// called from one worker thread.
+//
+// With a fight strategy set, a device whose corrections keep following each other
+// closely is in a tamper war. Its follow-up checks go on the same schedule in
+// every mode, so NextCheckMs() and CheckDue() then matter without the adaptive
+// schedule too.
+//
+// Every pass, endpoint call, correction and error is recorded in Metrics(); recording
+// is a few relaxed atomic adds, so other threads can export them at any time.
+//
+// With a worker pool the endpoint calls of the devices Sweep() and CheckDue() check,
+// including activating an endpoint that is not cached, are made on the pool first,
+// one task per device, and the outcomes are then applied on the worker thread in the
+// same order as without one.
+//
+// The endpoint calls of a check have a deadline. On the pool the worker stops waiting
+// for a check that overruns it and counts it as failed with MVS_E_CALL_TIMEOUT; the
+// device is not called again until the stuck call returns. A device whose checks keep
+// failing or timing out trips its circuit breaker and is skipped until a probe on the
+// schedule succeeds, and its watch is held meanwhile. The pool replaces the threads
+// stuck in such calls as far as its spares allow; when none is left, the checks of the
+// pass are dropped and reported.
+//
+// The deadline does not bound calls made on the worker thread, which can still hang it:
+// every check without a pool (a late one is only counted as timed out), the
+// corrections of ProcessNotifications(), registering a watch, and enumeration, name
+// and form factor reads when devices change.
+class MicrophoneEnforcer
+{
+public:
+    MicrophoneEnforcer(AudioBackend &backend, Clock &clock, EnforcementObserver &observer,
+                       std::function<void()> wake = nullptr);
+    ~MicrophoneEnforcer();
+
+    MicrophoneEnforcer(const MicrophoneEnforcer &) = delete;
+    MicrophoneEnforcer &operator=(const MicrophoneEnforcer &) = delete;
+
+    // Rules in priority order; SetFilter() appends an include rule for a case-insensitive
+    // substring of the friendly name. No rules and no filter select every capture device.
+    void SetRules(const std::vector<PolicyRule> &rules);
+    void SetFilter(const std::wstring &filter);
+    const std::wstring &Filter() const { return m_filter; }
+    const std::vector<PolicyRule> &Rules() const { return m_rules; }
+
+    // Evaluates the rules for a name alone (diagnostics and tests; passes use the cached DeviceSlot)
+    bool IsSelected(const std::wstring &deviceName);
+
+    void EnableNotifications();
+    void DisableNotifications();
+    bool NotificationsEnabled() const { return m_volumeWatch != nullptr; }
+
+    void EnableAdaptiveSchedule(const CheckSchedule &schedule);
+    bool AdaptiveScheduleEnabled() const { return m_adaptive; }
+
+    // Pool for the endpoint calls of Sweep() and CheckDue(); null (the default) makes
+    // them on the worker thread. The pool must outlive the enforcer or be unset first.
+    void SetWorkerPool(WorkerPool *pool) { m_pool = pool; }
+
+    // 0 disables the deadline of the endpoint calls of a check
+    void SetCallDeadline(uint32_t deadlineMs) { m_callDeadlineMs = deadlineMs; }
+    uint32_t CallDeadline() const { return m_callDeadlineMs; }
+
+    // Closes every open breaker without a report
+    void SetBreakerOptions(const BreakerOptions &options);
+    CircuitBreaker &Breakers() { return m_breakers; }
+
+    // Ends any ongoing tamper war without a report
+    void SetTamperWarOptions(const TamperWarOptions &options);
+    bool InTamperWar(DeviceHandle device) const { return m_wars.IsFighting(device); }
+    TamperWarDetector &TamperWars() { return m_wars; }
+
+    void Sweep();
+    void CheckDue();
+    void ProcessNotifications();
+
+    // After a pause, sleep or session lock: applies the queued device changes and checks
+    // every selected device at once. Tamper wars and open breakers do not carry over, and
+    // the adaptive schedule restarts at its minimum interval, since levels may still move
+    // after a resume.
+    void Resync();
+
+    // Clock time of the next CheckDue() work, TimerWheel::Never when nothing is scheduled
+    uint64_t NextCheckMs() const { return m_schedule.NextDueMs(); }
+    uint64_t NextCheckMs(DeviceHandle device) const { return m_schedule.DueMs(device); }
+
+    bool IsWatched(DeviceHandle device) const { return m_volumeWatch && m_volumeWatch->IsAttached(device); }
+
+    // Volume checks made by Sweep() and CheckDue()
+    uint64_t Checks() const { return m_checks; }
+
+    const EnforcementMetrics &Metrics() const { return m_metrics; }
+
+    // Device notifications are queued; a Sweep() applies them
+    bool HasPendingDeviceChanges() { return m_inventory.HasPending(); }
+
+    // Releases watches, notifications and the session on the worker thread
+    void Shutdown();
+
+    DeviceTable &Devices() { return m_devices; }
+    AudioSession &Session() { return m_session; }
+    DeviceInventory &Inventory() { return m_inventory; }
+    PolicyEngine &Policy() { return m_policy; }
+    const std::vector<DeviceHandle> &ActiveDevices() const { return m_activeDevices; }
+
+private:
+    enum class CheckResult
+    {
+        AtTarget,
+        Corrected,
+        Failed,
+        Skipped // The pool had no thread left to make the calls
+    };
+
+    // The endpoint calls of one check and what they returned. The policy is copied in,
+    // since a call the worker gave up on may outlive the DeviceSlot it came from.
+    struct EndpointCheck
+    {
+        std::shared_ptr<VolumeEndpoint> endpoint; // Null when activation failed; kept alive for a late call
+        bool activate = false;  // Not cached: the calls activate it first, from endpointId
+        std::wstring endpointId;
+        HRESULT activateHr = S_OK;
+        float targetVolume = 1.0f;
+        float tolerance = 0.0f;
+        MutePolicy mute = MutePolicy::Leave;
+        uint64_t deadlineUs = 0;
+        bool overran = false; // The calls took longer than the deadline
+        HRESULT readHr = S_OK;
+        float volume = -1.0f;
+        bool volumeWritten = false; // The level was off target
+        HRESULT writeHr = S_OK;
+        bool muteRead = false;
+        HRESULT muteReadHr = S_OK;
+        bool muted = false;
+        bool muteWritten = false;
+        HRESULT muteWriteHr = S_OK;
+        SessionCallCounters calls;
+        uint64_t callUs[4] = {}; // Time of each endpoint call, added to the metrics by the worker
+        uint8_t callCount = 0;
+
+        void EndCall(uint64_t startedUs) { callUs[callCount++] = MonotonicUs() - startedUs; }
+    };
+
+    enum CallState : uint8_t
+    {
+        CallIdle,
+        CallQueued,  // Posted to the pool
+        CallRunning, // Claimed by a pool thread
+        CallDone
+    };
+
+    enum class CallVerdict : uint8_t
+    {
+        Made,     // The calls returned; check holds what they did
+        TimedOut, // A pool thread is still in them, past the deadline
+        Dropped   // Not made: every pool thread was stuck
+    };
+
+    // Per device; stays at its address, since a call the worker gave up on writes to it late
+    struct CheckRecord
+    {
+        std::atomic<uint8_t> state{CallIdle}; // CallState; the task and the worker race to claim a queued call
+        bool pending = false;                 // Made ahead by CallEndpoints(), not applied yet
+        CallVerdict verdict = CallVerdict::Made;
+        EndpointCheck check;                  // Owned by the pool task while queued or running
+    };
+
+    // The check records, shared with the pool task: a call still stuck after the pool
+    // stopped and the enforcer went away writes only to records it keeps alive.
+    // The worker grows the table under the mutex; tasks look their record up under it.
+    struct CallRecords
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<CheckRecord>> records; // Indexed by DeviceHandle
+    };
+
+    bool BeginPass();
+    HRESULT UpdateInventory();
+    void RefreshActiveDevices();
+    void CompilePolicy();
+    void ResolvePolicy(DeviceHandle device);
+    bool ShouldCheck(DeviceHandle device, uint64_t nowMs);
+    CheckRecord &Record(DeviceHandle device);
+    void CallEndpoints(const std::vector<DeviceHandle> &devices);
+    bool BeginCheck(DeviceHandle device, CheckRecord &record, bool onPool);
+    static void CallEndpoint(EndpointCheck &check, AudioBackend &backend);
+    CheckResult CheckDevice(DeviceHandle device, HRESULT &failure);
+    CheckResult CheckMute(DeviceHandle device, const EndpointCheck &check);
+    void FinishCheck(DeviceHandle device, CheckResult result, HRESULT failure);
+    void AttachWatch(DeviceHandle device);
+    void Reschedule(DeviceHandle device, bool tampered);
+    void TrackFight(DeviceHandle device, CheckResult result);
+    void TrackBreaker(DeviceHandle device, HRESULT failure);
+    void CountCorrection(DeviceSlot &slot);
+    void CountError(DeviceSlot &slot);
+
+    AudioBackend &m_backend;
+    Clock &m_clock;
+    EnforcementObserver &m_observer;
+    std::function<void()> m_wake;
+    std::wstring m_filter;
+    std::vector<PolicyRule> m_rules;
+    PolicyEngine m_policy;
+
+    DeviceTable m_devices;
+    AudioSession m_session;
+    DeviceInventory m_inventory;
+    std::unique_ptr<VolumeChangeEnforcer> m_volumeWatch;
+
+    std::vector<DeviceHandle> m_activeDevices; // Handles of the devices currently in the inventory
+    uint64_t m_inventoryGeneration = 0;
+    std::vector<DeviceHandle> m_watchedDevices;    // Reused by Sweep()
+    std::vector<VolumeCorrection> m_corrections;   // Reused by ProcessNotifications()
+
+    bool m_adaptive = false;
+    CheckSchedule m_scheduleOptions;
+    TimerWheel m_schedule;                 // Next check of every selected present device
+    std::vector<uint32_t> m_dueDevices;    // Reused by CheckDue()
+    TamperWarDetector m_wars;
+    CircuitBreaker m_breakers;
+    uint64_t m_checks = 0;
+
+    WorkerPool *m_pool = nullptr;
+    uint32_t m_callDeadlineMs = 5000;
+    std::shared_ptr<CallRecords> m_calls;
+    std::vector<DeviceHandle> m_checkBatch;   // Reused by Sweep()
+    std::vector<DeviceHandle> m_poolBatch;    // Reused by CallEndpoints(): the devices posted
+    std::shared_ptr<const WorkerPool::Task> m_callTask; // Pool task: CallEndpoint() for a device
+    EnforcementMetrics m_metrics;
+};
+
+} // namespace MicVol
@@ -0,0 +1,44 @@
+#pragma once
+
+// Minimal platform layer so the enforcement core builds both as part of the
+// Windows service and as a plain C++17 library on Linux for tests.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdint>
+#include <cstring>
+
+typedef int32_t HRESULT;
+
+#define S_OK ((HRESULT)0L)
+#define S_FALSE ((HRESULT)1L)
+#define E_NOTIMPL ((HRESULT)0x80004001L)
+#define E_POINTER ((HRESULT)0x80004003L)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000EL)
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+struct GUID
+{
+    uint32_t Data1;
+    uint16_t Data2;
+    uint16_t Data3;
+    uint8_t Data4[8];
+};
+
+typedef const GUID *LPCGUID;
+
+inline bool operator==(const GUID &a, const GUID &b)
+{
+    return std::memcmp(&a, &b, sizeof(GUID)) == 0;
+}
+
+inline bool operator!=(const GUID &a, const GUID &b)
+{
+    return !(a == b);
+}
+#endif
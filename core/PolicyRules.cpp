@@ -0,0 +1,393 @@
+#include "PolicyRules.h"
+#include "FileIo.h"
+#include <algorithm>
+#include <cwchar>
+#include <cwctype>
+#include <deque>
+
+namespace MicVol
+{
+
+void TokenizeLine(const std::wstring &line, std::vector<std::wstring> &tokens)
+{
+    std::wstring token;
+    bool inToken = false;
+    bool quoted = false;
+    for (wchar_t c : line)
+    {
+        if (c == L'"')
+        {
+            quoted = !quoted;
+            inToken = true;
+        }
+        else if (!quoted && (c == L' ' || c == L'\t' || c == L'\r' || c == L'\n'))
+        {
+            if (inToken)
+                tokens.push_back(token);
+            token.clear();
+            inToken = false;
+        }
+        else
+        {
+            token += c;
+            inToken = true;
+        }
+    }
+    if (inToken)
+        tokens.push_back(token);
+}
+
+// Whole-number or fractional percentage between 0 and 100
+static bool ParsePercent(const std::wstring &text, float &fraction)
+{
+    wchar_t *end = nullptr;
+    double value = std::wcstod(text.c_str(), &end);
+    if (text.empty() || *end != L'\0' || value < 0.0 || value > 100.0)
+        return false;
+    fraction = (float)(value / 100.0);
+    return true;
+}
+
+HRESULT ParsePolicyRule(const std::wstring &line, PolicyRule &rule)
+{
+    std::vector<std::wstring> tokens;
+    TokenizeLine(line, tokens);
+    if (tokens.empty() || tokens[0][0] == L'#')
+        return S_FALSE;
+    if (tokens.size() < 2)
+        return E_INVALIDARG;
+
+    rule = PolicyRule();
+    if (tokens[0] == L"include")
+        rule.policy.enforce = true;
+    else if (tokens[0] == L"exclude")
+        rule.policy.enforce = false;
+    else
+        return E_INVALIDARG;
+
+    size_t colon = tokens[1].find(L':');
+    if (colon == std::wstring::npos)
+        return E_INVALIDARG;
+    std::wstring field = tokens[1].substr(0, colon);
+    if (field == L"name")
+        rule.field = RuleField::Name;
+    else if (field == L"id")
+        rule.field = RuleField::EndpointId;
+    else if (field == L"formfactor")
+        rule.field = RuleField::FormFactor;
+    else if (field == L"process")
+        rule.field = RuleField::Process;
+    else
+        return E_INVALIDARG;
+    rule.pattern = tokens[1].substr(colon + 1);
+    if (rule.pattern.empty())
+        return E_INVALIDARG;
+
+    for (size_t i = 2; i < tokens.size(); i++)
+    {
+        if (tokens[i][0] == L'#')
+            break;
+
+        size_t equals = tokens[i].find(L'=');
+        if (equals == std::wstring::npos)
+            return E_INVALIDARG;
+        std::wstring key = tokens[i].substr(0, equals);
+        std::wstring value = tokens[i].substr(equals + 1);
+
+        if (key == L"volume")
+        {
+            if (!ParsePercent(value, rule.policy.targetVolume))
+                return E_INVALIDARG;
+        }
+        else if (key == L"tolerance")
+        {
+            if (!ParsePercent(value, rule.policy.tolerance))
+                return E_INVALIDARG;
+        }
+        else if (key == L"mute")
+        {
+            if (value == L"leave")
+                rule.policy.mute = MutePolicy::Leave;
+            else if (value == L"unmute")
+                rule.policy.mute = MutePolicy::Unmute;
+            else if (value == L"mute")
+                rule.policy.mute = MutePolicy::Mute;
+            else
+                return E_INVALIDARG;
+        }
+        else
+        {
+            return E_INVALIDARG;
+        }
+    }
+    return S_OK;
+}
+
+HRESULT LoadPolicyRules(const std::wstring &path, std::vector<PolicyRule> &rules, size_t &errorLine)
+{
+    errorLine = 0;
+    std::wstring text;
+    HRESULT hr = ReadTextFile(path, text);
+    if (FAILED(hr))
+        return hr;
+
+    size_t lineNumber = 0;
+    size_t position = 0;
+    while (position <= text.size())
+    {
+        size_t end = text.find(L'\n', position);
+        if (end == std::wstring::npos)
+            end = text.size();
+        lineNumber++;
+
+        PolicyRule rule;
+        HRESULT hr = ParsePolicyRule(text.substr(position, end - position), rule);
+        if (FAILED(hr))
+        {
+            errorLine = lineNumber;
+            return hr;
+        }
+        if (hr == S_OK)
+            rules.push_back(rule);
+        position = end + 1;
+    }
+    return S_OK;
+}
+
+const wchar_t *FormFactorName(FormFactor formFactor)
+{
+    switch (formFactor)
+    {
+    case FormFactor::RemoteNetworkDevice: return L"RemoteNetworkDevice";
+    case FormFactor::Speakers: return L"Speakers";
+    case FormFactor::LineLevel: return L"LineLevel";
+    case FormFactor::Headphones: return L"Headphones";
+    case FormFactor::Microphone: return L"Microphone";
+    case FormFactor::Headset: return L"Headset";
+    case FormFactor::Handset: return L"Handset";
+    case FormFactor::UnknownDigitalPassthrough: return L"UnknownDigitalPassthrough";
+    case FormFactor::SPDIF: return L"SPDIF";
+    case FormFactor::DigitalAudioDisplayDevice: return L"DigitalAudioDisplayDevice";
+    default: return L"Unknown";
+    }
+}
+
+bool GlobMatch(const std::wstring &pattern, const std::wstring &text)
+{
+    // Backtracks only to the most recent '*', which is enough for globs: linear in practice
+    size_t p = 0, t = 0;
+    size_t starPattern = std::wstring::npos, starText = 0;
+    while (t < text.size())
+    {
+        if (p < pattern.size() && (pattern[p] == L'?' || pattern[p] == text[t]))
+        {
+            p++;
+            t++;
+        }
+        else if (p < pattern.size() && pattern[p] == L'*')
+        {
+            starPattern = p++;
+            starText = t;
+        }
+        else if (starPattern != std::wstring::npos)
+        {
+            p = starPattern + 1;
+            t = ++starText;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == L'*')
+    {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+// PolicyEngine::Automaton
+
+void PolicyEngine::Automaton::Clear()
+{
+    m_nodes.clear();
+    m_nodes.emplace_back();
+}
+
+void PolicyEngine::Automaton::Add(const std::wstring &literal, uint32_t rule)
+{
+    uint32_t node = 0;
+    for (wchar_t c : literal)
+    {
+        auto it = m_nodes[node].next.find(c);
+        if (it == m_nodes[node].next.end())
+        {
+            uint32_t child = (uint32_t)m_nodes.size();
+            m_nodes[node].next[c] = child;
+            m_nodes.emplace_back();
+            node = child;
+        }
+        else
+        {
+            node = it->second;
+        }
+    }
+    m_nodes[node].rules.push_back(rule);
+}
+
+void PolicyEngine::Automaton::Build()
+{
+    // Breadth first, so the fail target of a node is complete before the node
+    std::deque<uint32_t> queue;
+    for (const auto &edge : m_nodes[0].next)
+    {
+        m_nodes[edge.second].fail = 0;
+        queue.push_back(edge.second);
+    }
+
+    while (!queue.empty())
+    {
+        uint32_t node = queue.front();
+        queue.pop_front();
+
+        for (const auto &edge : m_nodes[node].next)
+        {
+            uint32_t child = edge.second;
+            uint32_t fail = m_nodes[node].fail;
+            while (fail != 0 && m_nodes[fail].next.find(edge.first) == m_nodes[fail].next.end())
+            {
+                fail = m_nodes[fail].fail;
+            }
+            auto it = m_nodes[fail].next.find(edge.first);
+            m_nodes[child].fail = (it != m_nodes[fail].next.end() && it->second != child) ? it->second : 0;
+
+            const std::vector<uint32_t> &inherited = m_nodes[m_nodes[child].fail].rules;
+            m_nodes[child].rules.insert(m_nodes[child].rules.end(), inherited.begin(), inherited.end());
+            queue.push_back(child);
+        }
+    }
+}
+
+void PolicyEngine::Automaton::Scan(const std::wstring &text, std::vector<uint32_t> &rules) const
+{
+    if (m_nodes.size() < 2)
+        return;
+
+    uint32_t node = 0;
+    for (wchar_t c : text)
+    {
+        auto it = m_nodes[node].next.find(c);
+        while (node != 0 && it == m_nodes[node].next.end())
+        {
+            node = m_nodes[node].fail;
+            it = m_nodes[node].next.find(c);
+        }
+        node = it == m_nodes[node].next.end() ? 0 : it->second;
+        rules.insert(rules.end(), m_nodes[node].rules.begin(), m_nodes[node].rules.end());
+    }
+}
+
+// PolicyEngine
+
+void PolicyEngine::Lowercase(const std::wstring &text, std::wstring &lower)
+{
+    lower.resize(text.size());
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        lower[i] = (wchar_t)towlower(text[i]);
+    }
+}
+
+void PolicyEngine::Compile(const std::vector<PolicyRule> &rules, RuleScope scope)
+{
+    m_rules.clear();
+    m_unanchored.clear();
+    m_hasInclude = false;
+    for (size_t field = 0; field < RuleFieldCount; field++)
+    {
+        m_automata[field].Clear();
+        m_fieldUsed[field] = false;
+    }
+
+    for (size_t number = 0; number < rules.size(); number++)
+    {
+        const PolicyRule &rule = rules[number];
+        if ((rule.field == RuleField::Process) != (scope == RuleScope::Sessions))
+            continue;
+
+        uint32_t index = (uint32_t)m_rules.size();
+        CompiledRule compiled;
+        compiled.field = rule.field;
+        compiled.number = (uint32_t)number;
+        compiled.policy = rule.policy;
+        Lowercase(rule.pattern, compiled.pattern);
+        m_rules.push_back(compiled);
+
+        m_fieldUsed[(size_t)rule.field] = true;
+        if (rule.policy.enforce)
+            m_hasInclude = true;
+
+        // Every match of the glob contains its longest literal run
+        std::wstring literal, longest;
+        for (wchar_t c : compiled.pattern)
+        {
+            if (c == L'*' || c == L'?')
+            {
+                if (literal.size() > longest.size())
+                    longest = literal;
+                literal.clear();
+            }
+            else
+            {
+                literal += c;
+            }
+        }
+        if (literal.size() > longest.size())
+            longest = literal;
+
+        if (longest.empty())
+            m_unanchored.push_back(index);
+        else
+            m_automata[(size_t)rule.field].Add(longest, index);
+    }
+
+    for (size_t field = 0; field < RuleFieldCount; field++)
+    {
+        m_automata[field].Build();
+    }
+}
+
+int PolicyEngine::Resolve(const PolicySubject &subject, DevicePolicy &policy)
+{
+    m_candidates.assign(m_unanchored.begin(), m_unanchored.end());
+
+    const std::wstring formFactorName = FormFactorName(subject.formFactor);
+    const std::wstring *values[RuleFieldCount] = {&subject.name, &subject.endpointId, &formFactorName,
+                                                  &subject.processName};
+    for (size_t field = 0; field < RuleFieldCount; field++)
+    {
+        if (!m_fieldUsed[field])
+            continue;
+        Lowercase(*values[field], m_lower[field]);
+        m_automata[field].Scan(m_lower[field], m_candidates);
+    }
+
+    std::sort(m_candidates.begin(), m_candidates.end());
+    m_candidates.erase(std::unique(m_candidates.begin(), m_candidates.end()), m_candidates.end());
+
+    for (uint32_t index : m_candidates)
+    {
+        const CompiledRule &rule = m_rules[index];
+        if (GlobMatch(rule.pattern, m_lower[(size_t)rule.field]))
+        {
+            policy = rule.policy;
+            return (int)rule.number;
+        }
+    }
+
+    policy = DevicePolicy();
+    policy.enforce = !m_hasInclude;
+    return -1;
+}
+
+} // namespace MicVol
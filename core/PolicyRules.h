@@ -0,0 +1,138 @@
+#pragma once
+#include "AudioBackend.h"
+#include "DeviceTable.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace MicVol
+{
+
+// Attribute a rule pattern is matched against
+enum class RuleField : uint8_t
+{
+    Name,       // Friendly name
+    EndpointId, // IMMDevice::GetId
+    FormFactor, // FormFactorName(), e.g. "Headset"
+    Process     // Executable of an audio session, e.g. "discord.exe"; session rules only
+};
+
+const size_t RuleFieldCount = 4;
+
+// Which rules of a rule set a PolicyEngine compiles
+enum class RuleScope : uint8_t
+{
+    Devices, // Every rule except process rules
+    Sessions // Process rules only
+};
+
+// What a rule set is matched against: an endpoint, or an audio session of a process
+struct PolicySubject
+{
+    std::wstring name;
+    std::wstring endpointId;
+    FormFactor formFactor = FormFactor::UnknownFormFactor;
+    std::wstring processName;
+};
+
+// What enforcement does with one device or session
+struct DevicePolicy
+{
+    bool enforce = true;
+    float targetVolume = 1.0f;
+    float tolerance = 0.01f;
+    MutePolicy mute = MutePolicy::Leave;
+};
+
+// One include (policy.enforce) or exclude rule. The pattern is a case-insensitive
+// glob: '*' matches any run of characters, '?' exactly one.
+struct PolicyRule
+{
+    RuleField field = RuleField::Name;
+    std::wstring pattern;
+    DevicePolicy policy;
+};
+
+// Splits a line on whitespace and appends the tokens; double quotes group characters and are removed
+void TokenizeLine(const std::wstring &line, std::vector<std::wstring> &tokens);
+
+// Parses one line of a rules file:
+//   include|exclude name|id|formfactor|process:<glob> [volume=<percent>] [tolerance=<percent>] [mute=leave|unmute|mute]
+// Patterns with spaces are quoted, e.g. name:"*USB Microphone*". Returns S_FALSE for blank
+// lines and '#' comments, E_INVALIDARG for a syntax error.
+HRESULT ParsePolicyRule(const std::wstring &line, PolicyRule &rule);
+
+// Reads a UTF-8 rules file, one rule per line. On a syntax error returns E_INVALIDARG
+// with errorLine set to the 1-based line number.
+HRESULT LoadPolicyRules(const std::wstring &path, std::vector<PolicyRule> &rules, size_t &errorLine);
+
+const wchar_t *FormFactorName(FormFactor formFactor);
+
+// Glob match of text against pattern; both already lowercased
+bool GlobMatch(const std::wstring &pattern, const std::wstring &text);
+
+// The rule set compiled for matching. The first rule that matches a device decides its
+// policy; a device no rule matches is enforced with the default policy unless there is
+// at least one include rule.
+//
+// Compile() lowercases the patterns and builds one Aho-Corasick automaton per field
+// over the longest literal of every pattern, so Resolve() scans each attribute once
+// and only verifies the full glob of the rules whose literal occurs in it. Meant for
+// the rare paths (device appeared or renamed); the result is cached in the DeviceSlot.
+class PolicyEngine
+{
+public:
+    void Compile(const std::vector<PolicyRule> &rules, RuleScope scope = RuleScope::Devices);
+
+    size_t RuleCount() const { return m_rules.size(); }
+    bool UsesField(RuleField field) const { return m_fieldUsed[(size_t)field]; }
+
+    // Index of the deciding rule in the rules passed to Compile(), -1 when the default applied
+    int Resolve(const PolicySubject &subject, DevicePolicy &policy);
+
+    // Rules verified by the last Resolve() (for tests and benchmarks)
+    size_t LastCandidateCount() const { return m_candidates.size(); }
+
+private:
+    struct CompiledRule
+    {
+        RuleField field;
+        uint32_t number;      // Index in the rules passed to Compile()
+        std::wstring pattern; // Lowercased
+        DevicePolicy policy;
+    };
+
+    class Automaton
+    {
+    public:
+        void Clear();
+        void Add(const std::wstring &literal, uint32_t rule);
+        void Build();
+
+        // Appends the rules of every literal that occurs in text
+        void Scan(const std::wstring &text, std::vector<uint32_t> &rules) const;
+
+    private:
+        struct Node
+        {
+            std::map<wchar_t, uint32_t> next;
+            uint32_t fail = 0;
+            std::vector<uint32_t> rules; // Including the rules of the fail chain after Build()
+        };
+
+        std::vector<Node> m_nodes;
+    };
+
+    void Lowercase(const std::wstring &text, std::wstring &lower);
+
+    std::vector<CompiledRule> m_rules;
+    Automaton m_automata[RuleFieldCount];        // Indexed by RuleField
+    std::vector<uint32_t> m_unanchored;          // Rules without a literal; always verified
+    bool m_fieldUsed[RuleFieldCount] = {};
+    bool m_hasInclude = false;
+
+    std::vector<uint32_t> m_candidates; // Reused by Resolve()
+    std::wstring m_lower[RuleFieldCount];
+};
+
+} // namespace MicVol
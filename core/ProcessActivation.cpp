@@ -0,0 +1,156 @@
+#include "ProcessActivation.h"
+#include "PolicyRules.h"
+#include <cwctype>
+
+namespace MicVol
+{
+
+static std::wstring Lowercase(const std::wstring &text)
+{
+    std::wstring lower(text);
+    for (wchar_t &c : lower)
+    {
+        c = (wchar_t)towlower(c);
+    }
+    return lower;
+}
+
+ProcessActivation::ProcessActivation(ProcessSource &source, std::function<void()> wake)
+    : m_source(source), m_wake(std::move(wake))
+{
+}
+
+ProcessActivation::~ProcessActivation()
+{
+    Stop();
+}
+
+void ProcessActivation::ParseTargets(const std::wstring &list, std::vector<std::wstring> &targets)
+{
+    size_t position = 0;
+    while (position <= list.size())
+    {
+        size_t end = list.find_first_of(L",;", position);
+        if (end == std::wstring::npos)
+            end = list.size();
+
+        std::wstring item = list.substr(position, end - position);
+        size_t first = item.find_first_not_of(L" \t");
+        if (first != std::wstring::npos)
+            targets.push_back(item.substr(first, item.find_last_not_of(L" \t") - first + 1));
+        position = end + 1;
+    }
+}
+
+void ProcessActivation::SetTargets(const std::vector<std::wstring> &targets)
+{
+    m_targets.clear();
+    for (const std::wstring &target : targets)
+    {
+        m_targets.push_back(Lowercase(target));
+    }
+}
+
+HRESULT ProcessActivation::Start()
+{
+    if (m_started)
+        return S_FALSE;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_starting = true;
+    }
+    std::vector<RunningProcess> running;
+    HRESULT hr = m_source.Start(this, running);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_starting = false;
+    if (FAILED(hr))
+    {
+        m_exitedDuringStart.clear();
+        return hr;
+    }
+    m_started = true;
+
+    // Events are live before the snapshot is merged: a process that exited in between
+    // is in the snapshot, but its exit found nothing to remove
+    for (const RunningProcess &process : running)
+    {
+        if (IsTarget(process.name) && m_exitedDuringStart.count(process.processId) == 0)
+            m_running[process.processId] = process.name;
+    }
+    m_exitedDuringStart.clear();
+    m_armed = !m_running.empty();
+    return S_OK;
+}
+
+void ProcessActivation::Stop()
+{
+    if (!m_started)
+        return;
+    m_source.Stop();
+    m_started = false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running.clear();
+    m_armed = false;
+}
+
+bool ProcessActivation::ProcessPending()
+{
+    bool armed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        armed = !m_running.empty();
+    }
+    if (armed == m_armed)
+        return false;
+    m_armed = armed;
+    return true;
+}
+
+std::wstring ProcessActivation::RunningTarget()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running.empty() ? std::wstring() : m_running.begin()->second;
+}
+
+void ProcessActivation::OnProcessStarted(uint32_t processId, const std::wstring &name)
+{
+    if (!IsTarget(name))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running[processId] = name;
+    }
+    if (m_wake)
+        m_wake();
+}
+
+void ProcessActivation::OnProcessExited(uint32_t processId)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_running.erase(processId) == 0)
+        {
+            if (m_starting)
+                m_exitedDuringStart.insert(processId);
+            return;
+        }
+    }
+    if (m_wake)
+        m_wake();
+}
+
+bool ProcessActivation::IsTarget(const std::wstring &name) const
+{
+    const std::wstring lower = Lowercase(name);
+    for (const std::wstring &target : m_targets)
+    {
+        if (GlobMatch(target, lower))
+            return true;
+    }
+    return false;
+}
+
+} // namespace MicVol
@@ -0,0 +1,60 @@
+#pragma once
+#include "ProcessSource.h"
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+
+namespace MicVol
+{
+
+// Arms enforcement only while one of the target processes runs.
+//
+// The targets are case-insensitive globs over the executable name. Start and exit
+// events are matched on the notification thread, so only target processes call the
+// wake function; starts and exits of anything else cost nothing on the worker.
+class ProcessActivation : private ProcessEventSink
+{
+public:
+    explicit ProcessActivation(ProcessSource &source, std::function<void()> wake = nullptr);
+    ~ProcessActivation();
+
+    ProcessActivation(const ProcessActivation &) = delete;
+    ProcessActivation &operator=(const ProcessActivation &) = delete;
+
+    // Splits a comma or semicolon separated list, e.g. L"helldivers2.exe, game*.exe"
+    static void ParseTargets(const std::wstring &list, std::vector<std::wstring> &targets);
+
+    // Call before Start()
+    void SetTargets(const std::vector<std::wstring> &targets);
+    const std::vector<std::wstring> &Targets() const { return m_targets; }
+
+    // Starts watching; the processes already running count immediately
+    HRESULT Start();
+    void Stop();
+
+    // Picks up the events queued since the last call; true when Armed() changed
+    bool ProcessPending();
+    bool Armed() const { return m_armed; }
+
+    // Name of a running target process, empty while disarmed
+    std::wstring RunningTarget();
+
+private:
+    void OnProcessStarted(uint32_t processId, const std::wstring &name) override;
+    void OnProcessExited(uint32_t processId) override;
+    bool IsTarget(const std::wstring &name) const;
+
+    ProcessSource &m_source;
+    std::function<void()> m_wake;
+    std::vector<std::wstring> m_targets; // Lowercased
+    bool m_started = false;
+    bool m_armed = false;
+
+    std::mutex m_mutex;
+    std::map<uint32_t, std::wstring> m_running; // Target processes alive, by process ID
+    bool m_starting = false;
+    std::set<uint32_t> m_exitedDuringStart; // Exits reported while Start() took the snapshot
+};
+
+} // namespace MicVol
@@ -0,0 +1,42 @@
+#pragma once
+#include "Platform.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MicVol
+{
+
+// Process start and exit notifications (the Win32_ProcessStartTrace / StopTrace model).
+// Called on a system thread: only record the event and return.
+class ProcessEventSink
+{
+public:
+    virtual ~ProcessEventSink() = default;
+
+    // name is the executable file name, e.g. "helldivers2.exe"
+    virtual void OnProcessStarted(uint32_t processId, const std::wstring &name) = 0;
+    virtual void OnProcessExited(uint32_t processId) = 0;
+};
+
+struct RunningProcess
+{
+    uint32_t processId;
+    std::wstring name;
+};
+
+// Where process lifetime events come from (WMI process traces on Windows)
+class ProcessSource
+{
+public:
+    virtual ~ProcessSource() = default;
+
+    // Registers the sink, then appends the processes already running. A process started
+    // in between may be reported twice.
+    virtual HRESULT Start(ProcessEventSink *sink, std::vector<RunningProcess> &running) = 0;
+
+    // No event is delivered after Stop() returns
+    virtual void Stop() = 0;
+};
+
+} // namespace MicVol
@@ -0,0 +1,189 @@
+#include "ServiceConfig.h"
+#include "FileIo.h"
+#include <algorithm>
+#include <filesystem>
+
+namespace MicVol
+{
+
+void ParseConfigText(const std::wstring &text, ServiceOptions &options)
+{
+    // One parse over every line, so clamping sees the whole file (-t 0 needs -events)
+    std::vector<std::wstring> tokens;
+    size_t position = 0;
+    while (position <= text.size())
+    {
+        size_t end = text.find(L'\n', position);
+        if (end == std::wstring::npos)
+            end = text.size();
+
+        std::vector<std::wstring> lineTokens;
+        TokenizeLine(text.substr(position, end - position), lineTokens);
+        if (!lineTokens.empty() && lineTokens[0][0] != L'#')
+            tokens.insert(tokens.end(), lineTokens.begin(), lineTokens.end());
+        position = end + 1;
+    }
+
+    std::vector<wchar_t *> argv;
+    for (std::wstring &token : tokens)
+    {
+        argv.push_back(&token[0]);
+    }
+    std::wstring configFile = options.configFile;
+    ParseServiceOptions((int)argv.size(), argv.data(), 0, options);
+    options.configFile = configFile;
+}
+
+std::unique_ptr<ServiceConfig> BuildServiceConfig(const ServiceOptions &commandLine)
+{
+    std::unique_ptr<ServiceConfig> config(new ServiceConfig());
+    config->options = commandLine;
+
+    if (!commandLine.configFile.empty())
+    {
+        std::wstring text;
+        config->configResult = ReadTextFile(commandLine.configFile, text);
+        if (SUCCEEDED(config->configResult))
+            ParseConfigText(text, config->options);
+    }
+
+    if (!config->options.rulesFile.empty())
+    {
+        config->rulesResult = LoadPolicyRules(config->options.rulesFile, config->rules, config->rulesErrorLine);
+        if (FAILED(config->rulesResult))
+            config->rules.clear();
+    }
+    return config;
+}
+
+static bool SameRules(const std::vector<PolicyRule> &a, const std::vector<PolicyRule> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        const PolicyRule &x = a[i];
+        const PolicyRule &y = b[i];
+        if (x.field != y.field || x.pattern != y.pattern || x.policy.enforce != y.policy.enforce ||
+            x.policy.targetVolume != y.policy.targetVolume || x.policy.tolerance != y.policy.tolerance ||
+            x.policy.mute != y.policy.mute)
+            return false;
+    }
+    return true;
+}
+
+static void AddRestartOption(std::wstring &restartOptions, const wchar_t *name)
+{
+    if (!restartOptions.empty())
+        restartOptions += L", ";
+    restartOptions += name;
+}
+
+uint32_t CompareConfigs(const ServiceConfig &current, const ServiceConfig &next, std::wstring &restartOptions)
+{
+    const ServiceOptions &a = current.options;
+    const ServiceOptions &b = next.options;
+    uint32_t changes = 0;
+    restartOptions.clear();
+
+    if (a.intervalSeconds != b.intervalSeconds)
+        changes |= ConfigChangeInterval;
+    if (a.microphoneFilter != b.microphoneFilter)
+        changes |= ConfigChangeFilter;
+    if (a.rulesFile != b.rulesFile || !SameRules(current.rules, next.rules))
+        changes |= ConfigChangeRules;
+    if (a.fightStrategy != b.fightStrategy)
+        changes |= ConfigChangeFightStrategy;
+    if (a.minIntervalMs != b.minIntervalMs || a.maxIntervalMs != b.maxIntervalMs)
+        changes |= ConfigChangeSchedule;
+    if (a.callDeadlineMs != b.callDeadlineMs)
+        changes |= ConfigChangeDeadline;
+    if (a.logLevel != b.logLevel)
+        changes |= ConfigChangeLogLevel;
+
+    // The loops, watches and sinks these select are set up once per run
+    if (a.useEvents != b.useEvents)
+        AddRestartOption(restartOptions, L"-events");
+    if (a.adaptive != b.adaptive)
+        AddRestartOption(restartOptions, L"-adaptive");
+    if (a.enforceSessions != b.enforceSessions)
+        AddRestartOption(restartOptions, L"-sessions");
+    if (a.activationProcesses != b.activationProcesses)
+        AddRestartOption(restartOptions, L"-whenrunning");
+    if (a.workerThreads != b.workerThreads)
+        AddRestartOption(restartOptions, L"-workers");
+    if (a.useEventLog != b.useEventLog || a.logFile != b.logFile || a.logSegmentMb != b.logSegmentMb ||
+        a.logSegmentCount != b.logSegmentCount)
+        AddRestartOption(restartOptions, L"-logfile");
+    if (a.binaryLogFile != b.binaryLogFile)
+        AddRestartOption(restartOptions, L"-binlog");
+    if (a.metricsFile != b.metricsFile || a.metricsPipe != b.metricsPipe)
+        AddRestartOption(restartOptions, L"-metrics");
+    if (!restartOptions.empty())
+        changes |= ConfigChangeRestart;
+    return changes;
+}
+
+void ConfigFileStamps::Watch(const ServiceOptions &options)
+{
+    m_files.clear();
+    if (!options.configFile.empty())
+        m_files.push_back(options.configFile);
+    if (!options.rulesFile.empty())
+        m_files.push_back(options.rulesFile);
+
+    m_stamps.clear();
+    for (const std::wstring &file : m_files)
+        m_stamps.push_back(Take(file));
+}
+
+std::vector<std::wstring> ConfigFileStamps::Directories() const
+{
+    std::vector<std::wstring> directories;
+    for (const std::wstring &file : m_files)
+    {
+        std::error_code error;
+        std::filesystem::path absolute = std::filesystem::absolute(std::filesystem::path(file), error);
+        std::wstring directory = (error ? std::filesystem::path(file) : absolute).parent_path().wstring();
+        if (std::find(directories.begin(), directories.end(), directory) == directories.end())
+            directories.push_back(directory);
+    }
+    return directories;
+}
+
+bool ConfigFileStamps::Changed()
+{
+    bool changed = false;
+    for (size_t i = 0; i < m_files.size(); i++)
+    {
+        Stamp stamp = Take(m_files[i]);
+        if (!(stamp == m_stamps[i]))
+        {
+            m_stamps[i] = stamp;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+ConfigFileStamps::Stamp ConfigFileStamps::Take(const std::wstring &file)
+{
+    Stamp stamp;
+    std::error_code error;
+    std::filesystem::path path(file);
+    if (!std::filesystem::is_regular_file(path, error))
+        return stamp;
+
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (error)
+        return stamp;
+    std::filesystem::file_time_type written = std::filesystem::last_write_time(path, error);
+    if (error)
+        return stamp;
+    stamp.exists = true;
+    stamp.size = (uint64_t)size;
+    stamp.writeTime = (int64_t)written.time_since_epoch().count();
+    return stamp;
+}
+
+} // namespace MicVol
@@ -0,0 +1,114 @@
+#pragma once
+#include "PolicyRules.h"
+#include "ServiceOptions.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MicVol
+{
+
+// Configuration the worker runs with: the command line options overlaid with the
+// -config file, and the rules the options name. Built off the worker thread and
+// never changed afterwards; a reload builds a new one.
+struct ServiceConfig
+{
+    ServiceOptions options;
+    std::vector<PolicyRule> rules;
+    HRESULT configResult = S_FALSE; // S_FALSE without -config
+    size_t configErrorLine = 0;
+    HRESULT rulesResult = S_FALSE;  // S_FALSE without -rules
+    size_t rulesErrorLine = 0;
+};
+
+// Applies a configuration text over options. Each line holds command line parameters,
+// e.g. -t 5 or -m "USB Microphone"; blank lines and '#' comments are skipped. -config
+// itself is ignored. Unknown parameters are ignored, as on the command line.
+void ParseConfigText(const std::wstring &text, ServiceOptions &options);
+
+// Reads commandLine.configFile (if any) over commandLine, then the rules file. A
+// configuration file that cannot be read leaves the command line options in effect.
+std::unique_ptr<ServiceConfig> BuildServiceConfig(const ServiceOptions &commandLine);
+
+// What differs between two configurations (ConfigChange bits)
+enum ConfigChange : uint32_t
+{
+    ConfigChangeInterval = 1,
+    ConfigChangeFilter = 2,
+    ConfigChangeRules = 4,
+    ConfigChangeFightStrategy = 8,
+    ConfigChangeSchedule = 16,  // -tmin or -tmax
+    ConfigChangeRestart = 32,   // Options that only take effect when the service starts
+    ConfigChangeDeadline = 64,
+    ConfigChangeLogLevel = 128
+};
+
+// restartOptions receives the parameters behind ConfigChangeRestart, e.g. L"-events, -logfile"
+uint32_t CompareConfigs(const ServiceConfig &current, const ServiceConfig &next, std::wstring &restartOptions);
+
+// Size and last write time of the files a configuration is read from (the -config
+// file and the rules file it names), so a watch on their directories can tell an
+// edit to one of them from other writes there, such as the service's own log file.
+class ConfigFileStamps
+{
+public:
+    // Replaces the files and takes their stamps
+    void Watch(const ServiceOptions &options);
+    const std::vector<std::wstring> &Files() const { return m_files; }
+
+    // The absolute directories holding the files, each once
+    std::vector<std::wstring> Directories() const;
+
+    // Takes new stamps; true when a file was written, created or removed since the last call
+    bool Changed();
+
+private:
+    struct Stamp
+    {
+        bool exists = false;
+        uint64_t size = 0;
+        int64_t writeTime = 0;
+
+        bool operator==(const Stamp &other) const
+        {
+            return exists == other.exists && size == other.size && writeTime == other.writeTime;
+        }
+    };
+
+    static Stamp Take(const std::wstring &file);
+
+    std::vector<std::wstring> m_files;
+    std::vector<Stamp> m_stamps;
+};
+
+// Hands snapshots from any thread to one consumer without locks: Publish() swaps the
+// new snapshot into a single slot (freeing one that was never taken), Take() swaps it
+// out. The consumer owns what it takes, so reading its current snapshot is a plain
+// pointer access.
+template <typename T>
+class SnapshotSwap
+{
+public:
+    SnapshotSwap() = default;
+    ~SnapshotSwap() { delete m_pending.exchange(nullptr); }
+
+    SnapshotSwap(const SnapshotSwap &) = delete;
+    SnapshotSwap &operator=(const SnapshotSwap &) = delete;
+
+    void Publish(std::unique_ptr<const T> snapshot)
+    {
+        delete m_pending.exchange(snapshot.release(), std::memory_order_acq_rel);
+    }
+
+    // The latest snapshot published since the last call, null if none
+    std::unique_ptr<const T> Take()
+    {
+        return std::unique_ptr<const T>(m_pending.exchange(nullptr, std::memory_order_acq_rel));
+    }
+
+private:
+    std::atomic<const T *> m_pending{nullptr};
+};
+
+} // namespace MicVol
@@ -0,0 +1,232 @@
+#include "ServiceOptions.h"
+#include <cwchar>
+
+namespace MicVol
+{
+
+// Like _wtoi, but negative and non-numeric values read as 0
+static uint32_t ParseCount(const wchar_t *text)
+{
+    long value = std::wcstol(text, nullptr, 10);
+    return value > 0 ? (uint32_t)value : 0;
+}
+
+static const wchar_t *const FightStrategyNames[] = {L"off", L"verify", L"backoff"};
+static const wchar_t *const LogLevelNames[] = {L"info", L"warning", L"error"};
+
+void ParseServiceOptions(int argc, wchar_t *argv[], int first, ServiceOptions &options)
+{
+    for (int i = first; i < argc; i++)
+    {
+        if (std::wcscmp(argv[i], L"-t") == 0 && i + 1 < argc)
+        {
+            options.intervalSeconds = ParseCount(argv[++i]);
+        }
+        else if (std::wcscmp(argv[i], L"-m") == 0 && i + 1 < argc)
+        {
+            options.microphoneFilter = argv[++i];
+        }
+        else if (std::wcscmp(argv[i], L"-rules") == 0 && i + 1 < argc)
+        {
+            options.rulesFile = argv[++i];
+        }
+        else if (std::wcscmp(argv[i], L"-config") == 0 && i + 1 < argc)
+        {
+            options.configFile = argv[++i];
+        }
+        else if (std::wcscmp(argv[i], L"-logfile") == 0 && i + 1 < argc)
+        {
+            options.logFile = argv[++i];
+            options.useEventLog = false;
+        }
+        else if (std::wcscmp(argv[i], L"-eventlog") == 0)
+        {
+            options.useEventLog = true;
+        }
+        else if (std::wcscmp(argv[i], L"-events") == 0)
+        {
+            options.useEvents = true;
+        }
+        else if (std::wcscmp(argv[i], L"-whenrunning") == 0 && i + 1 < argc)
+        {
+            options.activationProcesses = argv[++i];
+        }
+        else if (std::wcscmp(argv[i], L"-sessions") == 0)
+        {
+            options.enforceSessions = true;
+        }
+        else if (std::wcscmp(argv[i], L"-adaptive") == 0)
+        {
+            options.adaptive = true;
+        }
+        else if (std::wcscmp(argv[i], L"-tmin") == 0 && i + 1 < argc)
+        {
+            options.minIntervalMs = ParseCount(argv[++i]);
+        }
+        else if (std::wcscmp(argv[i], L"-tmax") == 0 && i + 1 < argc)
+        {
+            options.maxIntervalMs = ParseCount(argv[++i]);
+        }
+        else if (std::wcscmp(argv[i], L"-fight") == 0 && i + 1 < argc)
+        {
+            const wchar_t *name = argv[++i];
+            for (int strategy = 0; strategy < 3; strategy++)
+            {
+                if (std::wcscmp(name, FightStrategyNames[strategy]) == 0)
+                    options.fightStrategy = (FightStrategy)strategy;
+            }
+        }
+        else if (std::wcscmp(argv[i], L"-workers") == 0 && i + 1 < argc)
+        {
+            options.workerThreads = ParseCount(argv[++i]);
+        }
+        else if (std::wcscmp(argv[i], L"-deadline") == 0 && i + 1 < argc)
+        {
+            options.callDeadlineMs = ParseCount(argv[++i]);
+        }
+        else if (std::wcscmp(argv[i], L"-metrics") == 0 && i + 1 < argc)
+        {
+            options.metricsFile = argv[++i];
+        }
+        else if (std::wcscmp(argv[i], L"-metricspipe") == 0)
+        {
+            options.metricsPipe = true;
+        }
+        else if (std::wcscmp(argv[i], L"-binlog") == 0 && i + 1 < argc)
+        {
+            options.binaryLogFile = argv[++i];
+        }
+        else if (std::wcscmp(argv[i], L"-logsize") == 0 && i + 1 < argc)
+        {
+            options.logSegmentMb = ParseCount(argv[++i]);
+        }
+        else if (std::wcscmp(argv[i], L"-logcount") == 0 && i + 1 < argc)
+        {
+            options.logSegmentCount = ParseCount(argv[++i]);
+        }
+        else if (std::wcscmp(argv[i], L"-loglevel") == 0 && i + 1 < argc)
+        {
+            const wchar_t *name = argv[++i];
+            for (int level = 0; level < 3; level++)
+            {
+                if (std::wcscmp(name, LogLevelNames[level]) == 0)
+                    options.logLevel = (LogLevel)level;
+            }
+        }
+    }
+
+    if (options.logSegmentMb > 1024)
+        options.logSegmentMb = 1024;
+    if (options.logSegmentCount < 2)
+        options.logSegmentCount = 2;
+
+    if (options.workerThreads > MaxWorkerThreads)
+        options.workerThreads = MaxWorkerThreads;
+
+    if (options.minIntervalMs < 10)
+        options.minIntervalMs = 10;
+    if (options.maxIntervalMs < options.minIntervalMs)
+        options.maxIntervalMs = options.minIntervalMs;
+
+    // Interval 0 disables the safety-net sweep, which only makes sense with change notifications
+    if (options.intervalSeconds < 1 && !options.useEvents)
+        options.intervalSeconds = 2;
+}
+
+std::wstring FormatServiceArguments(const ServiceOptions &options)
+{
+    const ServiceOptions defaults;
+    std::wstring arguments;
+
+    if (options.intervalSeconds != defaults.intervalSeconds)
+    {
+        arguments += L" -t " + std::to_wstring(options.intervalSeconds);
+    }
+    if (!options.microphoneFilter.empty())
+    {
+        arguments += L" -m \"" + options.microphoneFilter + L"\"";
+    }
+    if (!options.rulesFile.empty())
+    {
+        arguments += L" -rules \"" + options.rulesFile + L"\"";
+    }
+    if (!options.configFile.empty())
+    {
+        arguments += L" -config \"" + options.configFile + L"\"";
+    }
+    if (options.useEvents)
+    {
+        arguments += L" -events";
+    }
+    if (!options.activationProcesses.empty())
+    {
+        arguments += L" -whenrunning \"" + options.activationProcesses + L"\"";
+    }
+    if (options.enforceSessions)
+    {
+        arguments += L" -sessions";
+    }
+    if (options.adaptive)
+    {
+        arguments += L" -adaptive";
+        if (options.minIntervalMs != defaults.minIntervalMs)
+        {
+            arguments += L" -tmin " + std::to_wstring(options.minIntervalMs);
+        }
+        if (options.maxIntervalMs != defaults.maxIntervalMs)
+        {
+            arguments += L" -tmax " + std::to_wstring(options.maxIntervalMs);
+        }
+    }
+    if (options.fightStrategy != defaults.fightStrategy)
+    {
+        arguments += std::wstring(L" -fight ") + FightStrategyNames[(int)options.fightStrategy];
+    }
+    if (options.workerThreads != defaults.workerThreads)
+    {
+        arguments += L" -workers " + std::to_wstring(options.workerThreads);
+    }
+    if (options.callDeadlineMs != defaults.callDeadlineMs)
+    {
+        arguments += L" -deadline " + std::to_wstring(options.callDeadlineMs);
+    }
+    if (!options.metricsFile.empty())
+    {
+        arguments += L" -metrics \"" + options.metricsFile + L"\"";
+    }
+    if (options.metricsPipe)
+    {
+        arguments += L" -metricspipe";
+    }
+    if (options.useEventLog)
+    {
+        arguments += L" -eventlog";
+    }
+    else
+    {
+        if (!options.logFile.empty() && options.logFile != defaults.logFile)
+        {
+            arguments += L" -logfile \"" + options.logFile + L"\"";
+        }
+        if (options.logSegmentMb != defaults.logSegmentMb)
+        {
+            arguments += L" -logsize " + std::to_wstring(options.logSegmentMb);
+        }
+        if (options.logSegmentCount != defaults.logSegmentCount)
+        {
+            arguments += L" -logcount " + std::to_wstring(options.logSegmentCount);
+        }
+    }
+    if (options.logLevel != defaults.logLevel)
+    {
+        arguments += std::wstring(L" -loglevel ") + LogLevelNames[(int)options.logLevel];
+    }
+    if (!options.binaryLogFile.empty())
+    {
+        arguments += L" -binlog \"" + options.binaryLogFile + L"\"";
+    }
+
+    return arguments;
+}
+
+} // namespace MicVol
@@ -0,0 +1,48 @@
+#pragma once
+#include "LogSink.h"
+#include "TamperWar.h"
+#include <cstdint>
+#include <string>
+
+namespace MicVol
+{
+
+const wchar_t *const DefaultLogFile = L"C:\\Windows\\Temp\\MicrophoneVolumeService.log";
+const uint32_t MetricsFileIntervalMs = 5000;
+const uint32_t MaxWorkerThreads = 16;
+
+// Settings taken from the command line of -service, -test and -install
+struct ServiceOptions
+{
+    uint32_t intervalSeconds = 2;
+    std::wstring microphoneFilter;    // Empty selects every microphone
+    std::wstring rulesFile;           // Optional per-device policy rules (see PolicyRules.h)
+    std::wstring configFile;          // Optional file with more of these options, reloaded when it changes
+    std::wstring logFile = DefaultLogFile;
+    bool useEventLog = false;         // Windows Event Log instead of the log file
+    bool useEvents = false;           // Correct volume from change notifications; the interval sweep becomes a safety net
+    std::wstring activationProcesses; // Enforce only while one of these runs, e.g. L"helldivers2.exe"
+    bool enforceSessions = false;     // Per-application session volumes selected by process rules
+    bool adaptive = false;            // Per-device check intervals between minIntervalMs and maxIntervalMs instead of -t sweeps
+    uint32_t minIntervalMs = 250;
+    uint32_t maxIntervalMs = 30000;
+    FightStrategy fightStrategy = FightStrategy::Verify; // Once an application keeps re-applying its level
+    uint32_t workerThreads = 2;       // Pool threads making device calls next to the worker thread, 0 = none
+    uint32_t callDeadlineMs = 5000;   // Longest the device calls of one check may take, 0 = no limit
+    std::wstring metricsFile;         // Prometheus text file rewritten every MetricsFileIntervalMs
+    bool metricsPipe = false;         // Serve the metrics on a local named pipe
+    std::wstring binaryLogFile;       // Optional binary event log, queried with -log-query
+    uint32_t logSegmentMb = 10;       // Log file rotation: segment size in MB, 0 = no rotation
+    uint32_t logSegmentCount = 5;     // Log file rotation: segments kept, including the current one
+    LogLevel logLevel = LogLevel::Information; // Messages below this level are not logged
+};
+
+// Parses argv[first..argc) into options, then clamps the values to their valid ranges.
+// Unknown arguments are ignored.
+void ParseServiceOptions(int argc, wchar_t *argv[], int first, ServiceOptions &options);
+
+// Arguments that reproduce the non-default options, e.g. L" -t 5 -m \"USB\"";
+// used to build the service command line on -install
+std::wstring FormatServiceArguments(const ServiceOptions &options);
+
+} // namespace MicVol
@@ -0,0 +1,344 @@
+#include "SessionEnforcer.h"
+#include <cmath>
+
+namespace MicVol
+{
+
+class SessionEnforcer::Listener : public SessionListener
+{
+public:
+    Listener(SessionEnforcer *owner, SessionEvent event, const DevicePolicy &policy)
+        : owner(owner), event(event), policy(policy)
+    {
+    }
+
+    void OnSessionVolumeChanged(float volume, bool muted, const GUID &eventContext) override
+    {
+        // Our own corrections come back here too, tagged with our event context
+        WriterKind kind = ClassifyWriter(eventContext);
+        if (kind == WriterKind::Service)
+            return;
+        if (std::fabs(volume - policy.targetVolume) <= policy.tolerance &&
+            (policy.mute == MutePolicy::Leave || muted == (policy.mute == MutePolicy::Mute)))
+            return;
+
+        writer = (uint8_t)kind;
+        if (!pending.exchange(true))
+            owner->Flag(event, false);
+    }
+
+    void OnSessionDisconnected() override { owner->Flag(event, true); }
+
+    SessionEnforcer *owner;
+    SessionEvent event;
+    DevicePolicy policy;
+    std::atomic<bool> pending{false};
+    std::atomic<uint8_t> writer{(uint8_t)WriterKind::Unknown};
+};
+
+SessionEnforcer::SessionEnforcer(SessionManager &manager, SessionObserver &observer, std::function<void()> wake)
+    : m_manager(manager), m_observer(observer), m_wake(std::move(wake))
+{
+}
+
+SessionEnforcer::~SessionEnforcer()
+{
+    Shutdown();
+}
+
+void SessionEnforcer::SetRules(const std::vector<PolicyRule> &rules)
+{
+    // Tracked sessions were selected by the old rules; the next refresh enumerates them again
+    Reset();
+    m_policy.Compile(rules, RuleScope::Sessions);
+}
+
+void SessionEnforcer::Reset()
+{
+    for (const auto &endpoint : m_endpoints)
+    {
+        m_manager.UnwatchEndpoint(endpoint.first);
+    }
+    m_endpoints.clear();
+
+    for (SessionHandle session = 0; session < (SessionHandle)m_sessions.size(); session++)
+    {
+        if (m_sessions[session]->control)
+            Release(session);
+    }
+
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_created.clear();
+    m_flagged.clear();
+    m_disconnected.clear();
+}
+
+void SessionEnforcer::Shutdown()
+{
+    Reset();
+    if (m_initialized)
+    {
+        m_manager.Uninitialize();
+        m_initialized = false;
+    }
+}
+
+HRESULT SessionEnforcer::RefreshEndpoints()
+{
+    if (!m_initialized)
+    {
+        HRESULT hr = m_manager.Initialize();
+        if (FAILED(hr))
+            return hr;
+        m_initialized = true;
+    }
+
+    // Without process rules no session can be selected
+    if (m_policy.RuleCount() == 0)
+        return S_OK;
+
+    std::unordered_map<std::wstring, DataFlow> current;
+    for (DataFlow flow : {DataFlow::Render, DataFlow::Capture})
+    {
+        std::vector<std::wstring> endpointIds;
+        HRESULT hr = m_manager.EnumerateEndpoints(flow, endpointIds);
+        if (FAILED(hr))
+            return hr;
+        for (const std::wstring &endpointId : endpointIds)
+        {
+            current[endpointId] = flow;
+        }
+    }
+
+    for (auto it = m_endpoints.begin(); it != m_endpoints.end();)
+    {
+        if (current.count(it->first))
+        {
+            ++it;
+            continue;
+        }
+
+        m_manager.UnwatchEndpoint(it->first);
+        for (SessionHandle session = 0; session < (SessionHandle)m_sessions.size(); session++)
+        {
+            if (m_sessions[session]->control && m_sessions[session]->info.endpointId == it->first)
+                Untrack(session);
+        }
+        it = m_endpoints.erase(it);
+    }
+
+    for (const auto &endpoint : current)
+    {
+        if (m_endpoints.count(endpoint.first))
+            continue;
+
+        m_existing.clear();
+        HRESULT hr = m_manager.WatchEndpoint(endpoint.first, this, m_existing);
+        if (FAILED(hr))
+        {
+            m_observer.OnEndpointWatchFailed(endpoint.first, hr);
+            continue;
+        }
+        m_endpoints[endpoint.first] = endpoint.second;
+        for (const std::shared_ptr<SessionControl> &control : m_existing)
+        {
+            Track(endpoint.first, endpoint.second, control);
+        }
+    }
+    m_existing.clear();
+    return S_OK;
+}
+
+void SessionEnforcer::ProcessPending()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_created.swap(m_createdWork);
+        m_flagged.swap(m_flaggedWork);
+        m_disconnected.swap(m_disconnectedWork);
+    }
+
+    for (const SessionEvent &event : m_disconnectedWork)
+    {
+        if (IsCurrent(event))
+            Untrack(event.session);
+    }
+
+    for (CreatedSession &created : m_createdWork)
+    {
+        auto endpoint = m_endpoints.find(created.endpointId);
+        if (endpoint != m_endpoints.end())
+            Track(created.endpointId, endpoint->second, std::move(created.control));
+    }
+
+    for (const SessionEvent &event : m_flaggedWork)
+    {
+        if (!IsCurrent(event))
+            continue;
+        Slot &slot = *m_sessions[event.session];
+        slot.listener->pending = false;
+        slot.info.lastWriter = (WriterKind)slot.listener->writer.load();
+        Check(event.session);
+    }
+
+    m_createdWork.clear();
+    m_flaggedWork.clear();
+    m_disconnectedWork.clear();
+}
+
+void SessionEnforcer::OnSessionCreated(const std::wstring &endpointId, std::shared_ptr<SessionControl> session)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_created.push_back({endpointId, std::move(session)});
+    }
+    if (m_wake)
+        m_wake();
+}
+
+void SessionEnforcer::Flag(const SessionEvent &event, bool disconnected)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        (disconnected ? m_disconnected : m_flagged).push_back(event);
+    }
+    if (m_wake)
+        m_wake();
+}
+
+bool SessionEnforcer::IsCurrent(const SessionEvent &event) const
+{
+    return event.session < m_sessions.size() && m_sessions[event.session]->control &&
+           m_sessions[event.session]->generation == event.generation;
+}
+
+// Resolves the process rules for a new session and starts enforcing it if selected
+void SessionEnforcer::Track(const std::wstring &endpointId, DataFlow flow, std::shared_ptr<SessionControl> control)
+{
+    std::wstring instanceId;
+    uint32_t processId = 0;
+    if (!control || FAILED(control->GetInstanceId(instanceId)) || FAILED(control->GetProcessId(&processId)))
+        return;
+
+    // Reported by both the enumeration and a notification
+    if (m_sessionsByInstance.count(instanceId))
+        return;
+
+    PolicySubject subject;
+    subject.endpointId = endpointId;
+    if (FAILED(m_manager.GetProcessName(processId, subject.processName)))
+        subject.processName.clear();
+
+    // Sessions are opt-in: unlike devices, the default policy never applies
+    DevicePolicy policy;
+    int rule = m_policy.Resolve(subject, policy);
+    if (rule < 0 || !policy.enforce)
+        return;
+
+    SessionHandle session;
+    if (!m_freeSessions.empty())
+    {
+        session = m_freeSessions.back();
+        m_freeSessions.pop_back();
+    }
+    else
+    {
+        session = (SessionHandle)m_sessions.size();
+        m_sessions.emplace_back(new Slot());
+    }
+
+    Slot &slot = *m_sessions[session];
+    slot.info = TrackedSession();
+    slot.info.instanceId = instanceId;
+    slot.info.endpointId = endpointId;
+    slot.info.flow = flow;
+    slot.info.processId = processId;
+    slot.info.processName = subject.processName;
+    slot.info.policy = policy;
+    slot.info.policyRule = rule;
+    slot.control = std::move(control);
+    slot.listener.reset(new Listener(this, {session, slot.generation}, policy));
+
+    HRESULT hr = slot.control->RegisterListener(slot.listener.get());
+    if (FAILED(hr))
+    {
+        m_observer.OnSessionError(session, hr);
+        slot.listener.reset();
+        slot.control.reset();
+        slot.generation++;
+        m_freeSessions.push_back(session);
+        return;
+    }
+
+    m_sessionsByInstance[instanceId] = session;
+    m_sessionCount++;
+    m_observer.OnSessionTracked(session);
+
+    // The volume may already be wrong
+    Check(session);
+}
+
+void SessionEnforcer::Untrack(SessionHandle session)
+{
+    m_observer.OnSessionEnded(session);
+    Release(session);
+}
+
+void SessionEnforcer::Release(SessionHandle session)
+{
+    Slot &slot = *m_sessions[session];
+    slot.control->UnregisterListener(slot.listener.get());
+    m_sessionsByInstance.erase(slot.info.instanceId);
+    slot.listener.reset();
+    slot.control.reset();
+    slot.generation++;
+    m_freeSessions.push_back(session);
+    m_sessionCount--;
+}
+
+void SessionEnforcer::Check(SessionHandle session)
+{
+    Slot &slot = *m_sessions[session];
+    const DevicePolicy &policy = slot.info.policy;
+    m_checks++;
+
+    float volume = 0.0f;
+    HRESULT hr = slot.control->GetVolume(&volume);
+    if (FAILED(hr))
+    {
+        m_observer.OnSessionError(session, hr);
+        return;
+    }
+
+    if (std::fabs(volume - policy.targetVolume) > policy.tolerance)
+    {
+        hr = slot.control->SetVolume(policy.targetVolume);
+        if (FAILED(hr))
+        {
+            m_observer.OnSessionError(session, hr);
+            return;
+        }
+        slot.info.corrections++;
+        m_observer.OnSessionCorrected(session, volume, policy.targetVolume);
+    }
+
+    if (policy.mute == MutePolicy::Leave)
+        return;
+
+    const bool wanted = policy.mute == MutePolicy::Mute;
+    bool muted = false;
+    hr = slot.control->GetMute(&muted);
+    if (SUCCEEDED(hr) && muted != wanted)
+    {
+        hr = slot.control->SetMute(wanted);
+        if (SUCCEEDED(hr))
+        {
+            slot.info.corrections++;
+            m_observer.OnSessionMuteCorrected(session, wanted);
+        }
+    }
+    if (FAILED(hr))
+        m_observer.OnSessionError(session, hr);
+}
+
+} // namespace MicVol
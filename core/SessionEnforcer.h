@@ -0,0 +1,140 @@
+#pragma once
+#include "PolicyRules.h"
+#include "SessionManager.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace MicVol
+{
+
+// Index of a tracked session; reused after the session ends
+typedef uint32_t SessionHandle;
+
+// A session the rules selected
+struct TrackedSession
+{
+    std::wstring instanceId;
+    std::wstring endpointId;
+    DataFlow flow = DataFlow::Render;
+    uint32_t processId = 0;
+    std::wstring processName;
+    DevicePolicy policy;
+    int policyRule = -1; // Index in the rules passed to SetRules()
+    uint32_t corrections = 0;
+    WriterKind lastWriter = WriterKind::Unknown; // Of the latest change corrected through a notification
+};
+
+// What the session enforcer did, for logging. Every method has an empty default.
+class SessionObserver
+{
+public:
+    virtual ~SessionObserver() = default;
+
+    virtual void OnEndpointWatchFailed(const std::wstring & /*endpointId*/, HRESULT) {}
+    virtual void OnSessionTracked(SessionHandle) {}
+    virtual void OnSessionEnded(SessionHandle) {}
+    virtual void OnSessionCorrected(SessionHandle, float /*oldVolume*/, float /*newVolume*/) {}
+    virtual void OnSessionMuteCorrected(SessionHandle, bool /*muted*/) {}
+    virtual void OnSessionError(SessionHandle, HRESULT) {}
+};
+
+// Enforces per-application session volumes on render and capture endpoints.
+//
+// Sessions are selected by the process rules of the policy (process:<glob>). Every
+// active endpoint is watched once: the sessions that exist then are enumerated,
+// later ones arrive as session-created notifications and leave through
+// session-disconnected ones, so no pass re-enumerates sessions. A session volume
+// change outside the tolerance band flags the session; ProcessPending() corrects
+// only the flagged ones. Notification threads only queue and call the wake function;
+// everything else must be called from one worker thread.
+class SessionEnforcer : private SessionCreatedSink
+{
+public:
+    SessionEnforcer(SessionManager &manager, SessionObserver &observer, std::function<void()> wake = nullptr);
+    ~SessionEnforcer();
+
+    SessionEnforcer(const SessionEnforcer &) = delete;
+    SessionEnforcer &operator=(const SessionEnforcer &) = delete;
+
+    // Only process rules apply; a session no rule selects is not tracked
+    void SetRules(const std::vector<PolicyRule> &rules);
+    size_t RuleCount() const { return m_policy.RuleCount(); } // Process rules
+
+    // Watches endpoints that appeared since the last call and drops the ones that went away
+    HRESULT RefreshEndpoints();
+
+    // Applies queued session arrivals and departures, then corrects flagged sessions
+    void ProcessPending();
+
+    // Releases every watch and session on the worker thread
+    void Shutdown();
+
+    const TrackedSession &Session(SessionHandle session) const { return m_sessions[session]->info; }
+    size_t SessionCount() const { return m_sessionCount; }
+    size_t WatchedEndpointCount() const { return m_endpoints.size(); }
+
+    // Session volume reads made by ProcessPending() (for tests and benchmarks)
+    uint64_t Checks() const { return m_checks; }
+
+private:
+    class Listener;
+
+    struct Slot
+    {
+        uint32_t generation = 0; // Tells events of an ended session from those of a reused handle
+        TrackedSession info;
+        std::shared_ptr<SessionControl> control;
+        std::unique_ptr<Listener> listener;
+    };
+
+    struct CreatedSession
+    {
+        std::wstring endpointId;
+        std::shared_ptr<SessionControl> control;
+    };
+
+    struct SessionEvent
+    {
+        SessionHandle session;
+        uint32_t generation;
+    };
+
+    void OnSessionCreated(const std::wstring &endpointId, std::shared_ptr<SessionControl> session) override;
+    void Flag(const SessionEvent &event, bool disconnected);
+    bool IsCurrent(const SessionEvent &event) const;
+
+    void Track(const std::wstring &endpointId, DataFlow flow, std::shared_ptr<SessionControl> control);
+    void Untrack(SessionHandle session);
+    void Release(SessionHandle session); // Untrack without telling the observer
+    void Reset();
+    void Check(SessionHandle session);
+
+    SessionManager &m_manager;
+    SessionObserver &m_observer;
+    std::function<void()> m_wake;
+    PolicyEngine m_policy;
+    bool m_initialized = false;
+
+    std::unordered_map<std::wstring, DataFlow> m_endpoints;              // Watched endpoints
+    std::unordered_map<std::wstring, SessionHandle> m_sessionsByInstance; // Arrivals and departures only
+    std::vector<std::unique_ptr<Slot>> m_sessions;                       // Indexed by SessionHandle
+    std::vector<SessionHandle> m_freeSessions;
+    size_t m_sessionCount = 0;
+    uint64_t m_checks = 0;
+
+    // Filled by notification threads
+    std::mutex m_queueMutex;
+    std::vector<CreatedSession> m_created;
+    std::vector<SessionEvent> m_flagged;
+    std::vector<SessionEvent> m_disconnected;
+
+    // Swapped with the queues by ProcessPending()
+    std::vector<CreatedSession> m_createdWork;
+    std::vector<SessionEvent> m_flaggedWork;
+    std::vector<SessionEvent> m_disconnectedWork;
+    std::vector<std::shared_ptr<SessionControl>> m_existing;
+};
+
+} // namespace MicVol
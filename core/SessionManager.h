@@ -0,0 +1,78 @@
+#pragma once
+#include "DeviceNotifications.h"
+#include "Platform.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MicVol
+{
+
+// Receives the events of one audio session (the IAudioSessionEvents model).
+// Called on an audio service thread: only record the event and return.
+class SessionListener
+{
+public:
+    virtual ~SessionListener() = default;
+
+    // eventContext is the one the writer passed, all zero if none
+    virtual void OnSessionVolumeChanged(float volume, bool muted, const GUID &eventContext) = 0;
+
+    // The session expired, its device went away or its process exited
+    virtual void OnSessionDisconnected() = 0;
+};
+
+// Per-application volume of one audio session (IAudioSessionControl2 + ISimpleAudioVolume)
+class SessionControl
+{
+public:
+    virtual ~SessionControl() = default;
+
+    // Unique per session and stable for its lifetime; used to drop duplicate reports
+    virtual HRESULT GetInstanceId(std::wstring &instanceId) = 0;
+    virtual HRESULT GetProcessId(uint32_t *processId) = 0;
+
+    virtual HRESULT GetVolume(float *level) = 0;
+    virtual HRESULT SetVolume(float level) = 0;
+    virtual HRESULT GetMute(bool *muted) = 0;
+    virtual HRESULT SetMute(bool muted) = 0;
+
+    // One listener per session; after UnregisterListener returns no further events are delivered
+    virtual HRESULT RegisterListener(SessionListener *listener) = 0;
+    virtual HRESULT UnregisterListener(SessionListener *listener) = 0;
+};
+
+// Reports sessions created on a watched endpoint (the IAudioSessionNotification model).
+// Called on an audio service thread: only queue the session and return.
+class SessionCreatedSink
+{
+public:
+    virtual ~SessionCreatedSink() = default;
+    virtual void OnSessionCreated(const std::wstring &endpointId, std::shared_ptr<SessionControl> session) = 0;
+};
+
+// Access to the audio sessions of render and capture endpoints (IAudioSessionManager2 on Windows).
+// All methods are called from the worker thread that called Initialize().
+class SessionManager
+{
+public:
+    virtual ~SessionManager() = default;
+
+    virtual HRESULT Initialize() = 0;
+    virtual void Uninitialize() = 0;
+
+    // IDs of the active endpoints of one data flow
+    virtual HRESULT EnumerateEndpoints(DataFlow flow, std::vector<std::wstring> &endpointIds) = 0;
+
+    // Registers the sink for sessions created on the endpoint from now on, then appends
+    // the sessions that already exist. A session created in between may be reported twice.
+    virtual HRESULT WatchEndpoint(const std::wstring &endpointId, SessionCreatedSink *sink,
+                                  std::vector<std::shared_ptr<SessionControl>> &existing) = 0;
+    virtual void UnwatchEndpoint(const std::wstring &endpointId) = 0;
+
+    // Executable file name of a process, e.g. "Discord.exe"
+    virtual HRESULT GetProcessName(uint32_t processId, std::wstring &name) = 0;
+};
+
+} // namespace MicVol
@@ -0,0 +1,227 @@
+#pragma once
+#include "AudioBackend.h"
+#include "SimulatedEndpoint.h"
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace MicVol
+{
+
+// HRESULT returned by a simulated endpoint after its device was removed
+// (same value as AUDCLNT_E_DEVICE_INVALIDATED)
+const HRESULT SIM_E_DEVICE_INVALIDATED = (HRESULT)0x88890004L;
+
+// Backend calls as seen by the audio stack
+struct BackendCallCounters
+{
+    unsigned long long initializations = 0;
+    unsigned long long enumerations = 0;
+    unsigned long long nameReads = 0;
+    unsigned long long stateReads = 0;
+    unsigned long long formFactorReads = 0;
+    unsigned long long activations = 0;
+};
+
+// In-memory audio devices for tests and benchmarks.
+// The scripting methods (AddDevice, RemoveDevice, ...) deliver device notifications
+// to the registered sink synchronously, like a hotplug would. ActivateVolume() may be
+// called from several pool threads at once, but not during a scripting method.
+class SimulatedAudioBackend : public AudioBackend
+{
+public:
+    HRESULT Initialize() override
+    {
+        counters.initializations++;
+        std::lock_guard<std::mutex> lock(m_activateMutex);
+        m_initialized = true;
+        return S_OK;
+    }
+
+    void Uninitialize() override
+    {
+        std::lock_guard<std::mutex> lock(m_activateMutex);
+        m_initialized = false;
+    }
+
+    HRESULT EnumerateCaptureEndpoints(std::vector<std::wstring> &deviceIds) override
+    {
+        if (!m_initialized)
+            return E_FAIL;
+        counters.enumerations++;
+        for (const auto &device : m_devices)
+        {
+            if (device.second.flow == DataFlow::Capture && device.second.state == EndpointStateActive)
+                deviceIds.push_back(device.first);
+        }
+        return S_OK;
+    }
+
+    HRESULT GetEndpointName(const std::wstring &deviceId, std::wstring &name) override
+    {
+        counters.nameReads++;
+        auto it = m_devices.find(deviceId);
+        if (it == m_devices.end())
+            return SIM_E_DEVICE_INVALIDATED;
+        name = it->second.name;
+        return S_OK;
+    }
+
+    HRESULT GetEndpointFormFactor(const std::wstring &deviceId, FormFactor &formFactor) override
+    {
+        counters.formFactorReads++;
+        auto it = m_devices.find(deviceId);
+        if (it == m_devices.end())
+            return SIM_E_DEVICE_INVALIDATED;
+        formFactor = it->second.formFactor;
+        return S_OK;
+    }
+
+    HRESULT GetEndpointState(const std::wstring &deviceId, DataFlow &flow, unsigned &state) override
+    {
+        counters.stateReads++;
+        auto it = m_devices.find(deviceId);
+        if (it == m_devices.end())
+            return SIM_E_DEVICE_INVALIDATED;
+        flow = it->second.flow;
+        state = it->second.state;
+        return S_OK;
+    }
+
+    HRESULT GetDefaultCaptureEndpoint(std::wstring &deviceId) override
+    {
+        deviceId = m_defaultCapture;
+        return deviceId.empty() ? S_FALSE : S_OK;
+    }
+
+    HRESULT RegisterDeviceNotifications(DeviceNotificationSink *sink) override
+    {
+        if (!sink)
+            return E_POINTER;
+        m_sink = sink;
+        return S_OK;
+    }
+
+    HRESULT UnregisterDeviceNotifications(DeviceNotificationSink *sink) override
+    {
+        if (m_sink != sink)
+            return E_INVALIDARG;
+        m_sink = nullptr;
+        return S_OK;
+    }
+
+    HRESULT ActivateVolume(const std::wstring &deviceId, std::shared_ptr<VolumeEndpoint> &endpoint) override
+    {
+        if (activateHook)
+            activateHook();
+        std::lock_guard<std::mutex> lock(m_activateMutex);
+        if (!m_initialized)
+            return E_FAIL;
+        counters.activations++;
+        auto it = m_devices.find(deviceId);
+        if (it == m_devices.end() || it->second.state != EndpointStateActive)
+            return SIM_E_DEVICE_INVALIDATED;
+        endpoint = it->second.endpoint;
+        return S_OK;
+    }
+
+    // Scripted device changes
+
+    std::shared_ptr<SimulatedEndpoint> AddDevice(const std::wstring &deviceId, const std::wstring &name,
+                                                 float volume = 0.5f, DataFlow flow = DataFlow::Capture)
+    {
+        Device &device = m_devices[deviceId];
+        device.name = name;
+        device.flow = flow;
+        device.state = EndpointStateActive;
+        device.endpoint = std::make_shared<SimulatedEndpoint>(volume);
+
+        if (m_sink)
+            m_sink->OnDeviceAdded(deviceId);
+        return device.endpoint;
+    }
+
+    // Interfaces handed out earlier keep existing but fail from now on
+    void RemoveDevice(const std::wstring &deviceId)
+    {
+        auto it = m_devices.find(deviceId);
+        if (it == m_devices.end())
+            return;
+        it->second.endpoint->SetFailure(SIM_E_DEVICE_INVALIDATED);
+        m_devices.erase(it);
+
+        if (m_sink)
+            m_sink->OnDeviceRemoved(deviceId);
+    }
+
+    // E.g. unplugging a jack (DEVICE_STATE_UNPLUGGED) or disabling the device
+    void SetDeviceState(const std::wstring &deviceId, unsigned state)
+    {
+        auto it = m_devices.find(deviceId);
+        if (it == m_devices.end())
+            return;
+        it->second.state = state;
+        it->second.endpoint->SetFailure(state == EndpointStateActive ? S_OK : SIM_E_DEVICE_INVALIDATED);
+
+        if (m_sink)
+            m_sink->OnDeviceStateChanged(deviceId, state);
+    }
+
+    void SetDefaultCaptureDevice(const std::wstring &deviceId)
+    {
+        m_defaultCapture = deviceId;
+        if (m_sink)
+        {
+            m_sink->OnDefaultDeviceChanged(DataFlow::Capture, DeviceRole::Console, deviceId);
+            m_sink->OnDefaultDeviceChanged(DataFlow::Capture, DeviceRole::Multimedia, deviceId);
+            m_sink->OnDefaultDeviceChanged(DataFlow::Capture, DeviceRole::Communications, deviceId);
+        }
+    }
+
+    void RenameDevice(const std::wstring &deviceId, const std::wstring &name)
+    {
+        auto it = m_devices.find(deviceId);
+        if (it == m_devices.end())
+            return;
+        it->second.name = name;
+
+        if (m_sink)
+            m_sink->OnDevicePropertyChanged(deviceId);
+    }
+
+    void SetFormFactor(const std::wstring &deviceId, FormFactor formFactor)
+    {
+        auto it = m_devices.find(deviceId);
+        if (it != m_devices.end())
+            it->second.formFactor = formFactor;
+    }
+
+    std::shared_ptr<SimulatedEndpoint> Endpoint(const std::wstring &deviceId)
+    {
+        auto it = m_devices.find(deviceId);
+        return it == m_devices.end() ? nullptr : it->second.endpoint;
+    }
+
+    BackendCallCounters counters;
+
+    // Runs at the start of every activation, e.g. to make it hang like a wedged driver
+    std::function<void()> activateHook;
+
+private:
+    struct Device
+    {
+        std::wstring name;
+        DataFlow flow = DataFlow::Capture;
+        unsigned state = EndpointStateActive;
+        FormFactor formFactor = FormFactor::Microphone;
+        std::shared_ptr<SimulatedEndpoint> endpoint;
+    };
+
+    std::mutex m_activateMutex; // Activations on pool threads against the rest
+    bool m_initialized = false; // Written under m_activateMutex
+    std::map<std::wstring, Device> m_devices;
+    std::wstring m_defaultCapture;
+    DeviceNotificationSink *m_sink = nullptr;
+};
+
+} // namespace MicVol
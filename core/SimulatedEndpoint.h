@@ -0,0 +1,234 @@
+#pragma once
+#include "VolumeEndpoint.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MicVol
+{
+
+// In-memory endpoint used by tests and benchmarks off Windows.
+// Like the real audio stack it notifies every registered listener synchronously
+// on each volume write, including writes made by the enforcer itself, which carry
+// ServiceEventContext.
+class SimulatedEndpoint : public VolumeEndpoint
+{
+public:
+    explicit SimulatedEndpoint(float initialVolume = 0.5f) : m_volume(initialVolume) {}
+
+    HRESULT GetMasterVolume(float *level) override
+    {
+        if (!level)
+            return E_POINTER;
+        getCalls++;
+        if (m_callHook)
+            m_callHook();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        HRESULT hr = Fault(lock);
+        if (FAILED(hr))
+            return hr;
+        *level = m_volume;
+        return S_OK;
+    }
+
+    HRESULT SetMasterVolume(float level) override
+    {
+        setCalls++;
+        if (m_callHook)
+            m_callHook();
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            HRESULT hr = Fault(lock);
+            if (FAILED(hr))
+                return hr;
+        }
+        return Write(level, ServiceEventContext);
+    }
+
+    HRESULT GetMute(bool *muted) override
+    {
+        if (!muted)
+            return E_POINTER;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        HRESULT hr = Fault(lock);
+        if (FAILED(hr))
+            return hr;
+        *muted = m_muted;
+        return S_OK;
+    }
+
+    HRESULT SetMute(bool muted) override
+    {
+        muteSetCalls++;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            HRESULT hr = Fault(lock);
+            if (FAILED(hr))
+                return hr;
+        }
+        return WriteMute(muted, ServiceEventContext);
+    }
+
+    HRESULT RegisterListener(VolumeListener *listener) override
+    {
+        if (!listener)
+            return E_POINTER;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_listeners.push_back(listener);
+        return S_OK;
+    }
+
+    HRESULT UnregisterListener(VolumeListener *listener) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = std::find(m_listeners.begin(), m_listeners.end(), listener);
+        if (it == m_listeners.end())
+            return E_INVALIDARG;
+        m_listeners.erase(it);
+        return S_OK;
+    }
+
+    // Runs at the start of every GetMasterVolume/SetMasterVolume, e.g. to advance a
+    // virtual clock by a simulated call latency. Set before the endpoint is shared.
+    void SetCallHook(std::function<void()> hook) { m_callHook = std::move(hook); }
+
+    // Simulates another application changing the level; most writers pass no context
+    void Tamper(float level, const GUID &context = GUID{}) { Write(level, context); }
+    void TamperMute(bool muted, const GUID &context = GUID{}) { WriteMute(muted, context); }
+
+    // Makes every subsequent call fail with hr (e.g. the device was unplugged); S_OK clears it
+    void SetFailure(HRESULT hr)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failure = hr;
+    }
+
+    // Fault injection for a driver that misbehaves for a while: the next `calls` volume
+    // and mute calls fail with hr, after which the endpoint works again
+    void FailNext(unsigned calls, HRESULT hr)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failNext = calls;
+        m_failNextHr = hr;
+    }
+
+    // Makes volume and mute calls hang, like a wedged driver, until Unstall()
+    void Stall()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stalled = true;
+    }
+
+    void Unstall()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stalled = false;
+        m_unstalled.notify_all();
+    }
+
+    // Calls currently hanging in a stall
+    unsigned StalledCalls()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stalledCalls;
+    }
+
+    float Volume()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_volume;
+    }
+
+    bool Muted()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_muted;
+    }
+
+    size_t ListenerCount()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_listeners.size();
+    }
+
+    std::atomic<unsigned> getCalls{0};
+    std::atomic<unsigned> setCalls{0};
+    std::atomic<unsigned> muteSetCalls{0};
+
+private:
+    // Waits out a stall, then applies the injected failures; called with m_mutex held
+    HRESULT Fault(std::unique_lock<std::mutex> &lock)
+    {
+        if (m_stalled)
+        {
+            m_stalledCalls++;
+            m_unstalled.wait(lock, [this]() { return !m_stalled; });
+            m_stalledCalls--;
+        }
+        if (m_failNext > 0)
+        {
+            m_failNext--;
+            return m_failNextHr;
+        }
+        return m_failure;
+    }
+
+    HRESULT Write(float level, const GUID &context)
+    {
+        if (level < 0.0f || level > 1.0f)
+            return E_INVALIDARG;
+
+        VolumeNotification notification;
+        std::vector<VolumeListener *> listeners;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_volume = level;
+            notification = {m_volume, m_muted, context};
+            listeners = m_listeners;
+        }
+
+        Notify(listeners, notification);
+        return S_OK;
+    }
+
+    HRESULT WriteMute(bool muted, const GUID &context)
+    {
+        VolumeNotification notification;
+        std::vector<VolumeListener *> listeners;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_muted = muted;
+            notification = {m_volume, m_muted, context};
+            listeners = m_listeners;
+        }
+
+        Notify(listeners, notification);
+        return S_OK;
+    }
+
+    static void Notify(const std::vector<VolumeListener *> &listeners, const VolumeNotification &notification)
+    {
+        for (VolumeListener *listener : listeners)
+        {
+            listener->OnVolumeNotification(notification);
+        }
+    }
+
+    std::mutex m_mutex;
+    float m_volume;
+    bool m_muted = false;
+    HRESULT m_failure = S_OK;
+    unsigned m_failNext = 0;
+    HRESULT m_failNextHr = S_OK;
+    bool m_stalled = false;
+    unsigned m_stalledCalls = 0;
+    std::condition_variable m_unstalled;
+    std::function<void()> m_callHook;
+    std::vector<VolumeListener *> m_listeners;
+};
+
+} // namespace MicVol
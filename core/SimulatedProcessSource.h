@@ -0,0 +1,62 @@
+#pragma once
+#include "ProcessSource.h"
+#include <functional>
+#include <map>
+
+namespace MicVol
+{
+
+// In-memory process table for tests and benchmarks.
+// Launch and Exit deliver the events to the registered sink synchronously.
+class SimulatedProcessSource : public ProcessSource
+{
+public:
+    HRESULT Start(ProcessEventSink *sink, std::vector<RunningProcess> &running) override
+    {
+        if (!sink)
+            return E_POINTER;
+        if (FAILED(startResult))
+            return startResult;
+        m_sink = sink;
+        for (const auto &process : m_processes)
+        {
+            running.push_back({process.first, process.second});
+        }
+        if (afterSnapshot)
+            afterSnapshot();
+        return S_OK;
+    }
+
+    void Stop() override { m_sink = nullptr; }
+
+    void Launch(uint32_t processId, const std::wstring &name)
+    {
+        m_processes[processId] = name;
+        if (m_sink)
+            m_sink->OnProcessStarted(processId, name);
+    }
+
+    void Exit(uint32_t processId)
+    {
+        if (m_processes.erase(processId) && m_sink)
+            m_sink->OnProcessExited(processId);
+    }
+
+    // Reports a start again, as for a process started while Start() enumerated
+    void RepeatStart(uint32_t processId)
+    {
+        auto it = m_processes.find(processId);
+        if (it != m_processes.end() && m_sink)
+            m_sink->OnProcessStarted(processId, it->second);
+    }
+
+    HRESULT startResult = S_OK;
+    // Runs inside Start() once the snapshot is taken, for events racing it
+    std::function<void()> afterSnapshot;
+
+private:
+    std::map<uint32_t, std::wstring> m_processes;
+    ProcessEventSink *m_sink = nullptr;
+};
+
+} // namespace MicVol
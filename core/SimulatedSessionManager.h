@@ -0,0 +1,276 @@
+#pragma once
+#include "SessionManager.h"
+#include "SimulatedAudioBackend.h"
+#include <map>
+#include <mutex>
+
+namespace MicVol
+{
+
+// In-memory audio session. Like ISimpleAudioVolume it notifies the registered listener
+// synchronously on each write, including writes made by the enforcer itself, which
+// carry ServiceEventContext.
+class SimulatedSession : public SessionControl
+{
+public:
+    SimulatedSession(const std::wstring &instanceId, uint32_t processId, float volume)
+        : m_instanceId(instanceId), m_processId(processId), m_volume(volume)
+    {
+    }
+
+    HRESULT GetInstanceId(std::wstring &instanceId) override
+    {
+        instanceId = m_instanceId;
+        return S_OK;
+    }
+
+    HRESULT GetProcessId(uint32_t *processId) override
+    {
+        if (!processId)
+            return E_POINTER;
+        *processId = m_processId;
+        return S_OK;
+    }
+
+    HRESULT GetVolume(float *level) override
+    {
+        if (!level)
+            return E_POINTER;
+        getCalls++;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_disconnected)
+            return SIM_E_DEVICE_INVALIDATED;
+        *level = m_volume;
+        return S_OK;
+    }
+
+    HRESULT SetVolume(float level) override
+    {
+        setCalls++;
+        return Write(&level, nullptr, ServiceEventContext);
+    }
+
+    HRESULT GetMute(bool *muted) override
+    {
+        if (!muted)
+            return E_POINTER;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_disconnected)
+            return SIM_E_DEVICE_INVALIDATED;
+        *muted = m_muted;
+        return S_OK;
+    }
+
+    HRESULT SetMute(bool muted) override
+    {
+        muteSetCalls++;
+        return Write(nullptr, &muted, ServiceEventContext);
+    }
+
+    HRESULT RegisterListener(SessionListener *listener) override
+    {
+        if (!listener)
+            return E_POINTER;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_listener = listener;
+        return S_OK;
+    }
+
+    HRESULT UnregisterListener(SessionListener *listener) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_listener != listener)
+            return E_INVALIDARG;
+        m_listener = nullptr;
+        return S_OK;
+    }
+
+    // Another application (or the volume mixer) changes the session
+    void Tamper(float level, const GUID &context = GUID{}) { Write(&level, nullptr, context); }
+    void TamperMute(bool muted, const GUID &context = GUID{}) { Write(nullptr, &muted, context); }
+
+    // The process exited or the session expired
+    void Disconnect()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_disconnected = true;
+        if (m_listener)
+            m_listener->OnSessionDisconnected();
+    }
+
+    float Volume()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_volume;
+    }
+
+    bool Muted()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_muted;
+    }
+
+    std::atomic<unsigned> getCalls{0};
+    std::atomic<unsigned> setCalls{0};
+    std::atomic<unsigned> muteSetCalls{0};
+
+private:
+    HRESULT Write(const float *level, const bool *muted, const GUID &context)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_disconnected)
+            return SIM_E_DEVICE_INVALIDATED;
+        if (level)
+            m_volume = *level;
+        if (muted)
+            m_muted = *muted;
+        if (m_listener)
+            m_listener->OnSessionVolumeChanged(m_volume, m_muted, context);
+        return S_OK;
+    }
+
+    std::wstring m_instanceId;
+    uint32_t m_processId;
+    std::mutex m_mutex;
+    float m_volume;
+    bool m_muted = false;
+    bool m_disconnected = false;
+    SessionListener *m_listener = nullptr;
+};
+
+// Session manager calls as seen by the audio stack
+struct SessionManagerCallCounters
+{
+    unsigned long long endpointEnumerations = 0;
+    unsigned long long sessionEnumerations = 0; // One per WatchEndpoint
+    unsigned long long processNameReads = 0;
+};
+
+// In-memory endpoints and sessions for tests and benchmarks.
+// StartSession and EndSession deliver notifications synchronously, like a process
+// opening or closing an audio stream would.
+class SimulatedSessionManager : public SessionManager
+{
+public:
+    HRESULT Initialize() override
+    {
+        m_initialized = true;
+        return S_OK;
+    }
+
+    void Uninitialize() override { m_initialized = false; }
+
+    HRESULT EnumerateEndpoints(DataFlow flow, std::vector<std::wstring> &endpointIds) override
+    {
+        if (!m_initialized)
+            return E_FAIL;
+        counters.endpointEnumerations++;
+        for (const auto &endpoint : m_endpoints)
+        {
+            if (endpoint.second.flow == flow)
+                endpointIds.push_back(endpoint.first);
+        }
+        return S_OK;
+    }
+
+    HRESULT WatchEndpoint(const std::wstring &endpointId, SessionCreatedSink *sink,
+                          std::vector<std::shared_ptr<SessionControl>> &existing) override
+    {
+        if (!sink)
+            return E_POINTER;
+        auto it = m_endpoints.find(endpointId);
+        if (it == m_endpoints.end())
+            return SIM_E_DEVICE_INVALIDATED;
+        counters.sessionEnumerations++;
+        it->second.sink = sink;
+        existing.insert(existing.end(), it->second.sessions.begin(), it->second.sessions.end());
+        return S_OK;
+    }
+
+    void UnwatchEndpoint(const std::wstring &endpointId) override
+    {
+        auto it = m_endpoints.find(endpointId);
+        if (it != m_endpoints.end())
+            it->second.sink = nullptr;
+    }
+
+    HRESULT GetProcessName(uint32_t processId, std::wstring &name) override
+    {
+        counters.processNameReads++;
+        auto it = m_processes.find(processId);
+        if (it == m_processes.end())
+            return E_INVALIDARG;
+        name = it->second;
+        return S_OK;
+    }
+
+    // Scripted changes
+
+    void AddEndpoint(const std::wstring &endpointId, DataFlow flow) { m_endpoints[endpointId].flow = flow; }
+
+    // Sessions of the endpoint disconnect first
+    void RemoveEndpoint(const std::wstring &endpointId)
+    {
+        auto it = m_endpoints.find(endpointId);
+        if (it == m_endpoints.end())
+            return;
+        for (const auto &session : it->second.sessions)
+        {
+            session->Disconnect();
+        }
+        m_endpoints.erase(it);
+    }
+
+    std::shared_ptr<SimulatedSession> StartSession(const std::wstring &endpointId, uint32_t processId,
+                                                   const std::wstring &processName, float volume = 1.0f)
+    {
+        auto it = m_endpoints.find(endpointId);
+        if (it == m_endpoints.end())
+            return nullptr;
+
+        m_processes[processId] = processName;
+        auto session = std::make_shared<SimulatedSession>(
+            endpointId + L"|" + std::to_wstring(processId) + L"|" + std::to_wstring(m_nextSession++), processId,
+            volume);
+        it->second.sessions.push_back(session);
+
+        if (it->second.sink)
+            it->second.sink->OnSessionCreated(endpointId, session);
+        return session;
+    }
+
+    // Reports a session again, as for one created while WatchEndpoint enumerated
+    void RepeatNotification(const std::wstring &endpointId, const std::shared_ptr<SimulatedSession> &session)
+    {
+        auto it = m_endpoints.find(endpointId);
+        if (it != m_endpoints.end() && it->second.sink)
+            it->second.sink->OnSessionCreated(endpointId, session);
+    }
+
+    void EndSession(const std::shared_ptr<SimulatedSession> &session)
+    {
+        for (auto &endpoint : m_endpoints)
+        {
+            auto &sessions = endpoint.second.sessions;
+            sessions.erase(std::remove(sessions.begin(), sessions.end(), session), sessions.end());
+        }
+        session->Disconnect();
+    }
+
+    SessionManagerCallCounters counters;
+
+private:
+    struct Endpoint
+    {
+        DataFlow flow = DataFlow::Render;
+        std::vector<std::shared_ptr<SimulatedSession>> sessions;
+        SessionCreatedSink *sink = nullptr;
+    };
+
+    bool m_initialized = false;
+    std::map<std::wstring, Endpoint> m_endpoints;
+    std::map<uint32_t, std::wstring> m_processes;
+    uint32_t m_nextSession = 0;
+};
+
+} // namespace MicVol
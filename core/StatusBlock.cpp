@@ -0,0 +1,212 @@
+#include "StatusBlock.h"
+#include "FileIo.h"
+#include "MicrophoneEnforcer.h"
+#include <cwchar>
+
+namespace MicVol
+{
+
+void SeqLockedStatus::Write(const StatusSnapshot &status)
+{
+    uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const unsigned char *bytes = (const unsigned char *)&status;
+    for (size_t i = 0; i < WordCount; i++)
+    {
+        uint64_t word = 0;
+        size_t offset = i * 8;
+        memcpy(&word, bytes + offset, sizeof(StatusSnapshot) - offset < 8 ? sizeof(StatusSnapshot) - offset : 8);
+        m_words[i].store(word, std::memory_order_relaxed);
+    }
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool SeqLockedStatus::Read(StatusSnapshot &status, int attempts) const
+{
+    unsigned char *bytes = (unsigned char *)&status;
+    for (int attempt = 0; attempt < attempts; attempt++)
+    {
+        uint32_t before = m_sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            continue;
+
+        for (size_t i = 0; i < WordCount; i++)
+        {
+            uint64_t word = m_words[i].load(std::memory_order_relaxed);
+            size_t offset = i * 8;
+            memcpy(bytes + offset, &word, sizeof(StatusSnapshot) - offset < 8 ? sizeof(StatusSnapshot) - offset : 8);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_sequence.load(std::memory_order_relaxed) == before)
+            return true;
+    }
+    return false;
+}
+
+void CaptureStatus(MicrophoneEnforcer &enforcer, uint64_t nowMs, uint64_t wallMs, StatusSnapshot &status)
+{
+    status.magic = StatusMagic;
+    status.version = StatusVersion;
+    status.updatedWallMs = wallMs;
+
+    const EnforcementMetrics &metrics = enforcer.Metrics();
+    status.ticks = metrics.ticks.Value();
+    status.corrections = metrics.corrections.Value();
+    status.tamperEvents = metrics.tamperEvents.Value();
+    status.backendErrors = metrics.backendErrors.Value();
+    status.callTimeouts = metrics.callTimeouts.Value();
+    status.checksDropped = metrics.checksDropped.Value();
+
+    // Between passes of -whenrunning the session is closed and names cannot be read
+    status.deviceCount = 0;
+    status.presentDevices = 0;
+    if (!enforcer.Session().IsOpen())
+        return;
+
+    const std::vector<DeviceHandle> &devices = enforcer.ActiveDevices();
+    status.presentDevices = (uint32_t)devices.size();
+    for (DeviceHandle device : devices)
+    {
+        if (status.deviceCount == MaxStatusDevices)
+            break;
+
+        const DeviceSlot &slot = enforcer.Devices().Slot(device);
+        DeviceStatus &entry = status.devices[status.deviceCount++];
+        const std::wstring &name = enforcer.Session().GetName(device);
+        CopyUtf8(entry.name, sizeof(entry.name), name.c_str(), name.size());
+        entry.volume = slot.lastVolume;
+        entry.targetVolume = slot.targetVolume;
+        entry.lastCorrectionWallMs =
+            slot.corrections > 0 && slot.lastCorrectionMs <= nowMs ? wallMs - (nowMs - slot.lastCorrectionMs) : 0;
+        entry.corrections = slot.corrections;
+        entry.errorCount = slot.errorCount;
+        entry.consecutiveErrors = slot.consecutiveErrors;
+        entry.checkIntervalMs = slot.checkIntervalMs;
+        entry.tamperWars = slot.tamperWars;
+
+        uint64_t nextCheck = enforcer.NextCheckMs(device);
+        entry.nextCheckInMs = nextCheck == TimerWheel::Never ? -1
+                              : nextCheck <= nowMs          ? 0
+                                                            : (int32_t)(nextCheck - nowMs < INT32_MAX ? nextCheck - nowMs : INT32_MAX);
+
+        entry.flags = 0;
+        if (slot.enforced)
+            entry.flags |= DeviceStatusEnforced;
+        if (enforcer.IsWatched(device))
+            entry.flags |= DeviceStatusWatched;
+        if (enforcer.InTamperWar(device))
+            entry.flags |= DeviceStatusFighting;
+        if (enforcer.TamperWars().IsHeld(device, nowMs))
+            entry.flags |= DeviceStatusHeld;
+        if (enforcer.Breakers().IsOpen(device))
+            entry.flags |= DeviceStatusFailing;
+        entry.mute = (uint8_t)slot.mute;
+        entry.lastWriter = (uint8_t)slot.lastWriter;
+        entry.reserved = 0;
+    }
+}
+
+// e.g. "2h 03m 10s", "45s"
+static std::wstring FormatDuration(uint64_t ms)
+{
+    unsigned long long seconds = ms / 1000;
+    unsigned long long tenths = ms % 1000 / 100;
+    wchar_t buffer[64];
+    if (seconds >= 86400)
+        swprintf(buffer, 64, L"%llud %02lluh %02llum", seconds / 86400, seconds / 3600 % 24, seconds / 60 % 60);
+    else if (seconds >= 3600)
+        swprintf(buffer, 64, L"%lluh %02llum %02llus", seconds / 3600, seconds / 60 % 60, seconds % 60);
+    else if (seconds >= 60)
+        swprintf(buffer, 64, L"%llum %02llus", seconds / 60, seconds % 60);
+    else
+        swprintf(buffer, 64, L"%llu.%llus", seconds, tenths);
+    return buffer;
+}
+
+static std::wstring Percent(float level)
+{
+    return level < 0.0f ? L"?" : std::to_wstring((int)(level * 100 + 0.5f)) + L"%";
+}
+
+std::wstring FormatStatus(const StatusSnapshot &status, uint64_t wallMs)
+{
+    static const wchar_t *const StateNames[] = {L"stopped", L"enforcing", L"idle, waiting for a target process",
+                                                L"suspended (paused, asleep or session locked)"};
+    const wchar_t *state = status.state < 4 ? StateNames[status.state] : L"unknown";
+    uint64_t age = wallMs > status.updatedWallMs ? wallMs - status.updatedWallMs : 0;
+
+    std::wstring text = L"Service: " + std::wstring(state) + L" (pid " + std::to_wstring(status.processId) + L")";
+    if (status.state != (uint8_t)ServiceState::Stopped)
+        text += L", up " + FormatDuration(status.updatedWallMs - status.startedWallMs + age);
+    text += L", updated " + FormatDuration(age) + L" ago\n";
+
+    text += L"Mode: ";
+    text += (status.mode & StatusModeAdaptive) ? L"adaptive" : (status.mode & StatusModeEvents) ? L"event-driven" : L"polling";
+    if ((status.mode & StatusModeAdaptive) && (status.mode & StatusModeEvents))
+        text += L" with events";
+    if (status.mode & StatusModeSessions)
+        text += L", application sessions";
+    if (status.mode & StatusModeWhenRunning)
+        text += L", while target processes run";
+    text += status.nextWakeInMs < 0 ? std::wstring(L"; next wake on an event")
+                                    : L"; next wake in " + std::to_wstring(status.nextWakeInMs) + L" ms";
+    text += L"\n";
+
+    text += L"Passes " + std::to_wstring(status.ticks) + L", corrections " + std::to_wstring(status.corrections) +
+            L", tamper events " + std::to_wstring(status.tamperEvents) + L", backend errors " +
+            std::to_wstring(status.backendErrors) + L"\n";
+    if (status.callTimeouts > 0 || status.checksDropped > 0)
+        text += L"Checks timed out " + std::to_wstring(status.callTimeouts) + L", dropped " +
+                std::to_wstring(status.checksDropped) + L" (every worker pool thread stuck)\n";
+
+    if (status.state != (uint8_t)ServiceState::Enforcing)
+        return text;
+    int failing = 0;
+    for (int i = 0; i < status.deviceCount && i < MaxStatusDevices; i++)
+    {
+        if (status.devices[i].flags & DeviceStatusFailing)
+            failing++;
+    }
+    text += L"Devices: " + std::to_wstring(status.presentDevices) + L" present";
+    if (failing > 0)
+        text += L", " + std::to_wstring(failing) + L" failing";
+    text += L"\n";
+    for (int i = 0; i < status.deviceCount && i < MaxStatusDevices; i++)
+    {
+        const DeviceStatus &device = status.devices[i];
+        std::wstring name;
+        AppendWide(name, device.name, strnlen(device.name, sizeof(device.name)));
+
+        if (!(device.flags & DeviceStatusEnforced))
+        {
+            text += L"  " + name + L": not enforced\n";
+            continue;
+        }
+        text += L"  " + name + L": " + Percent(device.volume) + L" (target " + Percent(device.targetVolume) + L")";
+        if (device.flags & DeviceStatusFailing)
+            text += L", failing (circuit open)";
+        if (device.flags & DeviceStatusWatched)
+            text += L", watched";
+        if (device.flags & DeviceStatusFighting)
+            text += (device.flags & DeviceStatusHeld) ? L", volume fight (backing off)" : L", volume fight";
+        text += L", " + std::to_wstring(device.corrections) + L" corrections";
+        if (device.lastCorrectionWallMs != 0 && device.lastCorrectionWallMs <= wallMs)
+            text += L" (last " + FormatDuration(wallMs - device.lastCorrectionWallMs) + L" ago)";
+        if (device.errorCount > 0)
+            text += L", " + std::to_wstring(device.errorCount) + L" errors (" +
+                    std::to_wstring(device.consecutiveErrors) + L" in a row)";
+        if (device.nextCheckInMs >= 0)
+            text += ((device.flags & DeviceStatusFailing) ? L", next probe in " : L", next check in ") +
+                    std::to_wstring(device.nextCheckInMs) + L" ms";
+        text += L"\n";
+    }
+    if (status.presentDevices > status.deviceCount)
+        text += L"  ... " + std::to_wstring(status.presentDevices - status.deviceCount) + L" more\n";
+    return text;
+}
+
+} // namespace MicVol
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace MicVol
+{
+
+class MicrophoneEnforcer;
+
+const uint32_t StatusMagic = 0x5353564D; // "MVSS"
+const uint32_t StatusVersion = 2;
+const int MaxStatusDevices = 32;
+const int StatusNameBytes = 96;
+
+enum class ServiceState : uint8_t
+{
+    Stopped,
+    Enforcing,
+    Idle,     // -whenrunning: waiting for a target process
+    Suspended // Paused, asleep or the console session locked
+};
+
+// StatusSnapshot::mode bits
+const uint8_t StatusModeEvents = 1;
+const uint8_t StatusModeAdaptive = 2;
+const uint8_t StatusModeSessions = 4;
+const uint8_t StatusModeWhenRunning = 8;
+
+// DeviceStatus::flags bits
+const uint8_t DeviceStatusEnforced = 1;
+const uint8_t DeviceStatusWatched = 2;  // Volume change notifications registered
+const uint8_t DeviceStatusFighting = 4; // In a tamper war
+const uint8_t DeviceStatusHeld = 8;     // Tamper war backoff pause
+const uint8_t DeviceStatusFailing = 16; // Circuit breaker open: skipped until its probe succeeds
+
+struct DeviceStatus
+{
+    char name[StatusNameBytes];    // UTF-8, null-terminated, possibly truncated
+    float volume;                  // Last observed level, -1 before the first read
+    float targetVolume;
+    uint64_t lastCorrectionWallMs; // 0 = never corrected
+    uint32_t corrections;
+    uint32_t errorCount;
+    uint32_t consecutiveErrors;
+    uint32_t checkIntervalMs;      // Adaptive schedule
+    uint32_t tamperWars;
+    int32_t nextCheckInMs;         // Relative to updatedWallMs, -1 = not scheduled
+    uint8_t flags;
+    uint8_t mute;                  // MutePolicy
+    uint8_t lastWriter;            // WriterKind
+    uint8_t reserved;
+};
+
+// What -status prints. Plain data of fixed size, so it can be copied in and out of
+// shared memory as words. Times are wall clock milliseconds since the Unix epoch.
+struct StatusSnapshot
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t processId;
+    uint8_t state;                 // ServiceState
+    uint8_t mode;                  // StatusMode* bits
+    uint16_t deviceCount;          // Entries used in devices
+    uint64_t startedWallMs;
+    uint64_t updatedWallMs;
+    int64_t nextWakeInMs;          // Until the worker wakes up on its own, -1 = only on an event
+    uint64_t ticks;
+    uint64_t corrections;
+    uint64_t tamperEvents;
+    uint64_t backendErrors;
+    uint64_t callTimeouts;
+    uint64_t checksDropped;        // Every worker pool thread was stuck
+    uint32_t presentDevices;       // May exceed MaxStatusDevices
+    uint32_t reserved;
+    DeviceStatus devices[MaxStatusDevices];
+};
+
+static_assert(std::is_trivially_copyable<StatusSnapshot>::value, "status is copied as raw words");
+
+// Single-writer seqlock around a StatusSnapshot, laid out to live in shared memory
+// (zero-filled memory is a valid empty block). The writer never waits: it makes the
+// sequence odd, stores the words and makes it even again. A reader copies the words
+// and retries if the sequence was odd or changed meanwhile, so it never blocks the
+// writer and never returns a torn snapshot. The words are relaxed atomics, which
+// makes concurrent access well-defined while compiling to plain moves.
+class SeqLockedStatus
+{
+public:
+    static const size_t WordCount = (sizeof(StatusSnapshot) + 7) / 8;
+
+    void Write(const StatusSnapshot &status);
+
+    // False if the writer was mid-update on every attempt
+    bool Read(StatusSnapshot &status, int attempts = 1000) const;
+
+    uint32_t Sequence() const { return m_sequence.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<uint32_t> m_sequence;
+    uint32_t m_reserved;
+    std::atomic<uint64_t> m_words[WordCount];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory needs address-free atomics");
+
+// Fills the device list and counters from the enforcer; the caller sets the service
+// fields (state, mode, processId, startedWallMs, nextWakeInMs). nowMs is the clock of
+// the enforcer, wallMs the matching wall clock time. Lists no devices while the session
+// is closed. Does not allocate once the device names are cached.
+void CaptureStatus(MicrophoneEnforcer &enforcer, uint64_t nowMs, uint64_t wallMs, StatusSnapshot &status);
+
+// Human-readable report of a snapshot, as printed by -status
+std::wstring FormatStatus(const StatusSnapshot &status, uint64_t wallMs);
+
+} // namespace MicVol
@@ -0,0 +1,75 @@
+#include "Suspension.h"
+
+namespace MicVol
+{
+
+void SuspendController::Post(ControlEvent event)
+{
+    switch (event)
+    {
+    case ControlEvent::Pause:
+        m_raised.fetch_or(SuspendPaused);
+        m_requested.fetch_or(SuspendPaused);
+        break;
+    case ControlEvent::Continue:
+        m_requested.fetch_and(~SuspendPaused);
+        break;
+    case ControlEvent::PowerSuspend:
+        m_raised.fetch_or(SuspendSleeping);
+        m_requested.fetch_or(SuspendSleeping);
+        break;
+    case ControlEvent::PowerResume:
+        m_requested.fetch_and(~SuspendSleeping);
+        break;
+    case ControlEvent::SessionLock:
+        m_raised.fetch_or(SuspendLocked);
+        m_requested.fetch_or(SuspendLocked);
+        break;
+    case ControlEvent::SessionUnlock:
+        m_requested.fetch_and(~SuspendLocked);
+        break;
+    }
+
+    if (m_wake)
+        m_wake();
+}
+
+SuspendChange SuspendController::Update(uint64_t nowMs)
+{
+    uint32_t raised = m_raised.exchange(0);
+    uint32_t requested = m_requested.load();
+    uint32_t previous = m_applied;
+    m_applied = requested;
+
+    if (previous == 0 && requested != 0)
+    {
+        m_sinceMs = nowMs;
+        return SuspendChange::Suspended;
+    }
+    if (previous != 0 && requested == 0)
+    {
+        m_lastDurationMs = nowMs - m_sinceMs;
+        return SuspendChange::Resumed;
+    }
+    if (previous == 0 && raised != 0)
+    {
+        m_lastDurationMs = 0;
+        return SuspendChange::Resumed;
+    }
+    return SuspendChange::None;
+}
+
+const wchar_t *SuspendReasonsName(uint32_t reasons)
+{
+    static const wchar_t *const Names[] = {L"none",
+                                           L"pause",
+                                           L"sleep",
+                                           L"pause, sleep",
+                                           L"session lock",
+                                           L"pause, session lock",
+                                           L"sleep, session lock",
+                                           L"pause, sleep, session lock"};
+    return Names[reasons & 7];
+}
+
+} // namespace MicVol
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+namespace MicVol
+{
+
+// Service controls and system notifications that suspend or resume enforcement
+enum class ControlEvent
+{
+    Pause,         // SERVICE_CONTROL_PAUSE
+    Continue,      // SERVICE_CONTROL_CONTINUE
+    PowerSuspend,  // PBT_APMSUSPEND
+    PowerResume,   // PBT_APMRESUMEAUTOMATIC or PBT_APMRESUMESUSPEND
+    SessionLock,   // WTS_SESSION_LOCK of the console session
+    SessionUnlock  // WTS_SESSION_UNLOCK of the console session
+};
+
+// Why enforcement is suspended (bits); each reason is lifted by its own event
+const uint32_t SuspendPaused = 1;
+const uint32_t SuspendSleeping = 2;
+const uint32_t SuspendLocked = 4;
+
+enum class SuspendChange
+{
+    None,
+    Suspended, // The first reason appeared: stop checking and scheduling
+    Resumed    // The last reason went away: re-sync every device once
+};
+
+// Tracks the suspend reasons reported by the service control handler.
+//
+// Post() may be called on any thread; it updates the requested reasons with atomic
+// bit operations and calls the wake function. The worker calls Update() when woken
+// and acts on the change. A suspension the worker slept through entirely (e.g. a
+// sleep and resume between two of its waits) still reports Resumed, since devices
+// come back from sleep at odd levels.
+class SuspendController
+{
+public:
+    explicit SuspendController(std::function<void()> wake = nullptr) : m_wake(std::move(wake)) {}
+
+    SuspendController(const SuspendController &) = delete;
+    SuspendController &operator=(const SuspendController &) = delete;
+
+    // Any thread
+    void Post(ControlEvent event);
+
+    // Worker thread
+    SuspendChange Update(uint64_t nowMs);
+    bool IsSuspended() const { return m_applied != 0; }
+    uint32_t Reasons() const { return m_applied; }
+
+    // After Suspended: when it began; after Resumed: how long it lasted (0 if never applied)
+    uint64_t SuspendedSinceMs() const { return m_sinceMs; }
+    uint64_t LastSuspendedMs() const { return m_lastDurationMs; }
+
+private:
+    std::function<void()> m_wake;
+    std::atomic<uint32_t> m_requested{0};
+    std::atomic<uint32_t> m_raised{0}; // Every reason set since the last Update()
+    uint32_t m_applied = 0;
+    uint64_t m_sinceMs = 0;
+    uint64_t m_lastDurationMs = 0;
+};
+
+// "pause, sleep", for logs
+const wchar_t *SuspendReasonsName(uint32_t reasons);
+
+} // namespace MicVol
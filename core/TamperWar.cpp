@@ -0,0 +1,105 @@
+#include "TamperWar.h"
+
+namespace MicVol
+{
+
+void TamperWarDetector::SetOptions(const TamperWarOptions &options)
+{
+    m_options = options;
+    if (m_options.cycles < 2)
+        m_options.cycles = 2;
+    if (m_options.verifyIntervalMs < 1)
+        m_options.verifyIntervalMs = 1;
+    if (m_options.backoffMs < 1)
+        m_options.backoffMs = 1;
+    if (m_options.maxBackoffMs < m_options.backoffMs)
+        m_options.maxBackoffMs = m_options.backoffMs;
+    m_states.clear();
+}
+
+TamperWarState &TamperWarDetector::Get(DeviceHandle device)
+{
+    if (device >= m_states.size())
+        m_states.resize(device + 1);
+    return m_states[device];
+}
+
+FightChange TamperWarDetector::OnCorrected(DeviceHandle device, uint64_t nowMs)
+{
+    if (!Enabled())
+        return FightChange::None;
+
+    TamperWarState &state = Get(device);
+    bool inWindow = state.streak > 0 && nowMs - state.lastCorrectionMs <= m_options.windowMs;
+    state.streak = inWindow ? state.streak + 1 : 1;
+    state.lastCorrectionMs = nowMs;
+
+    FightChange change = FightChange::None;
+    if (state.fighting)
+    {
+        // Every correction during a fight is another round, however long the pause before it
+        state.cycles++;
+        uint64_t doubled = (uint64_t)state.backoffMs * 2;
+        state.backoffMs = (uint32_t)(doubled < m_options.maxBackoffMs ? doubled : m_options.maxBackoffMs);
+    }
+    else if (state.streak >= m_options.cycles)
+    {
+        state.fighting = true;
+        state.startedMs = nowMs;
+        state.cycles = state.streak;
+        state.backoffMs = m_options.backoffMs;
+        change = FightChange::Started;
+    }
+    else
+    {
+        return FightChange::None;
+    }
+
+    if (m_options.strategy == FightStrategy::Verify)
+    {
+        state.verifyLeft = m_options.verifyChecks;
+        state.holdUntilMs = 0;
+        state.nextCheckMs = nowMs + (state.verifyLeft > 0 ? m_options.verifyIntervalMs : m_options.quietMs);
+    }
+    else
+    {
+        state.holdUntilMs = nowMs + state.backoffMs;
+        state.nextCheckMs = state.holdUntilMs;
+    }
+    return change;
+}
+
+FightChange TamperWarDetector::OnAtTarget(DeviceHandle device, uint64_t nowMs)
+{
+    if (!IsFighting(device))
+        return FightChange::None;
+
+    TamperWarState &state = m_states[device];
+    uint64_t quietUntil = state.lastCorrectionMs + m_options.quietMs;
+    if (nowMs >= quietUntil)
+    {
+        state.fighting = false;
+        state.streak = 0;
+        state.verifyLeft = 0;
+        state.holdUntilMs = 0;
+        return FightChange::Ended;
+    }
+
+    if (state.verifyLeft > 0)
+        state.verifyLeft--;
+    state.nextCheckMs = state.verifyLeft > 0 ? nowMs + m_options.verifyIntervalMs : quietUntil;
+    return FightChange::None;
+}
+
+uint64_t TamperWarDetector::NextCheckMs(DeviceHandle device) const
+{
+    return IsFighting(device) ? m_states[device].nextCheckMs : UINT64_MAX;
+}
+
+void TamperWarDetector::Forget(DeviceHandle device)
+{
+    if (device < m_states.size())
+        m_states[device] = TamperWarState();
+}
+
+} // namespace MicVol
@@ -0,0 +1,91 @@
+#pragma once
+#include "DeviceTable.h"
+#include <cstdint>
+#include <vector>
+
+namespace MicVol
+{
+
+// What the enforcer does once another application keeps re-applying its level
+enum class FightStrategy : uint8_t
+{
+    Off,     // No detection; every round is corrected and logged like any other
+    Verify,  // Correct at once, then re-check a few times at a short interval to catch the next round early
+    Backoff  // Correct, then leave the device alone for a pause that doubles every round
+};
+
+struct TamperWarOptions
+{
+    FightStrategy strategy = FightStrategy::Off;
+    uint32_t cycles = 4;             // Corrections in a row, each within windowMs of the previous, that make a fight
+    uint32_t windowMs = 5000;
+    uint32_t quietMs = 10000;        // The fight is over once a check finds the level held this long after a correction
+    uint32_t verifyChecks = 5;       // Verify: checks after each correction, verifyIntervalMs apart
+    uint32_t verifyIntervalMs = 100;
+    uint32_t backoffMs = 1000;       // Backoff: first pause, doubled every round up to maxBackoffMs
+    uint32_t maxBackoffMs = 30000;
+};
+
+// Tamper war state of one device
+struct TamperWarState
+{
+    uint64_t lastCorrectionMs = 0;
+    uint32_t streak = 0;       // Corrections in a row within windowMs of each other
+    bool fighting = false;
+    uint64_t startedMs = 0;    // Of the current or last fight
+    uint32_t cycles = 0;       // Rounds of the current or last fight
+    uint32_t verifyLeft = 0;   // Verify: checks left in the burst
+    uint32_t backoffMs = 0;    // Backoff: current pause
+    uint64_t holdUntilMs = 0;  // Backoff: no check or correction before this
+    uint64_t nextCheckMs = 0;  // Check the fight asks for; meaningless while not fighting
+};
+
+enum class FightChange
+{
+    None,
+    Started,
+    Ended
+};
+
+// Recognizes tamper wars (another application re-applying its level right after
+// every correction) from the corrections of each device and decides, per the
+// strategy, when the device must be checked next. Pure bookkeeping: the clock
+// is passed in and all calls come from the worker thread.
+class TamperWarDetector
+{
+public:
+    void SetOptions(const TamperWarOptions &options);
+    const TamperWarOptions &Options() const { return m_options; }
+    bool Enabled() const { return m_options.strategy != FightStrategy::Off; }
+
+    // A correction was made; Started when it turns the corrections of the device into a fight
+    FightChange OnCorrected(DeviceHandle device, uint64_t nowMs);
+
+    // A check found the device at its target; Ended once it held for quietMs
+    FightChange OnAtTarget(DeviceHandle device, uint64_t nowMs);
+
+    bool IsFighting(DeviceHandle device) const { return device < m_states.size() && m_states[device].fighting; }
+
+    // Backoff: the device is not to be checked or corrected before its pause is over
+    bool IsHeld(DeviceHandle device, uint64_t nowMs) const
+    {
+        return IsFighting(device) && nowMs < m_states[device].holdUntilMs;
+    }
+
+    // Clock time of the check the fight asks for, Never (UINT64_MAX) while not fighting
+    uint64_t NextCheckMs(DeviceHandle device) const;
+
+    const TamperWarState &State(DeviceHandle device) { return Get(device); }
+
+    // The device went away or its policy changed; an ongoing fight ends without a report
+    void Forget(DeviceHandle device);
+    void Reset() { m_states.clear(); }
+
+private:
+    TamperWarState &Get(DeviceHandle device);
+
+    TamperWarOptions m_options;
+    std::vector<TamperWarState> m_states; // Indexed by DeviceHandle
+};
+
+} // namespace MicVol
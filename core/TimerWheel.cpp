@@ -0,0 +1,146 @@
+#include "TimerWheel.h"
+
+namespace MicVol
+{
+
+TimerWheel::TimerWheel(uint64_t resolutionMs, uint32_t slotCount)
+    : m_resolutionMs(resolutionMs > 0 ? resolutionMs : 1), m_slotCount(slotCount > 0 ? slotCount : 1),
+      m_heads(m_slotCount, InvalidId)
+{
+}
+
+void TimerWheel::Schedule(uint32_t id, uint64_t dueMs)
+{
+    if (id == InvalidId || dueMs == Never)
+        return;
+
+    if (id >= m_dueMs.size())
+    {
+        m_dueMs.resize(id + 1, Never);
+        m_tick.resize(id + 1, 0);
+        m_next.resize(id + 1, InvalidId);
+        m_prev.resize(id + 1, InvalidId);
+    }
+
+    if (IsScheduled(id))
+        Unlink(id);
+
+    uint64_t tick = dueMs / m_resolutionMs;
+    if (tick < m_currentTick)
+        tick = m_currentTick;
+
+    m_dueMs[id] = dueMs;
+    Link(id, tick);
+}
+
+void TimerWheel::Cancel(uint32_t id)
+{
+    if (IsScheduled(id))
+        Unlink(id);
+}
+
+void TimerWheel::Clear()
+{
+    for (uint32_t &head : m_heads)
+        head = InvalidId;
+    for (uint64_t &due : m_dueMs)
+        due = Never;
+    m_size = 0;
+}
+
+void TimerWheel::Link(uint32_t id, uint64_t tick)
+{
+    uint32_t slot = (uint32_t)(tick % m_slotCount);
+    m_tick[id] = tick;
+    m_prev[id] = InvalidId;
+    m_next[id] = m_heads[slot];
+    if (m_heads[slot] != InvalidId)
+        m_prev[m_heads[slot]] = id;
+    m_heads[slot] = id;
+    m_size++;
+}
+
+void TimerWheel::Unlink(uint32_t id)
+{
+    uint32_t slot = (uint32_t)(m_tick[id] % m_slotCount);
+    if (m_prev[id] != InvalidId)
+        m_next[m_prev[id]] = m_next[id];
+    else
+        m_heads[slot] = m_next[id];
+    if (m_next[id] != InvalidId)
+        m_prev[m_next[id]] = m_prev[id];
+
+    m_dueMs[id] = Never;
+    m_next[id] = InvalidId;
+    m_prev[id] = InvalidId;
+    m_size--;
+}
+
+size_t TimerWheel::PopSlot(uint32_t slot, uint64_t nowMs, std::vector<uint32_t> &due)
+{
+    size_t popped = 0;
+    uint32_t id = m_heads[slot];
+    while (id != InvalidId)
+    {
+        uint32_t next = m_next[id];
+        if (m_dueMs[id] <= nowMs)
+        {
+            Unlink(id);
+            due.push_back(id);
+            popped++;
+        }
+        id = next;
+    }
+    return popped;
+}
+
+size_t TimerWheel::PopDue(uint64_t nowMs, std::vector<uint32_t> &due)
+{
+    uint64_t nowTick = nowMs / m_resolutionMs;
+    if (nowTick < m_currentTick)
+        nowTick = m_currentTick;
+
+    size_t popped = 0;
+    if (m_size > 0)
+    {
+        // After a long gap one pass over every slot covers every tick in between
+        uint64_t ticks = nowTick - m_currentTick + 1;
+        if (ticks > m_slotCount)
+            ticks = m_slotCount;
+
+        for (uint64_t i = 0; i < ticks && m_size > 0; i++)
+        {
+            popped += PopSlot((uint32_t)((m_currentTick + i) % m_slotCount), nowMs, due);
+        }
+    }
+
+    m_currentTick = nowTick;
+    return popped;
+}
+
+uint64_t TimerWheel::NextDueMs() const
+{
+    if (m_size == 0)
+        return Never;
+
+    // The first slot holding a deadline for its own revolution has the earliest one;
+    // if every deadline is more than a revolution away, take the minimum over all
+    uint64_t earliest = Never;
+    for (uint32_t i = 0; i < m_slotCount; i++)
+    {
+        uint64_t tick = m_currentTick + i;
+        uint64_t slotEarliest = Never;
+        for (uint32_t id = m_heads[tick % m_slotCount]; id != InvalidId; id = m_next[id])
+        {
+            if (m_tick[id] == tick && m_dueMs[id] < slotEarliest)
+                slotEarliest = m_dueMs[id];
+            if (m_dueMs[id] < earliest)
+                earliest = m_dueMs[id];
+        }
+        if (slotEarliest != Never)
+            return slotEarliest;
+    }
+    return earliest;
+}
+
+} // namespace MicVol
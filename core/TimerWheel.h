@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MicVol
+{
+
+// Hashed timer wheel for per-device deadlines, keyed by a dense ID (DeviceHandle).
+//
+// Every ID has at most one deadline. Slots cover resolutionMs each; a deadline
+// more than one revolution away stays in its slot until the wheel comes around
+// to it again. Entries are linked through arrays indexed by ID, so scheduling,
+// cancelling and popping do not allocate once the ID range has been seen.
+class TimerWheel
+{
+public:
+    static constexpr uint32_t InvalidId = 0xFFFFFFFFu;
+    static constexpr uint64_t Never = UINT64_MAX;
+
+    explicit TimerWheel(uint64_t resolutionMs = 10, uint32_t slotCount = 1024);
+
+    // Replaces any deadline the ID already has; deadlines in the past are due on the next PopDue()
+    void Schedule(uint32_t id, uint64_t dueMs);
+    void Cancel(uint32_t id);
+    void Clear();
+
+    bool IsScheduled(uint32_t id) const { return id < m_dueMs.size() && m_dueMs[id] != Never; }
+    uint64_t DueMs(uint32_t id) const { return id < m_dueMs.size() ? m_dueMs[id] : Never; }
+    size_t Size() const { return m_size; }
+
+    // Removes every ID due at or before nowMs and appends it to due. Returns the number appended.
+    size_t PopDue(uint64_t nowMs, std::vector<uint32_t> &due);
+
+    // Earliest deadline, Never when empty
+    uint64_t NextDueMs() const;
+
+private:
+    void Link(uint32_t id, uint64_t tick);
+    void Unlink(uint32_t id);
+    size_t PopSlot(uint32_t slot, uint64_t nowMs, std::vector<uint32_t> &due);
+
+    uint64_t m_resolutionMs;
+    uint32_t m_slotCount;
+    uint64_t m_currentTick = 0; // Every deadline before this tick has been popped
+    size_t m_size = 0;
+    std::vector<uint32_t> m_heads; // First ID per slot
+
+    // Indexed by ID
+    std::vector<uint64_t> m_dueMs;
+    std::vector<uint64_t> m_tick;
+    std::vector<uint32_t> m_next;
+    std::vector<uint32_t> m_prev;
+};
+
+} // namespace MicVol
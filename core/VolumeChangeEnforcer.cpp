@@ -0,0 +1,208 @@
+#include "VolumeChangeEnforcer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace MicVol
+{
+
+class VolumeChangeEnforcer::Watch : public VolumeListener
+{
+public:
+    Watch(VolumeChangeEnforcer *owner, std::shared_ptr<VolumeEndpoint> endpoint,
+          float targetVolume, float tolerance, MutePolicy mute)
+        : owner(owner), endpoint(std::move(endpoint)), targetVolume(targetVolume), tolerance(tolerance), mute(mute)
+    {
+    }
+
+    void OnVolumeNotification(const VolumeNotification &notification) override
+    {
+        // Our own corrections come back here too, tagged with our event context. A
+        // correction of the level alone would land in band, but one of two pending
+        // corrections does not while the other is still outstanding.
+        WriterKind kind = ClassifyWriter(notification.eventContext);
+        if (kind == WriterKind::Service)
+        {
+            owner->m_ownNotifications++;
+            return;
+        }
+        if (std::fabs(notification.masterVolume - targetVolume) <= tolerance &&
+            (mute == MutePolicy::Leave || notification.muted == (mute == MutePolicy::Mute)))
+            return;
+
+        owner->m_tamperNotifications++;
+        if (owner->m_metrics)
+            owner->m_metrics->tamperEvents.Add();
+        writer = (uint8_t)kind;
+        // The first change since the last correction starts the time to correct
+        uint64_t unflagged = 0;
+        flaggedUs.compare_exchange_strong(unflagged, MonotonicUs());
+        if (!pending.exchange(true))
+        {
+            owner->OnWatchFlagged();
+        }
+    }
+
+    VolumeChangeEnforcer *owner;
+    std::shared_ptr<VolumeEndpoint> endpoint;
+    float targetVolume;
+    float tolerance;
+    MutePolicy mute;
+    std::atomic<bool> pending{false};
+    std::atomic<uint8_t> writer{(uint8_t)WriterKind::Unknown}; // Of the latest foreign change
+    std::atomic<uint64_t> flaggedUs{0};                        // Of the first foreign change still pending
+    bool held = false; // Worker thread only
+};
+
+VolumeChangeEnforcer::VolumeChangeEnforcer(std::function<void()> wake, EnforcementMetrics *metrics)
+    : m_wake(std::move(wake)), m_metrics(metrics)
+{
+}
+
+VolumeChangeEnforcer::~VolumeChangeEnforcer()
+{
+    DetachAll();
+}
+
+HRESULT VolumeChangeEnforcer::Attach(DeviceHandle device, std::shared_ptr<VolumeEndpoint> endpoint,
+                                     float targetVolume, float tolerance, MutePolicy mute)
+{
+    if (!endpoint)
+        return E_POINTER;
+
+    Detach(device);
+
+    std::unique_ptr<Watch> watch(new Watch(this, std::move(endpoint), targetVolume, tolerance, mute));
+    HRESULT hr = watch->endpoint->RegisterListener(watch.get());
+    if (FAILED(hr))
+        return hr;
+
+    // The level may already be wrong; treat attach as a notification so it gets checked
+    watch->pending = true;
+    if (device >= m_watches.size())
+        m_watches.resize(device + 1);
+    m_watches[device] = std::move(watch);
+    m_attached++;
+    OnWatchFlagged();
+    return S_OK;
+}
+
+void VolumeChangeEnforcer::Detach(DeviceHandle device)
+{
+    if (!IsAttached(device))
+        return;
+
+    m_watches[device]->endpoint->UnregisterListener(m_watches[device].get());
+    m_watches[device].reset();
+    m_attached--;
+}
+
+void VolumeChangeEnforcer::DetachAll()
+{
+    for (DeviceHandle device = 0; device < (DeviceHandle)m_watches.size(); device++)
+    {
+        Detach(device);
+    }
+}
+
+void VolumeChangeEnforcer::DetachMissing(const std::vector<DeviceHandle> &activeDevices)
+{
+    for (DeviceHandle device = 0; device < (DeviceHandle)m_watches.size(); device++)
+    {
+        if (m_watches[device] && std::find(activeDevices.begin(), activeDevices.end(), device) == activeDevices.end())
+            Detach(device);
+    }
+}
+
+void VolumeChangeEnforcer::Hold(DeviceHandle device)
+{
+    if (IsAttached(device))
+        m_watches[device]->held = true;
+}
+
+bool VolumeChangeEnforcer::IsHeld(DeviceHandle device) const
+{
+    return IsAttached(device) && m_watches[device]->held;
+}
+
+void VolumeChangeEnforcer::Resume(DeviceHandle device)
+{
+    if (!IsHeld(device))
+        return;
+    m_watches[device]->held = false;
+    m_watches[device]->pending = false;
+    m_watches[device]->flaggedUs = 0;
+}
+
+size_t VolumeChangeEnforcer::ProcessPending(std::vector<VolumeCorrection> &corrections)
+{
+    size_t writes = 0;
+    Histogram *callLatency = m_metrics ? &m_metrics->backendCall : nullptr;
+
+    for (DeviceHandle device = 0; device < (DeviceHandle)m_watches.size(); device++)
+    {
+        if (!m_watches[device])
+            continue;
+
+        Watch &watch = *m_watches[device];
+        if (watch.held || !watch.pending.exchange(false))
+            continue;
+        WriterKind writer = (WriterKind)watch.writer.exchange((uint8_t)WriterKind::Unknown);
+        uint64_t flaggedUs = watch.flaggedUs.exchange(0);
+
+        // Re-read: the notification may be stale if the level was restored meanwhile
+        float currentVolume = -1.0f;
+        HRESULT hr;
+        {
+            ScopedLatency latency(callLatency);
+            hr = watch.endpoint->GetMasterVolume(&currentVolume);
+        }
+        if (FAILED(hr))
+        {
+            corrections.push_back({device, -1.0f, watch.targetVolume, hr, false, writer, flaggedUs});
+            continue;
+        }
+
+        if (std::fabs(currentVolume - watch.targetVolume) > watch.tolerance)
+        {
+            {
+                ScopedLatency latency(callLatency);
+                hr = watch.endpoint->SetMasterVolume(watch.targetVolume);
+            }
+            writes++;
+            corrections.push_back({device, currentVolume, watch.targetVolume, hr, false, writer, flaggedUs});
+        }
+
+        if (watch.mute == MutePolicy::Leave)
+            continue;
+
+        bool wanted = watch.mute == MutePolicy::Mute;
+        bool muted = false;
+        {
+            ScopedLatency latency(callLatency);
+            hr = watch.endpoint->GetMute(&muted);
+        }
+        if (FAILED(hr))
+        {
+            corrections.push_back({device, -1.0f, wanted ? 1.0f : 0.0f, hr, true, writer, flaggedUs});
+        }
+        else if (muted != wanted)
+        {
+            {
+                ScopedLatency latency(callLatency);
+                hr = watch.endpoint->SetMute(wanted);
+            }
+            writes++;
+            corrections.push_back({device, muted ? 1.0f : 0.0f, wanted ? 1.0f : 0.0f, hr, true, writer, flaggedUs});
+        }
+    }
+
+    return writes;
+}
+
+void VolumeChangeEnforcer::OnWatchFlagged()
+{
+    if (m_wake)
+        m_wake();
+}
+
+} // namespace MicVol
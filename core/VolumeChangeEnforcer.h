@@ -0,0 +1,86 @@
+#pragma once
+#include "DeviceTable.h"
+#include "Metrics.h"
+#include "VolumeEndpoint.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace MicVol
+{
+
+// Result of one event-driven correction
+struct VolumeCorrection
+{
+    DeviceHandle device;
+    float observedVolume;
+    float targetVolume;
+    HRESULT hr;
+    bool mute = false; // Correction of the mute state: the volumes are 1 for muted, 0 for unmuted
+    WriterKind writer = WriterKind::Unknown; // Who made the change; Unknown for the check after Attach
+    uint64_t flaggedUs = 0; // MonotonicUs() of the notification that asked for it; 0 for the check after Attach
+};
+
+// Event-driven enforcement: listens for volume changes on every attached endpoint
+// and corrects the level as soon as it leaves the tolerance band, and the mute state
+// as soon as it differs from the mute policy. Notifications of our own writes are
+// recognized by their event context and dropped.
+//
+// Notifications only flag the endpoint and call the wake function; the actual
+// correction runs on the worker thread in ProcessPending(), because the audio stack
+// does not allow calling back into the endpoint from inside the notification.
+// Attach/Detach/ProcessPending must all be called from the same (worker) thread.
+//
+// With metrics, foreign changes count as tamper events and every endpoint call of
+// ProcessPending() is timed as a backend call.
+class VolumeChangeEnforcer
+{
+public:
+    explicit VolumeChangeEnforcer(std::function<void()> wake, EnforcementMetrics *metrics = nullptr);
+    ~VolumeChangeEnforcer();
+
+    VolumeChangeEnforcer(const VolumeChangeEnforcer &) = delete;
+    VolumeChangeEnforcer &operator=(const VolumeChangeEnforcer &) = delete;
+
+    // Shares the endpoint (usually with the AudioSession cache) and registers for its notifications
+    HRESULT Attach(DeviceHandle device, std::shared_ptr<VolumeEndpoint> endpoint,
+                   float targetVolume, float tolerance, MutePolicy mute = MutePolicy::Leave);
+    void Detach(DeviceHandle device);
+    void DetachAll();
+
+    bool IsAttached(DeviceHandle device) const { return device < m_watches.size() && m_watches[device]; }
+    size_t AttachedCount() const { return m_attached; }
+
+    // Detaches every endpoint not in activeDevices (device removed or filtered out)
+    void DetachMissing(const std::vector<DeviceHandle> &activeDevices);
+
+    // While held, notifications still flag the endpoint (waking the worker once) but
+    // ProcessPending() leaves it alone. Resume() drops the flag: the caller checks the
+    // endpoint itself right after. Resume() of an endpoint not held does nothing.
+    void Hold(DeviceHandle device);
+    void Resume(DeviceHandle device);
+    bool IsHeld(DeviceHandle device) const;
+
+    // Corrects every endpoint flagged since the last call. Returns the number of writes issued.
+    size_t ProcessPending(std::vector<VolumeCorrection> &corrections);
+
+    // Number of notifications that asked for a correction (for diagnostics and tests)
+    unsigned long long TamperNotifications() const { return m_tamperNotifications.load(); }
+    // Number of notifications caused by our own writes
+    unsigned long long OwnNotifications() const { return m_ownNotifications.load(); }
+
+private:
+    class Watch;
+
+    void OnWatchFlagged();
+
+    std::function<void()> m_wake;
+    EnforcementMetrics *m_metrics;
+    std::vector<std::unique_ptr<Watch>> m_watches; // Indexed by DeviceHandle
+    size_t m_attached = 0;
+    std::atomic<unsigned long long> m_tamperNotifications{0};
+    std::atomic<unsigned long long> m_ownNotifications{0};
+};
+
+} // namespace MicVol
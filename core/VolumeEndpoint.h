@@ -0,0 +1,80 @@
+#pragma once
+#include "Platform.h"
+#include <cstdint>
+
+namespace MicVol
+{
+
+// Event context of every volume and mute write the service makes. The audio stack hands
+// it back in the change notifications, which tells our own writes from foreign ones.
+// {6D1F3A52-8C4E-4B7A-9E21-5F3C7A90D418}
+inline const GUID ServiceEventContext = {0x6d1f3a52, 0x8c4e, 0x4b7a, {0x9e, 0x21, 0x5f, 0x3c, 0x7a, 0x90, 0xd4, 0x18}};
+
+// Who made a volume change, judged by its event context
+enum class WriterKind : uint8_t
+{
+    Unknown = 0,  // Not caused by a notification (first check, sweep)
+    Service,      // Our own write
+    Unidentified, // No event context: Sound settings, volume keys and most applications
+    Application   // A foreign context, e.g. the volume mixer or an application tagging its writes
+};
+
+inline WriterKind ClassifyWriter(const GUID &eventContext)
+{
+    static const GUID none = {};
+    if (eventContext == ServiceEventContext)
+        return WriterKind::Service;
+    return eventContext == none ? WriterKind::Unidentified : WriterKind::Application;
+}
+
+inline const wchar_t *WriterKindName(WriterKind writer)
+{
+    switch (writer)
+    {
+    case WriterKind::Service:
+        return L"service";
+    case WriterKind::Unidentified:
+        return L"unidentified writer";
+    case WriterKind::Application:
+        return L"application";
+    default:
+        return L"unknown";
+    }
+}
+
+// Payload of a master volume change notification (mirrors AUDIO_VOLUME_NOTIFICATION_DATA)
+struct VolumeNotification
+{
+    float masterVolume;
+    bool muted;
+    GUID eventContext; // All zero when the writer passed none
+};
+
+// Receives volume change notifications for one endpoint.
+// Called on the notifying thread (a COM worker thread on Windows), so implementations
+// must return quickly and must not call back into the endpoint.
+class VolumeListener
+{
+public:
+    virtual ~VolumeListener() = default;
+    virtual void OnVolumeNotification(const VolumeNotification &notification) = 0;
+};
+
+// Master volume and mute control of a single audio endpoint (IAudioEndpointVolume on Windows).
+// Implementations pass ServiceEventContext with every write.
+class VolumeEndpoint
+{
+public:
+    virtual ~VolumeEndpoint() = default;
+
+    virtual HRESULT GetMasterVolume(float *level) = 0;
+    virtual HRESULT SetMasterVolume(float level) = 0;
+    virtual HRESULT GetMute(bool *muted) = 0;
+    virtual HRESULT SetMute(bool muted) = 0;
+
+    // After UnregisterListener returns no further notifications are delivered to the listener
+    virtual HRESULT RegisterListener(VolumeListener *listener) = 0;
+    virtual HRESULT UnregisterListener(VolumeListener *listener) = 0;
+};
+
+} // namespace MicVol
@@ -0,0 +1,343 @@
+#include "WorkerPool.h"
+#include <chrono>
+#include <system_error>
+
+namespace MicVol
+{
+
+struct alignas(64) WorkerPoolShard
+{
+    std::mutex mutex;
+    std::vector<uint32_t> keys; // Reused from batch to batch
+    size_t head = 0;            // Next task the owner runs
+    size_t tail = 0;            // One past the task a thief takes next
+};
+
+struct WorkerPoolThread
+{
+    bool running = false;   // In a task
+    bool abandoned = false; // The task overran its deadline and no longer counts
+    uint64_t startedUs = 0;
+    uint64_t incarnation = 0; // Threads that ran the shard; a replaced one exits after its task
+};
+
+struct WorkerPool::State
+{
+    std::function<void()> threadStart;
+    std::function<void()> threadStop;
+
+    std::mutex mutex;
+    std::condition_variable wake;     // A batch was posted or the pool stops
+    std::condition_variable progress; // A task started or finished
+    uint64_t epoch = 0;               // Start() calls; threads of an earlier one exit
+    uint64_t generation = 0;          // Batches posted
+    bool stopping = false;
+
+    // Replaced by Start(), under the mutex, once no thread of the earlier epoch touches them
+    std::unique_ptr<WorkerPoolShard[]> shards;
+    std::vector<WorkerPoolThread> threads; // By shard
+    size_t shardCount = 0;
+    size_t spares = 0;  // Replaced threads allowed to be stuck at once
+    size_t retired = 0; // Replaced threads still in their task
+
+    std::shared_ptr<const WorkerPool::Task> task; // Of the current batch
+    size_t remaining = 0; // Tasks of the current batch not finished, abandoned or dropped
+
+    Counter steals;
+    Counter abandoned;
+    Counter replaced;
+};
+
+static uint64_t NowUs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+WorkerPool::WorkerPool(std::function<void()> threadStart, std::function<void()> threadStop)
+    : m_state(std::make_shared<State>())
+{
+    m_state->threadStart = std::move(threadStart);
+    m_state->threadStop = std::move(threadStop);
+}
+
+const Counter &WorkerPool::Steals() const
+{
+    return m_state->steals;
+}
+
+const Counter &WorkerPool::Abandoned() const
+{
+    return m_state->abandoned;
+}
+
+const Counter &WorkerPool::Replaced() const
+{
+    return m_state->replaced;
+}
+
+HRESULT WorkerPool::Start(unsigned threads, unsigned spares)
+{
+    if (!m_threads.empty())
+        return S_FALSE;
+    if (threads == 0)
+        return S_OK;
+
+    uint64_t epoch;
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        epoch = ++m_state->epoch;
+        m_state->stopping = false;
+        m_state->shardCount = threads;
+        m_state->spares = spares;
+        m_state->retired = 0;
+        m_state->shards.reset(new WorkerPoolShard[threads]);
+        m_state->threads.assign(threads, WorkerPoolThread());
+    }
+    try
+    {
+        for (size_t shard = 0; shard < threads; shard++)
+            m_threads.emplace_back(&WorkerPool::ThreadLoop, m_state, shard, epoch, (uint64_t)0);
+    }
+    catch (const std::system_error &)
+    {
+        Stop();
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+void WorkerPool::Stop()
+{
+    std::vector<bool> stuck(m_threads.size());
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        m_state->stopping = true;
+        m_state->wake.notify_all();
+        for (size_t shard = 0; shard < m_threads.size(); shard++)
+            stuck[shard] = m_state->threads[shard].running;
+    }
+    for (size_t shard = 0; shard < m_threads.size(); shard++)
+    {
+        if (stuck[shard])
+            m_threads[shard].detach();
+        else
+            m_threads[shard].join();
+    }
+    m_threads.clear();
+}
+
+bool WorkerPool::RunBatch(const uint32_t *keys, size_t count, const Task &task, uint32_t timeoutMs)
+{
+    // Shares no ownership, so it neither allocates nor keeps task alive
+    return RunBatch(keys, count, std::shared_ptr<const Task>(std::shared_ptr<const Task>(), &task), timeoutMs);
+}
+
+bool WorkerPool::RunBatch(const uint32_t *keys, size_t count, const std::shared_ptr<const Task> &task,
+                          uint32_t timeoutMs)
+{
+    if (count == 0)
+        return true;
+    if (m_threads.empty())
+    {
+        for (size_t i = 0; i < count; i++)
+            (*task)(keys[i]);
+        return true;
+    }
+
+    State &state = *m_state;
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.task = task;
+    state.remaining = count;
+    for (size_t shard = 0; shard < state.shardCount; shard++)
+    {
+        WorkerPoolShard &target = state.shards[shard];
+        std::lock_guard<std::mutex> shardLock(target.mutex);
+        target.keys.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (keys[i] % state.shardCount == shard)
+                target.keys.push_back(keys[i]);
+        }
+        target.head = 0;
+        target.tail = target.keys.size();
+    }
+    state.generation++;
+    state.wake.notify_all();
+
+    bool complete = true;
+    uint64_t timeoutUs = (uint64_t)timeoutMs * 1000;
+    while (state.remaining > 0)
+    {
+        uint64_t now = NowUs();
+        uint64_t nextDeadline = UINT64_MAX;
+        size_t stuck = 0;
+        for (size_t shard = 0; shard < state.shardCount; shard++)
+        {
+            WorkerPoolThread &thread = state.threads[shard];
+            if (!thread.running)
+                continue;
+            if (!thread.abandoned && timeoutUs > 0 && now - thread.startedUs >= timeoutUs)
+            {
+                thread.abandoned = true;
+                state.remaining--;
+                state.abandoned.Add();
+                complete = false;
+            }
+            if (thread.abandoned && state.retired < state.spares && Replace(shard))
+                continue;
+            if (thread.abandoned)
+                stuck++;
+            else if (timeoutUs > 0 && thread.startedUs + timeoutUs < nextDeadline)
+                nextDeadline = thread.startedUs + timeoutUs;
+        }
+
+        // Nobody is left to run what is still queued, possibly stuck since an earlier batch,
+        // and no spare thread may be started
+        if (stuck == state.shardCount)
+        {
+            for (size_t shard = 0; shard < state.shardCount; shard++)
+            {
+                WorkerPoolShard &target = state.shards[shard];
+                std::lock_guard<std::mutex> shardLock(target.mutex);
+                state.remaining -= target.tail - target.head;
+                complete = complete && target.head == target.tail;
+                target.head = target.tail;
+            }
+            continue;
+        }
+
+        if (state.remaining == 0)
+            break;
+        if (nextDeadline == UINT64_MAX)
+            state.progress.wait(lock);
+        else
+            state.progress.wait_for(lock, std::chrono::microseconds(nextDeadline - now));
+    }
+
+    // Every queued task was claimed or dropped; threads still in one hold their own reference
+    state.task.reset();
+    return complete;
+}
+
+// Under the state mutex: a new thread takes over the shard of one stuck in an abandoned
+// task, which exits once the task returns
+bool WorkerPool::Replace(size_t shard)
+{
+    State &state = *m_state;
+    WorkerPoolThread &slot = state.threads[shard];
+    uint64_t incarnation = slot.incarnation + 1;
+    std::thread thread;
+    try
+    {
+        thread = std::thread(&WorkerPool::ThreadLoop, m_state, shard, state.epoch, incarnation);
+    }
+    catch (const std::system_error &)
+    {
+        return false;
+    }
+
+    m_threads[shard].detach();
+    m_threads[shard] = std::move(thread);
+    slot = WorkerPoolThread();
+    slot.incarnation = incarnation;
+    state.retired++;
+    state.replaced.Add();
+    return true;
+}
+
+bool WorkerPool::PopOwn(State &state, size_t shard, uint32_t &key)
+{
+    WorkerPoolShard &own = state.shards[shard];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.head == own.tail)
+        return false;
+    key = own.keys[own.head++];
+    return true;
+}
+
+// Takes the last task of the next shard that has any, so the owner and the thief
+// work from opposite ends
+bool WorkerPool::Steal(State &state, size_t thief, uint32_t &key)
+{
+    for (size_t offset = 1; offset < state.shardCount; offset++)
+    {
+        WorkerPoolShard &victim = state.shards[(thief + offset) % state.shardCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.head == victim.tail)
+            continue;
+        key = victim.keys[--victim.tail];
+        state.steals.Add();
+        return true;
+    }
+    return false;
+}
+
+// False once the pool was stopped or restarted while a task ran
+bool WorkerPool::Work(State &state, size_t shard, uint64_t epoch, uint64_t incarnation)
+{
+    uint32_t key;
+    while (PopOwn(state, shard, key) || Steal(state, shard, key))
+    {
+        std::shared_ptr<const Task> task;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            WorkerPoolThread &self = state.threads[shard];
+            self.running = true;
+            self.abandoned = false;
+            self.startedUs = NowUs();
+            task = state.task;
+            state.progress.notify_all();
+        }
+
+        (*task)(key);
+        task.reset();
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.epoch != epoch)
+            return false;
+        WorkerPoolThread &self = state.threads[shard];
+        if (self.incarnation != incarnation)
+        {
+            // Replaced while stuck; the shard belongs to the new thread
+            state.retired--;
+            state.progress.notify_all();
+            return false;
+        }
+        self.running = false;
+        if (!self.abandoned)
+            state.remaining--;
+        state.progress.notify_all();
+        if (state.stopping)
+            return false;
+    }
+    return true;
+}
+
+void WorkerPool::ThreadLoop(std::shared_ptr<State> state, size_t shard, uint64_t epoch, uint64_t incarnation)
+{
+    if (state->threadStart)
+        state->threadStart();
+
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->wake.wait(lock, [&]() {
+                return state->stopping || state->epoch != epoch || state->generation != seen;
+            });
+            if (state->stopping || state->epoch != epoch)
+                break;
+            seen = state->generation;
+        }
+        if (!Work(*state, shard, epoch, incarnation))
+            break;
+    }
+
+    if (state->threadStop)
+        state->threadStop();
+}
+
+} // namespace MicVol
@@ -0,0 +1,85 @@
+#pragma once
+#include "Metrics.h"
+#include "Platform.h"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MicVol
+{
+
+// A few threads that run batches of independent tasks, e.g. the endpoint calls of
+// one check per device, so that a slow endpoint holds up only its own task.
+//
+// RunBatch() shards a batch by the key of each task: shard key % threads, so a key
+// keeps going to the same thread from batch to batch. A thread that runs out of work
+// steals from the back of another shard. A task runs once, on one thread, so what it
+// does for its key keeps its order, and batches never overlap. The calling thread
+// only waits, which lets it give up on a task that overruns the deadline of the
+// batch: the task is abandoned, not cancelled, and its thread rejoins the pool when
+// the task returns. So that a few hung tasks cannot take every thread, a spare thread
+// may take over the shard of a stuck one, which then exits when its task returns.
+// Without threads the tasks run inline, in order, with no deadline.
+class WorkerPool
+{
+public:
+    // threadStart and threadStop run on each pool thread, e.g. to join the COM apartment
+    explicit WorkerPool(std::function<void()> threadStart = nullptr, std::function<void()> threadStop = nullptr);
+    ~WorkerPool() { Stop(); }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // S_FALSE when already running. At most spares threads replaced while stuck in an
+    // abandoned task may still be in it; past that a stuck thread keeps its shard.
+    HRESULT Start(unsigned threads, unsigned spares = 0);
+
+    // Threads still stuck in an abandoned task are detached rather than waited for;
+    // they exit once the task returns
+    void Stop();
+    unsigned ThreadCount() const { return (unsigned)m_threads.size(); }
+
+    using Task = std::function<void(uint32_t)>;
+
+    // From one thread at a time; runs task(keys[i]) for every i < count and returns once
+    // each task finished or was given up on. With a timeout, a task still running after
+    // timeoutMs is abandoned, and when every thread is stuck in an abandoned task and
+    // no spare may replace one, the tasks nobody started are dropped. False if any task was abandoned or dropped; the
+    // tasks record what they did, which tells the caller which ones.
+    //
+    // An abandoned task keeps running after the call, and after Stop() detached its
+    // thread. With the shared task the thread holds a reference until it returns, so
+    // what the task owns outlives its caller; a task passed by reference must outlive
+    // every thread that may still run it.
+    bool RunBatch(const uint32_t *keys, size_t count, const std::shared_ptr<const Task> &task,
+                  uint32_t timeoutMs = 0);
+    bool RunBatch(const uint32_t *keys, size_t count, const Task &task, uint32_t timeoutMs = 0);
+
+    // Tasks run by another thread than the one their key maps to
+    const Counter &Steals() const;
+
+    // Tasks that overran the deadline of their batch
+    const Counter &Abandoned() const;
+
+    // Threads started in place of one stuck in an abandoned task
+    const Counter &Replaced() const;
+
+private:
+    struct State;
+
+    static bool PopOwn(State &state, size_t shard, uint32_t &key);
+    static bool Steal(State &state, size_t thief, uint32_t &key);
+    bool Replace(size_t shard);
+    static bool Work(State &state, size_t shard, uint64_t epoch, uint64_t incarnation);
+    static void ThreadLoop(std::shared_ptr<State> state, size_t shard, uint64_t epoch, uint64_t incarnation);
+
+    // Shared with the threads, so one detached by Stop() or Replace() can still finish its task
+    std::shared_ptr<State> m_state;
+    std::vector<std::thread> m_threads; // By shard
+};
+
+} // namespace MicVol
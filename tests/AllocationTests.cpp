@@ -0,0 +1,212 @@
+// Counts heap allocations around steady-state enforcement passes: devices present,
+// at their target and unchanged, nothing to correct. Such a pass must not allocate,
+// since the service runs next to games around the clock.
+//
+// Replaces the global operator new of this test executable; the count covers every
+// thread, so work the worker pool does for a pass is included.
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include "SimpleTest.h"
+#include "core/AsyncLogger.h"
+#include "core/EventLoop.h"
+#include "core/LogRateLimiter.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+#include "core/StatusBlock.h"
+#include "core/WorkerPool.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+static std::atomic<bool> g_counting{false};
+static std::atomic<uint64_t> g_allocations{0};
+
+static void *CountedAlloc(size_t size)
+{
+    if (g_counting.load(std::memory_order_relaxed))
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *memory = std::malloc(size ? size : 1);
+    if (!memory)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void *operator new(size_t size) { return CountedAlloc(size); }
+void *operator new[](size_t size) { return CountedAlloc(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    try { return CountedAlloc(size); } catch (...) { return nullptr; }
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    try { return CountedAlloc(size); } catch (...) { return nullptr; }
+}
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, size_t) noexcept { std::free(memory); }
+
+// Allocations made by every thread between construction and Count()
+class AllocationScope {
+public:
+    AllocationScope() {
+        g_allocations.store(0);
+        g_counting.store(true);
+    }
+    ~AllocationScope() { g_counting.store(false); }
+    uint64_t Count() const { return g_allocations.load(); }
+};
+
+// Logs what a pass reports the way the service does: rate-limited, deferred
+class LoggingObserver : public EnforcementObserver {
+public:
+    LoggingObserver(AsyncLogger &logger, LogRateLimiter &limiter, Clock &clock)
+        : logger(logger), limiter(limiter), clock(clock) {}
+
+    void OnVolumeAtTarget(DeviceHandle device) override {
+        MVS_LOG_INFO(logger, L"Volume already at target for: {}", LogArg::Device(device));
+    }
+    void OnVolumeCorrected(DeviceHandle device, float oldVolume, float newVolume, CorrectionSource) override {
+        if (limiter.Allow(device, LogKind::VolumeCorrected, clock.NowMs()))
+            MVS_LOG_INFO(logger, L"Volume changed for {}: {} -> {}", LogArg::Device(device),
+                         LogArg::Percent(oldVolume), LogArg::Percent(newVolume));
+    }
+
+    AsyncLogger &logger;
+    LogRateLimiter &limiter;
+    Clock &clock;
+};
+
+class NullSink : public LogSink {
+public:
+    HRESULT Write(const LogRecord &) override { return S_OK; }
+    HRESULT Flush() override { return S_OK; }
+};
+
+struct Harness {
+    Harness() : observer(logger, limiter, clock), enforcer(backend, clock, observer) {
+        for (int i = 0; i < 4; i++) {
+            std::wstring id = L"{mic" + std::to_wstring(i) + L"}";
+            mics[i] = backend.AddDevice(id, L"Microphone " + std::to_wstring(i), 1.0f);
+        }
+        logger.SetSink(std::make_shared<NullSink>());
+        logger.Start();
+    }
+
+    SimulatedAudioBackend backend;
+    std::shared_ptr<SimulatedEndpoint> mics[4];
+    VirtualClock clock{1000};
+    AsyncLogger logger;
+    LogRateLimiter limiter;
+    LoggingObserver observer;
+    MicrophoneEnforcer enforcer;
+    StatusSnapshot status = StatusSnapshot();
+};
+
+TEST_FUNCTION(Allocation_PollingSweep_AllocatesNothing) {
+    Harness harness;
+    // The first passes build the inventory, resolve policies and size the buffers
+    for (int i = 0; i < 3; i++)
+        harness.enforcer.Sweep();
+
+    AllocationScope scope;
+    for (int i = 0; i < 200; i++) {
+        harness.clock.Advance(2000);
+        harness.enforcer.Sweep();
+        CaptureStatus(harness.enforcer, harness.clock.NowMs(), 1700000000000ull, harness.status);
+    }
+    EXPECT_EQ(0ull, scope.Count());
+    EXPECT_EQ(4u, (unsigned)harness.status.deviceCount);
+}
+
+TEST_FUNCTION(Allocation_SweepOnWorkerPool_AllocatesNothing) {
+    Harness harness;
+    WorkerPool pool;
+    pool.Start(2);
+    harness.enforcer.SetWorkerPool(&pool);
+    for (int i = 0; i < 3; i++)
+        harness.enforcer.Sweep();
+
+    AllocationScope scope;
+    for (int i = 0; i < 200; i++) {
+        harness.clock.Advance(2000);
+        harness.enforcer.Sweep();
+    }
+    EXPECT_EQ(0ull, scope.Count());
+    EXPECT_EQ(800u, harness.mics[0]->getCalls.load() + harness.mics[1]->getCalls.load() +
+                        harness.mics[2]->getCalls.load() + harness.mics[3]->getCalls.load() - 12);
+}
+
+TEST_FUNCTION(Allocation_AdaptiveAndEventsOnLoop_AllocateNothing) {
+    // The service's event loop: adaptive checks on a timer, change notifications as a
+    // source, the status captured before every wait
+    Harness harness;
+    CheckSchedule schedule;
+    schedule.minIntervalMs = 100;
+    schedule.maxIntervalMs = 1000;
+    harness.enforcer.EnableAdaptiveSchedule(schedule);
+    harness.enforcer.EnableNotifications();
+
+    EventLoop loop(harness.clock);
+    loop.SetSource(0, [&]() { harness.enforcer.ProcessNotifications(); });
+    loop.SetTimer(0, [&]() { harness.enforcer.CheckDue(); });
+    loop.SetBeforeWait([&]() {
+        uint64_t next = harness.enforcer.NextCheckMs();
+        if (next == TimerWheel::Never)
+            loop.Cancel(0);
+        else
+            loop.Schedule(0, next);
+        CaptureStatus(harness.enforcer, harness.clock.NowMs(), 1700000000000ull, harness.status);
+    });
+    harness.enforcer.CheckDue();
+    for (int i = 0; i < 50; i++) {
+        harness.clock.Advance(100);
+        loop.Poll();
+    }
+
+    AllocationScope scope;
+    for (int i = 0; i < 500; i++) {
+        harness.clock.Advance(100);
+        loop.Signal(0);
+        loop.Poll();
+    }
+    EXPECT_EQ(0ull, scope.Count());
+    EXPECT_GT(harness.enforcer.Metrics().ticks.Value(), 500ull);
+}
+
+TEST_FUNCTION(Allocation_SuppressedCorrections_AllocateNothing) {
+    // A storm of corrections the log limiter suppresses: the corrections themselves
+    // are work, but neither they nor their log lines allocate
+    Harness harness;
+    for (int i = 0; i < 3; i++)
+        harness.enforcer.Sweep();
+    for (int i = 0; i < 10; i++) {
+        harness.mics[0]->Tamper(0.3f);
+        harness.enforcer.Sweep();
+    }
+
+    AllocationScope scope;
+    for (int i = 0; i < 200; i++) {
+        harness.mics[0]->Tamper(0.3f);
+        harness.clock.Advance(2000);
+        harness.enforcer.Sweep();
+    }
+    EXPECT_EQ(0ull, scope.Count());
+    EXPECT_GT(harness.limiter.Suppressed().Value(), 100ull);
+}
+
+TEST_FUNCTION(Allocation_HookCountsAllocations) {
+    AllocationScope scope;
+    std::unique_ptr<int> value(new int(7));
+    EXPECT_EQ(1ull, scope.Count());
+}
+
+int main() {
+    std::wcout << L"Allocation tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
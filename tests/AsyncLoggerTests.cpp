@@ -0,0 +1,378 @@
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/AsyncLogger.h"
+#include "core/FileLogSink.h"
+#ifdef __linux__
+#include <sys/stat.h>
+#endif
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+// Collects records in memory; can hold the writer inside Write() to fill the queue
+class MemorySink : public LogSink {
+public:
+    HRESULT Write(const LogRecord& record) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        gateCv.wait(lock, [this] { return !gateClosed; });
+        messages.push_back(std::wstring(record.text, record.length));
+        levels.push_back(record.level);
+        truncated.push_back(record.truncated);
+        return S_OK;
+    }
+
+    HRESULT Flush() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushes++;
+        return S_OK;
+    }
+
+    void CloseGate() {
+        std::lock_guard<std::mutex> lock(mutex);
+        gateClosed = true;
+    }
+
+    void OpenGate() {
+        std::lock_guard<std::mutex> lock(mutex);
+        gateClosed = false;
+        gateCv.notify_all();
+    }
+
+    std::mutex mutex;
+    std::condition_variable gateCv;
+    bool gateClosed = false;
+    std::vector<std::wstring> messages;
+    std::vector<LogLevel> levels;
+    std::vector<bool> truncated;
+    int flushes = 0;
+};
+
+static std::filesystem::path TempLogPath(const char* name) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+        (std::string("mvs_") + name + "_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".log");
+    std::filesystem::remove(path);
+    return path;
+}
+
+static std::string ReadFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+TEST_FUNCTION(AsyncLogger_Stop_DrainsQueuedMessagesInOrder) {
+    auto sink = std::make_shared<MemorySink>();
+    AsyncLogger logger;
+    logger.SetSink(sink);
+    EXPECT_EQ(S_OK, logger.Start());
+
+    for (int i = 0; i < 500; i++) {
+        logger.Log(LogLevel::Information, L"message " + std::to_wstring(i));
+    }
+    logger.Stop();
+
+    EXPECT_EQ(500u, sink->messages.size());
+    EXPECT_TRUE(sink->messages[0] == L"message 0");
+    EXPECT_TRUE(sink->messages[499] == L"message 499");
+    EXPECT_TRUE(sink->flushes >= 1);
+    EXPECT_EQ(0u, logger.Dropped());
+    EXPECT_EQ(500u, logger.Written());
+}
+
+TEST_FUNCTION(AsyncLogger_NotRunning_WritesSynchronously) {
+    auto sink = std::make_shared<MemorySink>();
+    AsyncLogger logger;
+    logger.SetSink(sink);
+
+    logger.Log(LogLevel::Error, L"before start");
+    EXPECT_EQ(1u, sink->messages.size());
+    EXPECT_TRUE(sink->levels[0] == LogLevel::Error);
+    EXPECT_EQ(1, sink->flushes);
+
+    logger.Start();
+    logger.Stop();
+    logger.Log(LogLevel::Information, L"after stop");
+    EXPECT_EQ(2u, sink->messages.size());
+    EXPECT_TRUE(sink->messages[1] == L"after stop");
+}
+
+TEST_FUNCTION(AsyncLogger_QueueFull_DropPolicyCountsAndReportsDrops) {
+    auto sink = std::make_shared<MemorySink>();
+    AsyncLoggerOptions options;
+    options.capacity = 8;
+    AsyncLogger logger(options);
+    logger.SetSink(sink);
+    logger.Start();
+
+    // Park the writer inside the sink with one record, then overfill the queue
+    sink->CloseGate();
+    logger.Log(LogLevel::Information, L"held");
+    while (logger.Dropped() == 0) {
+        logger.Log(LogLevel::Information, L"filler");
+        std::this_thread::yield();
+    }
+    for (int i = 0; i < 5; i++) {
+        logger.Log(LogLevel::Information, L"overflow");
+    }
+    uint64_t dropped = logger.Dropped();
+    EXPECT_TRUE(dropped >= 6);
+
+    sink->OpenGate();
+    logger.Stop();
+
+    EXPECT_TRUE(sink->messages.back() == L"WARNING: " + std::to_wstring(dropped) + L" log messages dropped, queue full");
+    EXPECT_TRUE(sink->levels.back() == LogLevel::Warning);
+    EXPECT_EQ(sink->messages.size(), (size_t)logger.Written());
+}
+
+TEST_FUNCTION(AsyncLogger_QueueFull_BlockPolicyLosesNothing) {
+    auto sink = std::make_shared<MemorySink>();
+    AsyncLoggerOptions options;
+    options.capacity = 4;
+    options.overflow = LogOverflowPolicy::Block;
+    AsyncLogger logger(options);
+    logger.SetSink(sink);
+    logger.Start();
+
+    for (int i = 0; i < 1000; i++) {
+        logger.Log(LogLevel::Information, std::to_wstring(i));
+    }
+    logger.Stop();
+
+    EXPECT_EQ(0u, logger.Dropped());
+    EXPECT_EQ(1000u, sink->messages.size());
+    EXPECT_TRUE(sink->messages[999] == L"999");
+}
+
+TEST_FUNCTION(AsyncLogger_ConcurrentProducers_KeepPerThreadOrder) {
+    auto sink = std::make_shared<MemorySink>();
+    AsyncLoggerOptions options;
+    options.capacity = 64;
+    options.overflow = LogOverflowPolicy::Block;
+    AsyncLogger logger(options);
+    logger.SetSink(sink);
+    logger.Start();
+
+    const int threadCount = 4;
+    const int perThread = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&logger, t] {
+            for (int i = 0; i < perThread; i++) {
+                logger.Log(LogLevel::Information, std::to_wstring(t) + L":" + std::to_wstring(i));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    logger.Stop();
+
+    EXPECT_EQ((size_t)(threadCount * perThread), sink->messages.size());
+    std::vector<int> next(threadCount, 0);
+    for (const std::wstring& message : sink->messages) {
+        int thread = std::stoi(message.substr(0, message.find(L':')));
+        int index = std::stoi(message.substr(message.find(L':') + 1));
+        EXPECT_EQ(next[thread], index);
+        next[thread]++;
+    }
+}
+
+TEST_FUNCTION(AsyncLogger_FlushesOnRecordThreshold) {
+    auto sink = std::make_shared<MemorySink>();
+    AsyncLoggerOptions options;
+    options.flushRecords = 10;
+    options.flushIntervalMs = 60 * 60 * 1000;
+    AsyncLogger logger(options);
+    logger.SetSink(sink);
+    logger.Start();
+
+    for (int i = 0; i < 10; i++) {
+        logger.Log(LogLevel::Information, L"x");
+    }
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        {
+            std::lock_guard<std::mutex> lock(sink->mutex);
+            if (sink->flushes > 0) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sink->mutex);
+        EXPECT_TRUE(sink->flushes > 0);
+    }
+    logger.Stop();
+}
+
+TEST_FUNCTION(AsyncLogger_LongMessage_IsTruncated) {
+    auto sink = std::make_shared<MemorySink>();
+    AsyncLogger logger;
+    logger.SetSink(sink);
+    logger.Start();
+
+    logger.Log(LogLevel::Information, std::wstring(1000, L'a'));
+    logger.Stop();
+
+    EXPECT_EQ(LogRecordMaxChars - 1, sink->messages[0].size());
+    EXPECT_TRUE(sink->truncated[0]);
+}
+
+TEST_FUNCTION(FileLogSink_WritesTimestampedUtf8Lines) {
+    std::filesystem::path path = TempLogPath("lines");
+    {
+        auto sink = std::make_shared<FileLogSink>(path.wstring());
+        AsyncLogger logger;
+        logger.SetSink(sink);
+        logger.Start();
+        logger.Log(LogLevel::Information, L"Volume corrected to 100% for: Mikrofon (Gerät)");
+        logger.Log(LogLevel::Error, L"ERROR: second");
+        logger.Stop();
+        EXPECT_TRUE(sink->IsOpen());
+    }
+
+    std::string content = ReadFile(path);
+    EXPECT_EQ('[', content[0]);
+    EXPECT_EQ(']', content[20]);
+    EXPECT_TRUE(content.find("] Volume corrected to 100% for: Mikrofon (Ger\xC3\xA4t)\n") != std::string::npos);
+    EXPECT_TRUE(content.find("] ERROR: second\n") != std::string::npos);
+    std::filesystem::remove(path);
+}
+
+TEST_FUNCTION(FileLogSink_AppendsToExistingFile) {
+    std::filesystem::path path = TempLogPath("append");
+    {
+        std::ofstream existing(path, std::ios::binary);
+        existing << "old line\n";
+    }
+
+    {
+        AsyncLogger logger;
+        logger.SetSink(std::make_shared<FileLogSink>(path.wstring()));
+        logger.Log(LogLevel::Information, L"new line");
+    }
+
+    std::string content = ReadFile(path);
+    EXPECT_EQ(0u, content.find("old line\n"));
+    EXPECT_TRUE(content.find("] new line\n") != std::string::npos);
+    std::filesystem::remove(path);
+}
+
+TEST_FUNCTION(FileLogSink_UnwritablePath_FailsAndRetries) {
+    FileLogSink sink(L"/nonexistent-directory/mvs.log");
+    LogRecord record = {};
+    record.length = 1;
+    record.text[0] = L'x';
+
+    EXPECT_TRUE(FAILED(sink.Write(record)));
+    EXPECT_FALSE(sink.IsOpen());
+    EXPECT_EQ(S_FALSE, sink.Flush());
+}
+
+static LogRecord MakeRecord(const std::wstring& text) {
+    LogRecord record = {};
+    record.timestampMs = 1735689600000ull;
+    record.length = (uint16_t)text.size();
+    text.copy(record.text, text.size());
+    return record;
+}
+
+TEST_FUNCTION(FileLogSink_SegmentPath_InsertsIndexBeforeExtension) {
+    FileLogSink sink(L"C:\\Windows\\Temp\\MicrophoneVolumeService.log");
+    EXPECT_TRUE(sink.SegmentPath(0) == L"C:\\Windows\\Temp\\MicrophoneVolumeService.log");
+    EXPECT_TRUE(sink.SegmentPath(2) == L"C:\\Windows\\Temp\\MicrophoneVolumeService.2.log");
+
+    FileLogSink noExtension(L"/var/log.d/mvs");
+    EXPECT_TRUE(noExtension.SegmentPath(1) == L"/var/log.d/mvs.1");
+}
+
+TEST_FUNCTION(FileLogSink_Rotation_BoundsSegmentCountAndSize) {
+    std::filesystem::path path = TempLogPath("rotate");
+    FileLogRotation rotation;
+    rotation.segmentBytes = 4096;
+    rotation.segmentCount = 3;
+    FileLogSink sink(path.wstring(), rotation);
+
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(S_OK, sink.Write(MakeRecord(L"Volume corrected to 100% for: Microphone #" + std::to_wstring(i))));
+    }
+    sink.Flush();
+
+    EXPECT_TRUE(sink.Rotations() > 3);
+    for (uint32_t index = 0; index < 3; index++) {
+        std::filesystem::path segment(sink.SegmentPath(index));
+        EXPECT_TRUE(std::filesystem::exists(segment));
+        EXPECT_TRUE(std::filesystem::file_size(segment) <= 4096);
+    }
+    EXPECT_FALSE(std::filesystem::exists(std::filesystem::path(sink.SegmentPath(3))));
+
+    // Newest lines in the current segment, the next older ones in .1, the oldest gone
+    std::string current = ReadFile(path);
+    EXPECT_TRUE(current.find("Microphone #999\n") != std::string::npos);
+    std::string previous = ReadFile(std::filesystem::path(sink.SegmentPath(1)));
+    size_t lastInPrevious = previous.rfind("#");
+    size_t firstInCurrent = current.find("#");
+    EXPECT_EQ(std::stoi(previous.substr(lastInPrevious + 1)) + 1, std::stoi(current.substr(firstInCurrent + 1)));
+    std::string all = current + previous + ReadFile(std::filesystem::path(sink.SegmentPath(2)));
+    EXPECT_TRUE(all.find("Microphone #0\n") == std::string::npos);
+
+    for (uint32_t index = 0; index < 3; index++) {
+        std::filesystem::remove(std::filesystem::path(sink.SegmentPath(index)));
+    }
+}
+
+TEST_FUNCTION(FileLogSink_Rotation_OversizedExistingFileRotatesOnFirstWrite) {
+    std::filesystem::path path = TempLogPath("oversized");
+    {
+        std::ofstream existing(path, std::ios::binary);
+        existing << std::string(8192, 'x') << "\n";
+    }
+    FileLogRotation rotation;
+    rotation.segmentBytes = 4096;
+    rotation.segmentCount = 2;
+    FileLogSink sink(path.wstring(), rotation);
+
+    sink.Write(MakeRecord(L"first"));
+    sink.Flush();
+
+    EXPECT_EQ(1u, sink.Rotations());
+    EXPECT_TRUE(ReadFile(path).find("] first\n") != std::string::npos);
+    EXPECT_EQ(8193u, std::filesystem::file_size(std::filesystem::path(sink.SegmentPath(1))));
+    std::filesystem::remove(path);
+    std::filesystem::remove(std::filesystem::path(sink.SegmentPath(1)));
+}
+
+TEST_FUNCTION(FileLogSink_Rotation_PreallocatesWithoutGrowingTheFile) {
+    std::filesystem::path path = TempLogPath("prealloc");
+    FileLogRotation rotation;
+    rotation.segmentBytes = 1024 * 1024;
+    FileLogSink sink(path.wstring(), rotation);
+
+    sink.Write(MakeRecord(L"one line"));
+    sink.Flush();
+
+    // The visible size is only what was written; the reservation is disk space
+    EXPECT_TRUE(std::filesystem::file_size(path) < 100);
+#ifdef __linux__
+    if (sink.IsPreallocated()) {
+        struct stat info;
+        EXPECT_EQ(0, stat(path.c_str(), &info));
+        EXPECT_TRUE((uint64_t)info.st_blocks * 512 >= rotation.segmentBytes);
+    }
+#endif
+    std::filesystem::remove(path);
+}
+
+int main() {
+    std::wcout << L"Async logger tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
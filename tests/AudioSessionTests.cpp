@@ -0,0 +1,132 @@
+#include <iostream>
+#include <cmath>
+#include "SimpleTest.h"
+#include "core/AudioSession.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+// Same call pattern as ProcessMicrophones()
+static void RunTick(AudioSession& session) {
+    session.Open();
+    session.BeginTick();
+
+    std::vector<DeviceHandle> devices;
+    if (FAILED(session.EnumerateCaptureEndpoints(devices)))
+        return;
+
+    for (DeviceHandle device : devices) {
+        session.GetName(device);
+        float volume = -1.0f;
+        session.GetVolume(device, &volume);
+        if (std::fabs(volume - 1.0f) > 0.01f)
+            session.SetVolume(device, 1.0f);
+    }
+}
+
+TEST_FUNCTION(Session_Open_InitializesBackendOnce) {
+    SimulatedAudioBackend backend;
+    DeviceTable devices;
+    AudioSession session(backend, devices);
+
+    EXPECT_TRUE(SUCCEEDED(session.Open()));
+    EXPECT_EQ(S_FALSE, session.Open());
+    EXPECT_EQ(1ull, backend.counters.initializations);
+}
+
+TEST_FUNCTION(Session_SteadyStateTick_MakesNoActivations) {
+    SimulatedAudioBackend backend;
+    DeviceTable devices;
+    backend.AddDevice(L"{mic-1}", L"USB Microphone", 0.3f);
+    backend.AddDevice(L"{mic-2}", L"Voicemeeter Out B1", 1.0f);
+    backend.AddDevice(L"{mic-3}", L"CABLE Output", 1.0f);
+    AudioSession session(backend, devices);
+
+    RunTick(session);
+    EXPECT_EQ(3ull, session.TickCalls().activations);
+    EXPECT_EQ(3ull, session.TickCalls().nameReads);
+
+    for (int i = 0; i < 10; i++) {
+        RunTick(session);
+        EXPECT_EQ(0ull, session.TickCalls().initializations);
+        EXPECT_EQ(0ull, session.TickCalls().activations);
+        EXPECT_EQ(0ull, session.TickCalls().nameReads);
+        EXPECT_EQ(0ull, session.TickCalls().volumeWrites);
+        EXPECT_EQ(3ull, session.TickCalls().volumeReads);
+    }
+
+    EXPECT_EQ(3ull, backend.counters.activations);
+    EXPECT_EQ(1ull, backend.counters.initializations);
+}
+
+TEST_FUNCTION(Session_Tamper_CorrectedThroughCachedInterface) {
+    SimulatedAudioBackend backend;
+    DeviceTable devices;
+    auto mic = backend.AddDevice(L"{mic-1}", L"USB Microphone", 1.0f);
+    AudioSession session(backend, devices);
+    RunTick(session);
+
+    mic->Tamper(0.2f);
+    RunTick(session);
+
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_EQ(1ull, session.TickCalls().volumeWrites);
+    EXPECT_EQ(0ull, session.TickCalls().activations);
+}
+
+TEST_FUNCTION(Session_FailedCall_InvalidatesAndReactivates) {
+    SimulatedAudioBackend backend;
+    DeviceTable devices;
+    auto mic = backend.AddDevice(L"{mic-1}", L"USB Microphone", 1.0f);
+    AudioSession session(backend, devices);
+    RunTick(session);
+
+    mic->SetFailure(E_FAIL);
+    float volume = 0.0f;
+    EXPECT_FAILED(session.GetVolume(devices.Find(L"{mic-1}"), &volume));
+
+    mic->SetFailure(S_OK);
+    RunTick(session);
+    EXPECT_EQ(1ull, session.TickCalls().activations);
+
+    RunTick(session);
+    EXPECT_EQ(0ull, session.TickCalls().activations);
+}
+
+TEST_FUNCTION(Session_RemovedDevice_DroppedFromCache) {
+    SimulatedAudioBackend backend;
+    DeviceTable devices;
+    backend.AddDevice(L"{mic-1}", L"USB Microphone", 1.0f);
+    backend.AddDevice(L"{mic-2}", L"Headset", 1.0f);
+    AudioSession session(backend, devices);
+    RunTick(session);
+    EXPECT_EQ(2u, session.CachedEndpointCount());
+
+    backend.RemoveDevice(L"{mic-2}");
+    RunTick(session);
+    EXPECT_EQ(1u, session.CachedEndpointCount());
+    EXPECT_EQ(0ull, session.TickCalls().activations);
+}
+
+TEST_FUNCTION(Session_Close_ReleasesCache) {
+    SimulatedAudioBackend backend;
+    DeviceTable devices;
+    backend.AddDevice(L"{mic-1}", L"USB Microphone", 1.0f);
+    AudioSession session(backend, devices);
+    RunTick(session);
+
+    session.Close();
+    EXPECT_FALSE(session.IsOpen());
+    EXPECT_EQ(0u, session.CachedEndpointCount());
+
+    RunTick(session);
+    EXPECT_EQ(2ull, backend.counters.initializations);
+    EXPECT_EQ(1ull, session.TickCalls().activations);
+}
+
+int main() {
+    std::wcout << L"Audio session tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
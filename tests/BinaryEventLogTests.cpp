@@ -0,0 +1,243 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/BinaryEventLog.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+static const uint64_t BaseMs = 1735689600000ull; // 2025-01-01 00:00:00 UTC
+
+static std::wstring TempLogPath(const char* name) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+        (std::string("mvs_") + name + "_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".evl");
+    std::filesystem::remove(path);
+    return path.wstring();
+}
+
+static EventRecord MakeEvent(uint64_t timestampMs, DeviceHandle device, EventType type, float oldVolume, float newVolume,
+                             HRESULT hr = S_OK) {
+    EventRecord record = {};
+    record.timestampMs = timestampMs;
+    record.device = device;
+    record.type = (uint16_t)type;
+    record.oldVolume = oldVolume;
+    record.newVolume = newVolume;
+    record.hr = hr;
+    return record;
+}
+
+static std::vector<DecodedEvent> QueryAll(const std::wstring& path, const BinaryLogQuery& query = BinaryLogQuery(),
+                                          BinaryLogQueryStats* stats = nullptr) {
+    BinaryLogReader reader;
+    std::vector<DecodedEvent> events;
+    if (SUCCEEDED(reader.Open(path))) {
+        reader.Query(query, events, stats);
+    }
+    return events;
+}
+
+TEST_FUNCTION(BinaryEventLog_RoundTripsRecordsAndNames) {
+    std::wstring path = TempLogPath("roundtrip");
+    {
+        BinaryLogWriter writer;
+        EXPECT_EQ(S_OK, writer.Open(path, BaseMs));
+        writer.Describe(0, L"{0.0.1.00000000}.{mic-a}", L"Headset Microphone");
+        writer.Append(MakeEvent(BaseMs + 1, InvalidDeviceHandle, EventType::ServiceStarted, 0, 0));
+        writer.Append(MakeEvent(BaseMs + 2, 0, EventType::VolumeCorrected, 0.37f, 1.0f));
+        writer.Append(MakeEvent(BaseMs + 3, 0, EventType::CorrectionFailed, 0.5f, 1.0f, (HRESULT)0x88890004));
+    }
+
+    std::vector<DecodedEvent> events = QueryAll(path);
+    EXPECT_EQ(3u, events.size());
+    EXPECT_EQ((uint16_t)EventType::ServiceStarted, events[0].record.type);
+    EXPECT_TRUE(events[0].deviceName.empty());
+    EXPECT_EQ(BaseMs + 2, events[1].record.timestampMs);
+    EXPECT_FLOAT_EQ(0.37f, events[1].record.oldVolume);
+    EXPECT_FLOAT_EQ(1.0f, events[1].record.newVolume);
+    EXPECT_TRUE(events[1].deviceName == L"Headset Microphone");
+    EXPECT_TRUE(events[1].endpointId == L"{0.0.1.00000000}.{mic-a}");
+    EXPECT_EQ((int32_t)0x88890004, events[2].record.hr);
+    std::filesystem::remove(path);
+}
+
+TEST_FUNCTION(BinaryEventLog_NonAsciiNames_RoundTrip) {
+    std::wstring path = TempLogPath("names");
+    std::wstring name = L"Mikrofon (Gerät) マイク";
+    {
+        BinaryLogWriter writer;
+        writer.Open(path, BaseMs);
+        writer.Describe(0, L"{mic}", name);
+        writer.Append(MakeEvent(BaseMs, 0, EventType::DeviceAdded, 0, 0.8f));
+    }
+
+    std::vector<DecodedEvent> events = QueryAll(path);
+    EXPECT_EQ(1u, events.size());
+    EXPECT_TRUE(events[0].deviceName == name);
+    std::filesystem::remove(path);
+}
+
+TEST_FUNCTION(BinaryEventLog_TimeRangeQuery_SkipsBlocksOutsideRange) {
+    std::wstring path = TempLogPath("timerange");
+    {
+        BinaryLogWriter writer(4);
+        writer.Open(path, BaseMs);
+        writer.Describe(0, L"{mic}", L"Mic");
+        for (int i = 0; i < 40; i++) {
+            writer.Append(MakeEvent(BaseMs + i * 1000, 0, EventType::VolumeCorrected, 0.5f, 1.0f));
+        }
+    }
+
+    BinaryLogQuery query;
+    query.fromMs = BaseMs + 10 * 1000;
+    query.toMs = BaseMs + 13 * 1000;
+    BinaryLogQueryStats stats;
+    std::vector<DecodedEvent> events = QueryAll(path, query, &stats);
+
+    EXPECT_EQ(4u, events.size());
+    EXPECT_EQ(BaseMs + 10 * 1000, events[0].record.timestampMs);
+    EXPECT_EQ(BaseMs + 13 * 1000, events[3].record.timestampMs);
+    EXPECT_EQ(8u, stats.blocksSkipped);
+    std::filesystem::remove(path);
+}
+
+TEST_FUNCTION(BinaryEventLog_DeviceQuery_MatchesNameCaseInsensitively) {
+    std::wstring path = TempLogPath("device");
+    {
+        BinaryLogWriter writer(8);
+        writer.Open(path, BaseMs);
+        writer.Describe(0, L"{mic-a}", L"USB Microphone");
+        writer.Describe(1, L"{mic-b}", L"Headset Microphone");
+        for (int i = 0; i < 16; i++) {
+            writer.Append(MakeEvent(BaseMs + i, 0, EventType::VolumeCorrected, 0.5f, 1.0f));
+        }
+        for (int i = 0; i < 8; i++) {
+            writer.Append(MakeEvent(BaseMs + 100 + i, 1, EventType::VolumeCorrected, 0.2f, 1.0f));
+        }
+    }
+
+    BinaryLogQuery query;
+    query.device = L"headset";
+    BinaryLogQueryStats stats;
+    std::vector<DecodedEvent> events = QueryAll(path, query, &stats);
+
+    EXPECT_EQ(8u, events.size());
+    EXPECT_EQ(1u, events[0].record.device);
+    EXPECT_EQ(2u, stats.blocksSkipped);
+
+    query.device = L"{MIC-A}";
+    EXPECT_EQ(16u, QueryAll(path, query).size());
+    std::filesystem::remove(path);
+}
+
+TEST_FUNCTION(BinaryEventLog_Reopen_StartsNewSessionForHandles) {
+    std::wstring path = TempLogPath("sessions");
+    {
+        BinaryLogWriter writer;
+        writer.Open(path, BaseMs);
+        writer.Describe(0, L"{mic-a}", L"USB Microphone");
+        writer.Append(MakeEvent(BaseMs, 0, EventType::DeviceAdded, 0, 1.0f));
+    }
+    {
+        BinaryLogWriter writer;
+        EXPECT_EQ(S_OK, writer.Open(path, BaseMs + 5000));
+        EXPECT_FALSE(writer.IsDescribed(0));
+        writer.Describe(0, L"{mic-b}", L"Headset Microphone");
+        writer.Append(MakeEvent(BaseMs + 5000, 0, EventType::DeviceAdded, 0, 1.0f));
+    }
+
+    std::vector<DecodedEvent> events = QueryAll(path);
+    EXPECT_EQ(2u, events.size());
+    EXPECT_TRUE(events[0].deviceName == L"USB Microphone");
+    EXPECT_TRUE(events[1].deviceName == L"Headset Microphone");
+
+    BinaryLogQuery query;
+    query.device = L"usb";
+    EXPECT_EQ(1u, QueryAll(path, query).size());
+    std::filesystem::remove(path);
+}
+
+TEST_FUNCTION(BinaryEventLog_PartialTrailingBlock_IsIgnoredAndTrimmed) {
+    std::wstring path = TempLogPath("partial");
+    {
+        BinaryLogWriter writer;
+        writer.Open(path, BaseMs);
+        writer.Append(MakeEvent(BaseMs, InvalidDeviceHandle, EventType::ServiceStarted, 0, 0));
+    }
+    uintmax_t validSize = std::filesystem::file_size(path);
+    {
+        // A block header promising more payload than was written, as after a crash
+        std::ofstream file(std::filesystem::path(path), std::ios::binary | std::ios::app);
+        BinaryLogBlockHeader header = {};
+        header.magic = BinaryLogBlockMagic;
+        header.kind = (uint16_t)BinaryLogBlockKind::Events;
+        header.payloadBytes = 64;
+        file.write((const char*)&header, sizeof(header));
+        file.write("partial", 7);
+    }
+
+    EXPECT_EQ(1u, QueryAll(path).size());
+
+    {
+        BinaryLogWriter writer;
+        EXPECT_EQ(S_OK, writer.Open(path, BaseMs + 1000));
+        writer.Append(MakeEvent(BaseMs + 1000, InvalidDeviceHandle, EventType::ServiceStarted, 0, 0));
+    }
+    EXPECT_TRUE(std::filesystem::file_size(path) > validSize);
+    EXPECT_EQ(2u, QueryAll(path).size());
+    std::filesystem::remove(path);
+}
+
+TEST_FUNCTION(BinaryEventLog_ForeignFile_IsRejected) {
+    std::wstring path = TempLogPath("foreign");
+    {
+        std::ofstream file(std::filesystem::path(path), std::ios::binary);
+        file << "[2025-01-01 00:00:00] Service started\n";
+    }
+
+    BinaryLogWriter writer;
+    EXPECT_EQ(E_INVALIDARG, writer.Open(path, BaseMs));
+    BinaryLogReader reader;
+    EXPECT_EQ(E_INVALIDARG, reader.Open(path));
+    std::filesystem::remove(path);
+}
+
+TEST_FUNCTION(BinaryEventLog_FlushIfDue_WritesAfterInterval) {
+    std::wstring path = TempLogPath("flush");
+    BinaryLogWriter writer(256, 1000);
+    writer.Open(path, BaseMs);
+    writer.Append(MakeEvent(BaseMs, InvalidDeviceHandle, EventType::ServiceStarted, 0, 0));
+
+    EXPECT_EQ(S_FALSE, writer.FlushIfDue(BaseMs + 999));
+    EXPECT_EQ(0u, QueryAll(path).size());
+    EXPECT_EQ(S_OK, writer.FlushIfDue(BaseMs + 1000));
+    EXPECT_EQ(1u, QueryAll(path).size());
+
+    writer.Close();
+    std::filesystem::remove(path);
+}
+
+TEST_FUNCTION(BinaryEventLog_FormatEvent_ShowsLocalTimeAndVolumes) {
+    uint64_t ms = 0;
+    EXPECT_TRUE(ParseLocalTime(L"2025-03-04 05:06:07", ms));
+    EXPECT_FALSE(ParseLocalTime(L"yesterday", ms));
+
+    DecodedEvent event = {};
+    event.record = MakeEvent(ms + 89, 0, EventType::VolumeCorrected, 0.37f, 1.0f);
+    event.deviceName = L"USB Microphone";
+
+    EXPECT_TRUE(FormatEvent(event) == L"[2025-03-04 05:06:07.089] VolumeCorrected USB Microphone 37% -> 100%");
+
+    event.record.writer = (uint16_t)WriterKind::Application;
+    EXPECT_TRUE(FormatEvent(event) ==
+                L"[2025-03-04 05:06:07.089] VolumeCorrected USB Microphone 37% -> 100% (by application)");
+}
+
+int main() {
+    std::wcout << L"Binary event log tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
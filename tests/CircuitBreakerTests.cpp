@@ -0,0 +1,490 @@
+#include <atomic>
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "SimpleTest.h"
+#include "core/CircuitBreaker.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+#include "core/StatusBlock.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+class BreakerObserver : public EnforcementObserver {
+public:
+    void OnReadFailed(DeviceHandle, HRESULT hr, CorrectionSource) override {
+        readFailures++;
+        lastReadError = hr;
+    }
+    void OnBreakerOpened(DeviceHandle, HRESULT hr, uint64_t retryInMs) override {
+        opened++;
+        openedError = hr;
+        openedRetryInMs = retryInMs;
+    }
+    void OnBreakerClosed(DeviceHandle, uint64_t openForMs) override {
+        closed++;
+        closedAfterMs = openForMs;
+    }
+    void OnCheckDropped(DeviceHandle) override { dropped++; }
+
+    int readFailures = 0;
+    HRESULT lastReadError = S_OK;
+    int opened = 0;
+    HRESULT openedError = S_OK;
+    uint64_t openedRetryInMs = 0;
+    int closed = 0;
+    uint64_t closedAfterMs = 0;
+    int dropped = 0;
+};
+
+// Waits for a pool thread to come back from a stalled call after Unstall()
+static void WaitForCalls(SimulatedEndpoint &endpoint) {
+    for (int i = 0; i < 500 && endpoint.StalledCalls() > 0; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+}
+
+TEST_FUNCTION(CircuitBreaker_FailuresInARow_OpenThenProbe) {
+    CircuitBreaker breakers;
+    BreakerOptions options;
+    options.failures = 3;
+    options.openMs = 1000;
+    options.maxOpenMs = 3000;
+    breakers.SetOptions(options);
+
+    // A success in between starts the count over
+    EXPECT_TRUE(breakers.OnFailure(2, E_FAIL, 0) == BreakerChange::None);
+    EXPECT_TRUE(breakers.OnFailure(2, E_FAIL, 0) == BreakerChange::None);
+    EXPECT_TRUE(breakers.OnSuccess(2) == BreakerChange::None);
+    EXPECT_TRUE(breakers.OnFailure(2, E_FAIL, 100) == BreakerChange::None);
+    EXPECT_TRUE(breakers.OnFailure(2, E_FAIL, 200) == BreakerChange::None);
+    EXPECT_TRUE(breakers.OnFailure(2, E_OUTOFMEMORY, 300) == BreakerChange::Opened);
+    EXPECT_TRUE(breakers.IsOpen(2));
+    EXPECT_FALSE(breakers.IsOpen(1));
+    EXPECT_EQ(1300ull, breakers.RetryAtMs(2));
+    EXPECT_EQ(E_OUTOFMEMORY, breakers.State(2).lastError);
+
+    EXPECT_FALSE(breakers.Allow(2, 1299));
+    EXPECT_TRUE(breakers.Allow(1, 1299));
+    EXPECT_TRUE(breakers.Allow(2, 1300));
+    EXPECT_TRUE(breakers.Allow(2, 1300)); // Half-open until the probe is reported
+    EXPECT_TRUE(breakers.State(2).state == BreakerState::HalfOpen);
+
+    // Failed probes double the wait up to the limit
+    EXPECT_TRUE(breakers.OnFailure(2, E_FAIL, 1300) == BreakerChange::Reopened);
+    EXPECT_EQ(3300ull, breakers.RetryAtMs(2));
+    EXPECT_TRUE(breakers.Allow(2, 3300));
+    EXPECT_TRUE(breakers.OnFailure(2, E_FAIL, 3300) == BreakerChange::Reopened);
+    EXPECT_EQ(6300ull, breakers.RetryAtMs(2));
+    EXPECT_EQ(2u, breakers.State(2).probes);
+
+    EXPECT_TRUE(breakers.Allow(2, 6300));
+    EXPECT_TRUE(breakers.OnSuccess(2) == BreakerChange::Closed);
+    EXPECT_FALSE(breakers.IsOpen(2));
+    EXPECT_EQ(UINT64_MAX, breakers.RetryAtMs(2));
+    EXPECT_EQ(300ull, breakers.State(2).openedMs);
+}
+
+TEST_FUNCTION(CircuitBreaker_FailingDevice_SkippedAndReportedOnce) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Microphone", 0.4f);
+    auto healthy = backend.AddDevice(L"{other}", L"Other Microphone", 0.4f);
+    mic->SetFailure(E_OUTOFMEMORY);
+
+    VirtualClock clock(1000);
+    BreakerObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    BreakerOptions options;
+    options.failures = 3;
+    options.openMs = 5000;
+    enforcer.SetBreakerOptions(options);
+
+    for (int sweep = 0; sweep < 10; sweep++) {
+        healthy->Tamper(0.4f);
+        enforcer.Sweep();
+        clock.Advance(1000);
+    }
+    // Three failed checks up to 3000, then it is left alone but for the probe at 8000,
+    // which failed and doubled the wait; the healthy one is enforced all along
+    EXPECT_EQ(4u, mic->getCalls.load());
+    EXPECT_EQ(4, observer.readFailures);
+    EXPECT_EQ(1, observer.opened);
+    EXPECT_EQ(E_OUTOFMEMORY, observer.openedError);
+    EXPECT_EQ(5000ull, observer.openedRetryInMs);
+    EXPECT_EQ(10u, healthy->getCalls.load());
+    EXPECT_EQ(1ull, enforcer.Metrics().breakerTrips.Value());
+
+    DeviceHandle device = enforcer.Devices().Find(L"{mic}");
+    EXPECT_TRUE(enforcer.Breakers().IsOpen(device));
+    EXPECT_EQ(18000ull, enforcer.Breakers().RetryAtMs(device));
+
+    mic->SetFailure(S_OK);
+    clock.Set(17999);
+    enforcer.Sweep();
+    EXPECT_EQ(4u, mic->getCalls.load());
+    clock.Set(18000);
+    enforcer.Sweep();
+    EXPECT_EQ(5u, mic->getCalls.load());
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_EQ(1, observer.closed);
+    EXPECT_EQ(15000ull, observer.closedAfterMs);
+    EXPECT_FALSE(enforcer.Breakers().IsOpen(device));
+}
+
+TEST_FUNCTION(CircuitBreaker_TransientErrors_DoNotTrip) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Microphone", 1.0f);
+    VirtualClock clock;
+    BreakerObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+
+    // The read and the correction of two checks fail, then it works again
+    mic->FailNext(4, E_FAIL);
+    for (int sweep = 0; sweep < 4; sweep++) {
+        enforcer.Sweep();
+        clock.Advance(2000);
+    }
+    EXPECT_EQ(2, observer.readFailures);
+    EXPECT_EQ(0, observer.opened);
+    EXPECT_EQ(4u, mic->getCalls.load());
+    EXPECT_EQ(0u, enforcer.Breakers().State(enforcer.Devices().Find(L"{mic}")).failures);
+}
+
+TEST_FUNCTION(CircuitBreaker_AdaptiveSchedule_ProbeIsScheduled) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Microphone", 1.0f);
+    mic->SetFailure(E_FAIL);
+    VirtualClock clock;
+    BreakerObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    CheckSchedule schedule;
+    schedule.minIntervalMs = 100;
+    enforcer.EnableAdaptiveSchedule(schedule);
+
+    enforcer.Sweep();
+    DeviceHandle device = enforcer.Devices().Find(L"{mic}");
+    for (int check = 0; check < 2; check++) {
+        clock.Set(enforcer.NextCheckMs());
+        enforcer.CheckDue();
+    }
+    EXPECT_EQ(1, observer.opened);
+    EXPECT_EQ(enforcer.Breakers().RetryAtMs(device), enforcer.NextCheckMs(device));
+
+    // Nothing is due before the probe, which finds the device working
+    mic->SetFailure(S_OK);
+    clock.Set(enforcer.NextCheckMs() - 1);
+    enforcer.CheckDue();
+    EXPECT_EQ(3u, mic->getCalls.load());
+    clock.Set(enforcer.NextCheckMs());
+    enforcer.CheckDue();
+    EXPECT_EQ(4u, mic->getCalls.load());
+    EXPECT_EQ(1, observer.closed);
+    EXPECT_TRUE(enforcer.NextCheckMs(device) > clock.NowMs());
+    EXPECT_TRUE(enforcer.NextCheckMs(device) <= clock.NowMs() + schedule.maxIntervalMs);
+}
+
+TEST_FUNCTION(CircuitBreaker_StalledCall_WorkerMovesOnAfterDeadline) {
+    SimulatedAudioBackend backend;
+    auto stuck = backend.AddDevice(L"{stuck}", L"Stuck Microphone", 0.4f);
+    auto healthy = backend.AddDevice(L"{ok}", L"Healthy Microphone", 0.4f);
+    VirtualClock clock;
+    BreakerObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    WorkerPool pool;
+    pool.Start(2);
+    enforcer.SetWorkerPool(&pool);
+    enforcer.SetCallDeadline(50);
+    enforcer.Sweep(); // Activates both endpoints
+
+    stuck->Stall();
+    stuck->Tamper(0.4f);
+    healthy->Tamper(0.4f);
+    auto start = std::chrono::steady_clock::now();
+    enforcer.Sweep();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_TRUE(elapsed < std::chrono::seconds(2));
+    EXPECT_EQ(1u, stuck->StalledCalls());
+    EXPECT_FLOAT_EQ(1.0f, healthy->Volume());
+    EXPECT_EQ(1ull, enforcer.Metrics().callTimeouts.Value());
+    EXPECT_EQ(MVS_E_CALL_TIMEOUT, observer.lastReadError);
+    EXPECT_EQ(1ull, pool.Abandoned().Value());
+
+    // The stuck device is not called again while its call hangs, and trips its breaker
+    for (int sweep = 0; sweep < 3; sweep++) {
+        clock.Advance(1000);
+        healthy->Tamper(0.4f);
+        enforcer.Sweep();
+        EXPECT_FLOAT_EQ(1.0f, healthy->Volume());
+    }
+    EXPECT_EQ(2u, stuck->getCalls.load());
+    EXPECT_EQ(1, observer.opened);
+    EXPECT_EQ(MVS_E_CALL_TIMEOUT, observer.openedError);
+
+    // Once the driver lets go, the probe finds it working again
+    stuck->Unstall();
+    WaitForCalls(*stuck);
+    clock.Set(enforcer.Breakers().RetryAtMs(enforcer.Devices().Find(L"{stuck}")));
+    enforcer.Sweep();
+    EXPECT_EQ(1, observer.closed);
+    EXPECT_EQ(3u, stuck->getCalls.load());
+    EXPECT_FLOAT_EQ(1.0f, stuck->Volume());
+    enforcer.SetWorkerPool(nullptr);
+}
+
+TEST_FUNCTION(CircuitBreaker_StalledCall_OutlivesDeviceTableGrowth) {
+    SimulatedAudioBackend backend;
+    auto stuck = backend.AddDevice(L"{stuck}", L"Stuck Microphone", 1.0f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    WorkerPool pool;
+    pool.Start(1);
+    enforcer.SetWorkerPool(&pool);
+    enforcer.SetCallDeadline(20);
+    enforcer.Sweep();
+
+    stuck->Stall();
+    stuck->Tamper(0.4f);
+    enforcer.Sweep();
+    EXPECT_EQ(1u, stuck->StalledCalls());
+
+    // Hotplug while the call hangs: the device table reallocates its slots
+    for (int i = 0; i < 200; i++)
+        backend.AddDevice(L"{mic" + std::to_wstring(i) + L"}", L"Microphone " + std::to_wstring(i), 1.0f);
+    clock.Advance(1000);
+    enforcer.Sweep();
+    EXPECT_EQ(201u, enforcer.ActiveDevices().size());
+
+    // The late call writes the target it was given, read from its own record
+    stuck->Unstall();
+    WaitForCalls(*stuck);
+    EXPECT_FLOAT_EQ(1.0f, stuck->Volume());
+    enforcer.SetWorkerPool(nullptr);
+}
+
+TEST_FUNCTION(CircuitBreaker_StalledCall_OutlivesEnforcerAndPool) {
+    SimulatedAudioBackend backend;
+    auto stuck = backend.AddDevice(L"{stuck}", L"Stuck Microphone", 1.0f);
+    {
+        VirtualClock clock;
+        EnforcementObserver observer;
+        WorkerPool pool;
+        pool.Start(1);
+        MicrophoneEnforcer enforcer(backend, clock, observer);
+        enforcer.SetWorkerPool(&pool);
+        enforcer.SetCallDeadline(20);
+        enforcer.Sweep();
+
+        stuck->Stall();
+        stuck->Tamper(0.4f);
+        enforcer.Sweep();
+        EXPECT_EQ(1u, stuck->StalledCalls());
+
+        // As at service stop: the stuck thread is detached, then the enforcer goes away
+        enforcer.SetWorkerPool(nullptr);
+        pool.Stop();
+    }
+
+    // The call returns into a record and a task it keeps alive itself
+    stuck->Unstall();
+    WaitForCalls(*stuck);
+    EXPECT_FLOAT_EQ(1.0f, stuck->Volume());
+}
+
+TEST_FUNCTION(CircuitBreaker_StalledActivation_OnPoolUnderDeadline) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Microphone", 0.4f);
+    std::atomic<bool> slow{true};
+    backend.activateHook = [&slow]() {
+        if (slow)
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    };
+    VirtualClock clock;
+    BreakerObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    WorkerPool pool;
+    pool.Start(2);
+    enforcer.SetWorkerPool(&pool);
+    enforcer.SetCallDeadline(20);
+
+    // The endpoint is activated on the pool, so the worker gives up on it at the deadline
+    auto start = std::chrono::steady_clock::now();
+    enforcer.Sweep();
+    EXPECT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(200));
+    EXPECT_EQ(1ull, enforcer.Metrics().callTimeouts.Value());
+    EXPECT_EQ(MVS_E_CALL_TIMEOUT, observer.lastReadError);
+
+    // Once activated it is cached like one activated on the worker
+    slow = false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    clock.Advance(1000);
+    enforcer.Sweep();
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_EQ(1u, (unsigned)enforcer.Session().CachedEndpointCount());
+    enforcer.Sweep();
+    EXPECT_EQ(2ull, backend.counters.activations);
+    enforcer.SetWorkerPool(nullptr);
+}
+
+TEST_FUNCTION(CircuitBreaker_StalledCallOnEveryThread_HealthyDeviceStillCorrected) {
+    SimulatedAudioBackend backend;
+    auto first = backend.AddDevice(L"{stuck1}", L"Stuck Microphone 1", 0.4f);
+    auto second = backend.AddDevice(L"{stuck2}", L"Stuck Microphone 2", 0.4f);
+    auto healthy = backend.AddDevice(L"{ok}", L"Healthy Microphone", 0.4f);
+    VirtualClock clock;
+    BreakerObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    WorkerPool pool;
+    pool.Start(2, 2);
+    enforcer.SetWorkerPool(&pool);
+    enforcer.SetCallDeadline(30);
+    enforcer.Sweep();
+
+    // Each thread hangs in a call of its own; spares take over their shards
+    first->Stall();
+    second->Stall();
+    for (int sweep = 0; sweep < 3; sweep++) {
+        clock.Advance(1000);
+        healthy->Tamper(0.4f);
+        enforcer.Sweep();
+        EXPECT_FLOAT_EQ(1.0f, healthy->Volume());
+    }
+    EXPECT_EQ(2u, first->StalledCalls() + second->StalledCalls());
+    EXPECT_EQ(2ull, pool.Replaced().Value());
+    EXPECT_EQ(0ull, enforcer.Metrics().checksDropped.Value());
+    EXPECT_EQ(0, observer.dropped);
+
+    first->Unstall();
+    second->Unstall();
+    WaitForCalls(*first);
+    WaitForCalls(*second);
+    enforcer.SetWorkerPool(nullptr);
+}
+
+TEST_FUNCTION(CircuitBreaker_NoSpareThread_DroppedChecksReported) {
+    SimulatedAudioBackend backend;
+    auto first = backend.AddDevice(L"{mic1}", L"Stuck Microphone 1", 0.4f);
+    auto second = backend.AddDevice(L"{mic2}", L"Stuck Microphone 2", 0.4f);
+    auto healthy = backend.AddDevice(L"{mic3}", L"Healthy Microphone", 0.4f);
+    VirtualClock clock(10000);
+    BreakerObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    WorkerPool pool;
+    pool.Start(2);
+    enforcer.SetWorkerPool(&pool);
+    enforcer.SetCallDeadline(30);
+    enforcer.Sweep();
+
+    // Each thread runs its own shard first, so both hang before either reaches the healthy device
+    first->Stall();
+    second->Stall();
+    healthy->Tamper(0.4f);
+    enforcer.Sweep();
+    clock.Advance(1000);
+    enforcer.Sweep();
+    EXPECT_FLOAT_EQ(0.4f, healthy->Volume());
+    EXPECT_EQ(2ull, enforcer.Metrics().checksDropped.Value());
+    EXPECT_EQ(2, observer.dropped);
+
+    StatusSnapshot status = StatusSnapshot();
+    CaptureStatus(enforcer, clock.NowMs(), 1700000000000ull, status);
+    EXPECT_EQ(2ull, status.checksDropped);
+    status.state = (uint8_t)ServiceState::Enforcing;
+    status.startedWallMs = 1700000000000ull;
+    std::wstring text = FormatStatus(status, 1700000000000ull);
+    EXPECT_TRUE(text.find(L"Checks timed out 4, dropped 2") != std::wstring::npos);
+
+    // Once a thread returns the healthy device is checked again
+    first->Unstall();
+    second->Unstall();
+    WaitForCalls(*first);
+    WaitForCalls(*second);
+    clock.Advance(1000);
+    enforcer.Sweep();
+    EXPECT_FLOAT_EQ(1.0f, healthy->Volume());
+    enforcer.SetWorkerPool(nullptr);
+}
+
+TEST_FUNCTION(CircuitBreaker_StalledActivation_FailsAfterShutdown) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Microphone", 0.4f);
+    std::atomic<bool> slow{true};
+    backend.activateHook = [&slow]() {
+        if (slow)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    };
+    VirtualClock clock;
+    BreakerObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    WorkerPool pool;
+    pool.Start(1);
+    enforcer.SetWorkerPool(&pool);
+    enforcer.SetCallDeadline(20);
+    enforcer.Sweep();
+    EXPECT_EQ(1ull, enforcer.Metrics().callTimeouts.Value());
+
+    // As at a -whenrunning disarm: the backend is uninitialized under the late activation
+    enforcer.Shutdown();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(0ull, backend.counters.activations);
+    EXPECT_FLOAT_EQ(0.4f, mic->Volume());
+
+    slow = false;
+    clock.Advance(1000);
+    enforcer.Sweep();
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    enforcer.SetWorkerPool(nullptr);
+}
+
+TEST_FUNCTION(CircuitBreaker_SlowCallWithoutPool_CountsAsTimeout) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Microphone", 0.4f);
+    mic->SetCallHook([]() { std::this_thread::sleep_for(std::chrono::milliseconds(15)); });
+    VirtualClock clock;
+    BreakerObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.SetCallDeadline(5);
+
+    // The level found is still applied; the breaker sees the overrun
+    enforcer.Sweep();
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_EQ(1ull, enforcer.Metrics().callTimeouts.Value());
+    EXPECT_EQ(1u, enforcer.Breakers().State(enforcer.Devices().Find(L"{mic}")).failures);
+
+    enforcer.SetCallDeadline(0);
+    clock.Advance(2000);
+    enforcer.Sweep();
+    EXPECT_EQ(1ull, enforcer.Metrics().callTimeouts.Value());
+    EXPECT_EQ(0u, enforcer.Breakers().State(enforcer.Devices().Find(L"{mic}")).failures);
+}
+
+TEST_FUNCTION(CircuitBreaker_OpenBreaker_ShownInStatus) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"USB Microphone", 1.0f);
+    mic->SetFailure(E_FAIL);
+    VirtualClock clock(10000);
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    for (int sweep = 0; sweep < 3; sweep++)
+        enforcer.Sweep();
+
+    StatusSnapshot status = StatusSnapshot();
+    CaptureStatus(enforcer, clock.NowMs(), 1700000000000ull, status);
+    EXPECT_TRUE(status.devices[0].flags & DeviceStatusFailing);
+    EXPECT_EQ(5000, status.devices[0].nextCheckInMs);
+
+    status.state = (uint8_t)ServiceState::Enforcing;
+    status.startedWallMs = 1700000000000ull;
+    std::wstring text = FormatStatus(status, 1700000000000ull);
+    EXPECT_TRUE(text.find(L"Devices: 1 present, 1 failing") != std::wstring::npos);
+    EXPECT_TRUE(text.find(L"failing (circuit open)") != std::wstring::npos);
+    EXPECT_TRUE(text.find(L"next probe in 5000 ms") != std::wstring::npos);
+}
+
+int main() {
+    std::wcout << L"Circuit breaker tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
@@ -0,0 +1,143 @@
+// Information messages are compiled out of this file, to test the compile-time filter
+#define MVS_LOG_MIN_LEVEL 1
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/AsyncLogger.h"
+#include "core/DeferredLog.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+class MemorySink : public LogSink {
+public:
+    HRESULT Write(const LogRecord& record) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        messages.push_back(std::wstring(record.text, record.length));
+        levels.push_back(record.level);
+        return S_OK;
+    }
+    HRESULT Flush() override { return S_OK; }
+
+    std::mutex mutex;
+    std::vector<std::wstring> messages;
+    std::vector<LogLevel> levels;
+};
+
+static std::wstring Format(const wchar_t* format, std::initializer_list<LogArg> args, const LogNames& names) {
+    DeferredLogRecord deferred = DeferredLogRecord();
+    deferred.level = LogLevel::Information;
+    deferred.format = format;
+    for (const LogArg& arg : args)
+        deferred.args[deferred.argCount++] = arg;
+    LogRecord record;
+    FormatDeferred(deferred, names, record);
+    return std::wstring(record.text, record.length);
+}
+
+static int g_evaluations = 0;
+
+static int Counted(int value) {
+    g_evaluations++;
+    return value;
+}
+
+TEST_FUNCTION(DeferredLog_Format_TypedArguments) {
+    LogNames names;
+    names.Set(2, L"USB Microphone");
+
+    EXPECT_EQ(std::wstring(L"Volume changed for USB Microphone: 37% -> 100%"),
+              Format(L"Volume changed for {}: {} -> {}", {LogArg::Device(2), LogArg::Percent(0.37f), LogArg::Percent(1.0f)}, names));
+    EXPECT_EQ(std::wstring(L"ERROR: Volume setting error for device 5: -2147024891"),
+              Format(L"ERROR: Volume setting error for {}: {}", {LogArg::Device(5), LogArg((HRESULT)0x80070005)}, names));
+    EXPECT_EQ(std::wstring(L"18446744073709551615 corrections (changed by application)"),
+              Format(L"{} corrections{}", {LogArg(UINT64_MAX), LogArg(L" (changed by application)")}, names));
+
+    // Placeholders without an argument are left alone
+    EXPECT_EQ(std::wstring(L"a 1 b {} c"), Format(L"a {} b {} c", {LogArg(1)}, names));
+
+    names.Set(2, L"Renamed");
+    EXPECT_EQ(std::wstring(L"Renamed"), Format(L"{}", {LogArg::Device(2)}, names));
+}
+
+TEST_FUNCTION(DeferredLog_Format_TruncatesAtRecordSize) {
+    LogNames names;
+    names.Set(0, std::wstring(300, L'x'));
+    DeferredLogRecord deferred = DeferredLogRecord();
+    deferred.format = L"Name {} and more";
+    deferred.argCount = 1;
+    deferred.args[0] = LogArg::Device(0);
+
+    LogRecord record;
+    FormatDeferred(deferred, names, record);
+    EXPECT_EQ((size_t)LogRecordMaxChars - 1, (size_t)record.length);
+    EXPECT_EQ(L'\0', record.text[record.length]);
+}
+
+TEST_FUNCTION(DeferredLog_Logger_FormatsOnWriterInOrder) {
+    auto sink = std::make_shared<MemorySink>();
+    AsyncLogger logger;
+    logger.SetSink(sink);
+    logger.Names().Set(1, L"Headset");
+    logger.Start();
+
+    logger.Log(LogLevel::Warning, L"text before");
+    MVS_LOG_WARNING(logger, L"Volume corrected to {} for: {}", LogArg::Percent(0.5f), LogArg::Device(1));
+    MVS_LOG_ERROR(logger, L"ERROR: Mute setting error for {}: {}", LogArg::Device(1), (HRESULT)E_FAIL);
+    logger.Log(LogLevel::Error, L"text after");
+    logger.Stop();
+
+    EXPECT_EQ(4u, sink->messages.size());
+    EXPECT_EQ(std::wstring(L"Volume corrected to 50% for: Headset"), sink->messages[1]);
+    EXPECT_EQ(std::wstring(L"ERROR: Mute setting error for Headset: ") + std::to_wstring((HRESULT)E_FAIL),
+              sink->messages[2]);
+    EXPECT_TRUE(sink->levels[2] == LogLevel::Error);
+    EXPECT_EQ(std::wstring(L"text after"), sink->messages[3]);
+
+    // Stopped: written synchronously, still formatted
+    MVS_LOG_WARNING(logger, L"after stop {}", 7);
+    EXPECT_EQ(std::wstring(L"after stop 7"), sink->messages.back());
+}
+
+TEST_FUNCTION(DeferredLog_RuntimeLevel_SkipsArguments) {
+    auto sink = std::make_shared<MemorySink>();
+    AsyncLogger logger;
+    logger.SetSink(sink);
+    logger.SetMinLevel(LogLevel::Error);
+    g_evaluations = 0;
+
+    MVS_LOG_WARNING(logger, L"filtered {}", Counted(1));
+    logger.Log(LogLevel::Warning, L"filtered too");
+    MVS_LOG_ERROR(logger, L"kept {}", Counted(2));
+
+    EXPECT_EQ(1, g_evaluations);
+    EXPECT_EQ(1u, sink->messages.size());
+    EXPECT_EQ(std::wstring(L"kept 2"), sink->messages[0]);
+}
+
+TEST_FUNCTION(DeferredLog_CompileTimeLevel_RemovesCall) {
+    auto sink = std::make_shared<MemorySink>();
+    AsyncLogger logger;
+    logger.SetSink(sink);
+    g_evaluations = 0;
+
+    // MVS_LOG_MIN_LEVEL 1 above: the call and its arguments are gone, even at run-time level Information
+    MVS_LOG_INFO(logger, L"compiled out {}", Counted(1));
+    if (g_evaluations == 0)
+        MVS_LOG_INFO(logger, L"also compiled out");
+    else
+        MVS_LOG_WARNING(logger, L"not reached");
+
+    EXPECT_EQ(0, g_evaluations);
+    EXPECT_EQ(0u, sink->messages.size());
+}
+
+int main() {
+    std::wcout << L"Deferred log tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
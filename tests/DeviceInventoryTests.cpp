@@ -0,0 +1,141 @@
+#include <iostream>
+#include <algorithm>
+#include "SimpleTest.h"
+#include "core/DeviceInventory.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+static bool Has(const std::vector<std::wstring>& ids, const std::wstring& id) {
+    return std::find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+TEST_FUNCTION(Inventory_Build_EnumeratesCaptureDevicesOnce) {
+    SimulatedAudioBackend backend;
+    backend.Initialize();
+    backend.AddDevice(L"{mic-1}", L"USB Microphone");
+    backend.AddDevice(L"{speakers}", L"Speakers", 0.5f, DataFlow::Render);
+    DeviceInventory inventory;
+
+    EXPECT_TRUE(SUCCEEDED(inventory.Build(backend)));
+    EXPECT_TRUE(inventory.IsNotifying());
+    EXPECT_EQ(1u, inventory.CaptureDevices().size());
+    EXPECT_TRUE(inventory.Contains(L"{mic-1}"));
+    EXPECT_EQ(1ull, inventory.Generation());
+
+    // Nothing changed: applying is free and the generation stays put
+    EXPECT_TRUE(inventory.ApplyPending(backend).Empty());
+    EXPECT_EQ(1ull, inventory.Generation());
+    EXPECT_EQ(1ull, backend.counters.enumerations);
+}
+
+TEST_FUNCTION(Inventory_Hotplug_AddedAndRemovedWithoutEnumeration) {
+    SimulatedAudioBackend backend;
+    backend.Initialize();
+    backend.AddDevice(L"{mic-1}", L"USB Microphone");
+    int wakes = 0;
+    DeviceInventory inventory([&wakes]() { wakes++; });
+    inventory.Build(backend);
+
+    backend.AddDevice(L"{headset}", L"Bluetooth Headset");
+    EXPECT_EQ(1, wakes);
+    EXPECT_TRUE(inventory.HasPending());
+
+    InventoryChanges changes = inventory.ApplyPending(backend);
+    EXPECT_TRUE(Has(changes.added, L"{headset}"));
+    EXPECT_TRUE(inventory.Contains(L"{headset}"));
+    EXPECT_EQ(2ull, inventory.Generation());
+
+    backend.RemoveDevice(L"{mic-1}");
+    changes = inventory.ApplyPending(backend);
+    EXPECT_TRUE(Has(changes.removed, L"{mic-1}"));
+    EXPECT_FALSE(inventory.Contains(L"{mic-1}"));
+    EXPECT_EQ(3ull, inventory.Generation());
+
+    EXPECT_EQ(1ull, backend.counters.enumerations);
+}
+
+TEST_FUNCTION(Inventory_RenderDeviceAdded_Ignored) {
+    SimulatedAudioBackend backend;
+    backend.Initialize();
+    DeviceInventory inventory;
+    inventory.Build(backend);
+
+    backend.AddDevice(L"{hdmi}", L"HDMI Output", 0.5f, DataFlow::Render);
+    EXPECT_TRUE(inventory.ApplyPending(backend).Empty());
+    EXPECT_EQ(0u, inventory.CaptureDevices().size());
+    EXPECT_EQ(1ull, inventory.Generation());
+}
+
+TEST_FUNCTION(Inventory_StateChanged_UnplugAndReplug) {
+    SimulatedAudioBackend backend;
+    backend.Initialize();
+    backend.AddDevice(L"{jack-mic}", L"Rear Mic");
+    DeviceInventory inventory;
+    inventory.Build(backend);
+
+    const unsigned unplugged = 0x00000008;
+    backend.SetDeviceState(L"{jack-mic}", unplugged);
+    inventory.ApplyPending(backend);
+    EXPECT_FALSE(inventory.Contains(L"{jack-mic}"));
+
+    backend.SetDeviceState(L"{jack-mic}", EndpointStateActive);
+    inventory.ApplyPending(backend);
+    EXPECT_TRUE(inventory.Contains(L"{jack-mic}"));
+}
+
+TEST_FUNCTION(Inventory_FlappingDeviceInOneBatch_ReportedOnce) {
+    SimulatedAudioBackend backend;
+    backend.Initialize();
+    DeviceInventory inventory;
+    inventory.Build(backend);
+
+    backend.AddDevice(L"{usb}", L"USB Microphone");
+    backend.RemoveDevice(L"{usb}");
+    backend.AddDevice(L"{usb}", L"USB Microphone");
+
+    InventoryChanges changes = inventory.ApplyPending(backend);
+    EXPECT_EQ(1u, changes.added.size());
+    EXPECT_EQ(0u, changes.removed.size());
+    EXPECT_TRUE(inventory.Contains(L"{usb}"));
+}
+
+TEST_FUNCTION(Inventory_DefaultAndRename_Tracked) {
+    SimulatedAudioBackend backend;
+    backend.Initialize();
+    backend.AddDevice(L"{mic-1}", L"USB Microphone");
+    backend.AddDevice(L"{mic-2}", L"Headset");
+    DeviceInventory inventory;
+    inventory.Build(backend);
+    uint64_t generation = inventory.Generation();
+
+    backend.SetDefaultCaptureDevice(L"{mic-2}");
+    backend.RenameDevice(L"{mic-1}", L"Studio Mic");
+    InventoryChanges changes = inventory.ApplyPending(backend);
+
+    EXPECT_TRUE(changes.defaultChanged);
+    EXPECT_TRUE(inventory.DefaultCaptureDevice() == L"{mic-2}");
+    EXPECT_TRUE(Has(changes.renamed, L"{mic-1}"));
+    EXPECT_EQ(generation + 1, inventory.Generation());
+}
+
+TEST_FUNCTION(Inventory_Reset_Unregisters) {
+    SimulatedAudioBackend backend;
+    backend.Initialize();
+    DeviceInventory inventory;
+    inventory.Build(backend);
+
+    inventory.Reset(backend);
+    EXPECT_FALSE(inventory.IsBuilt());
+    EXPECT_FALSE(inventory.IsNotifying());
+
+    backend.AddDevice(L"{mic-1}", L"USB Microphone");
+    EXPECT_FALSE(inventory.HasPending());
+}
+
+int main() {
+    std::wcout << L"Device inventory tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include "SimpleTest.h"
+#include "core/AudioSession.h"
+#include "core/DeviceTable.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+TEST_FUNCTION(DeviceTable_Intern_ReturnsStableDenseHandles) {
+    DeviceTable table;
+
+    DeviceHandle first = table.Intern(L"{0.0.1.00000000}.{11111111-aaaa}");
+    DeviceHandle second = table.Intern(L"{0.0.1.00000000}.{22222222-bbbb}");
+
+    EXPECT_EQ(0u, first);
+    EXPECT_EQ(1u, second);
+    EXPECT_EQ(first, table.Intern(L"{0.0.1.00000000}.{11111111-aaaa}"));
+    EXPECT_EQ(2u, table.Size());
+    EXPECT_TRUE(table.EndpointId(second) == L"{0.0.1.00000000}.{22222222-bbbb}");
+}
+
+TEST_FUNCTION(DeviceTable_Find_UnknownIdIsInvalid) {
+    DeviceTable table;
+    table.Intern(L"{mic-1}");
+
+    EXPECT_EQ(InvalidDeviceHandle, table.Find(L"{mic-2}"));
+    EXPECT_FALSE(table.IsValid(InvalidDeviceHandle));
+}
+
+TEST_FUNCTION(DeviceTable_NewSlot_HasDefaults) {
+    DeviceTable table;
+    DeviceSlot& slot = table.Slot(table.Intern(L"{mic-1}"));
+
+    EXPECT_FLOAT_EQ(-1.0f, slot.lastVolume);
+    EXPECT_FLOAT_EQ(1.0f, slot.targetVolume);
+    EXPECT_FLOAT_EQ(0.01f, slot.tolerance);
+    EXPECT_EQ(0u, slot.errorCount);
+    EXPECT_FALSE(slot.present);
+}
+
+TEST_FUNCTION(DeviceTable_IdenticalHeadsets_GetSeparateState) {
+    SimulatedAudioBackend backend;
+    DeviceTable table;
+    backend.AddDevice(L"{headset-a}", L"Headset Microphone (Arctis 7)", 0.2f);
+    backend.AddDevice(L"{headset-b}", L"Headset Microphone (Arctis 7)", 0.9f);
+    AudioSession session(backend, table);
+    session.Open();
+
+    std::vector<DeviceHandle> devices;
+    session.EnumerateCaptureEndpoints(devices);
+    EXPECT_EQ(2u, devices.size());
+
+    for (DeviceHandle device : devices) {
+        session.GetVolume(device, &table.Slot(device).lastVolume);
+    }
+
+    EXPECT_FLOAT_EQ(0.2f, table.Slot(table.Find(L"{headset-a}")).lastVolume);
+    EXPECT_FLOAT_EQ(0.9f, table.Slot(table.Find(L"{headset-b}")).lastVolume);
+}
+
+TEST_FUNCTION(DeviceTable_RenamedDevice_KeepsSlot) {
+    SimulatedAudioBackend backend;
+    DeviceTable table;
+    backend.AddDevice(L"{mic-1}", L"USB Microphone");
+    AudioSession session(backend, table);
+    session.Open();
+
+    DeviceHandle device = table.Intern(L"{mic-1}");
+    table.Slot(device).corrections = 7;
+    EXPECT_TRUE(session.GetName(device) == L"USB Microphone");
+
+    backend.RenameDevice(L"{mic-1}", L"Podcast Mic");
+    session.ForgetName(device);
+
+    EXPECT_TRUE(session.GetName(device) == L"Podcast Mic");
+    EXPECT_EQ(device, table.Intern(L"{mic-1}"));
+    EXPECT_EQ(7u, table.Slot(device).corrections);
+}
+
+int main() {
+    std::wcout << L"Device table tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
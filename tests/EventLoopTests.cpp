@@ -0,0 +1,132 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/EventLoop.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+TEST_FUNCTION(EventLoop_SignalsBeforeDispatch_CoalesceIntoOneWakeup) {
+    VirtualClock clock;
+    EventLoop loop(clock);
+    int first = 0, second = 0;
+    loop.SetSource(0, [&]() { first++; });
+    loop.SetSource(1, [&]() { second++; });
+
+    EXPECT_FALSE(loop.Poll());
+    loop.Signal(0);
+    loop.Signal(0);
+    loop.Signal(1);
+    EXPECT_TRUE(loop.Poll());
+    EXPECT_EQ(1, first);
+    EXPECT_EQ(1, second);
+    EXPECT_EQ(1ull, loop.Wakeups().Value());
+    EXPECT_FALSE(loop.Poll());
+}
+
+TEST_FUNCTION(EventLoop_Timers_FireWhenDueInIdOrder) {
+    VirtualClock clock(1000);
+    EventLoop loop(clock);
+    std::vector<int> fired;
+    loop.SetTimer(0, [&]() { fired.push_back(0); });
+    loop.SetTimer(1, [&]() { fired.push_back(1); });
+    loop.SetTimer(2, [&]() { fired.push_back(2); });
+    loop.Schedule(2, 1500);
+    loop.Schedule(1, 1500);
+    loop.Schedule(0, 3000);
+    EXPECT_EQ(1500ull, loop.NextDueMs());
+
+    EXPECT_FALSE(loop.Poll());
+    clock.Set(1500);
+    EXPECT_TRUE(loop.Poll());
+    EXPECT_EQ(2u, fired.size());
+    EXPECT_EQ(1, fired[0]);
+    EXPECT_EQ(2, fired[1]);
+
+    // A cancelled timer never fires
+    loop.Cancel(0);
+    clock.Set(5000);
+    EXPECT_FALSE(loop.Poll());
+    EXPECT_EQ(TimerWheel::Never, loop.NextDueMs());
+}
+
+TEST_FUNCTION(EventLoop_BeforeWait_RearmsTimerEveryTurn) {
+    VirtualClock clock;
+    EventLoop loop(clock);
+    int checks = 0;
+    uint64_t nextCheck = 250;
+    loop.SetTimer(0, [&]() {
+        checks++;
+        nextCheck += 250;
+    });
+    loop.SetBeforeWait([&]() { loop.Schedule(0, nextCheck); });
+
+    for (int i = 0; i < 4; i++) {
+        clock.Advance(250);
+        EXPECT_TRUE(loop.Poll());
+    }
+    EXPECT_EQ(4, checks);
+    EXPECT_FALSE(loop.Poll());
+    EXPECT_EQ(1250ull, loop.DueMs(0));
+}
+
+TEST_FUNCTION(EventLoop_StopBeforeRun_ReturnsRightAway) {
+    VirtualClock clock;
+    EventLoop loop(clock);
+    loop.Stop();
+    loop.Run();
+    EXPECT_TRUE(loop.StopRequested());
+    EXPECT_EQ(0ull, loop.Wakeups().Value());
+}
+
+TEST_FUNCTION(EventLoop_Idle_NeverWakesUntilSignalled) {
+    SteadyClock clock;
+    EventLoop loop(clock);
+    std::atomic<int> handled{0};
+    loop.SetSource(3, [&]() { handled++; });
+    std::thread worker([&]() { loop.Run(); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(0ull, loop.Wakeups().Value());
+
+    loop.Signal(3);
+    while (handled.load() == 0)
+        std::this_thread::yield();
+    loop.Stop();
+    worker.join();
+    EXPECT_EQ(1, handled.load());
+    EXPECT_EQ(1ull, loop.Wakeups().Value());
+}
+
+TEST_FUNCTION(EventLoop_SignalsWhileHandling_AreNotLost) {
+    SteadyClock clock;
+    EventLoop loop(clock);
+    const int signalCount = 10000;
+    std::atomic<int> sent{0};
+    std::atomic<bool> done{false};
+    loop.SetSource(0, [&]() {
+        // Everything sent before this dispatch is handled by it or a later one
+        if (sent.load() == signalCount)
+            done = true;
+    });
+    std::thread worker([&]() { loop.Run(); });
+
+    for (int i = 0; i < signalCount; i++) {
+        sent++;
+        loop.Signal(0);
+    }
+    while (!done.load())
+        std::this_thread::yield();
+    loop.Stop();
+    worker.join();
+    EXPECT_TRUE(loop.Wakeups().Value() <= (uint64_t)signalCount);
+}
+
+int main() {
+    std::wcout << L"Event loop tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
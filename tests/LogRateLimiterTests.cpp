@@ -0,0 +1,277 @@
+#include <iostream>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/EventLoop.h"
+#include "core/LogRateLimiter.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+// Logs the way the service does: ask the limiter first, count the lines it lets through
+class LimitedLogObserver : public EnforcementObserver {
+public:
+    LimitedLogObserver(LogRateLimiter &limiter, Clock &clock) : limiter(limiter), clock(clock) {}
+
+    void OnVolumeCorrected(DeviceHandle device, float, float, CorrectionSource) override {
+        events++;
+        if (limiter.Allow(device, LogKind::VolumeCorrected, clock.NowMs()))
+            lines++;
+    }
+    void OnCorrectionFailed(DeviceHandle device, float, float, HRESULT, CorrectionSource) override {
+        events++;
+        if (limiter.Allow(device, LogKind::CorrectionFailed, clock.NowMs()))
+            lines++;
+    }
+
+    void TakeSummaries(bool all = false) {
+        LogSummary summary;
+        while (limiter.NextSummary(clock.NowMs(), summary, all)) {
+            summaries++;
+            summarized += summary.suppressed;
+        }
+    }
+
+    LogRateLimiter &limiter;
+    Clock &clock;
+    uint64_t events = 0;
+    uint64_t lines = 0;
+    uint64_t summaries = 0;
+    uint64_t summarized = 0;
+};
+
+TEST_FUNCTION(LogRateLimiter_Burst_ThenOnePerRefill) {
+    LogRateLimiter limiter;
+    LogLimitOptions options;
+    options.burst = 3;
+    options.refillMs = 1000;
+    options.summaryMs = 60000;
+    limiter.SetOptions(options);
+
+    EXPECT_TRUE(limiter.Allow(1, LogKind::CorrectionFailed, 0));
+    EXPECT_TRUE(limiter.Allow(1, LogKind::CorrectionFailed, 10));
+    EXPECT_TRUE(limiter.Allow(1, LogKind::CorrectionFailed, 20));
+    EXPECT_FALSE(limiter.Allow(1, LogKind::CorrectionFailed, 30));
+    EXPECT_FALSE(limiter.Allow(1, LogKind::CorrectionFailed, 999));
+
+    // Other kinds and devices have their own buckets
+    EXPECT_TRUE(limiter.Allow(1, LogKind::MuteFailed, 999));
+    EXPECT_TRUE(limiter.Allow(0, LogKind::CorrectionFailed, 999));
+
+    EXPECT_TRUE(limiter.Allow(1, LogKind::CorrectionFailed, 1000));
+    EXPECT_FALSE(limiter.Allow(1, LogKind::CorrectionFailed, 1500));
+    EXPECT_TRUE(limiter.Allow(1, LogKind::CorrectionFailed, 2000));
+    EXPECT_EQ(3ull, limiter.Suppressed().Value());
+
+    // A quiet spell refills the bucket, but never past the burst
+    for (int i = 0; i < 3; i++)
+        EXPECT_TRUE(limiter.Allow(1, LogKind::CorrectionFailed, 100000 + i));
+    EXPECT_FALSE(limiter.Allow(1, LogKind::CorrectionFailed, 100003));
+}
+
+TEST_FUNCTION(LogRateLimiter_Summary_DueAfterPeriod) {
+    LogRateLimiter limiter;
+    LogLimitOptions options;
+    options.burst = 1;
+    options.refillMs = 1000000;
+    options.summaryMs = 600000;
+    limiter.SetOptions(options);
+
+    LogSummary summary;
+    EXPECT_FALSE(limiter.NextSummary(0, summary));
+    EXPECT_TRUE(limiter.Allow(2, LogKind::VolumeCorrected, 0));
+    for (uint64_t ms = 2000; ms <= 600000; ms += 2000)
+        EXPECT_FALSE(limiter.Allow(2, LogKind::VolumeCorrected, ms));
+
+    EXPECT_FALSE(limiter.NextSummary(601999, summary));
+    EXPECT_TRUE(limiter.NextSummary(602000, summary));
+    EXPECT_EQ(2u, summary.device);
+    EXPECT_TRUE(summary.kind == LogKind::VolumeCorrected);
+    EXPECT_EQ(300ull, summary.suppressed);
+    EXPECT_EQ(600000ull, summary.periodMs);
+    EXPECT_FALSE(limiter.NextSummary(602000, summary));
+
+    // The next period starts with the next suppressed line
+    EXPECT_FALSE(limiter.Allow(2, LogKind::VolumeCorrected, 700000));
+    EXPECT_FALSE(limiter.NextSummary(1299999, summary));
+    EXPECT_TRUE(limiter.NextSummary(1300000, summary));
+    EXPECT_EQ(1ull, summary.suppressed);
+}
+
+TEST_FUNCTION(LogRateLimiter_All_TakesPendingSummaries) {
+    LogRateLimiter limiter;
+    LogLimitOptions options;
+    options.burst = 1;
+    limiter.SetOptions(options);
+
+    limiter.Allow(0, LogKind::CallTimeout, 0);
+    limiter.Allow(0, LogKind::CallTimeout, 1);
+    limiter.Allow(3, LogKind::MuteFailed, 0);
+    limiter.Allow(3, LogKind::MuteFailed, 1);
+    limiter.Allow(3, LogKind::MuteFailed, 2);
+
+    LogSummary summary;
+    EXPECT_FALSE(limiter.NextSummary(10, summary));
+    EXPECT_TRUE(limiter.NextSummary(10, summary, true));
+    EXPECT_EQ(0u, summary.device);
+    EXPECT_EQ(1ull, summary.suppressed);
+    EXPECT_TRUE(limiter.NextSummary(10, summary, true));
+    EXPECT_EQ(3u, summary.device);
+    EXPECT_TRUE(summary.kind == LogKind::MuteFailed);
+    EXPECT_EQ(2ull, summary.suppressed);
+    EXPECT_FALSE(limiter.NextSummary(10, summary, true));
+
+    // A forgotten device starts with a full bucket
+    limiter.Forget(3);
+    EXPECT_TRUE(limiter.Allow(3, LogKind::MuteFailed, 20));
+}
+
+TEST_FUNCTION(LogRateLimiter_TakeSummary_OnlyThatDevice) {
+    LogRateLimiter limiter;
+    LogLimitOptions options;
+    options.burst = 1;
+    limiter.SetOptions(options);
+
+    for (uint64_t now = 0; now < 3; now++) {
+        limiter.Allow(0, LogKind::CallTimeout, now);
+        limiter.Allow(2, LogKind::VolumeCorrected, now);
+        limiter.Allow(2, LogKind::MuteFailed, now);
+    }
+
+    LogSummary summary;
+    EXPECT_TRUE(limiter.TakeSummary(2, 10, summary));
+    EXPECT_EQ(2u, summary.device);
+    EXPECT_TRUE(summary.kind == LogKind::VolumeCorrected);
+    EXPECT_EQ(2ull, summary.suppressed);
+    EXPECT_EQ(9ull, summary.periodMs); // From the first suppressed line, at 1
+    EXPECT_TRUE(limiter.TakeSummary(2, 10, summary));
+    EXPECT_TRUE(summary.kind == LogKind::MuteFailed);
+    EXPECT_FALSE(limiter.TakeSummary(2, 10, summary));
+    EXPECT_FALSE(limiter.TakeSummary(7, 10, summary));
+
+    // Device 0 still has its own, reported on schedule
+    EXPECT_TRUE(limiter.NextSummary(10, summary, true));
+    EXPECT_EQ(0u, summary.device);
+    EXPECT_FALSE(limiter.NextSummary(10, summary, true));
+}
+
+TEST_FUNCTION(LogRateLimiter_SummaryTimer_LogsWithNoOtherEvent) {
+    VirtualClock clock;
+    EventLoop loop(clock);
+    LogRateLimiter limiter;
+    LogLimitOptions options;
+    options.burst = 1;
+    options.summaryMs = 600000;
+    limiter.SetOptions(options);
+
+    // As the service: a suppressed line arms the timer, which logs what is due and re-arms
+    const uint32_t summaryTimer = 0;
+    std::vector<LogSummary> logged;
+    auto allowed = [&](DeviceHandle device, LogKind kind) {
+        if (limiter.Allow(device, kind, clock.NowMs()))
+            return true;
+        if (loop.DueMs(summaryTimer) != limiter.NextSummaryMs())
+            loop.Schedule(summaryTimer, limiter.NextSummaryMs());
+        return false;
+    };
+    loop.SetTimer(summaryTimer, [&]() {
+        LogSummary summary;
+        while (limiter.NextSummary(clock.NowMs(), summary))
+            logged.push_back(summary);
+        if (limiter.NextSummaryMs() != UINT64_MAX)
+            loop.Schedule(summaryTimer, limiter.NextSummaryMs());
+    });
+
+    EXPECT_TRUE(allowed(1, LogKind::CorrectionFailed));
+    clock.Set(1000);
+    EXPECT_FALSE(allowed(1, LogKind::CorrectionFailed));
+    clock.Set(300000);
+    EXPECT_TRUE(allowed(4, LogKind::MuteFailed));
+    EXPECT_FALSE(allowed(4, LogKind::MuteFailed));
+    EXPECT_EQ(601000ull, loop.NextDueMs());
+
+    // Nothing else wakes the loop; the timer alone brings out each summary when due
+    clock.Set(600999);
+    EXPECT_FALSE(loop.Poll());
+    EXPECT_EQ(0u, logged.size());
+    clock.Set(601000);
+    EXPECT_TRUE(loop.Poll());
+    EXPECT_EQ(1u, logged.size());
+    EXPECT_EQ(1u, logged[0].device);
+    EXPECT_EQ(600000ull, logged[0].periodMs);
+    EXPECT_EQ(900000ull, loop.NextDueMs());
+    clock.Set(900000);
+    EXPECT_TRUE(loop.Poll());
+    EXPECT_EQ(2u, logged.size());
+    EXPECT_EQ(4u, logged[1].device);
+    EXPECT_EQ(TimerWheel::Never, loop.NextDueMs());
+}
+
+TEST_FUNCTION(LogRateLimiter_TamperStorm_LogOutputBounded) {
+    // A game re-applies its level to three microphones between every two sweeps, all day
+    SimulatedAudioBackend backend;
+    std::shared_ptr<SimulatedEndpoint> mics[3] = {
+        backend.AddDevice(L"{mic1}", L"Microphone 1", 0.4f),
+        backend.AddDevice(L"{mic2}", L"Microphone 2", 0.4f),
+        backend.AddDevice(L"{mic3}", L"Microphone 3", 0.4f)};
+
+    VirtualClock clock(0);
+    LogRateLimiter limiter;
+    LimitedLogObserver observer(limiter, clock);
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+
+    const uint64_t dayMs = 24ull * 3600 * 1000;
+    while (clock.NowMs() < dayMs) {
+        for (auto &mic : mics)
+            mic->Tamper(0.4f);
+        enforcer.Sweep();
+        observer.TakeSummaries();
+        clock.Advance(2000);
+    }
+    observer.TakeSummaries(true);
+
+    // 129,600 corrections; per microphone the burst, one line a minute and a summary every 10 min
+    EXPECT_EQ(129600ull, observer.events);
+    EXPECT_LE(observer.lines, 3ull * (5 + 1440));
+    EXPECT_LE(observer.summaries, 3ull * (144 + 1));
+    EXPECT_EQ(observer.events, observer.lines + limiter.Suppressed().Value());
+    EXPECT_EQ(limiter.Suppressed().Value(), observer.summarized);
+}
+
+TEST_FUNCTION(LogRateLimiter_FailureStorm_LogOutputBounded) {
+    // A device that fails on every check, with a breaker that never gives up on it
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Microphone", 0.4f);
+    mic->SetFailure(E_FAIL);
+
+    VirtualClock clock(0);
+    LogRateLimiter limiter;
+    LogLimitOptions options;
+    options.burst = 2;
+    options.refillMs = 600000;
+    limiter.SetOptions(options);
+    LimitedLogObserver observer(limiter, clock);
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    BreakerOptions breaker;
+    breaker.failures = 1000000;
+    enforcer.SetBreakerOptions(breaker);
+
+    // An hour of sweeps: the burst, one line per 10 min and a summary per 10 min
+    for (int sweep = 0; sweep < 1800; sweep++) {
+        enforcer.Sweep();
+        observer.TakeSummaries();
+        clock.Advance(2000);
+    }
+
+    EXPECT_EQ(1800ull, observer.events);
+    EXPECT_LE(observer.lines, 2ull + 6);
+    EXPECT_LE(observer.summaries, 6ull);
+    EXPECT_GT(observer.summaries, 0ull);
+}
+
+int main() {
+    std::wcout << L"Log rate limiter tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
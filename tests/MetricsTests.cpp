@@ -0,0 +1,139 @@
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/Metrics.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+TEST_FUNCTION(Metrics_Counter_ConcurrentAddsAreNotLost) {
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&counter]() {
+            for (int i = 0; i < 100000; i++)
+                counter.Add();
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    EXPECT_EQ(400000ull, counter.Value());
+}
+
+TEST_FUNCTION(Metrics_Histogram_BucketsDoubleFromOneMicrosecond) {
+    EXPECT_EQ(0, Histogram::BucketIndex(0));
+    EXPECT_EQ(0, Histogram::BucketIndex(1));
+    EXPECT_EQ(1, Histogram::BucketIndex(2));
+    EXPECT_EQ(2, Histogram::BucketIndex(3));
+    EXPECT_EQ(2, Histogram::BucketIndex(4));
+    EXPECT_EQ(10, Histogram::BucketIndex(1000));
+    EXPECT_EQ(Histogram::BucketCount - 1, Histogram::BucketIndex(UINT64_MAX));
+
+    Histogram histogram;
+    histogram.Record(3);
+    histogram.Record(4);
+    histogram.Record(1000);
+    EXPECT_EQ(2ull, histogram.Bucket(2));
+    EXPECT_EQ(1ull, histogram.Bucket(10));
+    EXPECT_EQ(3ull, histogram.Count());
+    EXPECT_EQ(1007ull, histogram.SumMicros());
+}
+
+TEST_FUNCTION(Metrics_FormatPrometheus_CumulativeBucketsInSeconds) {
+    Counter ticks;
+    ticks.Add(42);
+    Histogram latency;
+    latency.Record(1);
+    latency.Record(1500);
+    MetricsRegistry registry;
+    registry.AddCounter("mvs_ticks_total", "Passes.", ticks);
+    registry.AddHistogram("mvs_call_seconds", "Calls.", latency);
+
+    std::string text = registry.FormatPrometheus();
+    EXPECT_TRUE(text.find("# HELP mvs_ticks_total Passes.\n# TYPE mvs_ticks_total counter\nmvs_ticks_total 42\n") == 0);
+    EXPECT_TRUE(text.find("# TYPE mvs_call_seconds histogram\n") != std::string::npos);
+    EXPECT_TRUE(text.find("mvs_call_seconds_bucket{le=\"0.000001\"} 1\n") != std::string::npos);
+    EXPECT_TRUE(text.find("mvs_call_seconds_bucket{le=\"0.001024\"} 1\n") != std::string::npos);
+    EXPECT_TRUE(text.find("mvs_call_seconds_bucket{le=\"0.002048\"} 2\n") != std::string::npos);
+    EXPECT_TRUE(text.find("mvs_call_seconds_bucket{le=\"1073.741824\"} 2\n") != std::string::npos);
+    EXPECT_TRUE(text.find("mvs_call_seconds_bucket{le=\"+Inf\"} 2\n") != std::string::npos);
+    EXPECT_TRUE(text.find("mvs_call_seconds_sum 0.001501\nmvs_call_seconds_count 2\n") != std::string::npos);
+}
+
+TEST_FUNCTION(Metrics_Enforcer_CountsPassesCallsAndCorrections) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"USB Microphone", 0.5f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+
+    enforcer.Sweep();
+    const EnforcementMetrics &metrics = enforcer.Metrics();
+    EXPECT_EQ(1ull, metrics.ticks.Value());
+    EXPECT_EQ(1ull, metrics.tick.Count());
+    EXPECT_EQ(1ull, metrics.corrections.Value());
+    EXPECT_EQ(2ull, metrics.backendCall.Count()); // Read and write
+    EXPECT_EQ(0ull, metrics.backendErrors.Value());
+
+    mic->SetFailure(E_FAIL);
+    enforcer.Sweep();
+    EXPECT_EQ(2ull, metrics.ticks.Value());
+    EXPECT_EQ(2ull, metrics.backendErrors.Value()); // The read and the correction after it
+}
+
+TEST_FUNCTION(Metrics_Enforcer_NotificationRecordsTimeToCorrect) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"USB Microphone", 1.0f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.EnableNotifications();
+    enforcer.Sweep();
+    enforcer.ProcessNotifications(); // The check after Attach is no notification
+    const EnforcementMetrics &metrics = enforcer.Metrics();
+    EXPECT_EQ(0ull, metrics.timeToCorrect.Count());
+
+    mic->Tamper(0.4f);
+    mic->Tamper(0.3f);
+    EXPECT_EQ(2ull, metrics.tamperEvents.Value());
+    enforcer.ProcessNotifications();
+    EXPECT_EQ(1ull, metrics.corrections.Value());
+    EXPECT_EQ(1ull, metrics.timeToCorrect.Count());
+    EXPECT_TRUE(mic->Volume() > 0.99f);
+}
+
+TEST_FUNCTION(Metrics_FileExporter_ReplacesFileWithSnapshot) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "mvs_metrics_test.prom";
+    std::filesystem::remove(path);
+
+    Counter corrections;
+    MetricsRegistry registry;
+    registry.AddCounter("mvs_corrections_total", "Corrections.", corrections);
+    MetricsFileExporter exporter(registry);
+    EXPECT_TRUE(SUCCEEDED(exporter.Start(path.wstring(), 60000)));
+    corrections.Add(7);
+    exporter.Stop();
+
+    // Stop() writes the final snapshot
+    EXPECT_TRUE(exporter.Writes() >= 2);
+    EXPECT_TRUE(SUCCEEDED(exporter.LastResult()));
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    EXPECT_TRUE(content.str().find("mvs_corrections_total 7\n") != std::string::npos);
+    file.close();
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+    std::filesystem::remove(path);
+}
+
+int main() {
+    std::wcout << L"Metrics tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
@@ -0,0 +1,339 @@
+#include <iostream>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+// Collects the observer calls the service turns into log messages
+class RecordingObserver : public EnforcementObserver {
+public:
+    void OnDeviceAdded(DeviceHandle device, float) override { added.push_back(device); }
+    void OnDeviceRemoved(DeviceHandle device) override { removed.push_back(device); }
+    void OnVolumeChanged(DeviceHandle, float, float) override { changes++; }
+    void OnVolumeCorrected(DeviceHandle, float oldVolume, float, CorrectionSource source) override {
+        corrections++;
+        lastCorrectedFrom = oldVolume;
+        lastSource = source;
+    }
+    void OnCorrectionFailed(DeviceHandle, float, float, HRESULT, CorrectionSource) override { failures++; }
+    void OnWatchAttached(DeviceHandle) override { watches++; }
+
+    std::vector<DeviceHandle> added;
+    std::vector<DeviceHandle> removed;
+    int changes = 0;
+    int corrections = 0;
+    int failures = 0;
+    int watches = 0;
+    float lastCorrectedFrom = 0.0f;
+    CorrectionSource lastSource = CorrectionSource::Sweep;
+};
+
+TEST_FUNCTION(Enforcer_Sweep_CorrectsEveryDeviceBelowTarget) {
+    SimulatedAudioBackend backend;
+    auto usb = backend.AddDevice(L"{usb}", L"USB Microphone", 0.3f);
+    auto headset = backend.AddDevice(L"{headset}", L"Headset Microphone", 1.0f);
+    VirtualClock clock(5000);
+    RecordingObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+
+    enforcer.Sweep();
+
+    EXPECT_FLOAT_EQ(1.0f, usb->Volume());
+    EXPECT_EQ(0u, headset->setCalls.load());
+    EXPECT_EQ(2u, observer.added.size());
+    EXPECT_EQ(1, observer.corrections);
+    EXPECT_FLOAT_EQ(0.3f, observer.lastCorrectedFrom);
+
+    const DeviceSlot &slot = enforcer.Devices().Slot(enforcer.Devices().Find(L"{usb}"));
+    EXPECT_EQ(1u, slot.corrections);
+    EXPECT_EQ(5000ull, slot.lastCorrectionMs);
+    EXPECT_FLOAT_EQ(1.0f, slot.lastVolume);
+}
+
+TEST_FUNCTION(Enforcer_Filter_LeavesOtherDevicesAlone) {
+    SimulatedAudioBackend backend;
+    auto usb = backend.AddDevice(L"{usb}", L"USB Microphone", 0.3f);
+    auto cable = backend.AddDevice(L"{cable}", L"CABLE Output", 0.3f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.SetFilter(L"USB");
+
+    enforcer.Sweep();
+
+    EXPECT_FLOAT_EQ(1.0f, usb->Volume());
+    EXPECT_FLOAT_EQ(0.3f, cable->Volume());
+    EXPECT_TRUE(enforcer.IsSelected(L"USB Microphone"));
+    EXPECT_TRUE(enforcer.IsSelected(L"usb microphone"));
+    EXPECT_FALSE(enforcer.IsSelected(L"CABLE Output"));
+}
+
+static PolicyRule Rule(const wchar_t* line) {
+    PolicyRule rule;
+    ParsePolicyRule(line, rule);
+    return rule;
+}
+
+TEST_FUNCTION(Enforcer_PolicyRules_ApplyPerDeviceTargetsAndMute) {
+    SimulatedAudioBackend backend;
+    auto usb = backend.AddDevice(L"{usb}", L"USB Microphone", 0.3f);
+    auto cable = backend.AddDevice(L"{cable}", L"CABLE Output", 0.3f);
+    auto headset = backend.AddDevice(L"{headset}", L"Arctis Chat", 0.3f);
+    backend.SetFormFactor(L"{headset}", FormFactor::Headset);
+    headset->TamperMute(true);
+    VirtualClock clock;
+    RecordingObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.SetRules({ Rule(L"exclude name:*cable*"),
+                        Rule(L"include formfactor:headset volume=80 mute=unmute"),
+                        Rule(L"include name:*") });
+
+    enforcer.Sweep();
+
+    EXPECT_FLOAT_EQ(1.0f, usb->Volume());
+    EXPECT_FLOAT_EQ(0.3f, cable->Volume());
+    EXPECT_FLOAT_EQ(0.8f, headset->Volume());
+    EXPECT_FALSE(headset->Muted());
+    EXPECT_EQ(1, enforcer.Devices().Slot(enforcer.Devices().Find(L"{headset}")).policyRule);
+
+    // Rules are not evaluated again while the devices stay
+    unsigned long long nameReads = backend.counters.nameReads;
+    unsigned long long formFactorReads = backend.counters.formFactorReads;
+    for (int i = 0; i < 10; i++) {
+        enforcer.Sweep();
+    }
+    EXPECT_EQ(nameReads, backend.counters.nameReads);
+    EXPECT_EQ(formFactorReads, backend.counters.formFactorReads);
+    EXPECT_EQ(0u, cable->getCalls.load());
+}
+
+TEST_FUNCTION(Enforcer_Rename_ResolvesPolicyAgain) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Webcam Mic", 0.3f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.SetRules({ Rule(L"include name:\"usb *\" volume=50") });
+
+    enforcer.Sweep();
+    EXPECT_FLOAT_EQ(0.3f, mic->Volume());
+
+    backend.RenameDevice(L"{mic}", L"USB Mic");
+    enforcer.Sweep();
+    EXPECT_FLOAT_EQ(0.5f, mic->Volume());
+}
+
+TEST_FUNCTION(Enforcer_Notifications_CorrectMute) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Mic", 1.0f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.SetRules({ Rule(L"include name:* mute=unmute") });
+    enforcer.EnableNotifications();
+    enforcer.Sweep();
+    enforcer.ProcessNotifications();
+
+    mic->TamperMute(true);
+    enforcer.ProcessNotifications();
+
+    EXPECT_FALSE(mic->Muted());
+    EXPECT_EQ(1u, mic->muteSetCalls.load());
+    EXPECT_EQ(0u, mic->setCalls.load());
+}
+
+TEST_FUNCTION(Enforcer_WithinTolerance_IsNotWritten) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Mic", 0.995f);
+    VirtualClock clock;
+    RecordingObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+
+    for (int i = 0; i < 5; i++) {
+        enforcer.Sweep();
+    }
+
+    EXPECT_EQ(0u, mic->setCalls.load());
+    EXPECT_EQ(0, observer.changes);
+    EXPECT_EQ(5u, mic->getCalls.load());
+}
+
+TEST_FUNCTION(Enforcer_Hotplug_AddsAndRemovesDevicesWithoutEnumerating) {
+    SimulatedAudioBackend backend;
+    backend.AddDevice(L"{usb}", L"USB Microphone", 1.0f);
+    VirtualClock clock;
+    RecordingObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.Sweep();
+    EXPECT_EQ(1ull, backend.counters.enumerations);
+
+    auto headset = backend.AddDevice(L"{headset}", L"Headset Microphone", 0.2f);
+    EXPECT_TRUE(enforcer.HasPendingDeviceChanges());
+    enforcer.Sweep();
+    EXPECT_FLOAT_EQ(1.0f, headset->Volume());
+    EXPECT_EQ(2u, enforcer.ActiveDevices().size());
+
+    backend.RemoveDevice(L"{usb}");
+    enforcer.Sweep();
+    EXPECT_EQ(1u, observer.removed.size());
+    EXPECT_EQ(1u, enforcer.ActiveDevices().size());
+    EXPECT_FALSE(enforcer.Devices().Slot(observer.removed[0]).present);
+    EXPECT_EQ(1ull, backend.counters.enumerations);
+}
+
+TEST_FUNCTION(Enforcer_FailedWrite_CountsError) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Mic", 0.5f);
+    VirtualClock clock;
+    RecordingObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.Sweep();
+
+    mic->Tamper(0.2f);
+    mic->SetFailure(E_FAIL);
+    enforcer.Sweep();
+
+    const DeviceSlot &slot = enforcer.Devices().Slot(enforcer.Devices().Find(L"{mic}"));
+    EXPECT_EQ(1, observer.failures);
+    EXPECT_EQ(1u, slot.consecutiveErrors);
+    EXPECT_TRUE(slot.errorCount >= 2u);
+}
+
+TEST_FUNCTION(Enforcer_Notifications_CorrectTamperBetweenSweeps) {
+    int wakes = 0;
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Mic", 1.0f);
+    VirtualClock clock;
+    RecordingObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer, [&wakes]() { wakes++; });
+    enforcer.EnableNotifications();
+    enforcer.Sweep();
+    enforcer.ProcessNotifications();
+    EXPECT_EQ(1, observer.watches);
+
+    mic->Tamper(0.4f);
+    EXPECT_TRUE(wakes > 0);
+    enforcer.ProcessNotifications();
+
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_TRUE(observer.lastSource == CorrectionSource::Notification);
+    EXPECT_FLOAT_EQ(0.4f, observer.lastCorrectedFrom);
+
+    enforcer.Shutdown();
+    EXPECT_EQ(0u, mic->ListenerCount());
+    EXPECT_FALSE(enforcer.Session().IsOpen());
+}
+
+// -whenrunning shuts the enforcer down while idle; the next pass must re-sync from scratch
+TEST_FUNCTION(Enforcer_ShutdownThenSweep_ResyncsChangesMadeWhileIdle) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Mic", 1.0f);
+    VirtualClock clock;
+    RecordingObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.Sweep();
+    enforcer.Shutdown();
+
+    mic->Tamper(0.2f);
+    auto headset = backend.AddDevice(L"{headset}", L"Headset", 0.5f);
+    unsigned long long enumerations = backend.counters.enumerations;
+
+    enforcer.Sweep();
+    EXPECT_EQ(enumerations + 1, backend.counters.enumerations);
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_FLOAT_EQ(1.0f, headset->Volume());
+    EXPECT_EQ(2, observer.corrections);
+}
+
+TEST_FUNCTION(Enforcer_AdaptiveSchedule_StableDeviceBacksOffToMaxInterval) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"Mic", 1.0f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    CheckSchedule schedule;
+    schedule.minIntervalMs = 250;
+    schedule.maxIntervalMs = 60000;
+    enforcer.EnableAdaptiveSchedule(schedule);
+
+    // Run the worker loop for an hour, waking only when a check is due
+    uint64_t end = 3600 * 1000;
+    while (enforcer.NextCheckMs() <= end || enforcer.Checks() == 0) {
+        if (enforcer.Checks() > 0)
+            clock.Set(enforcer.NextCheckMs());
+        enforcer.CheckDue();
+    }
+
+    // 250 ms doubling to 60 s takes 9 checks, then one check a minute
+    EXPECT_TRUE(enforcer.Checks() < 75u);
+    EXPECT_EQ(60000u, enforcer.Devices().Slot(enforcer.Devices().Find(L"{mic}")).checkIntervalMs);
+    EXPECT_EQ(0u, mic->setCalls.load());
+}
+
+TEST_FUNCTION(Enforcer_AdaptiveSchedule_TamperedDeviceIsCheckedQuickly) {
+    SimulatedAudioBackend backend;
+    auto quiet = backend.AddDevice(L"{quiet}", L"Quiet Mic", 1.0f);
+    auto game = backend.AddDevice(L"{game}", L"Game Mic", 1.0f);
+    VirtualClock clock;
+    RecordingObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.EnableAdaptiveSchedule(CheckSchedule());
+    enforcer.CheckDue();
+
+    // Both settle at the maximum interval
+    while (clock.NowMs() < 10 * 60 * 1000) {
+        clock.Set(enforcer.NextCheckMs());
+        enforcer.CheckDue();
+    }
+    DeviceHandle gameHandle = enforcer.Devices().Find(L"{game}");
+    EXPECT_EQ(30000u, enforcer.Devices().Slot(gameHandle).checkIntervalMs);
+
+    // Caught by its next check, then watched closely
+    game->Tamper(0.3f);
+    uint64_t tamperedAt = clock.NowMs();
+    while (game->Volume() < 1.0f) {
+        clock.Set(enforcer.NextCheckMs());
+        enforcer.CheckDue();
+    }
+    EXPECT_TRUE(clock.NowMs() - tamperedAt <= 30000u);
+    EXPECT_EQ(250u, enforcer.Devices().Slot(gameHandle).checkIntervalMs);
+
+    game->Tamper(0.5f);
+    clock.Set(enforcer.NextCheckMs());
+    enforcer.CheckDue();
+    EXPECT_FLOAT_EQ(1.0f, game->Volume());
+    EXPECT_TRUE(clock.NowMs() - tamperedAt <= 30000u + 250u);
+    EXPECT_EQ(0u, quiet->setCalls.load());
+}
+
+TEST_FUNCTION(Enforcer_AdaptiveSchedule_HotplugSchedulesAndCancels) {
+    SimulatedAudioBackend backend;
+    backend.AddDevice(L"{usb}", L"USB Microphone", 1.0f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.EnableAdaptiveSchedule(CheckSchedule());
+    enforcer.CheckDue();
+
+    clock.Advance(100);
+    auto headset = backend.AddDevice(L"{headset}", L"Headset Microphone", 0.2f);
+    enforcer.CheckDue();
+    EXPECT_FLOAT_EQ(1.0f, headset->Volume());
+
+    backend.RemoveDevice(L"{usb}");
+    enforcer.CheckDue();
+    EXPECT_EQ(clock.NowMs() + 250, enforcer.NextCheckMs());
+
+    backend.RemoveDevice(L"{headset}");
+    enforcer.CheckDue();
+    EXPECT_EQ(TimerWheel::Never, enforcer.NextCheckMs());
+}
+
+int main() {
+    std::wcout << L"Microphone enforcer tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
@@ -0,0 +1,160 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/PolicyRules.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+static PolicyRule Rule(const wchar_t* line) {
+    PolicyRule rule;
+    ParsePolicyRule(line, rule);
+    return rule;
+}
+
+static PolicySubject Device(const wchar_t* name, const wchar_t* id, FormFactor formFactor = FormFactor::Microphone) {
+    PolicySubject subject;
+    subject.name = name;
+    subject.endpointId = id;
+    subject.formFactor = formFactor;
+    return subject;
+}
+
+TEST_FUNCTION(PolicyRule_ParsesEveryOption) {
+    PolicyRule rule;
+    EXPECT_EQ(S_OK, ParsePolicyRule(L"include name:\"*USB Mic*\" volume=75 tolerance=2 mute=unmute", rule));
+
+    EXPECT_TRUE(rule.policy.enforce);
+    EXPECT_TRUE(rule.field == RuleField::Name);
+    EXPECT_TRUE(rule.pattern == L"*USB Mic*");
+    EXPECT_FLOAT_EQ(0.75f, rule.policy.targetVolume);
+    EXPECT_FLOAT_EQ(0.02f, rule.policy.tolerance);
+    EXPECT_TRUE(rule.policy.mute == MutePolicy::Unmute);
+
+    EXPECT_EQ(S_OK, ParsePolicyRule(L"  exclude formfactor:headset  # no headsets", rule));
+    EXPECT_FALSE(rule.policy.enforce);
+    EXPECT_TRUE(rule.field == RuleField::FormFactor);
+}
+
+TEST_FUNCTION(PolicyRule_RejectsBadLines) {
+    PolicyRule rule;
+    EXPECT_EQ(S_FALSE, ParsePolicyRule(L"", rule));
+    EXPECT_EQ(S_FALSE, ParsePolicyRule(L"   # comment", rule));
+    EXPECT_EQ(E_INVALIDARG, ParsePolicyRule(L"allow name:*", rule));
+    EXPECT_EQ(E_INVALIDARG, ParsePolicyRule(L"include serial:*", rule));
+    EXPECT_EQ(E_INVALIDARG, ParsePolicyRule(L"include name:", rule));
+    EXPECT_EQ(E_INVALIDARG, ParsePolicyRule(L"include name:* volume=120", rule));
+    EXPECT_EQ(E_INVALIDARG, ParsePolicyRule(L"include name:* mute=maybe", rule));
+}
+
+TEST_FUNCTION(Glob_MatchesWildcards) {
+    EXPECT_TRUE(GlobMatch(L"*usb*", L"usb microphone"));
+    EXPECT_TRUE(GlobMatch(L"*", L""));
+    EXPECT_TRUE(GlobMatch(L"mic?", L"mic2"));
+    EXPECT_TRUE(GlobMatch(L"*a*b*c", L"xxaxxbxxbc"));
+    EXPECT_FALSE(GlobMatch(L"mic?", L"mic"));
+    EXPECT_FALSE(GlobMatch(L"*usb", L"usb microphone"));
+}
+
+TEST_FUNCTION(PolicyEngine_FirstMatchingRuleWinsCaseInsensitively) {
+    PolicyEngine engine;
+    engine.Compile({ Rule(L"exclude name:*cable*"),
+                     Rule(L"include name:*USB* volume=80"),
+                     Rule(L"include id:{0.0.1.00000000}.{abc*} mute=mute") });
+
+    DevicePolicy policy;
+    EXPECT_EQ(1, engine.Resolve(Device(L"usb microphone", L"{x}"), policy));
+    EXPECT_FLOAT_EQ(0.8f, policy.targetVolume);
+
+    EXPECT_EQ(0, engine.Resolve(Device(L"USB CABLE Output", L"{x}"), policy));
+    EXPECT_FALSE(policy.enforce);
+
+    EXPECT_EQ(2, engine.Resolve(Device(L"Mic", L"{0.0.1.00000000}.{ABCDEF}"), policy));
+    EXPECT_TRUE(policy.mute == MutePolicy::Mute);
+
+    // Include rules exist, so an unmatched device is left alone
+    EXPECT_EQ(-1, engine.Resolve(Device(L"Mic", L"{x}"), policy));
+    EXPECT_FALSE(policy.enforce);
+}
+
+TEST_FUNCTION(PolicyEngine_OnlyExcludesEnforceTheRest) {
+    PolicyEngine engine;
+    engine.Compile({ Rule(L"exclude formfactor:head*") });
+
+    DevicePolicy policy;
+    EXPECT_EQ(0, engine.Resolve(Device(L"Arctis", L"{x}", FormFactor::Headset), policy));
+    EXPECT_FALSE(policy.enforce);
+    EXPECT_EQ(-1, engine.Resolve(Device(L"Arctis", L"{x}"), policy));
+    EXPECT_TRUE(policy.enforce);
+    EXPECT_FLOAT_EQ(1.0f, policy.targetVolume);
+}
+
+TEST_FUNCTION(PolicyEngine_ScopeSeparatesProcessRules) {
+    std::vector<PolicyRule> rules = { Rule(L"include name:*usb*"), Rule(L"include process:discord.exe volume=80") };
+    PolicySubject discord;
+    discord.processName = L"Discord.exe";
+
+    PolicyEngine devices;
+    devices.Compile(rules);
+    DevicePolicy policy;
+    EXPECT_EQ(1u, devices.RuleCount());
+    EXPECT_EQ(-1, devices.Resolve(discord, policy));
+
+    // Rule numbers refer to the whole rule set
+    PolicyEngine sessions;
+    sessions.Compile(rules, RuleScope::Sessions);
+    EXPECT_EQ(1, sessions.Resolve(discord, policy));
+    EXPECT_FLOAT_EQ(0.8f, policy.targetVolume);
+}
+
+TEST_FUNCTION(PolicyEngine_VerifiesOnlyRulesWhoseLiteralOccurs) {
+    std::vector<PolicyRule> rules;
+    for (int i = 0; i < 500; i++) {
+        rules.push_back(Rule((L"include name:\"*device " + std::to_wstring(i) + L" mic*\"").c_str()));
+    }
+    PolicyEngine engine;
+    engine.Compile(rules);
+
+    DevicePolicy policy;
+    EXPECT_EQ(42, engine.Resolve(Device(L"Device 42 Mic", L"{x}"), policy));
+    EXPECT_EQ(1u, engine.LastCandidateCount());
+    EXPECT_EQ(-1, engine.Resolve(Device(L"Webcam", L"{x}"), policy));
+    EXPECT_EQ(0u, engine.LastCandidateCount());
+}
+
+TEST_FUNCTION(PolicyRules_LoadReportsFailingLine) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+        ("mvs_rules_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".txt");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "\xEF\xBB\xBF# Studio setup\r\n"
+             << "include name:\"R\xC3\xB8" "de*\" volume=90\r\n"
+             << "\r\n"
+             << "exclude id:*{dead}*\r\n";
+    }
+
+    std::vector<PolicyRule> rules;
+    size_t errorLine = 0;
+    EXPECT_EQ(S_OK, LoadPolicyRules(path.wstring(), rules, errorLine));
+    EXPECT_EQ(2u, rules.size());
+    EXPECT_TRUE(rules[0].pattern == L"R\u00F8de*");
+
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        file << "include name:* volume=loud\n";
+    }
+    rules.clear();
+    EXPECT_EQ(E_INVALIDARG, LoadPolicyRules(path.wstring(), rules, errorLine));
+    EXPECT_EQ(5u, errorLine);
+
+    std::filesystem::remove(path);
+}
+
+int main() {
+    std::wcout << L"Policy rules tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include "SimpleTest.h"
+#include "core/ProcessActivation.h"
+#include "core/SimulatedProcessSource.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+static std::vector<std::wstring> Targets(const wchar_t *list) {
+    std::vector<std::wstring> targets;
+    ProcessActivation::ParseTargets(list, targets);
+    return targets;
+}
+
+TEST_FUNCTION(Activation_ParseTargets_SplitsAndTrims) {
+    std::vector<std::wstring> targets = Targets(L" helldivers2.exe, game*.exe;;other.exe ");
+    EXPECT_EQ(3u, targets.size());
+    EXPECT_TRUE(targets[0] == L"helldivers2.exe");
+    EXPECT_TRUE(targets[1] == L"game*.exe");
+    EXPECT_TRUE(targets[2] == L"other.exe");
+    EXPECT_TRUE(Targets(L"").empty());
+}
+
+TEST_FUNCTION(Activation_TargetAlreadyRunning_ArmedAtStart) {
+    SimulatedProcessSource source;
+    source.Launch(42, L"HellDivers2.exe");
+    ProcessActivation activation(source);
+    activation.SetTargets(Targets(L"helldivers2.exe"));
+
+    EXPECT_EQ(S_OK, activation.Start());
+    EXPECT_TRUE(activation.Armed());
+    EXPECT_TRUE(activation.RunningTarget() == L"HellDivers2.exe");
+}
+
+TEST_FUNCTION(Activation_StartAndExit_ArmAndDisarm) {
+    int wakes = 0;
+    SimulatedProcessSource source;
+    ProcessActivation activation(source, [&wakes]() { wakes++; });
+    activation.SetTargets(Targets(L"helldivers2.exe"));
+    activation.Start();
+    EXPECT_FALSE(activation.Armed());
+    EXPECT_FALSE(activation.ProcessPending());
+
+    source.Launch(42, L"helldivers2.exe");
+    EXPECT_EQ(1, wakes);
+    EXPECT_TRUE(activation.ProcessPending());
+    EXPECT_TRUE(activation.Armed());
+
+    source.Exit(42);
+    EXPECT_EQ(2, wakes);
+    EXPECT_TRUE(activation.ProcessPending());
+    EXPECT_FALSE(activation.Armed());
+    EXPECT_TRUE(activation.RunningTarget().empty());
+}
+
+TEST_FUNCTION(Activation_OtherProcesses_NeverWake) {
+    int wakes = 0;
+    SimulatedProcessSource source;
+    ProcessActivation activation(source, [&wakes]() { wakes++; });
+    activation.SetTargets(Targets(L"helldivers2.exe"));
+    activation.Start();
+
+    for (uint32_t pid = 100; pid < 1100; pid++) {
+        source.Launch(pid, L"svchost.exe");
+        source.Exit(pid);
+    }
+    EXPECT_EQ(0, wakes);
+    EXPECT_FALSE(activation.ProcessPending());
+}
+
+TEST_FUNCTION(Activation_TwoInstances_DisarmAfterBothExit) {
+    SimulatedProcessSource source;
+    ProcessActivation activation(source);
+    activation.SetTargets(Targets(L"game*.exe"));
+    activation.Start();
+
+    source.Launch(1, L"game.exe");
+    source.Launch(2, L"game-launcher.exe");
+    // Reported by the enumeration and by the start event
+    source.RepeatStart(1);
+    EXPECT_TRUE(activation.ProcessPending());
+
+    source.Exit(1);
+    EXPECT_FALSE(activation.ProcessPending());
+    EXPECT_TRUE(activation.Armed());
+    source.Exit(2);
+    EXPECT_TRUE(activation.ProcessPending());
+    EXPECT_FALSE(activation.Armed());
+}
+
+TEST_FUNCTION(Activation_StartFailure_StaysDisarmed) {
+    SimulatedProcessSource source;
+    source.startResult = E_FAIL;
+    source.Launch(42, L"helldivers2.exe");
+    ProcessActivation activation(source);
+    activation.SetTargets(Targets(L"helldivers2.exe"));
+
+    EXPECT_EQ(E_FAIL, activation.Start());
+    EXPECT_FALSE(activation.Armed());
+}
+
+TEST_FUNCTION(Activation_ExitDuringStart_NotArmed) {
+    SimulatedProcessSource source;
+    source.Launch(42, L"helldivers2.exe");
+    source.Launch(43, L"helldivers2.exe");
+    // 42 exits after the snapshot listed it but before Start() merged the snapshot
+    source.afterSnapshot = [&source]() { source.Exit(42); };
+    ProcessActivation activation(source);
+    activation.SetTargets(Targets(L"helldivers2.exe"));
+
+    EXPECT_EQ(S_OK, activation.Start());
+    EXPECT_TRUE(activation.Armed());
+    source.Exit(43);
+    EXPECT_TRUE(activation.ProcessPending());
+    EXPECT_FALSE(activation.Armed());
+}
+
+int main() {
+    std::wcout << L"Process activation tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
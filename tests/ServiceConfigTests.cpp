@@ -0,0 +1,198 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "SimpleTest.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/ServiceConfig.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+static std::filesystem::path TempPath(const char* name) {
+    return std::filesystem::temp_directory_path() /
+        ("mvs_" + std::string(name) + "_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+}
+
+TEST_FUNCTION(Config_ParseText_SkipsCommentsAndKeepsQuotes) {
+    ServiceOptions options;
+    options.configFile = L"C:\\mvs.conf";
+    ParseConfigText(L"# Studio\r\n\r\n-m \"USB Mic\"\r\n-fight backoff\r\n", options);
+
+    EXPECT_TRUE(options.microphoneFilter == L"USB Mic");
+    EXPECT_TRUE(options.fightStrategy == FightStrategy::Backoff);
+    EXPECT_TRUE(options.configFile == L"C:\\mvs.conf");
+
+    // -t 0 needs -events, even when they are on different lines
+    ParseConfigText(L"-t 0\n-events", options);
+    EXPECT_EQ(0u, options.intervalSeconds);
+    EXPECT_TRUE(options.useEvents);
+}
+
+TEST_FUNCTION(Config_Build_ReadsFileAndRules) {
+    std::filesystem::path configPath = TempPath("config");
+    std::filesystem::path rulesPath = TempPath("rules");
+    {
+        std::ofstream rules(rulesPath, std::ios::binary);
+        rules << "exclude name:*CABLE*\n";
+        std::ofstream config(configPath, std::ios::binary);
+        config << "\xEF\xBB\xBF-t 9\n-rules \"" << rulesPath.string() << "\"\n";
+    }
+
+    ServiceOptions commandLine;
+    commandLine.intervalSeconds = 4;
+    commandLine.microphoneFilter = L"USB";
+    commandLine.configFile = configPath.wstring();
+    std::unique_ptr<ServiceConfig> config = BuildServiceConfig(commandLine);
+
+    EXPECT_EQ(S_OK, config->configResult);
+    EXPECT_EQ(9u, config->options.intervalSeconds);
+    EXPECT_TRUE(config->options.microphoneFilter == L"USB");
+    EXPECT_EQ(S_OK, config->rulesResult);
+    EXPECT_EQ(1u, config->rules.size());
+
+    // Without the file the command line stays in effect
+    std::filesystem::remove(configPath);
+    config = BuildServiceConfig(commandLine);
+    EXPECT_TRUE(FAILED(config->configResult));
+    EXPECT_EQ(4u, config->options.intervalSeconds);
+    EXPECT_EQ(S_FALSE, config->rulesResult);
+
+    std::filesystem::remove(rulesPath);
+}
+
+TEST_FUNCTION(Config_FileStamps_OnlyConfigAndRulesFilesCount) {
+    std::filesystem::path directory = TempPath("stamps");
+    std::filesystem::create_directories(directory / "rules");
+    std::filesystem::path configPath = directory / "mvs.conf";
+    std::filesystem::path rulesPath = directory / "rules" / "mvs.rules";
+    std::ofstream(configPath) << "-t 5\n";
+    std::ofstream(rulesPath) << "include name:*\n";
+
+    ServiceOptions options;
+    options.configFile = configPath.wstring();
+    options.rulesFile = rulesPath.wstring();
+    ConfigFileStamps stamps;
+    stamps.Watch(options);
+    EXPECT_EQ(2u, stamps.Files().size());
+    EXPECT_EQ(2u, stamps.Directories().size());
+    EXPECT_FALSE(stamps.Changed());
+
+    // The service's log next to the configuration is not a change to it
+    std::ofstream(directory / "mvs.log") << "Volume changed\n";
+    EXPECT_FALSE(stamps.Changed());
+
+    std::ofstream(rulesPath, std::ios::app) << "exclude name:*Webcam*\n";
+    EXPECT_TRUE(stamps.Changed());
+    EXPECT_FALSE(stamps.Changed());
+
+    std::filesystem::remove(configPath);
+    EXPECT_TRUE(stamps.Changed());
+    std::filesystem::remove_all(directory);
+}
+
+TEST_FUNCTION(Config_Compare_SeparatesHotAndRestartOptions) {
+    ServiceConfig current;
+    ServiceConfig next;
+    std::wstring restart;
+    EXPECT_EQ(0u, CompareConfigs(current, next, restart));
+
+    next.options.intervalSeconds = 7;
+    next.options.microphoneFilter = L"USB";
+    next.options.callDeadlineMs = 1000;
+    next.options.logLevel = LogLevel::Error;
+    PolicyRule rule;
+    ParsePolicyRule(L"include name:*Mic* volume=80", rule);
+    next.rules.push_back(rule);
+    EXPECT_EQ((uint32_t)(ConfigChangeInterval | ConfigChangeFilter | ConfigChangeRules | ConfigChangeDeadline |
+                         ConfigChangeLogLevel),
+              CompareConfigs(current, next, restart));
+    EXPECT_TRUE(restart.empty());
+
+    next = current;
+    next.options.useEvents = true;
+    next.options.binaryLogFile = L"D:\\mvs.evl";
+    EXPECT_EQ((uint32_t)ConfigChangeRestart, CompareConfigs(current, next, restart));
+    EXPECT_TRUE(restart == L"-events, -binlog");
+}
+
+TEST_FUNCTION(SnapshotSwap_TakeReturnsLatestOnce) {
+    SnapshotSwap<int> swap;
+    EXPECT_TRUE(swap.Take() == nullptr);
+
+    // The first snapshot was never taken and is freed by the second Publish()
+    swap.Publish(std::unique_ptr<const int>(new int(1)));
+    swap.Publish(std::unique_ptr<const int>(new int(2)));
+    std::unique_ptr<const int> taken = swap.Take();
+    EXPECT_TRUE(taken != nullptr);
+    EXPECT_EQ(2, *taken);
+    EXPECT_TRUE(swap.Take() == nullptr);
+
+    // Unconsumed at destruction: freed by the destructor
+    swap.Publish(std::unique_ptr<const int>(new int(3)));
+}
+
+TEST_FUNCTION(SnapshotSwap_ConcurrentPublisher_LastValueArrives) {
+    const int Count = 20000;
+    SnapshotSwap<int> swap;
+    std::atomic<bool> done{false};
+    std::thread publisher([&]() {
+        for (int i = 1; i <= Count; i++) {
+            swap.Publish(std::unique_ptr<const int>(new int(i)));
+        }
+        done = true;
+    });
+
+    int last = 0;
+    bool ordered = true;
+    for (;;) {
+        bool finished = done.load();
+        std::unique_ptr<const int> taken = swap.Take();
+        if (taken) {
+            ordered = ordered && *taken > last;
+            last = *taken;
+        }
+        if (finished && !taken)
+            break;
+    }
+    publisher.join();
+
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(Count, last);
+}
+
+TEST_FUNCTION(Config_Reload_KeepsDeviceStateAndEndpoints) {
+    SimulatedAudioBackend backend;
+    auto usb = backend.AddDevice(L"{usb}", L"USB Microphone", 0.3f);
+    backend.AddDevice(L"{cable}", L"CABLE Output", 0.3f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.SetFilter(L"USB");
+    enforcer.Sweep();
+    EXPECT_FLOAT_EQ(1.0f, usb->Volume());
+    unsigned long long activations = backend.counters.activations;
+
+    // What ApplyPendingConfig() does with a changed filter and rules
+    PolicyRule rule;
+    ParsePolicyRule(L"include name:*USB* volume=80", rule);
+    enforcer.SetRules({ rule });
+    enforcer.SetFilter(L"Microphone");
+    clock.Advance(1000);
+    enforcer.Sweep();
+
+    DeviceHandle handle = enforcer.Devices().Find(L"{usb}");
+    EXPECT_FLOAT_EQ(0.8f, usb->Volume());
+    EXPECT_EQ(2u, enforcer.Devices().Slot(handle).corrections);
+    EXPECT_EQ(activations, backend.counters.activations);
+}
+
+int main() {
+    std::wcout << L"Service config tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
@@ -0,0 +1,136 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/ServiceOptions.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+static ServiceOptions Parse(std::vector<std::wstring> args, int first = 1) {
+    std::vector<wchar_t*> argv;
+    for (std::wstring& arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    ServiceOptions options;
+    ParseServiceOptions((int)argv.size(), argv.data(), first, options);
+    return options;
+}
+
+TEST_FUNCTION(Options_Defaults_WhenNoArguments) {
+    ServiceOptions options = Parse({ L"mvs.exe", L"-service" });
+
+    EXPECT_EQ(2u, options.intervalSeconds);
+    EXPECT_TRUE(options.microphoneFilter.empty());
+    EXPECT_TRUE(options.logFile == DefaultLogFile);
+    EXPECT_FALSE(options.useEvents);
+    EXPECT_EQ(10u, options.logSegmentMb);
+    EXPECT_EQ(5u, options.logSegmentCount);
+}
+
+TEST_FUNCTION(Options_ParsesEveryFlag) {
+    ServiceOptions options = Parse({ L"mvs.exe", L"-install", L"-t", L"7", L"-m", L"USB Mic", L"-events",
+                                     L"-logfile", L"D:\\mvs.log", L"-logsize", L"3", L"-logcount", L"9",
+                                     L"-binlog", L"D:\\mvs.evl" }, 2);
+
+    EXPECT_EQ(7u, options.intervalSeconds);
+    EXPECT_TRUE(options.microphoneFilter == L"USB Mic");
+    EXPECT_TRUE(options.useEvents);
+    EXPECT_TRUE(options.logFile == L"D:\\mvs.log");
+    EXPECT_EQ(3u, options.logSegmentMb);
+    EXPECT_EQ(9u, options.logSegmentCount);
+    EXPECT_TRUE(options.binaryLogFile == L"D:\\mvs.evl");
+}
+
+TEST_FUNCTION(Options_ClampsOutOfRangeValues) {
+    ServiceOptions options = Parse({ L"mvs.exe", L"-t", L"-4", L"-logsize", L"99999", L"-logcount", L"1" });
+    EXPECT_EQ(2u, options.intervalSeconds);
+    EXPECT_EQ(1024u, options.logSegmentMb);
+    EXPECT_EQ(2u, options.logSegmentCount);
+
+    // Without a safety-net sweep only notifications correct, which needs -events
+    options = Parse({ L"mvs.exe", L"-t", L"0", L"-events" });
+    EXPECT_EQ(0u, options.intervalSeconds);
+}
+
+TEST_FUNCTION(Options_FormatServiceArguments_RoundTrips) {
+    EXPECT_TRUE(FormatServiceArguments(ServiceOptions()).empty());
+
+    ServiceOptions options = Parse({ L"mvs.exe", L"-t", L"5", L"-m", L"USB Mic", L"-rules", L"D:\\mics.rules",
+                                     L"-whenrunning", L"helldivers2.exe", L"-sessions", L"-logfile", L"D:\\mvs.log", L"-logcount", L"3", L"-binlog", L"D:\\mvs.evl" });
+    EXPECT_TRUE(options.rulesFile == L"D:\\mics.rules");
+    EXPECT_TRUE(options.enforceSessions);
+    EXPECT_TRUE(options.activationProcesses == L"helldivers2.exe");
+    std::wstring arguments = FormatServiceArguments(options);
+    EXPECT_TRUE(arguments == L" -t 5 -m \"USB Mic\" -rules \"D:\\mics.rules\" -whenrunning \"helldivers2.exe\" -sessions -logfile \"D:\\mvs.log\" -logcount 3 -binlog \"D:\\mvs.evl\"");
+
+    // Rotation settings do not apply to the Event Log
+    options.useEventLog = true;
+    EXPECT_TRUE(FormatServiceArguments(options).find(L"-logcount") == std::wstring::npos);
+}
+
+TEST_FUNCTION(Options_AdaptiveSchedule_ParsesAndClampsBounds) {
+    ServiceOptions options = Parse({ L"mvs.exe", L"-adaptive", L"-tmin", L"500", L"-tmax", L"100" });
+    EXPECT_TRUE(options.adaptive);
+    EXPECT_EQ(500u, options.minIntervalMs);
+    EXPECT_EQ(500u, options.maxIntervalMs);
+
+    options = Parse({ L"mvs.exe", L"-adaptive", L"-tmax", L"60000" });
+    EXPECT_TRUE(FormatServiceArguments(options) == L" -adaptive -tmax 60000");
+}
+
+TEST_FUNCTION(Options_FightStrategy_ParsesAndIgnoresUnknownNames) {
+    EXPECT_TRUE(ServiceOptions().fightStrategy == FightStrategy::Verify);
+    ServiceOptions options = Parse({ L"mvs.exe", L"-fight", L"backoff" });
+    EXPECT_TRUE(options.fightStrategy == FightStrategy::Backoff);
+    EXPECT_TRUE(FormatServiceArguments(options) == L" -fight backoff");
+
+    options = Parse({ L"mvs.exe", L"-fight", L"harder" });
+    EXPECT_TRUE(options.fightStrategy == FightStrategy::Verify);
+}
+
+TEST_FUNCTION(Options_Workers_ParseClampAndRoundTrip) {
+    ServiceOptions options = Parse({ L"mvs.exe", L"-workers", L"0" });
+    EXPECT_EQ(0u, options.workerThreads);
+    EXPECT_TRUE(FormatServiceArguments(options) == L" -workers 0");
+
+    options = Parse({ L"mvs.exe", L"-workers", L"500" });
+    EXPECT_EQ(MaxWorkerThreads, options.workerThreads);
+    EXPECT_TRUE(FormatServiceArguments(Parse({ L"mvs.exe", L"-workers", L"2" })).empty());
+}
+
+TEST_FUNCTION(Options_Deadline_ParseAndRoundTrip) {
+    ServiceOptions options = Parse({ L"mvs.exe", L"-deadline", L"0" });
+    EXPECT_EQ(0u, options.callDeadlineMs);
+    EXPECT_TRUE(FormatServiceArguments(options) == L" -deadline 0");
+    EXPECT_TRUE(FormatServiceArguments(Parse({ L"mvs.exe", L"-deadline", L"5000" })).empty());
+    EXPECT_EQ(1500u, Parse({ L"mvs.exe", L"-workers", L"4", L"-deadline", L"1500" }).callDeadlineMs);
+}
+
+TEST_FUNCTION(Options_LogLevel_ParseAndRoundTrip) {
+    ServiceOptions options = Parse({ L"mvs.exe", L"-loglevel", L"warning" });
+    EXPECT_TRUE(options.logLevel == LogLevel::Warning);
+    EXPECT_TRUE(FormatServiceArguments(options) == L" -loglevel warning");
+    EXPECT_TRUE(Parse({ L"mvs.exe", L"-loglevel", L"error" }).logLevel == LogLevel::Error);
+    EXPECT_TRUE(Parse({ L"mvs.exe", L"-loglevel", L"verbose" }).logLevel == LogLevel::Information);
+    EXPECT_TRUE(FormatServiceArguments(Parse({ L"mvs.exe", L"-loglevel", L"info" })).empty());
+}
+
+TEST_FUNCTION(Options_Metrics_ParseAndRoundTrip) {
+    ServiceOptions options = Parse({ L"mvs.exe", L"-metrics", L"C:\\ProgramData\\mvs.prom", L"-metricspipe" });
+    EXPECT_TRUE(options.metricsFile == L"C:\\ProgramData\\mvs.prom");
+    EXPECT_TRUE(options.metricsPipe);
+    EXPECT_TRUE(FormatServiceArguments(options) == L" -metrics \"C:\\ProgramData\\mvs.prom\" -metricspipe");
+}
+
+TEST_FUNCTION(Options_Config_ParseAndRoundTrip) {
+    ServiceOptions options = Parse({ L"mvs.exe", L"-rules", L"D:\\mics.rules", L"-config", L"D:\\mvs.conf", L"-events" });
+    EXPECT_TRUE(options.configFile == L"D:\\mvs.conf");
+    EXPECT_TRUE(FormatServiceArguments(options) == L" -rules \"D:\\mics.rules\" -config \"D:\\mvs.conf\" -events");
+}
+
+int main() {
+    std::wcout << L"Service options tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
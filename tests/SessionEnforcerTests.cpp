@@ -0,0 +1,215 @@
+#include <iostream>
+#include "SimpleTest.h"
+#include "core/SessionEnforcer.h"
+#include "core/SimulatedSessionManager.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+const std::wstring Speakers = L"{0.0.0.00000000}.{speakers}";
+const std::wstring Mic = L"{0.0.1.00000000}.{mic}";
+
+static std::vector<PolicyRule> Rules(std::initializer_list<const wchar_t *> lines) {
+    std::vector<PolicyRule> rules;
+    for (const wchar_t *line : lines) {
+        PolicyRule rule;
+        if (ParsePolicyRule(line, rule) == S_OK)
+            rules.push_back(rule);
+    }
+    return rules;
+}
+
+struct RecordingSessionObserver : SessionObserver {
+    void OnSessionTracked(SessionHandle) override { tracked++; }
+    void OnSessionEnded(SessionHandle) override { ended++; }
+    void OnSessionCorrected(SessionHandle, float, float) override { corrected++; }
+    void OnSessionMuteCorrected(SessionHandle, bool) override { muteCorrected++; }
+
+    int tracked = 0;
+    int ended = 0;
+    int corrected = 0;
+    int muteCorrected = 0;
+};
+
+TEST_FUNCTION(Sessions_ExistingAndNewSessions_TrackedOnBothFlows) {
+    SimulatedSessionManager manager;
+    manager.AddEndpoint(Speakers, DataFlow::Render);
+    manager.AddEndpoint(Mic, DataFlow::Capture);
+    auto existing = manager.StartSession(Speakers, 100, L"Discord.exe", 0.3f);
+
+    RecordingSessionObserver observer;
+    SessionEnforcer enforcer(manager, observer);
+    enforcer.SetRules(Rules({L"include process:discord.exe volume=80"}));
+    EXPECT_TRUE(SUCCEEDED(enforcer.RefreshEndpoints()));
+
+    EXPECT_EQ(2u, enforcer.WatchedEndpointCount());
+    EXPECT_EQ(1u, enforcer.SessionCount());
+    EXPECT_FLOAT_EQ(0.8f, existing->Volume());
+
+    auto voice = manager.StartSession(Mic, 100, L"Discord.exe", 0.5f);
+    enforcer.ProcessPending();
+    EXPECT_EQ(2u, enforcer.SessionCount());
+    EXPECT_FLOAT_EQ(0.8f, voice->Volume());
+    EXPECT_EQ(2, observer.tracked);
+    EXPECT_EQ(2, observer.corrected);
+    EXPECT_TRUE(enforcer.Session(1).flow == DataFlow::Capture);
+}
+
+TEST_FUNCTION(Sessions_UnmatchedProcess_NotTracked) {
+    SimulatedSessionManager manager;
+    manager.AddEndpoint(Speakers, DataFlow::Render);
+    auto browser = manager.StartSession(Speakers, 200, L"firefox.exe", 0.3f);
+
+    RecordingSessionObserver observer;
+    SessionEnforcer enforcer(manager, observer);
+    enforcer.SetRules(Rules({L"include process:discord.exe", L"exclude process:*"}));
+    enforcer.RefreshEndpoints();
+
+    EXPECT_EQ(0u, enforcer.SessionCount());
+    EXPECT_FLOAT_EQ(0.3f, browser->Volume());
+    EXPECT_EQ(0u, browser->setCalls.load());
+}
+
+TEST_FUNCTION(Sessions_Tamper_CorrectedThroughNotification) {
+    int wakes = 0;
+    SimulatedSessionManager manager;
+    manager.AddEndpoint(Speakers, DataFlow::Render);
+    auto discord = manager.StartSession(Speakers, 100, L"Discord.exe", 1.0f);
+
+    RecordingSessionObserver observer;
+    SessionEnforcer enforcer(manager, observer, [&wakes]() { wakes++; });
+    enforcer.SetRules(Rules({L"include process:discord* mute=unmute"}));
+    enforcer.RefreshEndpoints();
+    EXPECT_EQ(0, wakes);
+
+    discord->Tamper(0.2f);
+    EXPECT_EQ(1, wakes);
+    // Repeated changes before the worker runs are coalesced
+    discord->Tamper(0.1f);
+    EXPECT_EQ(1, wakes);
+    enforcer.ProcessPending();
+    EXPECT_FLOAT_EQ(1.0f, discord->Volume());
+    EXPECT_TRUE(enforcer.Session(0).lastWriter == WriterKind::Unidentified);
+
+    discord->TamperMute(true);
+    enforcer.ProcessPending();
+    EXPECT_FALSE(discord->Muted());
+    EXPECT_EQ(1, observer.corrected);
+    EXPECT_EQ(1, observer.muteCorrected);
+
+    // Our own writes came back as in-band notifications
+    unsigned sets = discord->setCalls;
+    enforcer.ProcessPending();
+    EXPECT_EQ(sets, discord->setCalls.load());
+}
+
+TEST_FUNCTION(Sessions_OwnVolumeAndMuteWrites_NeverWake) {
+    int wakes = 0;
+    SimulatedSessionManager manager;
+    manager.AddEndpoint(Speakers, DataFlow::Render);
+    auto discord = manager.StartSession(Speakers, 100, L"Discord.exe", 0.2f);
+    discord->TamperMute(true);
+
+    RecordingSessionObserver observer;
+    SessionEnforcer enforcer(manager, observer, [&wakes]() { wakes++; });
+    enforcer.SetRules(Rules({L"include process:discord* mute=unmute"}));
+    enforcer.RefreshEndpoints();
+
+    // The volume write was echoed while the session was still muted
+    EXPECT_EQ(0, wakes);
+    enforcer.ProcessPending();
+    EXPECT_EQ(1u, enforcer.Checks());
+    EXPECT_EQ(1u, discord->setCalls.load());
+    EXPECT_EQ(1u, discord->muteSetCalls.load());
+}
+
+TEST_FUNCTION(Sessions_Disconnect_UntracksAndReusesHandle) {
+    SimulatedSessionManager manager;
+    manager.AddEndpoint(Speakers, DataFlow::Render);
+    auto first = manager.StartSession(Speakers, 100, L"Discord.exe");
+
+    RecordingSessionObserver observer;
+    SessionEnforcer enforcer(manager, observer);
+    enforcer.SetRules(Rules({L"include process:discord.exe"}));
+    enforcer.RefreshEndpoints();
+
+    // A late tamper event of the ended session must not touch its successor
+    first->Tamper(0.2f);
+    manager.EndSession(first);
+    auto second = manager.StartSession(Speakers, 101, L"Discord.exe", 1.0f);
+    enforcer.ProcessPending();
+
+    EXPECT_EQ(1, observer.ended);
+    EXPECT_EQ(1u, enforcer.SessionCount());
+    EXPECT_EQ(101u, enforcer.Session(0).processId);
+    EXPECT_EQ(0u, second->setCalls.load());
+}
+
+TEST_FUNCTION(Sessions_ReportedTwice_TrackedOnce) {
+    SimulatedSessionManager manager;
+    manager.AddEndpoint(Speakers, DataFlow::Render);
+
+    RecordingSessionObserver observer;
+    SessionEnforcer enforcer(manager, observer);
+    enforcer.SetRules(Rules({L"include process:discord.exe"}));
+    enforcer.RefreshEndpoints();
+
+    // Created between registration and enumeration: the notification repeats the session
+    auto discord = manager.StartSession(Speakers, 100, L"Discord.exe");
+    manager.RepeatNotification(Speakers, discord);
+    enforcer.ProcessPending();
+    EXPECT_EQ(1u, enforcer.SessionCount());
+    EXPECT_EQ(1, observer.tracked);
+}
+
+TEST_FUNCTION(Sessions_SteadyState_NoReEnumeration) {
+    SimulatedSessionManager manager;
+    manager.AddEndpoint(Speakers, DataFlow::Render);
+    manager.AddEndpoint(Mic, DataFlow::Capture);
+    for (uint32_t pid = 1; pid <= 20; pid++)
+        manager.StartSession(pid % 2 ? Speakers : Mic, pid, pid % 4 == 1 ? L"Discord.exe" : L"other.exe");
+
+    RecordingSessionObserver observer;
+    SessionEnforcer enforcer(manager, observer);
+    enforcer.SetRules(Rules({L"include process:discord.exe"}));
+    enforcer.RefreshEndpoints();
+    EXPECT_EQ(5u, enforcer.SessionCount());
+    uint64_t checks = enforcer.Checks();
+
+    for (int tick = 0; tick < 1000; tick++) {
+        enforcer.ProcessPending();
+        if (tick % 100 == 0)
+            enforcer.RefreshEndpoints();
+    }
+
+    EXPECT_EQ(2ull, manager.counters.sessionEnumerations);
+    EXPECT_EQ(checks, enforcer.Checks());
+    EXPECT_EQ(20ull, manager.counters.processNameReads);
+}
+
+TEST_FUNCTION(Sessions_EndpointRemoved_UntracksItsSessions) {
+    SimulatedSessionManager manager;
+    manager.AddEndpoint(Speakers, DataFlow::Render);
+    manager.AddEndpoint(Mic, DataFlow::Capture);
+    manager.StartSession(Speakers, 100, L"Discord.exe");
+    manager.StartSession(Mic, 100, L"Discord.exe");
+
+    RecordingSessionObserver observer;
+    SessionEnforcer enforcer(manager, observer);
+    enforcer.SetRules(Rules({L"include process:discord.exe"}));
+    enforcer.RefreshEndpoints();
+    EXPECT_EQ(2u, enforcer.SessionCount());
+
+    manager.RemoveEndpoint(Speakers);
+    enforcer.RefreshEndpoints();
+    enforcer.ProcessPending();
+    EXPECT_EQ(1u, enforcer.WatchedEndpointCount());
+    EXPECT_EQ(1u, enforcer.SessionCount());
+    EXPECT_EQ(1, observer.ended);
+}
+
+int main() {
+    std::wcout << L"Session enforcement tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <string>
 #include <exception>
+#include <cstring>
+#include <cmath>
 
 namespace SimpleTest {
     
@@ -104,7 +106,7 @@ public:
     }
 
 #define EXPECT_FLOAT_EQ(expected, actual) \
-    if (abs((expected) - (actual)) > 0.0001f) { \
+    if (std::abs((expected) - (actual)) > 0.0001f) { \
         throw SimpleTest::TestFailure("Expected float equality: " #expected " == " #actual); \
     }
 
@@ -0,0 +1,165 @@
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "SimpleTest.h"
+#include "core/FileIo.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+#include "core/StatusBlock.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+// Every field derived from one number, so a torn read shows as a mismatch
+static void FillGeneration(StatusSnapshot &status, uint64_t generation) {
+    status.magic = StatusMagic;
+    status.version = StatusVersion;
+    status.ticks = generation;
+    status.corrections = generation * 3;
+    status.updatedWallMs = generation * 7;
+    status.deviceCount = MaxStatusDevices;
+    for (int i = 0; i < MaxStatusDevices; i++) {
+        status.devices[i].corrections = (uint32_t)generation;
+        status.devices[i].lastCorrectionWallMs = generation + i;
+    }
+}
+
+static bool IsConsistent(const StatusSnapshot &status) {
+    uint64_t generation = status.ticks;
+    bool consistent = status.corrections == generation * 3 && status.updatedWallMs == generation * 7;
+    for (int i = 0; i < MaxStatusDevices; i++) {
+        consistent = consistent && status.devices[i].corrections == (uint32_t)generation &&
+                     status.devices[i].lastCorrectionWallMs == generation + i;
+    }
+    return consistent;
+}
+
+TEST_FUNCTION(StatusBlock_ZeroFilledBlock_ReadsAsEmpty) {
+    std::unique_ptr<SeqLockedStatus> block(new SeqLockedStatus());
+    StatusSnapshot status;
+    EXPECT_TRUE(block->Read(status));
+    EXPECT_TRUE(status.magic != StatusMagic);
+
+    StatusSnapshot written = StatusSnapshot();
+    FillGeneration(written, 5);
+    block->Write(written);
+    EXPECT_EQ(2u, block->Sequence());
+    EXPECT_TRUE(block->Read(status));
+    EXPECT_EQ(5ull, status.ticks);
+    EXPECT_TRUE(IsConsistent(status));
+}
+
+TEST_FUNCTION(StatusBlock_ConcurrentReaders_NeverSeeTornSnapshot) {
+    std::unique_ptr<SeqLockedStatus> block(new SeqLockedStatus());
+    StatusSnapshot initial = StatusSnapshot();
+    FillGeneration(initial, 0);
+    block->Write(initial);
+
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<int> reads{0};
+    std::atomic<int> backwards{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back([&]() {
+            StatusSnapshot status;
+            uint64_t last = 0;
+            while (!done) {
+                if (!block->Read(status, 1000000))
+                    continue;
+                reads++;
+                if (!IsConsistent(status))
+                    torn++;
+                if (status.ticks < last)
+                    backwards++;
+                last = status.ticks;
+            }
+        });
+    }
+
+    // The writer never waits for the readers
+    StatusSnapshot status = StatusSnapshot();
+    for (uint64_t generation = 1; generation <= 20000; generation++) {
+        FillGeneration(status, generation);
+        block->Write(status);
+    }
+    done = true;
+    for (std::thread &reader : readers)
+        reader.join();
+
+    EXPECT_EQ(0, torn.load());
+    EXPECT_EQ(0, backwards.load());
+    EXPECT_TRUE(reads.load() > 0);
+    EXPECT_TRUE(block->Read(status));
+    EXPECT_EQ(20000ull, status.ticks);
+}
+
+TEST_FUNCTION(StatusBlock_CaptureStatus_ListsDevicesAndCounters) {
+    SimulatedAudioBackend backend;
+    backend.AddDevice(L"{mic}", L"USB Microphone", 0.5f);
+    backend.AddDevice(L"{cable}", L"CABLE Output", 1.0f);
+    VirtualClock clock(10000);
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.SetFilter(L"USB");
+    enforcer.Sweep();
+    clock.Advance(2500);
+
+    StatusSnapshot status = StatusSnapshot();
+    CaptureStatus(enforcer, clock.NowMs(), 1700000000000ull, status);
+    EXPECT_EQ(StatusMagic, status.magic);
+    EXPECT_EQ(1ull, status.ticks);
+    EXPECT_EQ(1ull, status.corrections);
+    EXPECT_EQ(2u, status.presentDevices);
+    EXPECT_EQ(2, (int)status.deviceCount);
+
+    int micIndex = std::string(status.devices[0].name) == "USB Microphone" ? 0 : 1;
+    const DeviceStatus &mic = status.devices[micIndex];
+    EXPECT_TRUE(std::string(mic.name) == "USB Microphone");
+    EXPECT_TRUE(mic.flags & DeviceStatusEnforced);
+    EXPECT_EQ(1u, mic.corrections);
+    EXPECT_EQ(1700000000000ull - 2500, mic.lastCorrectionWallMs);
+    EXPECT_EQ(-1, mic.nextCheckInMs);
+    EXPECT_FALSE(status.devices[1 - micIndex].flags & DeviceStatusEnforced);
+
+    status.state = (uint8_t)ServiceState::Enforcing;
+    status.startedWallMs = 1700000000000ull - 65000;
+    status.nextWakeInMs = 2000;
+    std::wstring text = FormatStatus(status, 1700000000000ull);
+    EXPECT_TRUE(text.find(L"Service: enforcing") == 0);
+    EXPECT_TRUE(text.find(L"up 1m 05s") != std::wstring::npos);
+    EXPECT_TRUE(text.find(L"next wake in 2000 ms") != std::wstring::npos);
+    EXPECT_TRUE(text.find(L"USB Microphone: 100% (target 100%), 1 corrections (last 2.5s ago)") != std::wstring::npos);
+    EXPECT_TRUE(text.find(L"CABLE Output: not enforced") != std::wstring::npos);
+}
+
+TEST_FUNCTION(StatusBlock_ClosedSession_ListsNoDevices) {
+    SimulatedAudioBackend backend;
+    backend.AddDevice(L"{mic}", L"USB Microphone", 1.0f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcer.Sweep();
+    enforcer.Shutdown();
+
+    StatusSnapshot status = StatusSnapshot();
+    CaptureStatus(enforcer, clock.NowMs(), 1000, status);
+    EXPECT_EQ(0, (int)status.deviceCount);
+    status.state = (uint8_t)ServiceState::Idle;
+    EXPECT_TRUE(FormatStatus(status, 1000).find(L"Devices") == std::wstring::npos);
+}
+
+TEST_FUNCTION(StatusBlock_CopyUtf8_TruncatesAtCharacterBoundary) {
+    // The second e-acute would need two more bytes than are left
+    char name[7];
+    const wchar_t *text = L"Mic \u00e9\u00e9";
+    EXPECT_EQ(6u, CopyUtf8(name, sizeof(name), text, 6));
+    EXPECT_TRUE(std::string(name) == "Mic \xc3\xa9");
+}
+
+int main() {
+    std::wcout << L"Status block tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
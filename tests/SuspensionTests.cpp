@@ -0,0 +1,155 @@
+#include <iostream>
+#include "SimpleTest.h"
+#include "core/BinaryEventLog.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+#include "core/Suspension.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+TEST_FUNCTION(Suspend_PauseAndContinue_ReportEachChangeOnce) {
+    int wakes = 0;
+    SuspendController suspend([&]() { wakes++; });
+    EXPECT_TRUE(suspend.Update(0) == SuspendChange::None);
+
+    suspend.Post(ControlEvent::Pause);
+    EXPECT_EQ(1, wakes);
+    EXPECT_TRUE(suspend.Update(1000) == SuspendChange::Suspended);
+    EXPECT_TRUE(suspend.IsSuspended());
+    EXPECT_EQ(SuspendPaused, suspend.Reasons());
+    EXPECT_TRUE(suspend.Update(2000) == SuspendChange::None);
+
+    suspend.Post(ControlEvent::Continue);
+    EXPECT_TRUE(suspend.Update(6000) == SuspendChange::Resumed);
+    EXPECT_FALSE(suspend.IsSuspended());
+    EXPECT_EQ(5000ull, suspend.LastSuspendedMs());
+    EXPECT_TRUE(suspend.Update(7000) == SuspendChange::None);
+}
+
+TEST_FUNCTION(Suspend_OverlappingReasons_ResumeWhenTheLastLifts) {
+    SuspendController suspend;
+    suspend.Post(ControlEvent::SessionLock);
+    EXPECT_TRUE(suspend.Update(0) == SuspendChange::Suspended);
+    suspend.Post(ControlEvent::PowerSuspend);
+    EXPECT_TRUE(suspend.Update(10) == SuspendChange::None);
+    EXPECT_TRUE(std::wstring(SuspendReasonsName(suspend.Reasons())) == L"sleep, session lock");
+
+    // Back from sleep to the lock screen: still suspended
+    suspend.Post(ControlEvent::PowerResume);
+    EXPECT_TRUE(suspend.Update(3600000) == SuspendChange::None);
+    EXPECT_EQ(SuspendLocked, suspend.Reasons());
+
+    suspend.Post(ControlEvent::SessionUnlock);
+    EXPECT_TRUE(suspend.Update(3700000) == SuspendChange::Resumed);
+    EXPECT_EQ(3700000ull, suspend.LastSuspendedMs());
+}
+
+TEST_FUNCTION(Suspend_SleepBetweenTwoUpdates_StillResyncs) {
+    SuspendController suspend;
+    suspend.Post(ControlEvent::PowerSuspend);
+    suspend.Post(ControlEvent::PowerResume);
+
+    EXPECT_TRUE(suspend.Update(500) == SuspendChange::Resumed);
+    EXPECT_FALSE(suspend.IsSuspended());
+    EXPECT_EQ(0ull, suspend.LastSuspendedMs());
+    EXPECT_TRUE(suspend.Update(600) == SuspendChange::None);
+
+    // A continue without a pause is nothing to resume from
+    suspend.Post(ControlEvent::Continue);
+    EXPECT_TRUE(suspend.Update(700) == SuspendChange::None);
+}
+
+// The adaptive service loop on a virtual clock: nothing is scheduled while suspended,
+// a resume re-syncs. Returns the passes run until endMs.
+static int RunUntil(MicrophoneEnforcer& enforcer, SuspendController& suspend, VirtualClock& clock, uint64_t endMs) {
+    int passes = 0;
+    for (;;) {
+        if (suspend.Update(clock.NowMs()) == SuspendChange::Resumed) {
+            enforcer.Resync();
+            passes++;
+        }
+        uint64_t next = suspend.IsSuspended() ? TimerWheel::Never : enforcer.NextCheckMs();
+        if (next >= endMs) {
+            clock.Set(endMs);
+            return passes;
+        }
+        clock.Set(next > clock.NowMs() ? next : clock.NowMs());
+        enforcer.CheckDue();
+        passes++;
+    }
+}
+
+TEST_FUNCTION(Suspend_Sleep_NoChecksThenOneResyncCorrects) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"USB Microphone", 1.0f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    CheckSchedule schedule;
+    schedule.minIntervalMs = 250;
+    schedule.maxIntervalMs = 30000;
+    enforcer.EnableAdaptiveSchedule(schedule);
+    SuspendController suspend;
+
+    // The first pass schedules the device, as the adaptive loop starts with one
+    enforcer.CheckDue();
+    EXPECT_TRUE(RunUntil(enforcer, suspend, clock, 120000) > 0);
+
+    suspend.Post(ControlEvent::PowerSuspend);
+    unsigned reads = mic->getCalls.load();
+    EXPECT_EQ(0, RunUntil(enforcer, suspend, clock, 8 * 3600000ull));
+    EXPECT_EQ(reads, mic->getCalls.load());
+
+    // The driver brings the microphone back at another level
+    mic->Tamper(0.4f);
+    suspend.Post(ControlEvent::PowerResume);
+    uint64_t resumedMs = clock.NowMs();
+    EXPECT_EQ(1, RunUntil(enforcer, suspend, clock, resumedMs + 100));
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_EQ(resumedMs + 250, enforcer.NextCheckMs(enforcer.Devices().Find(L"{mic}")));
+}
+
+TEST_FUNCTION(Suspend_Resync_EndsTamperWarAndChecksHeldDevice) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"USB Microphone", 1.0f);
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    TamperWarOptions options;
+    options.strategy = FightStrategy::Backoff;
+    enforcer.SetTamperWarOptions(options);
+
+    for (int i = 0; i < 4; i++) {
+        mic->Tamper(0.3f);
+        enforcer.Sweep();
+        clock.Advance(1000);
+    }
+    DeviceHandle device = enforcer.Devices().Find(L"{mic}");
+    EXPECT_TRUE(enforcer.InTamperWar(device));
+
+    mic->Tamper(0.3f);
+    enforcer.Resync();
+    EXPECT_FALSE(enforcer.InTamperWar(device));
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_EQ(TimerWheel::Never, enforcer.NextCheckMs());
+}
+
+TEST_FUNCTION(Suspend_BinaryLogEvents_Format) {
+    DecodedEvent event = {};
+    event.record.timestampMs = 1700000000000ull;
+    event.record.device = InvalidDeviceHandle;
+    event.record.type = (uint16_t)EventType::Suspended;
+    event.record.count = SuspendPaused | SuspendSleeping;
+    EXPECT_TRUE(FormatEvent(event).find(L"Suspended (pause, sleep)") != std::wstring::npos);
+
+    event.record.type = (uint16_t)EventType::Resumed;
+    event.record.count = 3600;
+    EXPECT_TRUE(FormatEvent(event).find(L"Resumed after 3600 s") != std::wstring::npos);
+}
+
+int main() {
+    std::wcout << L"Suspension tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
@@ -0,0 +1,202 @@
+#include <iostream>
+#include "SimpleTest.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+const DeviceHandle Mic = 0;
+
+static TamperWarOptions Options(FightStrategy strategy) {
+    TamperWarOptions options;
+    options.strategy = strategy;
+    options.cycles = 3;
+    options.windowMs = 2000;
+    options.quietMs = 5000;
+    return options;
+}
+
+TEST_FUNCTION(TamperWar_CloseCorrections_StartFight) {
+    TamperWarDetector wars;
+    wars.SetOptions(Options(FightStrategy::Verify));
+
+    EXPECT_TRUE(wars.OnCorrected(Mic, 0) == FightChange::None);
+    EXPECT_TRUE(wars.OnCorrected(Mic, 1000) == FightChange::None);
+    EXPECT_TRUE(wars.OnCorrected(Mic, 2000) == FightChange::Started);
+    EXPECT_TRUE(wars.IsFighting(Mic));
+    EXPECT_EQ(3u, wars.State(Mic).cycles);
+    EXPECT_EQ(2100ull, wars.NextCheckMs(Mic));
+    EXPECT_FALSE(wars.IsHeld(Mic, 2000));
+}
+
+TEST_FUNCTION(TamperWar_SpacedCorrections_NeverFight) {
+    TamperWarDetector wars;
+    wars.SetOptions(Options(FightStrategy::Verify));
+
+    for (uint64_t ms = 0; ms < 60000; ms += 2500) {
+        EXPECT_TRUE(wars.OnCorrected(Mic, ms) == FightChange::None);
+    }
+    EXPECT_FALSE(wars.IsFighting(Mic));
+    EXPECT_EQ(UINT64_MAX, wars.NextCheckMs(Mic));
+}
+
+TEST_FUNCTION(TamperWar_VerifyBurst_ThenQuietEndsFight) {
+    TamperWarOptions options = Options(FightStrategy::Verify);
+    options.verifyChecks = 2;
+    TamperWarDetector wars;
+    wars.SetOptions(options);
+    wars.OnCorrected(Mic, 0);
+    wars.OnCorrected(Mic, 100);
+    wars.OnCorrected(Mic, 200);
+
+    EXPECT_TRUE(wars.OnAtTarget(Mic, 300) == FightChange::None);
+    EXPECT_EQ(400ull, wars.NextCheckMs(Mic));
+    EXPECT_TRUE(wars.OnAtTarget(Mic, 400) == FightChange::None);
+    // Burst done: the next check is the one that can end the fight
+    EXPECT_EQ(5200ull, wars.NextCheckMs(Mic));
+    EXPECT_TRUE(wars.OnAtTarget(Mic, 5200) == FightChange::Ended);
+    EXPECT_FALSE(wars.IsFighting(Mic));
+    EXPECT_EQ(3u, wars.State(Mic).cycles);
+}
+
+TEST_FUNCTION(TamperWar_Backoff_DoublesPauseUpToMaximum) {
+    TamperWarOptions options = Options(FightStrategy::Backoff);
+    options.backoffMs = 1000;
+    options.maxBackoffMs = 3000;
+    TamperWarDetector wars;
+    wars.SetOptions(options);
+    wars.OnCorrected(Mic, 0);
+    wars.OnCorrected(Mic, 100);
+    wars.OnCorrected(Mic, 200);
+    EXPECT_TRUE(wars.IsHeld(Mic, 1199));
+    EXPECT_FALSE(wars.IsHeld(Mic, 1200));
+
+    wars.OnCorrected(Mic, 1200);
+    EXPECT_EQ(3200ull, wars.NextCheckMs(Mic));
+    wars.OnCorrected(Mic, 3200);
+    EXPECT_EQ(6200ull, wars.NextCheckMs(Mic));
+    EXPECT_EQ(5u, wars.State(Mic).cycles);
+}
+
+// Counts what the service would log
+class FightObserver : public EnforcementObserver {
+public:
+    explicit FightObserver(MicrophoneEnforcer *&enforcer) : m_enforcer(enforcer) {}
+
+    void OnVolumeCorrected(DeviceHandle device, float, float, CorrectionSource) override {
+        if (!m_enforcer->InTamperWar(device))
+            logged++;
+    }
+    void OnTamperWarStarted(DeviceHandle) override { started++; }
+    void OnTamperWarEnded(DeviceHandle, uint32_t warCycles, uint64_t) override {
+        ended++;
+        cycles = warCycles;
+    }
+
+    int logged = 0;
+    int started = 0;
+    int ended = 0;
+    uint32_t cycles = 0;
+
+private:
+    MicrophoneEnforcer *&m_enforcer;
+};
+
+struct FightResult {
+    unsigned backendCalls;
+    uint64_t wrongMs;
+    int logged;
+    int started;
+    int ended;
+};
+
+// A game that puts the microphone back to 30% every 300 ms for the first minute, against
+// the polling service (a sweep every second plus the checks its tamper war asks for).
+// Runs two minutes of virtual time.
+static FightResult SimulateAggressiveGame(FightStrategy strategy, bool events) {
+    SimulatedAudioBackend backend;
+    auto mic = backend.AddDevice(L"{mic}", L"USB Microphone", 1.0f);
+    VirtualClock clock;
+    MicrophoneEnforcer *enforcerRef = nullptr;
+    FightObserver observer(enforcerRef);
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    enforcerRef = &enforcer;
+    TamperWarOptions options;
+    options.strategy = strategy;
+    enforcer.SetTamperWarOptions(options);
+    if (events)
+        enforcer.EnableNotifications();
+
+    const uint64_t gameStopMs = 60000;
+    const uint64_t endMs = 120000;
+    uint64_t nextSweep = 0;
+    uint64_t nextGame = 300;
+    uint64_t wrongMs = 0;
+    while (clock.NowMs() < endMs) {
+        uint64_t next = nextSweep < nextGame ? nextSweep : nextGame;
+        if (enforcer.NextCheckMs() < next)
+            next = enforcer.NextCheckMs();
+        if (next < clock.NowMs())
+            next = clock.NowMs();
+        if (mic->Volume() < 0.99f)
+            wrongMs += next - clock.NowMs();
+        clock.Set(next);
+
+        if (next == nextGame && next < gameStopMs) {
+            mic->Tamper(0.3f);
+            nextGame += 300;
+            if (events)
+                enforcer.ProcessNotifications();
+        } else if (next == nextSweep) {
+            enforcer.Sweep();
+            nextSweep += 1000;
+        } else if (next == nextGame) {
+            nextGame = UINT64_MAX;
+        } else {
+            enforcer.CheckDue();
+        }
+    }
+    return {mic->getCalls.load() + mic->setCalls.load(), wrongMs, observer.logged, observer.started, observer.ended};
+}
+
+TEST_FUNCTION(TamperWar_AggressiveGame_BackoffCutsCallsAndLogLines) {
+    FightResult off = SimulateAggressiveGame(FightStrategy::Off, false);
+    FightResult backoff = SimulateAggressiveGame(FightStrategy::Backoff, false);
+
+    // Without detection: a correction and a log line every sweep for the whole minute
+    EXPECT_TRUE(off.logged >= 59);
+    EXPECT_EQ(0, off.started);
+
+    EXPECT_EQ(1, backoff.started);
+    EXPECT_EQ(1, backoff.ended);
+    EXPECT_TRUE(backoff.logged <= 4);
+    EXPECT_TRUE(backoff.backendCalls * 2 < off.backendCalls);
+}
+
+TEST_FUNCTION(TamperWar_AggressiveGame_VerifyCutsTimeAtWrongLevel) {
+    FightResult off = SimulateAggressiveGame(FightStrategy::Off, false);
+    FightResult verify = SimulateAggressiveGame(FightStrategy::Verify, false);
+
+    EXPECT_EQ(1, verify.started);
+    EXPECT_EQ(1, verify.ended);
+    EXPECT_TRUE(verify.logged <= 4);
+    EXPECT_TRUE(verify.wrongMs * 2 < off.wrongMs);
+}
+
+TEST_FUNCTION(TamperWar_AggressiveGameWithEvents_BackoffHoldsWatch) {
+    FightResult off = SimulateAggressiveGame(FightStrategy::Off, true);
+    FightResult backoff = SimulateAggressiveGame(FightStrategy::Backoff, true);
+
+    // Notifications alone correct every round
+    EXPECT_TRUE(off.logged >= 150);
+    EXPECT_EQ(1, backoff.started);
+    EXPECT_TRUE(backoff.logged <= 4);
+    EXPECT_TRUE(backoff.backendCalls * 10 < off.backendCalls);
+}
+
+int main() {
+    std::wcout << L"Tamper war tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
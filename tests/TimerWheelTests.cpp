@@ -0,0 +1,89 @@
+#include <iostream>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/TimerWheel.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+TEST_FUNCTION(TimerWheel_PopDue_ReturnsOnlyExpiredIds) {
+    TimerWheel wheel(10, 64);
+    wheel.Schedule(0, 100);
+    wheel.Schedule(1, 250);
+    wheel.Schedule(2, 105);
+
+    std::vector<uint32_t> due;
+    EXPECT_EQ(0u, wheel.PopDue(99, due));
+    EXPECT_EQ(1u, wheel.PopDue(104, due));
+    EXPECT_EQ(0u, due[0]);
+    EXPECT_EQ(1u, wheel.PopDue(249, due));
+    EXPECT_EQ(2u, due[1]);
+    EXPECT_EQ(1u, wheel.Size());
+    EXPECT_EQ(250ull, wheel.NextDueMs());
+}
+
+TEST_FUNCTION(TimerWheel_Reschedule_ReplacesDeadline) {
+    TimerWheel wheel(10, 64);
+    wheel.Schedule(5, 1000);
+    wheel.Schedule(5, 40);
+
+    EXPECT_EQ(1u, wheel.Size());
+    EXPECT_EQ(40ull, wheel.NextDueMs());
+
+    wheel.Cancel(5);
+    EXPECT_FALSE(wheel.IsScheduled(5));
+    EXPECT_EQ(TimerWheel::Never, wheel.NextDueMs());
+}
+
+TEST_FUNCTION(TimerWheel_DeadlinesBeyondOneRevolution_WaitForTheirTurn) {
+    TimerWheel wheel(10, 8); // One revolution is 80 ms
+    wheel.Schedule(0, 15);
+    wheel.Schedule(1, 95);   // Same slot as 15, one revolution later
+    wheel.Schedule(2, 1000);
+
+    std::vector<uint32_t> due;
+    EXPECT_EQ(1u, wheel.PopDue(20, due));
+    EXPECT_EQ(95ull, wheel.NextDueMs());
+    EXPECT_EQ(0u, wheel.PopDue(90, due));
+    EXPECT_EQ(1u, wheel.PopDue(95, due));
+    EXPECT_EQ(1000ull, wheel.NextDueMs());
+
+    // A long gap is covered by one pass over the wheel
+    EXPECT_EQ(1u, wheel.PopDue(5000, due));
+    EXPECT_EQ(0u, wheel.Size());
+}
+
+TEST_FUNCTION(TimerWheel_PastDeadline_IsDueOnNextPop) {
+    TimerWheel wheel(10, 16);
+    std::vector<uint32_t> due;
+    wheel.PopDue(500, due);
+
+    wheel.Schedule(3, 100);
+    EXPECT_EQ(1u, wheel.PopDue(500, due));
+    EXPECT_EQ(3u, due[0]);
+}
+
+TEST_FUNCTION(TimerWheel_ManyIds_PopInDeadlineOrderAcrossSlots) {
+    TimerWheel wheel(1, 128);
+    for (uint32_t id = 0; id < 1000; id++) {
+        wheel.Schedule(id, (id * 7919) % 5000);
+    }
+
+    std::vector<uint32_t> due;
+    for (uint64_t now = 0; now <= 5000; now += 50) {
+        size_t first = due.size();
+        wheel.PopDue(now, due);
+        for (size_t i = first; i < due.size(); i++) {
+            uint64_t deadline = (due[i] * 7919ull) % 5000;
+            EXPECT_TRUE(deadline <= now);
+            EXPECT_TRUE(deadline + 50 > now || now == 0);
+        }
+    }
+    EXPECT_EQ(1000u, due.size());
+}
+
+int main() {
+    std::wcout << L"Timer wheel tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
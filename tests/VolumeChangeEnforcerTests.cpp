@@ -0,0 +1,167 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include "SimpleTest.h"
+#include "core/VolumeChangeEnforcer.h"
+#include "core/SimulatedEndpoint.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+const DeviceHandle Mic = 0;
+const DeviceHandle Headset = 1;
+
+TEST_FUNCTION(Events_Attach_RegistersAndCorrectsInitialLevel) {
+    int wakes = 0;
+    auto mic = std::make_shared<SimulatedEndpoint>(0.4f);
+    VolumeChangeEnforcer enforcer([&wakes]() { wakes++; });
+
+    EXPECT_TRUE(SUCCEEDED(enforcer.Attach(Mic, mic, 1.0f, 0.01f)));
+    EXPECT_EQ(1u, mic->ListenerCount());
+    EXPECT_EQ(1, wakes);
+
+    std::vector<VolumeCorrection> corrections;
+    EXPECT_EQ(1u, enforcer.ProcessPending(corrections));
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_EQ(1u, corrections.size());
+    EXPECT_FLOAT_EQ(0.4f, corrections[0].observedVolume);
+}
+
+TEST_FUNCTION(Events_Tamper_CorrectedOnNextProcess) {
+    int wakes = 0;
+    auto mic = std::make_shared<SimulatedEndpoint>(1.0f);
+    VolumeChangeEnforcer enforcer([&wakes]() { wakes++; });
+    enforcer.Attach(Mic, mic, 1.0f, 0.01f);
+
+    std::vector<VolumeCorrection> corrections;
+    EXPECT_EQ(0u, enforcer.ProcessPending(corrections));
+
+    mic->Tamper(0.25f);
+    EXPECT_EQ(2, wakes);
+    EXPECT_EQ(1u, enforcer.ProcessPending(corrections));
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_EQ(1ull, enforcer.TamperNotifications());
+}
+
+TEST_FUNCTION(Events_OwnWrite_DoesNotTriggerAnotherCorrection) {
+    int wakes = 0;
+    auto mic = std::make_shared<SimulatedEndpoint>(0.5f);
+    VolumeChangeEnforcer enforcer([&wakes]() { wakes++; });
+    enforcer.Attach(Mic, mic, 1.0f, 0.01f);
+
+    std::vector<VolumeCorrection> corrections;
+    enforcer.ProcessPending(corrections);
+    unsigned setsAfterCorrection = mic->setCalls;
+
+    // The correction notified us as well; nothing must be pending afterwards
+    EXPECT_EQ(0u, enforcer.ProcessPending(corrections));
+    EXPECT_EQ(setsAfterCorrection, mic->setCalls.load());
+    EXPECT_EQ(1, wakes);
+}
+
+TEST_FUNCTION(Events_OwnVolumeAndMuteWrites_CauseNoBackendCalls) {
+    int wakes = 0;
+    auto mic = std::make_shared<SimulatedEndpoint>(0.5f);
+    mic->TamperMute(true);
+    VolumeChangeEnforcer enforcer([&wakes]() { wakes++; });
+    enforcer.Attach(Mic, mic, 1.0f, 0.01f, MutePolicy::Unmute);
+
+    // The volume write is echoed while the mute correction is still outstanding
+    std::vector<VolumeCorrection> corrections;
+    EXPECT_EQ(2u, enforcer.ProcessPending(corrections));
+    EXPECT_FALSE(mic->Muted());
+    EXPECT_EQ(2ull, enforcer.OwnNotifications());
+    EXPECT_EQ(0ull, enforcer.TamperNotifications());
+
+    unsigned gets = mic->getCalls;
+    EXPECT_EQ(0u, enforcer.ProcessPending(corrections));
+    EXPECT_EQ(gets, mic->getCalls.load());
+    EXPECT_EQ(1u, mic->setCalls.load());
+    EXPECT_EQ(1u, mic->muteSetCalls.load());
+    EXPECT_EQ(1, wakes);
+}
+
+TEST_FUNCTION(Events_ForeignWrites_RecordWriterKind) {
+    auto mic = std::make_shared<SimulatedEndpoint>(1.0f);
+    VolumeChangeEnforcer enforcer([]() {});
+    enforcer.Attach(Mic, mic, 1.0f, 0.01f);
+    std::vector<VolumeCorrection> corrections;
+    enforcer.ProcessPending(corrections);
+
+    mic->Tamper(0.2f);
+    enforcer.ProcessPending(corrections);
+    const GUID mixer = {0x11111111, 0x2222, 0x3333, {0x44, 0x44, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55}};
+    mic->Tamper(0.3f, mixer);
+    enforcer.ProcessPending(corrections);
+
+    EXPECT_EQ(2u, corrections.size());
+    EXPECT_TRUE(corrections[0].writer == WriterKind::Unidentified);
+    EXPECT_TRUE(corrections[1].writer == WriterKind::Application);
+    EXPECT_TRUE(ClassifyWriter(ServiceEventContext) == WriterKind::Service);
+}
+
+TEST_FUNCTION(Events_ChangeWithinTolerance_Ignored) {
+    int wakes = 0;
+    auto mic = std::make_shared<SimulatedEndpoint>(1.0f);
+    VolumeChangeEnforcer enforcer([&wakes]() { wakes++; });
+    enforcer.Attach(Mic, mic, 1.0f, 0.01f);
+
+    mic->Tamper(0.995f);
+    EXPECT_EQ(1, wakes);
+    EXPECT_EQ(0ull, enforcer.TamperNotifications());
+}
+
+TEST_FUNCTION(Events_Detach_UnregistersListener) {
+    auto mic = std::make_shared<SimulatedEndpoint>(1.0f);
+    auto headset = std::make_shared<SimulatedEndpoint>(1.0f);
+    VolumeChangeEnforcer enforcer([]() {});
+    enforcer.Attach(Mic, mic, 1.0f, 0.01f);
+    enforcer.Attach(Headset, headset, 1.0f, 0.01f);
+
+    enforcer.DetachMissing({Headset});
+    EXPECT_FALSE(enforcer.IsAttached(Mic));
+    EXPECT_TRUE(enforcer.IsAttached(Headset));
+    EXPECT_EQ(0u, mic->ListenerCount());
+
+    enforcer.DetachAll();
+    EXPECT_EQ(0u, headset->ListenerCount());
+}
+
+TEST_FUNCTION(Events_TamperFromOtherThread_CorrectedWithinMilliseconds) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool signalled = false;
+
+    auto mic = std::make_shared<SimulatedEndpoint>(1.0f);
+    VolumeChangeEnforcer enforcer([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        signalled = true;
+        cv.notify_one();
+    });
+    enforcer.Attach(Mic, mic, 1.0f, 0.01f);
+    std::vector<VolumeCorrection> corrections;
+    enforcer.ProcessPending(corrections);
+    signalled = false;
+
+    auto tamperedAt = std::chrono::steady_clock::now();
+    std::thread game([&mic]() { mic->Tamper(0.1f); });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        EXPECT_TRUE(cv.wait_for(lock, std::chrono::seconds(2), [&]() { return signalled; }));
+    }
+    enforcer.ProcessPending(corrections);
+    auto correctedAt = std::chrono::steady_clock::now();
+    game.join();
+
+    EXPECT_FLOAT_EQ(1.0f, mic->Volume());
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(correctedAt - tamperedAt).count(), 100);
+}
+
+int main() {
+    std::wcout << L"Event-driven enforcement tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
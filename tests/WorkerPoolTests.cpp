@@ -0,0 +1,251 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SimpleTest.h"
+#include "core/MicrophoneEnforcer.h"
+#include "core/SimulatedAudioBackend.h"
+#include "core/WorkerPool.h"
+
+using namespace SimpleTest;
+using namespace MicVol;
+
+TEST_FUNCTION(WorkerPool_NoThreads_RunsInlineInOrder) {
+    WorkerPool pool;
+    std::vector<uint32_t> keys = {5, 1, 5, 2};
+    std::vector<uint32_t> order;
+    EXPECT_TRUE(pool.RunBatch(keys.data(), keys.size(), [&](uint32_t key) { order.push_back(key); }));
+
+    EXPECT_TRUE(order == keys);
+}
+
+TEST_FUNCTION(WorkerPool_Batch_RunsEveryTaskOnce) {
+    int starts = 0;
+    std::mutex mutex;
+    WorkerPool pool([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        starts++;
+    });
+    EXPECT_EQ(S_OK, pool.Start(3));
+    EXPECT_EQ(S_FALSE, pool.Start(3));
+
+    std::vector<uint32_t> keys;
+    for (uint32_t key = 0; key < 1000; key++)
+        keys.push_back(key);
+    std::vector<std::atomic<int>> runs(keys.size());
+    for (int batch = 0; batch < 20; batch++)
+        pool.RunBatch(keys.data(), keys.size(), [&](uint32_t key) { runs[key]++; });
+
+    for (auto &count : runs)
+        EXPECT_EQ(20, count.load());
+    pool.Stop();
+    EXPECT_EQ(3, starts);
+}
+
+TEST_FUNCTION(WorkerPool_SameKey_StaysOnOneThreadUntilStolen) {
+    WorkerPool pool;
+    pool.Start(3);
+    std::vector<uint32_t> keys = {0, 1, 2, 3};
+    std::vector<std::thread::id> first(keys.size()), second(keys.size());
+
+    // Long tasks leave nothing to steal: every thread is busy with its own
+    auto record = [&](std::vector<std::thread::id> &threads) {
+        return [&](uint32_t key) {
+            threads[key] = std::this_thread::get_id();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        };
+    };
+    pool.RunBatch(keys.data(), keys.size(), record(first));
+    pool.RunBatch(keys.data(), keys.size(), record(second));
+
+    // A thread slow to wake up may have had its task stolen
+    if (pool.Steals().Value() == 0) {
+        EXPECT_TRUE(first[0] == first[3]);
+        EXPECT_TRUE(first[0] != std::this_thread::get_id());
+        for (size_t i = 0; i < keys.size(); i++)
+            EXPECT_TRUE(first[i] == second[i]);
+    }
+}
+
+TEST_FUNCTION(WorkerPool_UnevenShards_IdleThreadsSteal) {
+    WorkerPool pool;
+    pool.Start(3);
+
+    // Every key maps to the first thread's shard
+    std::vector<uint32_t> keys(16, 3);
+    std::mutex mutex;
+    std::vector<std::thread::id> threads;
+    pool.RunBatch(keys.data(), keys.size(), [&](uint32_t) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (std::find(threads.begin(), threads.end(), std::this_thread::get_id()) == threads.end())
+            threads.push_back(std::this_thread::get_id());
+    });
+
+    EXPECT_TRUE(pool.Steals().Value() > 0);
+    EXPECT_TRUE(threads.size() > 1);
+}
+
+TEST_FUNCTION(WorkerPool_Deadline_AbandonsStuckTask) {
+    WorkerPool pool;
+    pool.Start(2);
+    std::mutex mutex;
+    std::condition_variable released;
+    bool release = false;
+    std::atomic<int> finished{0};
+
+    std::vector<uint32_t> keys = {0, 1, 2, 3};
+    // Outlives the abandoned task, unlike a temporary
+    std::function<void(uint32_t)> task = [&](uint32_t key) {
+        if (key == 0) {
+            std::unique_lock<std::mutex> lock(mutex);
+            released.wait(lock, [&]() { return release; });
+        }
+        finished++;
+    };
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(pool.RunBatch(keys.data(), keys.size(), task, 50));
+    EXPECT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+    EXPECT_EQ(3, finished.load());
+    EXPECT_EQ(1ull, pool.Abandoned().Value());
+
+    // The other thread carries on alone; the stuck one rejoins once its task returns
+    EXPECT_TRUE(pool.RunBatch(keys.data() + 1, 3, task, 50));
+    EXPECT_EQ(6, finished.load());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+        released.notify_all();
+    }
+    for (int i = 0; i < 500 && finished.load() < 7; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    EXPECT_EQ(7, finished.load());
+    EXPECT_TRUE(pool.RunBatch(keys.data(), keys.size(), task, 50));
+    EXPECT_EQ(11, finished.load());
+}
+
+TEST_FUNCTION(WorkerPool_EveryThreadStuck_DropsQueuedTasks) {
+    WorkerPool pool;
+    pool.Start(1);
+    std::mutex mutex;
+    std::condition_variable released;
+    bool release = false;
+    std::atomic<int> finished{0};
+
+    std::vector<uint32_t> keys = {0, 1, 2};
+    // Outlives the abandoned task, unlike a temporary
+    std::function<void(uint32_t)> task = [&](uint32_t key) {
+        if (key == 0) {
+            std::unique_lock<std::mutex> lock(mutex);
+            released.wait(lock, [&]() { return release; });
+        }
+        finished++;
+    };
+    EXPECT_FALSE(pool.RunBatch(keys.data(), keys.size(), task, 30));
+    EXPECT_EQ(0, finished.load());
+
+    // Still stuck: nothing runs, and the batch does not wait for the deadline either
+    EXPECT_FALSE(pool.RunBatch(keys.data() + 1, 2, task, 1000));
+    EXPECT_EQ(0, finished.load());
+
+    // Stop() leaves the stuck thread behind instead of hanging
+    pool.Stop();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+        released.notify_all();
+    }
+    for (int i = 0; i < 500 && finished.load() < 1; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    EXPECT_EQ(1, finished.load());
+}
+
+TEST_FUNCTION(WorkerPool_StuckThread_ReplacedBySpare) {
+    WorkerPool pool;
+    pool.Start(1, 1);
+    std::mutex mutex;
+    std::condition_variable released;
+    bool release = false;
+    std::atomic<int> finished{0};
+
+    std::vector<uint32_t> keys = {0, 1, 2};
+    // Outlives the abandoned tasks, unlike a temporary
+    std::function<void(uint32_t)> task = [&](uint32_t key) {
+        if (key == 0) {
+            std::unique_lock<std::mutex> lock(mutex);
+            released.wait(lock, [&]() { return release; });
+        }
+        finished++;
+    };
+    // A spare takes over the shard and runs what the stuck thread left queued
+    EXPECT_FALSE(pool.RunBatch(keys.data(), keys.size(), task, 30));
+    EXPECT_EQ(2, finished.load());
+    EXPECT_EQ(1ull, pool.Replaced().Value());
+
+    // With the one spare still stuck, the next stuck thread keeps its shard
+    EXPECT_FALSE(pool.RunBatch(keys.data(), keys.size(), task, 30));
+    EXPECT_EQ(2, finished.load());
+    EXPECT_EQ(1ull, pool.Replaced().Value());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+        released.notify_all();
+    }
+    for (int i = 0; i < 500 && finished.load() < 4; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    EXPECT_EQ(4, finished.load());
+    EXPECT_TRUE(pool.RunBatch(keys.data(), keys.size(), task, 30));
+    EXPECT_EQ(7, finished.load());
+}
+
+TEST_FUNCTION(WorkerPool_EnforcerSweep_SameOutcomeAsWithout) {
+    SimulatedAudioBackend backend;
+    std::vector<std::shared_ptr<SimulatedEndpoint>> mics;
+    for (int i = 0; i < 6; i++)
+        mics.push_back(backend.AddDevice(L"{mic-" + std::to_wstring(i) + L"}", L"Mic " + std::to_wstring(i), 0.3f));
+    mics[0]->SetCallHook([]() { std::this_thread::sleep_for(std::chrono::milliseconds(30)); });
+    mics[3]->SetFailure(E_FAIL);
+
+    VirtualClock clock;
+    EnforcementObserver observer;
+    MicrophoneEnforcer enforcer(backend, clock, observer);
+    WorkerPool pool;
+    pool.Start(2);
+    enforcer.SetWorkerPool(&pool);
+    enforcer.Sweep();
+
+    for (int i = 0; i < 6; i++) {
+        const DeviceSlot &slot = enforcer.Devices().Slot(enforcer.Devices().Find(L"{mic-" + std::to_wstring(i) + L"}"));
+        if (i == 3) {
+            EXPECT_FLOAT_EQ(0.3f, mics[i]->Volume());
+            EXPECT_EQ(2u, slot.errorCount); // The read and the correction after it
+        } else {
+            EXPECT_FLOAT_EQ(1.0f, mics[i]->Volume());
+            EXPECT_EQ(1u, slot.corrections);
+        }
+    }
+    EXPECT_EQ(6ull, enforcer.Checks());
+    EXPECT_EQ(6ull, enforcer.Session().TickCalls().volumeReads);
+    EXPECT_EQ(6ull, enforcer.Session().TickCalls().volumeWrites);
+
+    // The failed endpoint was dropped from the cache and is activated again; the others are at target
+    mics[3]->SetFailure(S_OK);
+    clock.Advance(2000);
+    enforcer.Sweep();
+    EXPECT_EQ(1ull, enforcer.Session().TickCalls().activations);
+    EXPECT_EQ(1ull, enforcer.Session().TickCalls().volumeWrites);
+    EXPECT_FLOAT_EQ(1.0f, mics[3]->Volume());
+    enforcer.SetWorkerPool(nullptr);
+}
+
+int main() {
+    std::wcout << L"Worker pool tests" << std::endl;
+    TestRunner::PrintSummary();
+    return TestRunner::GetFailedCount();
+}
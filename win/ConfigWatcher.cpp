@@ -0,0 +1,109 @@
+#include "ConfigWatcher.h"
+#include <system_error>
+
+// Quiet time after the last change before reloading
+static const DWORD SettleMs = 250;
+
+HRESULT ConfigWatcher::Start(const MicVol::ServiceOptions &options, std::function<void()> onChange)
+{
+    if (m_thread.joinable())
+        return E_FAIL;
+
+    m_stamps.Watch(options);
+    for (const std::wstring &directory : m_stamps.Directories())
+    {
+        HANDLE change = FindFirstChangeNotificationW(directory.c_str(), FALSE,
+                                                     FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+        if (change == INVALID_HANDLE_VALUE)
+        {
+            HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+            Stop();
+            return hr;
+        }
+        m_changes.push_back(change);
+    }
+
+    m_stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    m_reloadEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (m_stopEvent == NULL || m_reloadEvent == NULL)
+    {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        Stop();
+        return hr;
+    }
+
+    m_onChange = std::move(onChange);
+    try
+    {
+        m_thread = std::thread(&ConfigWatcher::Run, this);
+    }
+    catch (const std::system_error &)
+    {
+        Stop();
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+void ConfigWatcher::RequestReload()
+{
+    if (m_reloadEvent)
+        SetEvent(m_reloadEvent);
+}
+
+void ConfigWatcher::Stop()
+{
+    if (m_thread.joinable())
+    {
+        SetEvent(m_stopEvent);
+        m_thread.join();
+    }
+    for (HANDLE change : m_changes)
+    {
+        FindCloseChangeNotification(change);
+    }
+    m_changes.clear();
+    if (m_stopEvent)
+    {
+        CloseHandle(m_stopEvent);
+        m_stopEvent = NULL;
+    }
+    if (m_reloadEvent)
+    {
+        CloseHandle(m_reloadEvent);
+        m_reloadEvent = NULL;
+    }
+}
+
+void ConfigWatcher::Run()
+{
+    std::vector<HANDLE> handles = {m_stopEvent, m_reloadEvent};
+    handles.insert(handles.end(), m_changes.begin(), m_changes.end());
+    const DWORD count = (DWORD)handles.size();
+    for (;;)
+    {
+        DWORD wait = WaitForMultipleObjects(count, handles.data(), FALSE, INFINITE);
+        if (wait >= WAIT_OBJECT_0 + 2 && wait < WAIT_OBJECT_0 + count)
+        {
+            // Wait until the directories have been quiet for SettleMs
+            do
+            {
+                if (!FindNextChangeNotification(handles[wait - WAIT_OBJECT_0]))
+                    return;
+                wait = WaitForMultipleObjects(count, handles.data(), FALSE, SettleMs);
+            } while (wait >= WAIT_OBJECT_0 + 2 && wait < WAIT_OBJECT_0 + count);
+            if (wait == WAIT_OBJECT_0)
+                return;
+
+            // Something else in the directories changed, e.g. a log file
+            if (wait == WAIT_TIMEOUT && !m_stamps.Changed())
+                continue;
+        }
+        else if (wait != WAIT_OBJECT_0 + 1)
+        {
+            return;
+        }
+        m_stamps.Changed();
+        m_onChange();
+    }
+}
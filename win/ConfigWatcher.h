@@ -0,0 +1,34 @@
+#pragma once
+#include <windows.h>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/ServiceConfig.h"
+
+// Calls onChange on its own thread whenever the configuration file or the rules file
+// it names is written, created or renamed (once the writes have settled, since editors
+// save in several steps), and whenever RequestReload() is called, as for
+// SERVICE_CONTROL_PARAMCHANGE. The directories of both files are watched; writes to
+// other files there are told apart by the files' size and last write time.
+class ConfigWatcher
+{
+private:
+    std::function<void()> m_onChange;
+    HANDLE m_stopEvent = NULL;
+    HANDLE m_reloadEvent = NULL;
+    std::vector<HANDLE> m_changes; // One per directory
+    MicVol::ConfigFileStamps m_stamps;
+    std::thread m_thread;
+
+    void Run();
+
+public:
+    ~ConfigWatcher() { Stop(); }
+
+    // Watches options.configFile and options.rulesFile; Stop() and Start() again when
+    // a reload names another rules file
+    HRESULT Start(const MicVol::ServiceOptions &options, std::function<void()> onChange);
+    void RequestReload();
+    void Stop();
+};
@@ -0,0 +1,16 @@
+#include "EventLogSink.h"
+
+HRESULT EventLogSink::Write(const MicVol::LogRecord &record)
+{
+    WORD eventType = EVENTLOG_INFORMATION_TYPE;
+    if (record.level == MicVol::LogLevel::Warning)
+        eventType = EVENTLOG_WARNING_TYPE;
+    else if (record.level == MicVol::LogLevel::Error)
+        eventType = EVENTLOG_ERROR_TYPE;
+
+    // Records are always null-terminated
+    LPCWSTR strings[] = { record.text };
+    if (!ReportEventW(m_eventSource, eventType, 0, 0, NULL, 1, 0, strings, NULL))
+        return HRESULT_FROM_WIN32(GetLastError());
+    return S_OK;
+}
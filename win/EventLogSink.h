@@ -0,0 +1,16 @@
+#pragma once
+#include <windows.h>
+#include "core/LogSink.h"
+
+// Reports each record to the Windows Event Log. The caller owns the event source handle.
+class EventLogSink : public MicVol::LogSink
+{
+private:
+    HANDLE m_eventSource;
+
+public:
+    explicit EventLogSink(HANDLE eventSource) : m_eventSource(eventSource) {}
+
+    HRESULT Write(const MicVol::LogRecord &record) override;
+    HRESULT Flush() override { return S_OK; }
+};
@@ -0,0 +1,131 @@
+#include "MetricsPipe.h"
+#include <sddl.h>
+#include <string>
+#include <system_error>
+
+#pragma comment(lib, "advapi32.lib")
+
+// SYSTEM and administrators own it, authenticated users may read
+static const wchar_t *const PipeSecurity = L"D:(A;;GA;;;SY)(A;;GA;;;BA)(A;;GR;;;AU)";
+
+HRESULT MetricsPipe::Start()
+{
+    if (m_thread.joinable())
+        return E_FAIL;
+
+    m_stopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (m_stopEvent == NULL)
+        return HRESULT_FROM_WIN32(GetLastError());
+    try
+    {
+        m_thread = std::thread(&MetricsPipe::Serve, this);
+    }
+    catch (const std::system_error &)
+    {
+        CloseHandle(m_stopEvent);
+        m_stopEvent = NULL;
+        return E_FAIL;
+    }
+    return S_OK;
+}
+
+void MetricsPipe::Stop()
+{
+    if (!m_thread.joinable())
+        return;
+
+    // Every wait in Serve() includes the stop event, whether or not a pipe exists yet
+    SetEvent(m_stopEvent);
+    m_thread.join();
+    CloseHandle(m_stopEvent);
+    m_stopEvent = NULL;
+}
+
+void MetricsPipe::Serve()
+{
+    PSECURITY_DESCRIPTOR descriptor = NULL;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(PipeSecurity, SDDL_REVISION_1, &descriptor, NULL))
+        return;
+    SECURITY_ATTRIBUTES attributes = {sizeof(attributes), descriptor, FALSE};
+
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    while (overlapped.hEvent != NULL && WaitForSingleObject(m_stopEvent, 0) == WAIT_TIMEOUT)
+    {
+        // Duplex only so Send() can see the client close its end; clients may only read.
+        // The first instance flag keeps anyone else from creating the pipe before us.
+        HANDLE pipe = CreateNamedPipeW(MetricsPipeName,
+                                       PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                       PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 64 * 1024, 0, 0,
+                                       &attributes);
+        if (pipe == INVALID_HANDLE_VALUE)
+            break;
+
+        if (Connect(pipe, overlapped))
+            Send(pipe, overlapped);
+        DisconnectNamedPipe(pipe);
+        CloseHandle(pipe);
+    }
+
+    if (overlapped.hEvent != NULL)
+        CloseHandle(overlapped.hEvent);
+    LocalFree(descriptor);
+}
+
+// Waits for a client without a timeout; false when stopping
+bool MetricsPipe::Connect(HANDLE pipe, OVERLAPPED &overlapped)
+{
+    ResetEvent(overlapped.hEvent);
+    if (ConnectNamedPipe(pipe, &overlapped))
+        return true;
+
+    switch (GetLastError())
+    {
+    case ERROR_PIPE_CONNECTED:
+        return true;
+    case ERROR_IO_PENDING:
+        return Complete(pipe, overlapped, INFINITE);
+    default:
+        return false;
+    }
+}
+
+void MetricsPipe::Send(HANDLE pipe, OVERLAPPED &overlapped)
+{
+    ULONGLONG start = GetTickCount64();
+    std::string text = m_registry.FormatPrometheus();
+
+    ResetEvent(overlapped.hEvent);
+    if (!WriteFile(pipe, text.data(), (DWORD)text.size(), NULL, &overlapped))
+    {
+        if (GetLastError() != ERROR_IO_PENDING || !Complete(pipe, overlapped, ClientTimeoutMs))
+            return;
+    }
+
+    // Disconnecting discards what the client has not read yet, and FlushFileBuffers()
+    // would wait for it without a timeout. Wait for the client to close its end
+    // instead, which fails this read, for the rest of its time.
+    ULONGLONG elapsed = GetTickCount64() - start;
+    if (elapsed >= ClientTimeoutMs)
+        return;
+    char unused;
+    ResetEvent(overlapped.hEvent);
+    if (!ReadFile(pipe, &unused, 1, NULL, &overlapped) && GetLastError() == ERROR_IO_PENDING)
+        Complete(pipe, overlapped, ClientTimeoutMs - (DWORD)elapsed);
+}
+
+// Waits for the pending I/O; cancels it when stopping or after timeoutMs. True when
+// the I/O completed successfully.
+bool MetricsPipe::Complete(HANDLE pipe, OVERLAPPED &overlapped, DWORD timeoutMs)
+{
+    HANDLE events[] = {m_stopEvent, overlapped.hEvent};
+    DWORD wait = WaitForMultipleObjects(2, events, FALSE, timeoutMs);
+    DWORD transferred = 0;
+    if (wait != WAIT_OBJECT_0 + 1)
+    {
+        CancelIoEx(pipe, &overlapped);
+        GetOverlappedResult(pipe, &overlapped, &transferred, TRUE);
+        return false;
+    }
+    return GetOverlappedResult(pipe, &overlapped, &transferred, FALSE) != FALSE;
+}
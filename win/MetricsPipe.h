@@ -0,0 +1,34 @@
+#pragma once
+#include <windows.h>
+#include <thread>
+#include "core/Metrics.h"
+
+const wchar_t *const MetricsPipeName = L"\\\\.\\pipe\\MicrophoneVolumeService.metrics";
+
+// Serves the metrics in Prometheus text format on a local named pipe: every client
+// that connects gets one snapshot, then the pipe is closed. Remote clients are
+// rejected and only signed-in users may read; reading is enough, e.g.
+// "type \\.\pipe\MicrophoneVolumeService.metrics". A client gets ClientTimeoutMs to
+// read the snapshot, so one that connects and never reads cannot hold up the others
+// or the service stopping.
+class MetricsPipe
+{
+private:
+    static const DWORD ClientTimeoutMs = 5000;
+
+    const MicVol::MetricsRegistry &m_registry;
+    std::thread m_thread;
+    HANDLE m_stopEvent = NULL;
+
+    void Serve();
+    bool Connect(HANDLE pipe, OVERLAPPED &overlapped);
+    void Send(HANDLE pipe, OVERLAPPED &overlapped);
+    bool Complete(HANDLE pipe, OVERLAPPED &overlapped, DWORD timeoutMs);
+
+public:
+    explicit MetricsPipe(const MicVol::MetricsRegistry &registry) : m_registry(registry) {}
+    ~MetricsPipe() { Stop(); }
+
+    HRESULT Start();
+    void Stop();
+};
@@ -0,0 +1,81 @@
+#include "StatusMemory.h"
+#include <sddl.h>
+
+#pragma comment(lib, "advapi32.lib")
+
+static const wchar_t *const StatusNames[] = {L"Global\\MicrophoneVolumeService.status",
+                                             L"Local\\MicrophoneVolumeService.status"};
+
+HRESULT StatusMemory::Create()
+{
+    Close();
+
+    // SYSTEM and administrators own it, authenticated users may read
+    PSECURITY_DESCRIPTOR descriptor = NULL;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(L"D:(A;;GA;;;SY)(A;;GA;;;BA)(A;;GR;;;AU)",
+                                                              SDDL_REVISION_1, &descriptor, NULL))
+        return HRESULT_FROM_WIN32(GetLastError());
+    SECURITY_ATTRIBUTES attributes = {sizeof(attributes), descriptor, FALSE};
+
+    DWORD error = ERROR_SUCCESS;
+    for (const wchar_t *name : StatusNames)
+    {
+        m_mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, &attributes, PAGE_READWRITE, 0,
+                                       sizeof(MicVol::SeqLockedStatus), name);
+        if (m_mapping != NULL)
+            break;
+        error = GetLastError();
+    }
+    LocalFree(descriptor);
+    if (m_mapping == NULL)
+        return HRESULT_FROM_WIN32(error);
+
+    // A new mapping is zero-filled, which is an empty SeqLockedStatus
+    m_status = (MicVol::SeqLockedStatus *)MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, sizeof(MicVol::SeqLockedStatus));
+    if (m_status == nullptr)
+    {
+        error = GetLastError();
+        Close();
+        return HRESULT_FROM_WIN32(error);
+    }
+    return S_OK;
+}
+
+HRESULT StatusMemory::OpenForReading()
+{
+    Close();
+
+    DWORD error = ERROR_FILE_NOT_FOUND;
+    for (const wchar_t *name : StatusNames)
+    {
+        m_mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, name);
+        if (m_mapping != NULL)
+            break;
+        error = GetLastError();
+    }
+    if (m_mapping == NULL)
+        return HRESULT_FROM_WIN32(error);
+
+    m_status = (MicVol::SeqLockedStatus *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, sizeof(MicVol::SeqLockedStatus));
+    if (m_status == nullptr)
+    {
+        error = GetLastError();
+        Close();
+        return HRESULT_FROM_WIN32(error);
+    }
+    return S_OK;
+}
+
+void StatusMemory::Close()
+{
+    if (m_status)
+    {
+        UnmapViewOfFile(m_status);
+        m_status = nullptr;
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = NULL;
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <windows.h>
+#include "core/StatusBlock.h"
+
+// Named shared memory holding the SeqLockedStatus of the running service, so -status
+// can read it without the log or the Service Control Manager. The service creates it
+// in the Global namespace, readable by every signed-in user; a console -test without
+// the privilege for that falls back to the Local namespace of its session.
+class StatusMemory
+{
+private:
+    HANDLE m_mapping = NULL;
+    MicVol::SeqLockedStatus *m_status = nullptr;
+
+public:
+    ~StatusMemory() { Close(); }
+
+    HRESULT Create();
+    HRESULT OpenForReading();
+    void Close();
+
+    MicVol::SeqLockedStatus *Status() { return m_status; }
+};
@@ -0,0 +1,427 @@
+#include "WasapiBackend.h"
+#include <functiondiscoverykeys_devpkey.h>
+
+// PKEY_AudioEndpoint_FormFactor, defined here so no GUID library has to be linked
+static const PROPERTYKEY FormFactorKey = {
+    {0x1da5d803, 0xd492, 0x4edd, {0x8c, 0x23, 0xe0, 0xc0, 0xff, 0xee, 0x7f, 0x0e}}, 0};
+
+// EndpointVolumeCallback
+
+HRESULT STDMETHODCALLTYPE EndpointVolumeCallback::QueryInterface(REFIID riid, void **ppvObject)
+{
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IAudioEndpointVolumeCallback))
+    {
+        *ppvObject = static_cast<IAudioEndpointVolumeCallback *>(this);
+        AddRef();
+        return S_OK;
+    }
+    *ppvObject = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE EndpointVolumeCallback::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+ULONG STDMETHODCALLTYPE EndpointVolumeCallback::Release()
+{
+    ULONG newRef = InterlockedDecrement(&m_refCount);
+    if (newRef == 0)
+    {
+        delete this;
+    }
+    return newRef;
+}
+
+HRESULT STDMETHODCALLTYPE EndpointVolumeCallback::OnNotify(PAUDIO_VOLUME_NOTIFICATION_DATA pNotify)
+{
+    if (pNotify)
+    {
+        MicVol::VolumeNotification notification = {pNotify->fMasterVolume, pNotify->bMuted != FALSE,
+                                                       pNotify->guidEventContext};
+        m_listener->OnVolumeNotification(notification);
+    }
+    return S_OK;
+}
+
+// WasapiVolumeEndpoint
+
+WasapiVolumeEndpoint::~WasapiVolumeEndpoint()
+{
+    UnregisterListener(NULL);
+    m_pEndpointVolume->Release();
+}
+
+HRESULT WasapiVolumeEndpoint::GetMasterVolume(float *level)
+{
+    return m_pEndpointVolume->GetMasterVolumeLevelScalar(level);
+}
+
+HRESULT WasapiVolumeEndpoint::SetMasterVolume(float level)
+{
+    return m_pEndpointVolume->SetMasterVolumeLevelScalar(level, &MicVol::ServiceEventContext);
+}
+
+HRESULT WasapiVolumeEndpoint::GetMute(bool *muted)
+{
+    BOOL bMuted = FALSE;
+    HRESULT hr = m_pEndpointVolume->GetMute(&bMuted);
+    if (SUCCEEDED(hr))
+        *muted = bMuted != FALSE;
+    return hr;
+}
+
+HRESULT WasapiVolumeEndpoint::SetMute(bool muted)
+{
+    return m_pEndpointVolume->SetMute(muted ? TRUE : FALSE, &MicVol::ServiceEventContext);
+}
+
+HRESULT WasapiVolumeEndpoint::RegisterListener(MicVol::VolumeListener *listener)
+{
+    if (m_pCallback)
+        return E_FAIL;
+
+    m_pCallback = new EndpointVolumeCallback(listener);
+    HRESULT hr = m_pEndpointVolume->RegisterControlChangeNotify(m_pCallback);
+    if (FAILED(hr))
+    {
+        m_pCallback->Release();
+        m_pCallback = NULL;
+    }
+    return hr;
+}
+
+HRESULT WasapiVolumeEndpoint::UnregisterListener(MicVol::VolumeListener *)
+{
+    if (!m_pCallback)
+        return S_FALSE;
+
+    HRESULT hr = m_pEndpointVolume->UnregisterControlChangeNotify(m_pCallback);
+    m_pCallback->Release();
+    m_pCallback = NULL;
+    return hr;
+}
+
+// DeviceNotificationClient
+
+HRESULT STDMETHODCALLTYPE DeviceNotificationClient::QueryInterface(REFIID riid, void **ppvObject)
+{
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IMMNotificationClient))
+    {
+        *ppvObject = static_cast<IMMNotificationClient *>(this);
+        AddRef();
+        return S_OK;
+    }
+    *ppvObject = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE DeviceNotificationClient::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+ULONG STDMETHODCALLTYPE DeviceNotificationClient::Release()
+{
+    ULONG newRef = InterlockedDecrement(&m_refCount);
+    if (newRef == 0)
+    {
+        delete this;
+    }
+    return newRef;
+}
+
+HRESULT STDMETHODCALLTYPE DeviceNotificationClient::OnDeviceAdded(LPCWSTR pwstrDeviceId)
+{
+    if (pwstrDeviceId)
+        m_sink->OnDeviceAdded(pwstrDeviceId);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DeviceNotificationClient::OnDeviceRemoved(LPCWSTR pwstrDeviceId)
+{
+    if (pwstrDeviceId)
+        m_sink->OnDeviceRemoved(pwstrDeviceId);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DeviceNotificationClient::OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState)
+{
+    if (pwstrDeviceId)
+        m_sink->OnDeviceStateChanged(pwstrDeviceId, dwNewState);
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DeviceNotificationClient::OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId)
+{
+    if (flow == eAll)
+        return S_OK;
+
+    MicVol::DeviceRole deviceRole = role == eConsole ? MicVol::DeviceRole::Console
+                                    : role == eMultimedia ? MicVol::DeviceRole::Multimedia
+                                                          : MicVol::DeviceRole::Communications;
+    m_sink->OnDefaultDeviceChanged(flow == eCapture ? MicVol::DataFlow::Capture : MicVol::DataFlow::Render,
+                                   deviceRole, pwstrDefaultDeviceId ? pwstrDefaultDeviceId : L"");
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DeviceNotificationClient::OnPropertyValueChanged(LPCWSTR pwstrDeviceId, const PROPERTYKEY key)
+{
+    if (pwstrDeviceId && IsEqualPropertyKey(key, PKEY_Device_FriendlyName))
+        m_sink->OnDevicePropertyChanged(pwstrDeviceId);
+    return S_OK;
+}
+
+// WasapiBackend
+
+HRESULT WasapiBackend::Initialize()
+{
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr))
+        return hr;
+    m_comInitialized = true;
+
+    IMMDeviceEnumerator *pEnumerator = NULL;
+    hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL,
+                          __uuidof(IMMDeviceEnumerator), (void **)&pEnumerator);
+    if (FAILED(hr))
+    {
+        Uninitialize();
+        return hr;
+    }
+
+    AcquireSRWLockExclusive(&m_enumeratorLock);
+    IMMDeviceEnumerator *pPrevious = m_pEnumerator;
+    m_pEnumerator = pEnumerator;
+    ReleaseSRWLockExclusive(&m_enumeratorLock);
+    if (pPrevious)
+        pPrevious->Release();
+    return hr;
+}
+
+void WasapiBackend::Uninitialize()
+{
+    UnregisterDeviceNotifications(NULL);
+
+    // A pool thread still in GetDevice() keeps its own reference
+    AcquireSRWLockExclusive(&m_enumeratorLock);
+    IMMDeviceEnumerator *pEnumerator = m_pEnumerator;
+    m_pEnumerator = NULL;
+    ReleaseSRWLockExclusive(&m_enumeratorLock);
+    if (pEnumerator)
+        pEnumerator->Release();
+    if (m_comInitialized)
+    {
+        CoUninitialize();
+        m_comInitialized = false;
+    }
+}
+
+// Also on pool threads (ActivateVolume), so it uses a reference of its own
+HRESULT WasapiBackend::GetDevice(const std::wstring &deviceId, IMMDevice **ppDevice)
+{
+    AcquireSRWLockShared(&m_enumeratorLock);
+    IMMDeviceEnumerator *pEnumerator = m_pEnumerator;
+    if (pEnumerator)
+        pEnumerator->AddRef();
+    ReleaseSRWLockShared(&m_enumeratorLock);
+    if (!pEnumerator)
+        return E_FAIL;
+
+    HRESULT hr = pEnumerator->GetDevice(deviceId.c_str(), ppDevice);
+    pEnumerator->Release();
+    return hr;
+}
+
+HRESULT WasapiBackend::EnumerateCaptureEndpoints(std::vector<std::wstring> &deviceIds)
+{
+    if (!m_pEnumerator)
+        return E_FAIL;
+
+    IMMDeviceCollection *pCollection = NULL;
+    HRESULT hr = m_pEnumerator->EnumAudioEndpoints(eCapture, DEVICE_STATE_ACTIVE, &pCollection);
+    if (FAILED(hr))
+        return hr;
+
+    UINT count = 0;
+    hr = pCollection->GetCount(&count);
+    for (UINT i = 0; SUCCEEDED(hr) && i < count; i++)
+    {
+        IMMDevice *pDevice = NULL;
+        if (SUCCEEDED(pCollection->Item(i, &pDevice)))
+        {
+            LPWSTR pwszId = NULL;
+            if (SUCCEEDED(pDevice->GetId(&pwszId)))
+            {
+                deviceIds.push_back(pwszId);
+                CoTaskMemFree(pwszId);
+            }
+            pDevice->Release();
+        }
+    }
+
+    pCollection->Release();
+    return hr;
+}
+
+HRESULT WasapiBackend::GetEndpointName(const std::wstring &deviceId, std::wstring &name)
+{
+    IMMDevice *pDevice = NULL;
+    HRESULT hr = GetDevice(deviceId, &pDevice);
+    if (FAILED(hr))
+        return hr;
+
+    IPropertyStore *pProps = NULL;
+    hr = pDevice->OpenPropertyStore(STGM_READ, &pProps);
+    if (SUCCEEDED(hr))
+    {
+        PROPVARIANT varName;
+        PropVariantInit(&varName);
+        hr = pProps->GetValue(PKEY_Device_FriendlyName, &varName);
+        if (SUCCEEDED(hr) && varName.vt == VT_LPWSTR)
+        {
+            name = varName.pwszVal;
+        }
+        else if (SUCCEEDED(hr))
+        {
+            hr = E_FAIL;
+        }
+        PropVariantClear(&varName);
+        pProps->Release();
+    }
+
+    pDevice->Release();
+    return hr;
+}
+
+HRESULT WasapiBackend::GetEndpointFormFactor(const std::wstring &deviceId, MicVol::FormFactor &formFactor)
+{
+    IMMDevice *pDevice = NULL;
+    HRESULT hr = GetDevice(deviceId, &pDevice);
+    if (FAILED(hr))
+        return hr;
+
+    IPropertyStore *pProps = NULL;
+    hr = pDevice->OpenPropertyStore(STGM_READ, &pProps);
+    if (SUCCEEDED(hr))
+    {
+        PROPVARIANT varFormFactor;
+        PropVariantInit(&varFormFactor);
+        hr = pProps->GetValue(FormFactorKey, &varFormFactor);
+        if (SUCCEEDED(hr) && varFormFactor.vt == VT_UI4 && varFormFactor.ulVal <= (ULONG)UnknownFormFactor)
+        {
+            formFactor = (MicVol::FormFactor)varFormFactor.ulVal;
+        }
+        else if (SUCCEEDED(hr))
+        {
+            formFactor = MicVol::FormFactor::UnknownFormFactor;
+        }
+        PropVariantClear(&varFormFactor);
+        pProps->Release();
+    }
+
+    pDevice->Release();
+    return hr;
+}
+
+HRESULT WasapiBackend::GetEndpointState(const std::wstring &deviceId, MicVol::DataFlow &flow, unsigned &state)
+{
+    IMMDevice *pDevice = NULL;
+    HRESULT hr = GetDevice(deviceId, &pDevice);
+    if (FAILED(hr))
+        return hr;
+
+    DWORD deviceState = 0;
+    hr = pDevice->GetState(&deviceState);
+    if (SUCCEEDED(hr))
+    {
+        IMMEndpoint *pEndpoint = NULL;
+        hr = pDevice->QueryInterface(__uuidof(IMMEndpoint), (void **)&pEndpoint);
+        if (SUCCEEDED(hr))
+        {
+            EDataFlow dataFlow = eRender;
+            hr = pEndpoint->GetDataFlow(&dataFlow);
+            flow = dataFlow == eCapture ? MicVol::DataFlow::Capture : MicVol::DataFlow::Render;
+            state = deviceState;
+            pEndpoint->Release();
+        }
+    }
+
+    pDevice->Release();
+    return hr;
+}
+
+HRESULT WasapiBackend::GetDefaultCaptureEndpoint(std::wstring &deviceId)
+{
+    if (!m_pEnumerator)
+        return E_FAIL;
+
+    IMMDevice *pDevice = NULL;
+    HRESULT hr = m_pEnumerator->GetDefaultAudioEndpoint(eCapture, eConsole, &pDevice);
+    if (hr == E_NOTFOUND)
+    {
+        deviceId.clear();
+        return S_FALSE;
+    }
+    if (FAILED(hr))
+        return hr;
+
+    LPWSTR pwszId = NULL;
+    hr = pDevice->GetId(&pwszId);
+    if (SUCCEEDED(hr))
+    {
+        deviceId = pwszId;
+        CoTaskMemFree(pwszId);
+    }
+
+    pDevice->Release();
+    return hr;
+}
+
+HRESULT WasapiBackend::RegisterDeviceNotifications(MicVol::DeviceNotificationSink *sink)
+{
+    if (!m_pEnumerator)
+        return E_FAIL;
+    if (m_pNotificationClient)
+        return E_FAIL;
+
+    m_pNotificationClient = new DeviceNotificationClient(sink);
+    HRESULT hr = m_pEnumerator->RegisterEndpointNotificationCallback(m_pNotificationClient);
+    if (FAILED(hr))
+    {
+        m_pNotificationClient->Release();
+        m_pNotificationClient = NULL;
+    }
+    return hr;
+}
+
+// Only one sink is supported, so the argument is not needed to find the registration
+HRESULT WasapiBackend::UnregisterDeviceNotifications(MicVol::DeviceNotificationSink *)
+{
+    if (!m_pNotificationClient)
+        return S_FALSE;
+
+    HRESULT hr = m_pEnumerator->UnregisterEndpointNotificationCallback(m_pNotificationClient);
+    m_pNotificationClient->Release();
+    m_pNotificationClient = NULL;
+    return hr;
+}
+
+HRESULT WasapiBackend::ActivateVolume(const std::wstring &deviceId, std::shared_ptr<MicVol::VolumeEndpoint> &endpoint)
+{
+    IMMDevice *pDevice = NULL;
+    HRESULT hr = GetDevice(deviceId, &pDevice);
+    if (FAILED(hr))
+        return hr;
+
+    IAudioEndpointVolume *pEndpointVolume = NULL;
+    hr = pDevice->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_ALL, NULL, (void **)&pEndpointVolume);
+    if (SUCCEEDED(hr))
+    {
+        endpoint = std::make_shared<WasapiVolumeEndpoint>(pEndpointVolume);
+    }
+
+    pDevice->Release();
+    return hr;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <windows.h>
+#include <mmdeviceapi.h>
+#include <endpointvolume.h>
+#include "core/AudioBackend.h"
+
+// Forwards IAudioEndpointVolume change notifications to the portable listener
+class EndpointVolumeCallback : public IAudioEndpointVolumeCallback
+{
+private:
+    LONG m_refCount = 1;
+    MicVol::VolumeListener *m_listener;
+
+public:
+    explicit EndpointVolumeCallback(MicVol::VolumeListener *listener) : m_listener(listener) {}
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    // Runs on an audio service thread: only hand the data over, never touch the endpoint here
+    HRESULT STDMETHODCALLTYPE OnNotify(PAUDIO_VOLUME_NOTIFICATION_DATA pNotify) override;
+};
+
+// IAudioEndpointVolume wrapped for the portable core
+class WasapiVolumeEndpoint : public MicVol::VolumeEndpoint
+{
+private:
+    IAudioEndpointVolume *m_pEndpointVolume;
+    EndpointVolumeCallback *m_pCallback = NULL;
+
+public:
+    // Takes over the caller's reference
+    explicit WasapiVolumeEndpoint(IAudioEndpointVolume *pEndpointVolume) : m_pEndpointVolume(pEndpointVolume) {}
+    ~WasapiVolumeEndpoint() override;
+
+    HRESULT GetMasterVolume(float *level) override;
+    HRESULT SetMasterVolume(float level) override;
+    HRESULT GetMute(bool *muted) override;
+    HRESULT SetMute(bool muted) override;
+    HRESULT RegisterListener(MicVol::VolumeListener *listener) override;
+    HRESULT UnregisterListener(MicVol::VolumeListener *listener) override;
+};
+
+// Forwards IMMNotificationClient callbacks to the portable sink
+class DeviceNotificationClient : public IMMNotificationClient
+{
+private:
+    LONG m_refCount = 1;
+    MicVol::DeviceNotificationSink *m_sink;
+
+public:
+    explicit DeviceNotificationClient(MicVol::DeviceNotificationSink *sink) : m_sink(sink) {}
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR pwstrDeviceId) override;
+    HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR pwstrDeviceId) override;
+    HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState) override;
+    HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId) override;
+    HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR pwstrDeviceId, const PROPERTYKEY key) override;
+};
+
+// Core Audio (MMDevice API) implementation of the audio backend.
+// Initialize() joins the multithreaded apartment and creates the device enumerator once.
+// ActivateVolume() may run on pool threads, so the enumerator is swapped under a lock
+// and they hold their own reference while they use it.
+class WasapiBackend : public MicVol::AudioBackend
+{
+private:
+    IMMDeviceEnumerator *m_pEnumerator = NULL; // Written under m_enumeratorLock, by the worker only
+    SRWLOCK m_enumeratorLock = SRWLOCK_INIT;
+    DeviceNotificationClient *m_pNotificationClient = NULL;
+    bool m_comInitialized = false;
+
+    HRESULT GetDevice(const std::wstring &deviceId, IMMDevice **ppDevice);
+
+public:
+    ~WasapiBackend() override { Uninitialize(); }
+
+    HRESULT Initialize() override;
+    void Uninitialize() override;
+    HRESULT EnumerateCaptureEndpoints(std::vector<std::wstring> &deviceIds) override;
+    HRESULT GetEndpointName(const std::wstring &deviceId, std::wstring &name) override;
+    HRESULT GetEndpointFormFactor(const std::wstring &deviceId, MicVol::FormFactor &formFactor) override;
+    HRESULT GetEndpointState(const std::wstring &deviceId, MicVol::DataFlow &flow, unsigned &state) override;
+    HRESULT GetDefaultCaptureEndpoint(std::wstring &deviceId) override;
+    HRESULT RegisterDeviceNotifications(MicVol::DeviceNotificationSink *sink) override;
+    HRESULT UnregisterDeviceNotifications(MicVol::DeviceNotificationSink *sink) override;
+    HRESULT ActivateVolume(const std::wstring &deviceId, std::shared_ptr<MicVol::VolumeEndpoint> &endpoint) override;
+};
@@ -0,0 +1,356 @@
+#include "WasapiSessions.h"
+
+// SessionEventsCallback
+
+HRESULT STDMETHODCALLTYPE SessionEventsCallback::QueryInterface(REFIID riid, void **ppvObject)
+{
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IAudioSessionEvents))
+    {
+        *ppvObject = static_cast<IAudioSessionEvents *>(this);
+        AddRef();
+        return S_OK;
+    }
+    *ppvObject = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE SessionEventsCallback::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+ULONG STDMETHODCALLTYPE SessionEventsCallback::Release()
+{
+    ULONG newRef = InterlockedDecrement(&m_refCount);
+    if (newRef == 0)
+    {
+        delete this;
+    }
+    return newRef;
+}
+
+HRESULT STDMETHODCALLTYPE SessionEventsCallback::OnSimpleVolumeChanged(float NewVolume, BOOL NewMute, LPCGUID EventContext)
+{
+    m_listener->OnSessionVolumeChanged(NewVolume, NewMute != FALSE, EventContext ? *EventContext : GUID{});
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SessionEventsCallback::OnStateChanged(AudioSessionState NewState)
+{
+    // Inactive sessions keep their volume; only an expired one is gone for good
+    if (NewState == AudioSessionStateExpired)
+        m_listener->OnSessionDisconnected();
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE SessionEventsCallback::OnSessionDisconnected(AudioSessionDisconnectReason)
+{
+    m_listener->OnSessionDisconnected();
+    return S_OK;
+}
+
+// WasapiSessionControl
+
+WasapiSessionControl::~WasapiSessionControl()
+{
+    UnregisterListener(NULL);
+    m_pVolume->Release();
+    m_pControl->Release();
+}
+
+HRESULT WasapiSessionControl::Create(IAudioSessionControl *pSession, std::shared_ptr<MicVol::SessionControl> &control)
+{
+    IAudioSessionControl2 *pControl = NULL;
+    HRESULT hr = pSession->QueryInterface(__uuidof(IAudioSessionControl2), (void **)&pControl);
+    if (FAILED(hr))
+        return hr;
+
+    ISimpleAudioVolume *pVolume = NULL;
+    hr = pSession->QueryInterface(__uuidof(ISimpleAudioVolume), (void **)&pVolume);
+    if (FAILED(hr))
+    {
+        pControl->Release();
+        return hr;
+    }
+
+    control = std::make_shared<WasapiSessionControl>(pControl, pVolume);
+    return S_OK;
+}
+
+HRESULT WasapiSessionControl::GetInstanceId(std::wstring &instanceId)
+{
+    LPWSTR pwszId = NULL;
+    HRESULT hr = m_pControl->GetSessionInstanceIdentifier(&pwszId);
+    if (SUCCEEDED(hr))
+    {
+        instanceId = pwszId;
+        CoTaskMemFree(pwszId);
+    }
+    return hr;
+}
+
+HRESULT WasapiSessionControl::GetProcessId(uint32_t *processId)
+{
+    DWORD pid = 0;
+    HRESULT hr = m_pControl->GetProcessId(&pid);
+    // AUDCLNT_S_NO_SINGLE_PROCESS: a cross-process session reports its first process
+    if (SUCCEEDED(hr))
+        *processId = pid;
+    return hr;
+}
+
+HRESULT WasapiSessionControl::GetVolume(float *level)
+{
+    return m_pVolume->GetMasterVolume(level);
+}
+
+HRESULT WasapiSessionControl::SetVolume(float level)
+{
+    return m_pVolume->SetMasterVolume(level, &MicVol::ServiceEventContext);
+}
+
+HRESULT WasapiSessionControl::GetMute(bool *muted)
+{
+    BOOL bMuted = FALSE;
+    HRESULT hr = m_pVolume->GetMute(&bMuted);
+    if (SUCCEEDED(hr))
+        *muted = bMuted != FALSE;
+    return hr;
+}
+
+HRESULT WasapiSessionControl::SetMute(bool muted)
+{
+    return m_pVolume->SetMute(muted ? TRUE : FALSE, &MicVol::ServiceEventContext);
+}
+
+HRESULT WasapiSessionControl::RegisterListener(MicVol::SessionListener *listener)
+{
+    if (m_pCallback)
+        return E_FAIL;
+
+    m_pCallback = new SessionEventsCallback(listener);
+    HRESULT hr = m_pControl->RegisterAudioSessionNotification(m_pCallback);
+    if (FAILED(hr))
+    {
+        m_pCallback->Release();
+        m_pCallback = NULL;
+    }
+    return hr;
+}
+
+HRESULT WasapiSessionControl::UnregisterListener(MicVol::SessionListener *)
+{
+    if (!m_pCallback)
+        return S_FALSE;
+
+    HRESULT hr = m_pControl->UnregisterAudioSessionNotification(m_pCallback);
+    m_pCallback->Release();
+    m_pCallback = NULL;
+    return hr;
+}
+
+// SessionNotificationClient
+
+HRESULT STDMETHODCALLTYPE SessionNotificationClient::QueryInterface(REFIID riid, void **ppvObject)
+{
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IAudioSessionNotification))
+    {
+        *ppvObject = static_cast<IAudioSessionNotification *>(this);
+        AddRef();
+        return S_OK;
+    }
+    *ppvObject = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE SessionNotificationClient::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+ULONG STDMETHODCALLTYPE SessionNotificationClient::Release()
+{
+    ULONG newRef = InterlockedDecrement(&m_refCount);
+    if (newRef == 0)
+    {
+        delete this;
+    }
+    return newRef;
+}
+
+HRESULT STDMETHODCALLTYPE SessionNotificationClient::OnSessionCreated(IAudioSessionControl *NewSession)
+{
+    std::shared_ptr<MicVol::SessionControl> control;
+    if (NewSession && SUCCEEDED(WasapiSessionControl::Create(NewSession, control)))
+        m_sink->OnSessionCreated(m_endpointId, control);
+    return S_OK;
+}
+
+// WasapiSessionManager
+
+HRESULT WasapiSessionManager::Initialize()
+{
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr))
+        return hr;
+    m_comInitialized = true;
+
+    hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL,
+                          __uuidof(IMMDeviceEnumerator), (void **)&m_pEnumerator);
+    if (FAILED(hr))
+    {
+        m_pEnumerator = NULL;
+        Uninitialize();
+    }
+    return hr;
+}
+
+void WasapiSessionManager::Uninitialize()
+{
+    while (!m_watches.empty())
+    {
+        UnwatchEndpoint(m_watches.begin()->first);
+    }
+    if (m_pEnumerator)
+    {
+        m_pEnumerator->Release();
+        m_pEnumerator = NULL;
+    }
+    if (m_comInitialized)
+    {
+        CoUninitialize();
+        m_comInitialized = false;
+    }
+}
+
+HRESULT WasapiSessionManager::EnumerateEndpoints(MicVol::DataFlow flow, std::vector<std::wstring> &endpointIds)
+{
+    if (!m_pEnumerator)
+        return E_FAIL;
+
+    IMMDeviceCollection *pCollection = NULL;
+    HRESULT hr = m_pEnumerator->EnumAudioEndpoints(flow == MicVol::DataFlow::Capture ? eCapture : eRender,
+                                                   DEVICE_STATE_ACTIVE, &pCollection);
+    if (FAILED(hr))
+        return hr;
+
+    UINT count = 0;
+    hr = pCollection->GetCount(&count);
+    for (UINT i = 0; SUCCEEDED(hr) && i < count; i++)
+    {
+        IMMDevice *pDevice = NULL;
+        if (SUCCEEDED(pCollection->Item(i, &pDevice)))
+        {
+            LPWSTR pwszId = NULL;
+            if (SUCCEEDED(pDevice->GetId(&pwszId)))
+            {
+                endpointIds.push_back(pwszId);
+                CoTaskMemFree(pwszId);
+            }
+            pDevice->Release();
+        }
+    }
+
+    pCollection->Release();
+    return hr;
+}
+
+HRESULT WasapiSessionManager::WatchEndpoint(const std::wstring &endpointId, MicVol::SessionCreatedSink *sink,
+                                            std::vector<std::shared_ptr<MicVol::SessionControl>> &existing)
+{
+    if (!m_pEnumerator)
+        return E_FAIL;
+    if (m_watches.count(endpointId))
+        return E_FAIL;
+
+    IMMDevice *pDevice = NULL;
+    HRESULT hr = m_pEnumerator->GetDevice(endpointId.c_str(), &pDevice);
+    if (FAILED(hr))
+        return hr;
+
+    IAudioSessionManager2 *pManager = NULL;
+    hr = pDevice->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, NULL, (void **)&pManager);
+    pDevice->Release();
+    if (FAILED(hr))
+        return hr;
+
+    // Register before enumerating so no session falls in between; duplicates are filtered by the caller
+    SessionNotificationClient *pClient = new SessionNotificationClient(endpointId, sink);
+    hr = pManager->RegisterSessionNotification(pClient);
+    if (FAILED(hr))
+    {
+        pClient->Release();
+        pManager->Release();
+        return hr;
+    }
+    m_watches[endpointId] = {pManager, pClient};
+
+    // The enumeration also starts the notifications, which are not delivered before the first one
+    IAudioSessionEnumerator *pSessions = NULL;
+    hr = pManager->GetSessionEnumerator(&pSessions);
+    if (FAILED(hr))
+    {
+        UnwatchEndpoint(endpointId);
+        return hr;
+    }
+
+    int count = 0;
+    hr = pSessions->GetCount(&count);
+    for (int i = 0; SUCCEEDED(hr) && i < count; i++)
+    {
+        IAudioSessionControl *pSession = NULL;
+        if (SUCCEEDED(pSessions->GetSession(i, &pSession)))
+        {
+            std::shared_ptr<MicVol::SessionControl> control;
+            if (SUCCEEDED(WasapiSessionControl::Create(pSession, control)))
+                existing.push_back(control);
+            pSession->Release();
+        }
+    }
+
+    pSessions->Release();
+    return hr;
+}
+
+void WasapiSessionManager::UnwatchEndpoint(const std::wstring &endpointId)
+{
+    auto it = m_watches.find(endpointId);
+    if (it == m_watches.end())
+        return;
+
+    it->second.pManager->UnregisterSessionNotification(it->second.pClient);
+    it->second.pClient->Release();
+    it->second.pManager->Release();
+    m_watches.erase(it);
+}
+
+HRESULT WasapiSessionManager::GetProcessName(uint32_t processId, std::wstring &name)
+{
+    // The system sounds session
+    if (processId == 0)
+    {
+        name = L"System";
+        return S_OK;
+    }
+
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!hProcess)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    wchar_t path[MAX_PATH];
+    DWORD length = MAX_PATH;
+    HRESULT hr = S_OK;
+    if (QueryFullProcessImageNameW(hProcess, 0, path, &length))
+    {
+        std::wstring fullPath(path, length);
+        size_t slash = fullPath.find_last_of(L"\\/");
+        name = slash == std::wstring::npos ? fullPath : fullPath.substr(slash + 1);
+    }
+    else
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    CloseHandle(hProcess);
+    return hr;
+}
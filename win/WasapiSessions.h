@@ -0,0 +1,107 @@
+#pragma once
+#include <windows.h>
+#include <mmdeviceapi.h>
+#include <audiopolicy.h>
+#include <map>
+#include "core/SessionManager.h"
+#include "core/VolumeEndpoint.h"
+
+// Forwards IAudioSessionEvents callbacks to the portable listener
+class SessionEventsCallback : public IAudioSessionEvents
+{
+private:
+    LONG m_refCount = 1;
+    MicVol::SessionListener *m_listener;
+
+public:
+    explicit SessionEventsCallback(MicVol::SessionListener *listener) : m_listener(listener) {}
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    HRESULT STDMETHODCALLTYPE OnDisplayNameChanged(LPCWSTR, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnIconPathChanged(LPCWSTR, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnSimpleVolumeChanged(float NewVolume, BOOL NewMute, LPCGUID EventContext) override;
+    HRESULT STDMETHODCALLTYPE OnChannelVolumeChanged(DWORD, float[], DWORD, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnGroupingParamChanged(LPCGUID, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnStateChanged(AudioSessionState NewState) override;
+    HRESULT STDMETHODCALLTYPE OnSessionDisconnected(AudioSessionDisconnectReason DisconnectReason) override;
+};
+
+// IAudioSessionControl2 and ISimpleAudioVolume of one session wrapped for the portable core
+class WasapiSessionControl : public MicVol::SessionControl
+{
+private:
+    IAudioSessionControl2 *m_pControl;
+    ISimpleAudioVolume *m_pVolume;
+    SessionEventsCallback *m_pCallback = NULL;
+
+public:
+    // Takes over the caller's references
+    WasapiSessionControl(IAudioSessionControl2 *pControl, ISimpleAudioVolume *pVolume)
+        : m_pControl(pControl), m_pVolume(pVolume)
+    {
+    }
+    ~WasapiSessionControl() override;
+
+    HRESULT GetInstanceId(std::wstring &instanceId) override;
+    HRESULT GetProcessId(uint32_t *processId) override;
+    HRESULT GetVolume(float *level) override;
+    HRESULT SetVolume(float level) override;
+    HRESULT GetMute(bool *muted) override;
+    HRESULT SetMute(bool muted) override;
+    HRESULT RegisterListener(MicVol::SessionListener *listener) override;
+    HRESULT UnregisterListener(MicVol::SessionListener *listener) override;
+
+    // Wraps a session control handed out by the session manager; adds its own references
+    static HRESULT Create(IAudioSessionControl *pSession, std::shared_ptr<MicVol::SessionControl> &control);
+};
+
+// Forwards IAudioSessionNotification callbacks of one endpoint to the portable sink
+class SessionNotificationClient : public IAudioSessionNotification
+{
+private:
+    LONG m_refCount = 1;
+    std::wstring m_endpointId;
+    MicVol::SessionCreatedSink *m_sink;
+
+public:
+    SessionNotificationClient(const std::wstring &endpointId, MicVol::SessionCreatedSink *sink)
+        : m_endpointId(endpointId), m_sink(sink)
+    {
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    HRESULT STDMETHODCALLTYPE OnSessionCreated(IAudioSessionControl *NewSession) override;
+};
+
+// IAudioSessionManager2 implementation of the session manager.
+// Initialize() joins the multithreaded apartment and creates its own device enumerator.
+class WasapiSessionManager : public MicVol::SessionManager
+{
+private:
+    struct Watch
+    {
+        IAudioSessionManager2 *pManager;
+        SessionNotificationClient *pClient;
+    };
+
+    IMMDeviceEnumerator *m_pEnumerator = NULL;
+    std::map<std::wstring, Watch> m_watches;
+    bool m_comInitialized = false;
+
+public:
+    ~WasapiSessionManager() override { Uninitialize(); }
+
+    HRESULT Initialize() override;
+    void Uninitialize() override;
+    HRESULT EnumerateEndpoints(MicVol::DataFlow flow, std::vector<std::wstring> &endpointIds) override;
+    HRESULT WatchEndpoint(const std::wstring &endpointId, MicVol::SessionCreatedSink *sink,
+                          std::vector<std::shared_ptr<MicVol::SessionControl>> &existing) override;
+    void UnwatchEndpoint(const std::wstring &endpointId) override;
+    HRESULT GetProcessName(uint32_t processId, std::wstring &name) override;
+};
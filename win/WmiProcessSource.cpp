@@ -0,0 +1,163 @@
+#include "WmiProcessSource.h"
+#include <tlhelp32.h>
+
+#pragma comment(lib, "wbemuuid.lib")
+
+// ProcessTraceSink
+
+HRESULT STDMETHODCALLTYPE ProcessTraceSink::QueryInterface(REFIID riid, void **ppvObject)
+{
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IWbemObjectSink))
+    {
+        *ppvObject = static_cast<IWbemObjectSink *>(this);
+        AddRef();
+        return S_OK;
+    }
+    *ppvObject = NULL;
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE ProcessTraceSink::AddRef()
+{
+    return InterlockedIncrement(&m_refCount);
+}
+
+ULONG STDMETHODCALLTYPE ProcessTraceSink::Release()
+{
+    ULONG newRef = InterlockedDecrement(&m_refCount);
+    if (newRef == 0)
+    {
+        delete this;
+    }
+    return newRef;
+}
+
+HRESULT STDMETHODCALLTYPE ProcessTraceSink::Indicate(LONG lObjectCount, IWbemClassObject **apObjArray)
+{
+    for (LONG i = 0; i < lObjectCount; i++)
+    {
+        VARIANT varId;
+        VariantInit(&varId);
+        if (FAILED(apObjArray[i]->Get(L"ProcessID", 0, &varId, NULL, NULL)) ||
+            (varId.vt != VT_I4 && varId.vt != VT_UI4))
+        {
+            VariantClear(&varId);
+            continue;
+        }
+        uint32_t processId = varId.vt == VT_I4 ? (uint32_t)varId.lVal : varId.ulVal;
+        VariantClear(&varId);
+
+        if (!m_starts)
+        {
+            m_sink->OnProcessExited(processId);
+            continue;
+        }
+
+        VARIANT varName;
+        VariantInit(&varName);
+        if (SUCCEEDED(apObjArray[i]->Get(L"ProcessName", 0, &varName, NULL, NULL)) && varName.vt == VT_BSTR)
+            m_sink->OnProcessStarted(processId, varName.bstrVal);
+        VariantClear(&varName);
+    }
+    return WBEM_S_NO_ERROR;
+}
+
+// WmiProcessSource
+
+HRESULT WmiProcessSource::Subscribe(const wchar_t *query, ProcessTraceSink *pSink)
+{
+    BSTR language = SysAllocString(L"WQL");
+    BSTR text = SysAllocString(query);
+    HRESULT hr = m_pServices->ExecNotificationQueryAsync(language, text, WBEM_FLAG_SEND_STATUS, NULL, pSink);
+    SysFreeString(text);
+    SysFreeString(language);
+    return hr;
+}
+
+HRESULT WmiProcessSource::Start(MicVol::ProcessEventSink *sink, std::vector<MicVol::RunningProcess> &running)
+{
+    if (m_pServices)
+        return E_FAIL;
+
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hr))
+        return hr;
+    m_comInitialized = true;
+
+    IWbemLocator *pLocator = NULL;
+    hr = CoCreateInstance(CLSID_WbemLocator, NULL, CLSCTX_INPROC_SERVER, IID_IWbemLocator, (void **)&pLocator);
+    if (SUCCEEDED(hr))
+    {
+        BSTR resource = SysAllocString(L"ROOT\\CIMV2");
+        hr = pLocator->ConnectServer(resource, NULL, NULL, NULL, 0, NULL, NULL, &m_pServices);
+        SysFreeString(resource);
+        pLocator->Release();
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = CoSetProxyBlanket(m_pServices, RPC_C_AUTHN_WINNT, RPC_C_AUTHZ_NONE, NULL, RPC_C_AUTHN_LEVEL_CALL,
+                               RPC_C_IMP_LEVEL_IMPERSONATE, NULL, EOAC_NONE);
+    }
+
+    // Subscribe before taking the snapshot so no process falls in between
+    if (SUCCEEDED(hr))
+    {
+        m_pStartSink = new ProcessTraceSink(sink, true);
+        hr = Subscribe(L"SELECT ProcessID, ProcessName FROM Win32_ProcessStartTrace", m_pStartSink);
+    }
+    if (SUCCEEDED(hr))
+    {
+        m_pStopSink = new ProcessTraceSink(sink, false);
+        hr = Subscribe(L"SELECT ProcessID FROM Win32_ProcessStopTrace", m_pStopSink);
+    }
+    if (FAILED(hr))
+    {
+        Stop();
+        return hr;
+    }
+
+    HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (hSnapshot == INVALID_HANDLE_VALUE)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Stop();
+        return hr;
+    }
+
+    PROCESSENTRY32W entry;
+    entry.dwSize = sizeof(entry);
+    for (BOOL more = Process32FirstW(hSnapshot, &entry); more; more = Process32NextW(hSnapshot, &entry))
+    {
+        running.push_back({entry.th32ProcessID, entry.szExeFile});
+    }
+    CloseHandle(hSnapshot);
+    return S_OK;
+}
+
+void WmiProcessSource::Stop()
+{
+    if (m_pServices)
+    {
+        if (m_pStartSink)
+            m_pServices->CancelAsyncCall(m_pStartSink);
+        if (m_pStopSink)
+            m_pServices->CancelAsyncCall(m_pStopSink);
+        m_pServices->Release();
+        m_pServices = NULL;
+    }
+    if (m_pStartSink)
+    {
+        m_pStartSink->Release();
+        m_pStartSink = NULL;
+    }
+    if (m_pStopSink)
+    {
+        m_pStopSink->Release();
+        m_pStopSink = NULL;
+    }
+    if (m_comInitialized)
+    {
+        CoUninitialize();
+        m_comInitialized = false;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <windows.h>
+#include <wbemidl.h>
+#include "core/ProcessSource.h"
+
+// Receives Win32_ProcessStartTrace or Win32_ProcessStopTrace events and forwards them
+class ProcessTraceSink : public IWbemObjectSink
+{
+private:
+    LONG m_refCount = 1;
+    MicVol::ProcessEventSink *m_sink;
+    bool m_starts; // Start trace, otherwise stop trace
+
+public:
+    ProcessTraceSink(MicVol::ProcessEventSink *sink, bool starts) : m_sink(sink), m_starts(starts) {}
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+    HRESULT STDMETHODCALLTYPE Indicate(LONG lObjectCount, IWbemClassObject **apObjArray) override;
+    HRESULT STDMETHODCALLTYPE SetStatus(LONG, HRESULT, BSTR, IWbemClassObject *) override { return WBEM_S_NO_ERROR; }
+};
+
+// Process start and exit events from the kernel process traces exposed by WMI.
+// They are pushed by the system, so nothing polls while no process starts or exits.
+// Needs administrator rights, which the service has.
+class WmiProcessSource : public MicVol::ProcessSource
+{
+private:
+    IWbemServices *m_pServices = NULL;
+    ProcessTraceSink *m_pStartSink = NULL;
+    ProcessTraceSink *m_pStopSink = NULL;
+    bool m_comInitialized = false;
+
+    HRESULT Subscribe(const wchar_t *query, ProcessTraceSink *pSink);
+
+public:
+    ~WmiProcessSource() override { Stop(); }
+
+    HRESULT Start(MicVol::ProcessEventSink *sink, std::vector<MicVol::RunningProcess> &running) override;
+    void Stop() override;
+};